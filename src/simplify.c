@@ -22,8 +22,20 @@
 #include "flags/flags.h"
 
 #include "simplify/expression/evaluate.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/memo.h"
+#include "simplify/expression/call_cache.h"
+#include "simplify/expression/call_stack.h"
+#include "simplify/expression/symbol.h"
+#include "simplify/expression/thread_pool.h"
+#include "simplify/expression/value_cache.h"
 #include "simplify/expression/simplify.h"
 #include "simplify/expression/isolate.h"
+#include "simplify/expression/solve.h"
+#include "simplify/expression/rewrite.h"
+#include "simplify/expression/egraph.h"
+#include "simplify/expression/fixpoint.h"
+#include "simplify/expression/cse.h"
 #include "simplify/expression/stringify.h"
 
 #define VERSION "0.1.2"
@@ -39,6 +51,17 @@
 static gmp_randstate_t _g_rand_state;
 static bool            _g_rand_state_initialized;
 static mpfr_ptr        _g_eulers_constant;
+static rewrite_rules_t _g_rewrite_rules;
+static egraph_cost_t   _g_saturate_cost;
+
+/* the work done simplifying every result */
+static expression_fixpoint_stats_t _g_fixpoint_stats;
+
+/* if true repeated subexpressions are only evaluated once, see `--cse` */
+static bool                   _g_cse;
+
+/* the work saved by evaluating repeated subexpressions once */
+static expression_cse_stats_t _g_cse_stats;
 
 void usage(char* arg0) {
     puts(INFO);
@@ -50,6 +73,65 @@ void usage(char* arg0) {
     puts("\t-d,--define NAME=EXPR ......... define a variable `NAME' as `EXPR'");
     puts("\t-i,--isolate NAME ............. if the variable `NAME' exists than attempt to isolate it");
     puts("\t-f,--file FILE ................ execute the file `FILE' before any expression(s)");
+    puts("\t-a,--adaptive DIGITS .......... raise the working precision until the result's bounds agree to `DIGITS' digits");
+    puts("\t-p,--precision BITS ........... compute every result with `BITS' bits of precision");
+    puts("\t-n,--digits DIGITS ............ print `DIGITS' significant digits, and compute with enough precision to do so");
+    puts("\t-m,--memoize .................. reuse the results of repeated subexpressions, until a variable they use changes");
+    puts("\t-c,--cache SIZE ............... remember the results of up to `SIZE' pure function calls (0 disables the cache)");
+    puts("\t-u,--pure NAME ................ cache calls to the function `NAME', even if it uses variables that may change");
+    puts("\t-l,--recursion-limit DEPTH .... fail if function calls or variable substitutions are nested more than `DEPTH' deep");
+    puts("\t-r,--reactive ................. remember the values of variables, until a name they use is redefined");
+    puts("\t-j,--jobs THREADS ............. evaluate expensive independent subexpressions on up to `THREADS' threads");
+    puts("\t-s,--max-steps STEPS .......... fail if an expression takes more than `STEPS' steps to evaluate and simplify");
+    puts("\t-t,--max-time SECONDS ......... fail if an expression takes longer than `SECONDS' seconds");
+    puts("\t-b,--max-bytes BYTES .......... fail if an expression's live numbers take more than `BYTES' bytes");
+    puts("\t-x,--max-precision BITS ....... fail if an expression needs a number wider than `BITS' bits");
+    puts("\t-w,--rules FILE ............... rewrite results with the rules in `FILE', each in the form PATTERN = REPLACEMENT");
+    puts("\t-e,--saturate COST ............ search for the cheapest equal form of each result, COST is `size' or `speed'");
+    puts("\t-o,--cse ...................... evaluate subexpressions repeated in an expression, or in a list of them, only once");
+}
+
+/* make `policy` compute every result with `bits` bits, numbers parsed from then on get the same precision */
+void set_precision(precision_policy_t* policy, mpfr_prec_t bits) {
+    if (bits < MPFR_PREC_MIN)
+        bits = MPFR_PREC_MIN;
+    precision_policy_set_fixed(policy, bits);
+    mpfr_set_default_prec(bits);
+}
+
+/* make `policy` print `digits` significant digits, if the precision hasn't been chosen it's derived from `digits` */
+void set_digits(precision_policy_t* policy, size_t digits) {
+    policy->digits = digits;
+    if (!policy->minimum && digits)
+        set_precision(policy, precision_for_digits(digits) + PRECISION_GUARD_BITS);
+}
+
+/* enable or resize the scope's call cache, a size of zero disables it. The cache is emptied first, if it was in use */
+void set_call_cache_size(scope_t* scope, call_cache_t* cache, size_t size) {
+    call_cache_clean(cache);
+    if (!size) {
+        scope_set_call_cache(scope, NULL);
+        return;
+    }
+
+    call_cache_init(cache, size);
+    scope_set_call_cache(scope, cache);
+}
+
+/* evaluate expensive subexpressions on `threads` threads, one thread evaluates everything in order */
+error_t set_jobs(scope_t* scope, thread_pool_t* pool, size_t threads) {
+    if (scope->threads) {
+        thread_pool_clean(pool);
+        scope_set_thread_pool(scope, NULL);
+    }
+    if (threads <= 1)
+        return ERROR_NO_ERROR;
+
+    error_t err = thread_pool_init(pool, threads);
+    if (err) return err;
+
+    scope_set_thread_pool(scope, pool);
+    return ERROR_NO_ERROR;
 }
 
 error_t do_assignment(char* assignment, scope_t* scope) {
@@ -70,6 +152,14 @@ error_t do_assignment(char* assignment, scope_t* scope) {
 }
 
 
+/* evaluate a list of statements, sharing their repeated subexpressions if `--cse` was given */
+error_t evaluate_statements(expression_list_t* statements, scope_t* scope,
+                            expression_statement_callback_t callback, void* data) {
+    if (_g_cse)
+        return expression_cse_evaluate_statements(statements, scope, callback, data, &_g_cse_stats);
+    return expression_evaluate_statements(statements, scope, callback, data);
+}
+
 error_t execute_file(char* fname, scope_t* scope) {
     int free_fname = 0;
 
@@ -95,13 +185,10 @@ error_t execute_file(char* fname, scope_t* scope) {
     error_t err = parse_file(f, exprs);
     if (err) return err;
 
-    expression_t* expr;
-    EXPRESSION_LIST_FOREACH(expr, exprs) {
-        err = expression_evaluate(expr, scope);
-        if (err) {
-            expression_list_free(exprs);
-            return err;
-        }
+    err = evaluate_statements(exprs, scope, NULL, NULL);
+    if (err) {
+        expression_list_free(exprs);
+        return err;
     }
 
     expression_list_free(exprs);
@@ -112,22 +199,66 @@ error_t execute_file(char* fname, scope_t* scope) {
     return ERROR_NO_ERROR;
 }
 
-error_t simplify_and_print(scope_t* scope, expression_t* expr, char* isolate_target, int print) {
-    error_t err;
+/* add the rewrite rules in the file `fname` to the rules results are rewritten with */
+error_t load_rules(char* fname) {
+    FILE* f = fopen(fname, "r");
+    if (!f)
+        return ERROR_UNABLE_TO_OPEN_FILE;
 
-    err = expression_evaluate(expr, scope);
-    if (err) return err;
+    error_t err = rewrite_rules_load(&_g_rewrite_rules, f);
+    fclose(f);
+    return err;
+}
 
-    err = expression_simplify(expr);
-    if (err) return err;
+/* search for the cheapest form of each result with an e-graph, under the cost model named `name` */
+void set_saturate_cost(char* name) {
+    _g_saturate_cost = strcmp(name, "speed") == 0 ? egraph_cost_speed : egraph_cost_size;
+}
 
-    if (isolate_target) {
-        err = expression_isolate_variable(expr, isolate_target);
-        if (!err) {
-            err = expression_evaluate(expr, scope);
-            if (err) return err;
+/* evaluate an expression, adaptively if `digits` is non-zero */
+error_t evaluate(scope_t* scope, expression_t* expr, size_t digits) {
+    if (digits)
+        return expression_evaluate_adaptive(expr, scope, digits);
+    if (_g_cse)
+        return expression_cse_evaluate(expr, scope, &_g_cse_stats);
+    return expression_evaluate(expr, scope);
+}
+
+/* how the result of each expression is shown */
+typedef struct {
+    scope_t* scope;
+    char*    isolate_target;
+    size_t   digits;
+    int      print;
+} print_options_t;
+
+/* simplify an evaluated expression, and print it */
+error_t print_evaluated(scope_t* scope, expression_t* expr, char* isolate_target, size_t digits, int print) {
+    error_t err;
+    budget_t* budget = scope_get_budget(scope);
+
+    if (budget) budget_enter(budget);
+    expression_fixpoint_stats_t stats;
+    err = expression_simplify_fixpoint(expr, &_g_rewrite_rules, &stats);
+    _g_fixpoint_stats.iterations += stats.iterations;
+    _g_fixpoint_stats.visited    += stats.visited;
+    _g_fixpoint_stats.skipped    += stats.skipped;
+    if (!err && _g_saturate_cost)
+        err = egraph_simplify(expr, &_g_rewrite_rules, NULL, _g_saturate_cost);
+    if (!err && isolate_target) {
+        /* variables that can't be isolated symbolically are solved for numerically */
+        err = expression_isolate_variable_numeric(expr, isolate_target, scope, NULL);
+        if (err == ERROR_BUDGET_EXCEEDED) {
+            /* running out of budget is an error, not being able to isolate the variable isn't */
+        } else if (!err) {
+            err = evaluate(scope, expr, digits);
+        } else {
+            err = ERROR_NO_ERROR;
         }
     }
+    if (budget) budget_leave(budget);
+    if (err) return err;
+
     if (print) {
         expression_result_t result = expression_evaluate_comparisons(expr);
         if (result == EXPRESSION_RESULT_TRUE) {
@@ -135,7 +266,7 @@ error_t simplify_and_print(scope_t* scope, expression_t* expr, char* isolate_tar
         } else if (result == EXPRESSION_RESULT_FALSE) {
             puts(FALSE_STRING);
         } else {
-            expression_print(expr);
+            expression_fprint_digits(expr, stdout, digits ? digits : scope_get_precision_policy(scope)->digits);
             puts("");
         }
     }
@@ -143,6 +274,25 @@ error_t simplify_and_print(scope_t* scope, expression_t* expr, char* isolate_tar
     return ERROR_NO_ERROR;
 }
 
+error_t simplify_and_print(scope_t* scope, expression_t* expr, char* isolate_target, size_t digits, int print) {
+    /* the budget covers evaluating and simplifying the expression together */
+    budget_t* budget = scope_get_budget(scope);
+    if (budget) budget_enter(budget);
+
+    error_t err = evaluate(scope, expr, digits);
+    if (!err)
+        err = print_evaluated(scope, expr, isolate_target, digits, print);
+
+    if (budget) budget_leave(budget);
+    return err;
+}
+
+/* print a statement evaluated by expression_evaluate_statements */
+error_t print_statement(expression_t* expr, void* data) {
+    print_options_t* options = data;
+    return print_evaluated(options->scope, expr, options->isolate_target, options->digits, options->print);
+}
+
 DEFINE_MPFR_FUNCTION(cos)
 DEFINE_MPFR_FUNCTION(sin)
 DEFINE_MPFR_FUNCTION(tan)
@@ -177,18 +327,16 @@ DEFINE_MPFR_CONST(euler)
 DEFINE_MPFR_CONST(catalan)
 
 error_t builtin_func_random(scope_t* scope, expression_t** out) {
-    (void)scope;
-
     if (!_g_rand_state_initialized) {
         _g_rand_state_initialized = true;
         gmp_randinit_default(_g_rand_state);
         gmp_randseed_ui(_g_rand_state, (unsigned long)time(NULL));
     }
 
-    mpfr_ptr num = malloc(sizeof(mpfr_t));
-    mpfr_init(num);
+    const precision_policy_t* policy = scope_get_precision_policy(scope);
+    mpfr_ptr num = precision_policy_new_number(policy, 0, 0);
 
-    mpfr_urandom(num, _g_rand_state, MPFR_RNDN);
+    mpfr_urandom(num, _g_rand_state, precision_policy_exact_round(policy));
     *out = expression_new_number(num);
 
     return ERROR_NO_ERROR;
@@ -197,16 +345,15 @@ error_t builtin_func_random(scope_t* scope, expression_t** out) {
 
 error_t builtin_func_ln(scope_t* scope, expression_t** out) {
     expression_t input;
-    scope_get_value(scope, "__arg0", &input);
+    scope_get_argument(scope, 0, &input);
     if (!EXPRESSION_IS_NUMBER(&input)) {
         return ERROR_NO_ERROR;
         expression_clean(&input);
     }
-    mpfr_ptr num = malloc(sizeof(mpfr_t));
-    mpfr_init(num);
-    mpfr_log(num, input.number.value, MPFR_RNDN);
+    const precision_policy_t* policy = scope_get_precision_policy(scope);
+    mpfr_ptr num = precision_policy_new_number(policy, mpfr_get_prec(input.number.value), 0);
+    mpfr_log(num, input.number.value, precision_policy_exact_round(policy));
     *out = expression_new_number(num);
-    mpfr_clear(num);
     expression_clean(&input);
     return ERROR_NO_ERROR;
 }
@@ -216,8 +363,15 @@ error_t builtin_func_log(scope_t* scope, expression_t** out) {
     expression_t* b = malloc(sizeof(expression_t));
     expression_t* y = malloc(sizeof(expression_t));
 
-    scope_get_value(scope, "__arg0", b);
-    scope_get_value(scope, "__arg1", y);
+    scope_get_argument(scope, 0, b);
+    scope_get_argument(scope, 1, y);
+
+    /* the logarithms are computed at the precision of the arguments, so they're widened to the policy's precision */
+    const precision_policy_t* policy = scope_get_precision_policy(scope);
+    if (EXPRESSION_IS_NUMBER(b) && mpfr_get_prec(b->number.value) < precision_policy_minimum(policy))
+        mpfr_prec_round(b->number.value, precision_policy_minimum(policy), MPFR_RNDN);
+    if (EXPRESSION_IS_NUMBER(y) && mpfr_get_prec(y->number.value) < precision_policy_minimum(policy))
+        mpfr_prec_round(y->number.value, precision_policy_minimum(policy), MPFR_RNDN);
 
     err = expression_do_logarithm(b, y, out);
     if (err) return err;
@@ -226,29 +380,24 @@ error_t builtin_func_log(scope_t* scope, expression_t** out) {
 }
 
 
-error_t builtin_const_e(scope_t* _, expression_t** out) {
-    (void)_;
+error_t builtin_const_e(scope_t* scope, expression_t** out) {
+    const precision_policy_t* policy = scope_get_precision_policy(scope);
+    mpfr_ptr copy = precision_policy_new_number(policy, 0, 0);
 
-    if (!_g_eulers_constant) {
-        // Approximate euler's constant and then cache it
-        _g_eulers_constant = malloc(sizeof(mpfr_t));
-        mpfr_t n;
-        mpfr_t x;
-        mpfr_init(n);
-        mpfr_init(x);
-        mpfr_init(_g_eulers_constant);
-
-        mpfr_set_ui(n, 9999999999UL, MPFR_RNDN);
-        mpfr_ui_div(x, 1, n, MPFR_RNDN);
-        mpfr_add_ui(x, x, 1, MPFR_RNDN);
-        mpfr_pow(_g_eulers_constant, x, n, MPFR_RNDN);
-
-        mpfr_clear(n);
-        mpfr_clear(x);
+    /* compute euler's number and cache it, it's only recomputed if a more precise value is needed */
+    if (!_g_eulers_constant || mpfr_get_prec(_g_eulers_constant) < mpfr_get_prec(copy)) {
+        if (_g_eulers_constant) {
+            mpfr_clear(_g_eulers_constant);
+        } else {
+            _g_eulers_constant = malloc(sizeof(mpfr_t));
+        }
+        mpfr_init2(_g_eulers_constant, mpfr_get_prec(copy) + PRECISION_GUARD_BITS);
+
+        mpfr_set_ui(_g_eulers_constant, 1, MPFR_RNDN);
+        mpfr_exp(_g_eulers_constant, _g_eulers_constant, MPFR_RNDN);
     }
 
-    mpfr_ptr copy = malloc(sizeof(mpfr_t));
-    mpfr_init_set(copy, _g_eulers_constant, MPFR_RNDN);
+    mpfr_set(copy, _g_eulers_constant, precision_policy_exact_round(policy));
     *out = expression_new_number(copy);
 
     return ERROR_NO_ERROR;
@@ -270,42 +419,75 @@ error_t builtin_const_inf(scope_t* _, expression_t** out) {
 
 int main(int argc, char** argv) {
     int verbosity = 0;
+    size_t digits = 0;
     variable_t isolation_target = NULL;
     scope_t scope;
+    precision_policy_t policy;
+    expression_memo_t memo;
+    call_cache_t calls = { NULL, 0, 0, 0, 0, 0 };
+    thread_pool_t threads;
+    value_cache_t values;
+    budget_t budget;
 
     scope_init(&scope);
-
-    EXPORT_BUILTIN_FUNCTION(&scope, cos);
-    EXPORT_BUILTIN_FUNCTION(&scope, sin);
-    EXPORT_BUILTIN_FUNCTION(&scope, tan);
-    EXPORT_BUILTIN_FUNCTION(&scope, acos);
-    EXPORT_BUILTIN_FUNCTION(&scope, asin);
-    EXPORT_BUILTIN_FUNCTION(&scope, atan);
-    EXPORT_BUILTIN_FUNCTION(&scope, sec);
-    EXPORT_BUILTIN_FUNCTION(&scope, csc);
-    EXPORT_BUILTIN_FUNCTION(&scope, cot);
-    EXPORT_BUILTIN_FUNCTION(&scope, cosh);
-    EXPORT_BUILTIN_FUNCTION(&scope, sinh);
-    EXPORT_BUILTIN_FUNCTION(&scope, tanh);
-    EXPORT_BUILTIN_FUNCTION(&scope, acosh);
-    EXPORT_BUILTIN_FUNCTION(&scope, asinh);
-    EXPORT_BUILTIN_FUNCTION(&scope, atanh);
-    EXPORT_BUILTIN_FUNCTION(&scope, sech);
-    EXPORT_BUILTIN_FUNCTION(&scope, csch);
-    EXPORT_BUILTIN_FUNCTION(&scope, coth);
-
-    EXPORT_BUILTIN_FUNCTION(&scope, ceil);
-    EXPORT_BUILTIN_FUNCTION(&scope, floor);
-    EXPORT_BUILTIN_FUNCTION(&scope, round);
-    EXPORT_BUILTIN_FUNCTION(&scope, roundeven);
-    EXPORT_BUILTIN_FUNCTION(&scope, trunc);
-    EXPORT_BUILTIN_FUNCTION(&scope, frac);
+    budget_init(&budget);
+    rewrite_rules_init(&_g_rewrite_rules);
+    precision_policy_init(&policy);
+    scope_set_precision_policy(&scope, &policy);
+
+    EXPORT_MPFR_FUNCTION(&scope, cos);
+    EXPORT_MPFR_FUNCTION(&scope, sin);
+    EXPORT_MPFR_FUNCTION(&scope, tan);
+    EXPORT_MPFR_FUNCTION(&scope, acos);
+    EXPORT_MPFR_FUNCTION(&scope, asin);
+    EXPORT_MPFR_FUNCTION(&scope, atan);
+    EXPORT_MPFR_FUNCTION(&scope, sec);
+    EXPORT_MPFR_FUNCTION(&scope, csc);
+    EXPORT_MPFR_FUNCTION(&scope, cot);
+    EXPORT_MPFR_FUNCTION(&scope, cosh);
+    EXPORT_MPFR_FUNCTION(&scope, sinh);
+    EXPORT_MPFR_FUNCTION(&scope, tanh);
+    EXPORT_MPFR_FUNCTION(&scope, acosh);
+    EXPORT_MPFR_FUNCTION(&scope, asinh);
+    EXPORT_MPFR_FUNCTION(&scope, atanh);
+    EXPORT_MPFR_FUNCTION(&scope, sech);
+    EXPORT_MPFR_FUNCTION(&scope, csch);
+    EXPORT_MPFR_FUNCTION(&scope, coth);
+
+    EXPORT_MPFR_FUNCTION(&scope, ceil);
+    EXPORT_MPFR_FUNCTION(&scope, floor);
+    EXPORT_MPFR_FUNCTION(&scope, round);
+    EXPORT_MPFR_FUNCTION(&scope, roundeven);
+    EXPORT_MPFR_FUNCTION(&scope, trunc);
+    EXPORT_MPFR_FUNCTION(&scope, frac);
     EXPORT_BUILTIN_FUNCTION(&scope, random);
+    scope_mark_impure(&scope, "random");
     EXPORT_BUILTIN_FUNCTION(&scope, ln);
+    scope_mark_thread_safe(&scope, "ln");
 
     EXPORT_BUILTIN_FUNCTION2(&scope, log);
-    EXPORT_BUILTIN_FUNCTION2(&scope, min);
-    EXPORT_BUILTIN_FUNCTION2(&scope, max);
+    EXPORT_MPFR_FUNCTION2(&scope, min);
+    EXPORT_MPFR_FUNCTION2(&scope, max);
+
+    /* the shapes of the builtins let adaptive evaluation bound their results */
+    scope_mark_shape(&scope, "sin", FUNCTION_SHAPE_SLOPE_ONE);
+    scope_mark_shape(&scope, "cos", FUNCTION_SHAPE_SLOPE_ONE);
+    scope_mark_shape(&scope, "acos", FUNCTION_SHAPE_DECREASING);
+    scope_mark_shape(&scope, "asin", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "atan", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "sinh", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "tanh", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "asinh", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "acosh", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "atanh", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "ceil", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "floor", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "round", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "roundeven", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "trunc", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "ln", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "min", FUNCTION_SHAPE_INCREASING);
+    scope_mark_shape(&scope, "max", FUNCTION_SHAPE_INCREASING);
 
     EXPORT_BUILTIN_CONST(&scope, pi);
     EXPORT_BUILTIN_CONST(&scope, euler);
@@ -326,6 +508,22 @@ int main(int argc, char** argv) {
         FLAG('d', "define",  err = do_assignment(FLAG_VALUE, &scope); if (err) goto error)
         FLAG('i', "isolate", isolation_target = FLAG_VALUE)
         FLAG('f', "file",    err = execute_file(FLAG_VALUE, &scope); if (err) goto error)
+        FLAG('a', "adaptive", digits = strtoul(FLAG_VALUE, NULL, 10))
+        FLAG('p', "precision", set_precision(&policy, strtol(FLAG_VALUE, NULL, 10)))
+        FLAG('n', "digits",  set_digits(&policy, strtoul(FLAG_VALUE, NULL, 10)))
+        FLAG('m', "memoize", if (!scope.memo) { expression_memo_init(&memo, true); scope_set_memo(&scope, &memo); })
+        FLAG('c', "cache",   set_call_cache_size(&scope, &calls, strtoul(FLAG_VALUE, NULL, 10)))
+        FLAG('u', "pure",    err = scope_mark_pure(&scope, FLAG_VALUE); if (err) goto error)
+        FLAG('l', "recursion-limit", expression_set_recursion_limit(strtoul(FLAG_VALUE, NULL, 10)))
+        FLAG('r', "reactive", if (!scope.values) { value_cache_init(&values); scope_set_value_cache(&scope, &values); })
+        FLAG('j', "jobs",    err = set_jobs(&scope, &threads, strtoul(FLAG_VALUE, NULL, 10)); if (err) goto error)
+        FLAG('s', "max-steps", budget.max_steps = strtoul(FLAG_VALUE, NULL, 10); scope_set_budget(&scope, &budget))
+        FLAG('t', "max-time", budget.max_seconds = strtod(FLAG_VALUE, NULL); scope_set_budget(&scope, &budget))
+        FLAG('b', "max-bytes", budget.max_bytes = strtoul(FLAG_VALUE, NULL, 10); scope_set_budget(&scope, &budget))
+        FLAG('x', "max-precision", budget.max_precision = strtol(FLAG_VALUE, NULL, 10); scope_set_budget(&scope, &budget))
+        FLAG('w', "rules",   err = load_rules(FLAG_VALUE); if (err) goto error)
+        FLAG('e', "saturate", set_saturate_cost(FLAG_VALUE))
+        FLAG('o', "cse",     _g_cse = true)
     )
 
     if (err) goto error;
@@ -339,8 +537,15 @@ int main(int argc, char** argv) {
         err = parse_file(stdin, expr_list);
         if (err) goto error;
 
-        EXPRESSION_LIST_FOREACH(expr, expr_list) {
-            err = simplify_and_print(&scope, expr, isolation_target, verbosity >= 0);
+        /* adaptive evaluation escalates the precision of each expression, so they're evaluated one at a time */
+        if (digits) {
+            EXPRESSION_LIST_FOREACH(expr, expr_list) {
+                err = simplify_and_print(&scope, expr, isolation_target, digits, verbosity >= 0);
+                if (err) goto error;
+            }
+        } else {
+            print_options_t options = { &scope, isolation_target, digits, verbosity >= 0 };
+            err = evaluate_statements(expr_list, &scope, print_statement, &options);
             if (err) goto error;
         }
 
@@ -353,7 +558,7 @@ int main(int argc, char** argv) {
         err = parse_string(flag_argv[i], &expr);
         if (err) goto error;
 
-        err = simplify_and_print(&scope, &expr, isolation_target, verbosity >= 0);
+        err = simplify_and_print(&scope, &expr, isolation_target, digits, verbosity >= 0);
         if (err) goto error;
 
         expression_clean(&expr);
@@ -365,7 +570,39 @@ error:
     printf("simplify: %s\n", error_string(err));
 
 cleanup:
+    if (scope.memo) {
+        if (verbosity > 0)
+            fprintf(stderr, "simplify: memo: %zu hits, %zu misses\n", memo.hits, memo.misses);
+        expression_memo_clean(&memo);
+    }
+    if (verbosity > 0 && scope.calls)
+        fprintf(stderr, "simplify: call cache: %zu hits, %zu misses (%.1f%%), %zu evictions, %zu impure calls\n",
+                calls.hits, calls.misses, 100 * call_cache_hit_rate(&calls), calls.evictions, calls.impure);
+    call_cache_clean(&calls);
+    if (scope.values) {
+        if (verbosity > 0)
+            fprintf(stderr, "simplify: values: %zu hits, %zu misses, %zu invalidated\n",
+                    values.hits, values.misses, values.invalidations);
+        value_cache_clean(&values);
+    }
+    if (scope.threads) {
+        if (verbosity > 0)
+            fprintf(stderr, "simplify: threads: %zu tasks, %zu stolen\n", threads.spawned, threads.stolen);
+        thread_pool_clean(&threads);
+    }
+    if (verbosity > 0 && _g_fixpoint_stats.iterations)
+        fprintf(stderr, "simplify: fixpoint: %zu walks, %zu visited, %zu skipped\n",
+                _g_fixpoint_stats.iterations, _g_fixpoint_stats.visited, _g_fixpoint_stats.skipped);
+    if (verbosity > 0 && _g_cse)
+        fprintf(stderr, "simplify: cse: %zu temporaries, %zu copies reused\n",
+                _g_cse_stats.temporaries, _g_cse_stats.reused);
+    if (verbosity > 0 && _g_rewrite_rules.rule_count)
+        fprintf(stderr, "simplify: rules: %zu rules, %zu rewrites\n",
+                _g_rewrite_rules.rule_count, _g_rewrite_rules.rewrites);
+    rewrite_rules_clean(&_g_rewrite_rules);
+    call_stack_free();
     scope_clean(&scope);
+    symbol_table_free();
     mpfr_free_cache();
     if (_g_rand_state_initialized)
         gmp_randclear(_g_rand_state);
@@ -8,14 +8,14 @@
 #define DEFINE_MPFR_FUNCTION(NAME) \
 error_t builtin_func_ ## NAME(scope_t* scope, expression_t** out) { \
     expression_t input; \
-    scope_get_value(scope, "__arg0", &input); \
+    scope_get_argument(scope, 0, &input); \
     if (!EXPRESSION_IS_NUMBER(&input)) { \
         return ERROR_NO_ERROR; \
         expression_clean(&input); \
     } \
-    mpfr_ptr num = malloc(sizeof(mpfr_t)); \
-    mpfr_init(num); \
-    mpfr_## NAME(num, input.number.value, MPFR_RNDN); \
+    const precision_policy_t* policy = scope_get_precision_policy(scope); \
+    mpfr_ptr num = precision_policy_new_number(policy, mpfr_get_prec(input.number.value), 0); \
+    mpfr_## NAME(num, input.number.value, precision_policy_exact_round(policy)); \
     *out = expression_new_number(num); \
     expression_clean(&input); \
     return ERROR_NO_ERROR; \
@@ -24,13 +24,13 @@ error_t builtin_func_ ## NAME(scope_t* scope, expression_t** out) { \
 #define DEFINE_MPFR_FUNCTION_NRND(NAME) \
 error_t builtin_func_ ## NAME(scope_t* scope, expression_t** out) { \
     expression_t input; \
-    scope_get_value(scope, "__arg0", &input); \
+    scope_get_argument(scope, 0, &input); \
     if (!EXPRESSION_IS_NUMBER(&input)) { \
         return ERROR_NO_ERROR; \
         expression_clean(&input); \
     } \
-    mpfr_ptr num = malloc(sizeof(mpfr_t)); \
-    mpfr_init(num); \
+    const precision_policy_t* policy = scope_get_precision_policy(scope); \
+    mpfr_ptr num = precision_policy_new_number(policy, mpfr_get_prec(input.number.value), 0); \
     mpfr_## NAME(num, input.number.value); \
     *out = expression_new_number(num); \
     expression_clean(&input); \
@@ -41,16 +41,17 @@ error_t builtin_func_ ## NAME(scope_t* scope, expression_t** out) { \
 error_t builtin_func_ ## NAME(scope_t* scope, expression_t** out) { \
     expression_t input; \
     expression_t input2; \
-    scope_get_value(scope, "__arg0", &input); \
-    scope_get_value(scope, "__arg1", &input2); \
+    scope_get_argument(scope, 0, &input); \
+    scope_get_argument(scope, 1, &input2); \
     if (!EXPRESSION_IS_NUMBER(&input) || !EXPRESSION_IS_NUMBER(&input2)) { \
         expression_clean(&input); \
         expression_clean(&input2); \
         return ERROR_NO_ERROR; \
     } \
-    mpfr_ptr num = malloc(sizeof(mpfr_t)); \
-    mpfr_init(num); \
-    mpfr_## NAME(num, input.number.value, input2.number.value, MPFR_RNDN); \
+    const precision_policy_t* policy = scope_get_precision_policy(scope); \
+    mpfr_ptr num = precision_policy_new_number(policy, \
+                        mpfr_get_prec(input.number.value), mpfr_get_prec(input2.number.value)); \
+    mpfr_## NAME(num, input.number.value, input2.number.value, precision_policy_exact_round(policy)); \
     *out = expression_new_number(num); \
     expression_clean(&input); \
     expression_clean(&input2); \
@@ -63,12 +64,21 @@ error_t builtin_func_ ## NAME(scope_t* scope, expression_t** out) { \
 #define EXPORT_BUILTIN_FUNCTION2(SCOPE, NAME) \
     scope_define_internal_function((SCOPE), #NAME, builtin_func_ ## NAME, 2, "__arg0", "__arg1");
 
+/* export a function made with DEFINE_MPFR_FUNCTION or DEFINE_MPFR_FUNCTION_NRND, they're thread safe */
+#define EXPORT_MPFR_FUNCTION(SCOPE, NAME) \
+    EXPORT_BUILTIN_FUNCTION(SCOPE, NAME) \
+    scope_mark_thread_safe((SCOPE), #NAME);
+
+/* export a function made with DEFINE_MPFR_FUNCTION2, they're thread safe */
+#define EXPORT_MPFR_FUNCTION2(SCOPE, NAME) \
+    EXPORT_BUILTIN_FUNCTION2(SCOPE, NAME) \
+    scope_mark_thread_safe((SCOPE), #NAME);
+
 #define DEFINE_MPFR_CONST(NAME) \
 error_t builtin_const_ ## NAME(scope_t* scope, expression_t** out) { \
-    (void)scope; \
-    mpfr_ptr num = malloc(sizeof(mpfr_t)); \
-    mpfr_init(num); \
-    mpfr_const_ ## NAME(num, MPFR_RNDF); \
+    const precision_policy_t* policy = scope_get_precision_policy(scope); \
+    mpfr_ptr num = precision_policy_new_number(policy, 0, 0); \
+    mpfr_const_ ## NAME(num, precision_policy_exact_round(policy)); \
     *out = expression_new_number(num); \
     return ERROR_NO_ERROR; \
 }
@@ -46,6 +46,13 @@ enum error {
     ERROR_IS_A_FUNCTION,
     ERROR_IS_A_VARIABLE,
     ERROR_MISSING_ARGUMENTS,
+    ERROR_RECURSION_LIMIT,
+    ERROR_THREAD_START,
+    ERROR_NOT_COMPILABLE,
+    ERROR_BUDGET_EXCEEDED,
+    ERROR_POLYNOMIAL_TOO_LARGE,
+    ERROR_INVALID_REWRITE_RULE,
+    ERROR_NO_ROOT_FOUND,
 };
 
 /* get a description of the error
@@ -105,6 +112,20 @@ static inline const char* error_string(error_t err) {
             return "you're trying to call a variable!";
         case ERROR_MISSING_ARGUMENTS:
             return "missing arguments to function call";
+        case ERROR_RECURSION_LIMIT:
+            return "recursion limit exceeded";
+        case ERROR_THREAD_START:
+            return "unable to start a thread";
+        case ERROR_NOT_COMPILABLE:
+            return "the expression can't be compiled";
+        case ERROR_BUDGET_EXCEEDED:
+            return "the evaluation's budget was exceeded";
+        case ERROR_POLYNOMIAL_TOO_LARGE:
+            return "the polynomial has too many terms";
+        case ERROR_INVALID_REWRITE_RULE:
+            return "expected a rewrite rule in the form PATTERN = REPLACEMENT";
+        case ERROR_NO_ROOT_FOUND:
+            return "no value of the variable was found that solves the equation";
     }
     return "unkown error type";
 }
@@ -0,0 +1,167 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/bounds.h"
+
+/* An MPFR operation on two numbers */
+typedef int (*_bounds_operation_t)(mpfr_ptr, mpfr_srcptr, mpfr_srcptr, mpfr_rnd_t);
+
+/* make bounds unbounded if only one of them is NaN, so some operands were outside the operation's domain
+ *
+ * @lower
+ * @upper
+ */
+void _bounds_settle(mpfr_ptr lower, mpfr_ptr upper) {
+    if (mpfr_nan_p(lower) != mpfr_nan_p(upper))
+        bounds_set_unbounded(lower, upper);
+}
+
+/* bound an operation that's increasing or decreasing in each of it's operands, by applying it to every pair of the
+ * operands' bounds. The result is undefined if all of the pairs are outside the operation's domain, and unbounded
+ * if only some are, or if an operand is unbounded, since an infinite bound doesn't mean the number is infinite.
+ *
+ * @lower location to store the lower bound
+ * @upper location to store the upper bound
+ * @operation the operation
+ * @lower1 the first operand's lower bound
+ * @upper1 the first operand's upper bound
+ * @lower2 the second operand's lower bound
+ * @upper2 the second operand's upper bound
+ */
+void _bounds_corners(mpfr_ptr lower, mpfr_ptr upper, _bounds_operation_t operation,
+                     mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2) {
+    mpfr_srcptr operands1[2] = { lower1, upper1 };
+    mpfr_srcptr operands2[2] = { lower2, upper2 };
+    size_t undefined = 0;
+
+    mpfr_t down;
+    mpfr_t up;
+    mpfr_init2(down, mpfr_get_prec(lower));
+    mpfr_init2(up, mpfr_get_prec(upper));
+    mpfr_set_inf(lower, 1);
+    mpfr_set_inf(upper, -1);
+
+    for (int i = 0; i < 4; ++i) {
+        operation(down, operands1[i / 2], operands2[i % 2], MPFR_RNDD);
+        operation(up, operands1[i / 2], operands2[i % 2], MPFR_RNDU);
+        if (mpfr_nan_p(down) || mpfr_nan_p(up)) {
+            ++undefined;
+            continue;
+        }
+
+        mpfr_min(lower, lower, down, MPFR_RNDD);
+        mpfr_max(upper, upper, up, MPFR_RNDU);
+    }
+
+    mpfr_clear(down);
+    mpfr_clear(up);
+
+    bool infinite = mpfr_inf_p(lower1) || mpfr_inf_p(upper1) || mpfr_inf_p(lower2) || mpfr_inf_p(upper2);
+    if (undefined == 4 && !infinite) {
+        mpfr_set_nan(lower);
+        mpfr_set_nan(upper);
+    } else if (undefined) {
+        bounds_set_unbounded(lower, upper);
+    }
+}
+
+void bounds_set_unbounded(mpfr_ptr lower, mpfr_ptr upper) {
+    mpfr_set_inf(lower, -1);
+    mpfr_set_inf(upper, 1);
+}
+
+void bounds_add(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2) {
+    mpfr_add(lower, lower1, lower2, MPFR_RNDD);
+    mpfr_add(upper, upper1, upper2, MPFR_RNDU);
+    _bounds_settle(lower, upper);
+}
+
+void bounds_sub(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2) {
+    mpfr_sub(lower, lower1, upper2, MPFR_RNDD);
+    mpfr_sub(upper, upper1, lower2, MPFR_RNDU);
+    _bounds_settle(lower, upper);
+}
+
+void bounds_mul(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2) {
+    _bounds_corners(lower, upper, mpfr_mul, lower1, upper1, lower2, upper2);
+}
+
+void bounds_div(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2) {
+    /* the quotient has no bound near zero, dividing by exactly zero gives an infinity like it usually does */
+    if (!mpfr_nan_p(lower2) && !mpfr_nan_p(upper2) && mpfr_sgn(lower2) <= 0 && mpfr_sgn(upper2) >= 0 &&
+            !bounds_are_exact(lower2, upper2)) {
+        bounds_set_unbounded(lower, upper);
+        return;
+    }
+
+    _bounds_corners(lower, upper, mpfr_div, lower1, upper1, lower2, upper2);
+}
+
+void bounds_pow(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2) {
+    /* for a base on one side of zero, or an integer power, the power is increasing or decreasing in each operand */
+    _bounds_corners(lower, upper, mpfr_pow, lower1, upper1, lower2, upper2);
+
+    bool straddles = mpfr_sgn(lower1) < 0 && mpfr_sgn(upper1) > 0;
+    if (!straddles || !bounds_are_exact(lower2, upper2) || !mpfr_integer_p(lower2))
+        return;
+
+    /* an integer power of a base on both sides of zero turns at zero, negative powers have a pole there */
+    if (mpfr_sgn(lower2) < 0) {
+        bounds_set_unbounded(lower, upper);
+        return;
+    }
+
+    mpfr_t half;
+    mpfr_init2(half, mpfr_get_prec(lower2));
+    mpfr_div_2ui(half, lower2, 1, MPFR_RNDN);
+    if (mpfr_sgn(lower2) > 0 && mpfr_integer_p(half))
+        mpfr_set_zero(lower, 1);
+    mpfr_clear(half);
+}
+
+void bounds_rootn(mpfr_ptr lower, mpfr_ptr upper,
+                  mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2) {
+    if (!bounds_are_exact(lower2, upper2) || !mpfr_integer_p(lower2)) {
+        bounds_set_unbounded(lower, upper);
+        return;
+    }
+
+    /* every root is increasing where it's defined */
+    unsigned long index = mpfr_get_ui(lower2, MPFR_RNDN);
+    mpfr_rootn_ui(lower, lower1, index, MPFR_RNDD);
+    mpfr_rootn_ui(upper, upper1, index, MPFR_RNDU);
+    _bounds_settle(lower, upper);
+}
+
+void bounds_hull(mpfr_ptr lower, mpfr_ptr upper,
+                 mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2) {
+    bool undefined1 = mpfr_nan_p(lower1) || mpfr_nan_p(upper1);
+    bool undefined2 = mpfr_nan_p(lower2) || mpfr_nan_p(upper2);
+    if (undefined1 || undefined2) {
+        if (undefined1 && undefined2) {
+            mpfr_set_nan(lower);
+            mpfr_set_nan(upper);
+        } else {
+            bounds_set_unbounded(lower, upper);
+        }
+        return;
+    }
+
+    mpfr_min(lower, lower1, lower2, MPFR_RNDD);
+    mpfr_max(upper, upper1, upper2, MPFR_RNDU);
+}
+
+void bounds_widen(mpfr_ptr lower, mpfr_ptr upper, mpfr_srcptr lower1, mpfr_srcptr upper1) {
+    mpfr_t width;
+    mpfr_init2(width, mpfr_get_prec(upper1) > mpfr_get_prec(lower1) ? mpfr_get_prec(upper1) : mpfr_get_prec(lower1));
+    mpfr_sub(width, upper1, lower1, MPFR_RNDU);
+
+    mpfr_sub(lower, lower, width, MPFR_RNDD);
+    mpfr_add(upper, upper, width, MPFR_RNDU);
+    mpfr_clear(width);
+    _bounds_settle(lower, upper);
+}
@@ -0,0 +1,96 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_BOUNDS_H_
+#define SIMPLIFY_EXPRESSION_BOUNDS_H_
+
+#include <stdbool.h>
+
+#include <gmp.h>
+#include <mpfr.h>
+
+/* Bounds enclose a number that can't be computed exactly, it lies somewhere between a lower and an upper bound.
+ *
+ * Each operation takes the bounds of it's operands, and gives bounds that enclose the exact result of the operation
+ * for any operands within their bounds. The lower bound is rounded down and the upper bound is rounded up, at the
+ * precision of the numbers they're stored in, so the result's rounding error is enclosed too.
+ *
+ * If bounds can't be found, like when dividing by bounds that include zero, the result is unbounded: it's lower
+ * bound is -inf and it's upper bound is inf. If the operation isn't defined for any of it's operands, like the
+ * square root of a negative number, both bounds are NaN.
+ *
+ * The results must not be the same numbers as the operands.
+ */
+
+/* make bounds that enclose every number
+ *
+ * @lower location to store the lower bound
+ * @upper location to store the upper bound
+ */
+void bounds_set_unbounded(mpfr_ptr lower, mpfr_ptr upper);
+
+/* bound the sum of two bounded numbers
+ *
+ * @lower location to store the lower bound
+ * @upper location to store the upper bound
+ * @lower1 the first operand's lower bound
+ * @upper1 the first operand's upper bound
+ * @lower2 the second operand's lower bound
+ * @upper2 the second operand's upper bound
+ */
+void bounds_add(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2);
+
+/* bound the difference of two bounded numbers, see bounds_add */
+void bounds_sub(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2);
+
+/* bound the product of two bounded numbers, see bounds_add */
+void bounds_mul(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2);
+
+/* bound the quotient of two bounded numbers, it's unbounded if the divisor's bounds include zero, see bounds_add */
+void bounds_div(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2);
+
+/* bound a bounded number raised to a bounded power, see bounds_add */
+void bounds_pow(mpfr_ptr lower, mpfr_ptr upper,
+                mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2);
+
+/* bound a root of a bounded number, it's unbounded unless the root's index is exactly an integer, see bounds_add
+ *
+ * @lower location to store the lower bound
+ * @upper location to store the upper bound
+ * @lower1 the radicand's lower bound
+ * @upper1 the radicand's upper bound
+ * @lower2 the index's lower bound
+ * @upper2 the index's upper bound
+ */
+void bounds_rootn(mpfr_ptr lower, mpfr_ptr upper,
+                  mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2);
+
+/* find bounds that enclose two pairs of bounds, see bounds_add */
+void bounds_hull(mpfr_ptr lower, mpfr_ptr upper,
+                 mpfr_srcptr lower1, mpfr_srcptr upper1, mpfr_srcptr lower2, mpfr_srcptr upper2);
+
+/* widen bounds by the width of another pair of bounds.
+ * If `f` changes no faster than it's argument, and [lower, upper] bounds f(lower1), then the widened bounds enclose
+ * f(x) for any x between lower1 and upper1.
+ *
+ * @lower the lower bound to widen
+ * @upper the upper bound to widen
+ * @lower1 the lower bound of the width
+ * @upper1 the upper bound of the width
+ */
+void bounds_widen(mpfr_ptr lower, mpfr_ptr upper, mpfr_srcptr lower1, mpfr_srcptr upper1);
+
+/* check if bounds are exact, so they enclose a single number
+ *
+ * @lower
+ * @upper
+ * @return returns true if the bounds are equal
+ */
+static inline bool bounds_are_exact(mpfr_srcptr lower, mpfr_srcptr upper) {
+    return mpfr_equal_p(lower, upper);
+}
+
+#endif  // SIMPLIFY_EXPRESSION_BOUNDS_H_
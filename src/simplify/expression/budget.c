@@ -0,0 +1,155 @@
+/* Copyright Ian Shehadeh 2018 */
+
+/* clock_gettime isn't part of C99 */
+#ifndef _POSIX_C_SOURCE
+#   define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <time.h>
+
+#include "simplify/expression/budget.h"
+#include "simplify/expression/call_stack.h"
+
+/* the budget work on this thread is counted against */
+static CALL_STACK_THREAD_LOCAL budget_t* _g_budget;
+
+/* the last generation given to a budget entered on this thread */
+static CALL_STACK_THREAD_LOCAL size_t _g_budget_generation;
+
+/* get the time, in seconds since an unspecified point
+ *
+ * @return returns the time
+ */
+double _budget_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/* get the size of a number's limbs
+ *
+ * @precision the number's precision in bits
+ * @return returns the size in bytes
+ */
+size_t _budget_bytes(mpfr_prec_t precision) {
+    return (size_t)((precision + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS) * sizeof(mp_limb_t);
+}
+
+/* mark a budget as exceeded
+ *
+ * @budget the budget
+ * @limit the limit that was exceeded
+ * @return returns ERROR_BUDGET_EXCEEDED
+ */
+error_t _budget_exceed(budget_t* budget, budget_limit_t limit) {
+    if (!budget->exceeded)
+        budget->exceeded = limit;
+    return ERROR_BUDGET_EXCEEDED;
+}
+
+void budget_init(budget_t* budget) {
+    budget->max_steps     = 0;
+    budget->max_seconds   = 0;
+    budget->max_bytes     = 0;
+    budget->max_precision = 0;
+    budget->steps         = 0;
+    budget->bytes         = 0;
+    budget->started       = 0;
+    budget->exceeded      = BUDGET_LIMIT_NONE;
+    budget->generation    = 0;
+    budget->entered       = 0;
+    budget->outer         = NULL;
+}
+
+void budget_enter(budget_t* budget) {
+    if (budget->entered++)
+        return;
+
+    budget->steps      = 0;
+    budget->bytes      = 0;
+    budget->exceeded   = BUDGET_LIMIT_NONE;
+    budget->started    = budget->max_seconds > 0 ? _budget_now() : 0;
+    budget->generation = ++_g_budget_generation;
+    budget->outer      = _g_budget;
+    _g_budget = budget;
+}
+
+void budget_leave(budget_t* budget) {
+    assert(budget->entered > 0);
+    if (--budget->entered)
+        return;
+
+    assert(_g_budget == budget);
+    _g_budget = budget->outer;
+    budget->outer = NULL;
+}
+
+budget_t* budget_current(void) {
+    return _g_budget;
+}
+
+error_t budget_step(void) {
+    return budget_steps(1);
+}
+
+error_t budget_steps(size_t count) {
+    budget_t* budget = _g_budget;
+    if (!budget)
+        return ERROR_NO_ERROR;
+    if (budget->exceeded)
+        return ERROR_BUDGET_EXCEEDED;
+
+    /* the clock is read whenever a multiple of the interval is passed, not only when it's landed on */
+    size_t interval = budget->steps / BUDGET_CLOCK_INTERVAL;
+    budget->steps += count;
+    if (budget->max_steps && budget->steps > budget->max_steps)
+        return _budget_exceed(budget, BUDGET_LIMIT_STEPS);
+    if (budget->max_bytes && budget->bytes > budget->max_bytes)
+        return _budget_exceed(budget, BUDGET_LIMIT_MEMORY);
+    if (budget->max_seconds > 0 && budget->steps / BUDGET_CLOCK_INTERVAL != interval &&
+            _budget_now() - budget->started > budget->max_seconds)
+        return _budget_exceed(budget, BUDGET_LIMIT_TIME);
+    return ERROR_NO_ERROR;
+}
+
+error_t budget_number(mpfr_prec_t precision) {
+    budget_t* budget = _g_budget;
+    if (!budget)
+        return ERROR_NO_ERROR;
+    if (budget->exceeded)
+        return ERROR_BUDGET_EXCEEDED;
+
+    if (budget->max_precision && precision > budget->max_precision)
+        return _budget_exceed(budget, BUDGET_LIMIT_PRECISION);
+
+    if (budget->max_bytes && budget->bytes + _budget_bytes(precision) > budget->max_bytes)
+        return _budget_exceed(budget, BUDGET_LIMIT_MEMORY);
+    if (budget->max_seconds > 0 && _budget_now() - budget->started > budget->max_seconds)
+        return _budget_exceed(budget, BUDGET_LIMIT_TIME);
+    return ERROR_NO_ERROR;
+}
+
+size_t budget_number_made(mpfr_prec_t precision) {
+    budget_t* budget = _g_budget;
+    if (!budget)
+        return 0;
+
+    budget->bytes += _budget_bytes(precision);
+    return budget->generation;
+}
+
+void budget_number_freed(size_t generation, mpfr_prec_t precision) {
+    /* the budget may be an outer one, numbers that outlive the entry that counted them aren't counted anymore */
+    budget_t* budget = _g_budget;
+    while (budget && budget->generation != generation)
+        budget = budget->outer;
+    if (!budget)
+        return;
+
+    size_t bytes = _budget_bytes(precision);
+    budget->bytes = budget->bytes > bytes ? budget->bytes - bytes : 0;
+}
+
+bool budget_exceeded(void) {
+    return _g_budget && _g_budget->exceeded;
+}
@@ -0,0 +1,134 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_BUDGET_H_
+#define SIMPLIFY_EXPRESSION_BUDGET_H_
+
+#include "simplify/expression/expression.h"
+
+/* the clock is read once every this many steps, so counting steps stays cheap */
+#ifndef BUDGET_CLOCK_INTERVAL
+#   define BUDGET_CLOCK_INTERVAL 256
+#endif
+
+/* The limit a budget ran out of */
+typedef enum {
+    BUDGET_LIMIT_NONE,
+    BUDGET_LIMIT_STEPS,
+    BUDGET_LIMIT_TIME,
+    BUDGET_LIMIT_MEMORY,
+    BUDGET_LIMIT_PRECISION,
+} budget_limit_t;
+
+/* A budget limits the work done by an evaluation, so untrusted input can't hang or exhaust the process.
+ *
+ * A budget is attached to a scope with `scope_set_budget`, expression_evaluate uses it while evaluating an
+ * expression in that scope. The budget can also be entered directly, with `budget_enter`, to limit anything
+ * done on the calling thread, like `expression_simplify` and `expression_isolate_variable`.
+ * The budget's usage is reset each time it's entered, unless it's already entered.
+ *
+ * Once a limit is exceeded, the work fails with ERROR_BUDGET_EXCEEDED, and everything allocated by the unfinished
+ * work is freed. The expression being worked on is left partly evaluated, and must still be cleaned by the caller.
+ * Budgets are checked between steps, a single operation isn't interrupted, so the precision limit is what bounds
+ * the time taken by one operation.
+ *
+ * The memory limit caps the bytes of limbs held by live numbers: a number made while the budget is entered is
+ * counted until it's freed, so work that frees its temporaries can run for as long as the other limits allow.
+ *
+ * A zero limit means there's no limit.
+ */
+struct budget {
+    /* the most expressions that may be visited */
+    size_t          max_steps;
+
+    /* the most seconds that may pass, measured by a monotonic clock */
+    double          max_seconds;
+
+    /* the most bytes of limbs the live numbers made while the budget is entered may have */
+    size_t          max_bytes;
+
+    /* the widest number that may be computed, in bits */
+    mpfr_prec_t     max_precision;
+
+    /* the usage since the budget was entered, `bytes` is the size of the limbs that are still live */
+    size_t          steps;
+    size_t          bytes;
+    double          started;
+
+    /* the limit that was exceeded, or BUDGET_LIMIT_NONE */
+    budget_limit_t  exceeded;
+
+    /* identifies this entry of the budget, numbers remember it so they're only uncounted by the entry that counted them */
+    size_t          generation;
+
+    /* the number of times the budget is entered, and the budget that was active on the thread before it */
+    size_t          entered;
+    budget_t*       outer;
+};
+
+/* initialize a budget without any limits
+ *
+ * @budget the budget to initialize
+ */
+void budget_init(budget_t* budget);
+
+/* make a budget the calling thread's budget, until it's left.
+ * If the budget isn't already entered it's usage is reset.
+ *
+ * @budget the budget to enter
+ */
+void budget_enter(budget_t* budget);
+
+/* stop using a budget on the calling thread, the budget active before it was entered is used again
+ *
+ * @budget the budget to leave, it must be the calling thread's budget
+ */
+void budget_leave(budget_t* budget);
+
+/* get the calling thread's budget
+ *
+ * @return returns the budget, or NULL if there isn't one
+ */
+budget_t* budget_current(void);
+
+/* count a step against the calling thread's budget
+ *
+ * @return returns ERROR_BUDGET_EXCEEDED if the budget has been exceeded
+ */
+error_t budget_step(void);
+
+/* count several steps against the calling thread's budget at once
+ *
+ * @count the number of steps
+ * @return returns ERROR_BUDGET_EXCEEDED if the budget has been exceeded
+ */
+error_t budget_steps(size_t count);
+
+/* check that a number that's about to be computed fits the calling thread's budget.
+ * The clock is checked too, since a wide operation may take longer than many steps.
+ *
+ * @precision the number's precision in bits
+ * @return returns ERROR_BUDGET_EXCEEDED if the number is too wide, there's no room for it, or time is up
+ */
+error_t budget_number(mpfr_prec_t precision);
+
+/* count a number that's been made against the calling thread's budget, until it's freed with budget_number_freed
+ *
+ * @precision the number's precision in bits
+ * @return returns the generation of the budget that counted the number, or zero if there isn't a budget
+ */
+size_t budget_number_made(mpfr_prec_t precision);
+
+/* stop counting a number that's been freed
+ *
+ * @generation the generation returned by budget_number_made when the number was made
+ * @precision the number's precision in bits, numbers are only ever trimmed so this never uncounts too much
+ */
+void budget_number_freed(size_t generation, mpfr_prec_t precision);
+
+/* check if the calling thread's budget has been exceeded
+ *
+ * @return returns true if there's a budget, and it's been exceeded
+ */
+bool budget_exceeded(void);
+
+#endif  // SIMPLIFY_EXPRESSION_BUDGET_H_
@@ -0,0 +1,297 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/call_cache.h"
+#include "simplify/expression/canonical.h"
+
+/* the definitions already visited while fingerprinting a function, so recursive definitions terminate */
+typedef struct {
+    variable_info_t** infos;
+    size_t            count;
+    size_t            capacity;
+} _call_cache_visited_t;
+
+/* mix a 64 bit value into a hash
+ *
+ * @hash the hash so far
+ * @value the value to mix in
+ * @return returns the new hash
+ */
+static inline uint64_t _call_cache_mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+/* mark a definition as visited
+ *
+ * @visited the set of visited definitions
+ * @info the definition to visit
+ * @return returns false if the definition was already visited
+ */
+bool _call_cache_visit(_call_cache_visited_t* visited, variable_info_t* info) {
+    for (size_t i = 0; i < visited->count; ++i) {
+        if (visited->infos[i] == info)
+            return false;
+    }
+
+    if (visited->count >= visited->capacity) {
+        visited->capacity = visited->capacity ? visited->capacity * 2 : 8;
+        visited->infos = realloc(visited->infos, visited->capacity * sizeof(variable_info_t*));
+    }
+    visited->infos[visited->count++] = info;
+    return true;
+}
+
+/* check if `name` is one of a function's parameters
+ *
+ * @params the function's parameters, or NULL
+ * @name the name to search for
+ * @return returns true if the name is a parameter
+ */
+bool _call_cache_is_parameter(expression_list_t* params, char* name) {
+    if (!params)
+        return false;
+
+    expression_t* param;
+    EXPRESSION_LIST_FOREACH(param, params) {
+        if (EXPRESSION_IS_VARIABLE(param) && strcmp(param->variable.value, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool _call_cache_fingerprint_recursive(scope_t* scope, expression_t* expr, expression_list_t* params,
+                                        _call_cache_visited_t* visited, uint64_t* fingerprint);
+
+/* fingerprint a name used by a function, and the definition it refers to
+ *
+ * @scope the scope to search for the definition
+ * @name the name
+ * @visited the definitions that have already been fingerprinted
+ * @fingerprint the fingerprint to update
+ * @return returns false if the definition is impure
+ */
+bool _call_cache_fingerprint_definition(scope_t* scope, char* name, _call_cache_visited_t* visited, uint64_t* fingerprint) {
+    variable_info_t* info;
+    if (scope_get_variable_info(scope, name, &info)) {
+        /* the name isn't defined, the fingerprint changes if it's defined later */
+        *fingerprint = _call_cache_mix(*fingerprint, 0);
+        return true;
+    }
+
+    if (info->impure)
+        return false;
+
+    *fingerprint = _call_cache_mix(*fingerprint, info->generation);
+    if (info->is_internal || info->pure || !_call_cache_visit(visited, info))
+        return true;
+
+    return _call_cache_fingerprint_recursive(scope, info->value.expression, info->named_inputs, visited, fingerprint);
+}
+
+/* fingerprint every definition an expression can reach
+ *
+ * @scope the scope definitions are found in
+ * @expr the expression to search
+ * @params the parameters of the function `expr` belongs to, they aren't looked up
+ * @visited the definitions that have already been fingerprinted
+ * @fingerprint the fingerprint to update
+ * @return returns false if the expression is impure
+ */
+bool _call_cache_fingerprint_recursive(scope_t* scope, expression_t* expr, expression_list_t* params,
+                                        _call_cache_visited_t* visited, uint64_t* fingerprint) {
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return true;
+        case EXPRESSION_TYPE_VARIABLE:
+            if (_call_cache_is_parameter(params, expr->variable.value))
+                return true;
+            return _call_cache_fingerprint_definition(expr->variable.binding ? expr->variable.binding : scope,
+                                                        expr->variable.value, visited, fingerprint);
+        case EXPRESSION_TYPE_PREFIX:
+            return _call_cache_fingerprint_recursive(scope, expr->prefix.right, params, visited, fingerprint);
+        case EXPRESSION_TYPE_OPERATOR:
+            if (expr->operator.infix == ':')
+                return false;
+            return _call_cache_fingerprint_recursive(scope, expr->operator.left, params, visited, fingerprint)
+                && _call_cache_fingerprint_recursive(scope, expr->operator.right, params, visited, fingerprint);
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            if (!_call_cache_fingerprint_definition(scope, expr->function.name, visited, fingerprint))
+                return false;
+
+            expression_t* param;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                if (!_call_cache_fingerprint_recursive(scope, param, params, visited, fingerprint))
+                    return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool call_cache_fingerprint(scope_t* scope, variable_info_t* function, uint64_t* fingerprint) {
+    *fingerprint = 0;
+    if (function->impure)
+        return false;
+    if (function->is_internal || function->pure)
+        return true;
+
+    _call_cache_visited_t visited = { NULL, 0, 0 };
+    _call_cache_visit(&visited, function);
+    bool pure = _call_cache_fingerprint_recursive(scope, function->value.expression, function->named_inputs,
+                                                    &visited, fingerprint);
+    free(visited.infos);
+    return pure;
+}
+
+void call_cache_init(call_cache_t* cache, size_t size) {
+    assert(size > 0);
+    cache->entries   = calloc(size, sizeof(call_cache_entry_t));
+    cache->size      = size;
+    cache->hits      = 0;
+    cache->misses    = 0;
+    cache->impure    = 0;
+    cache->evictions = 0;
+}
+
+/* free the arguments and result held by an entry
+ *
+ * @entry the entry to empty
+ */
+void _call_cache_entry_clean(call_cache_entry_t* entry) {
+    if (!entry->used)
+        return;
+
+    expression_list_free(entry->arguments);
+    expression_clean(&entry->result);
+    entry->used = false;
+}
+
+void call_cache_clear(call_cache_t* cache) {
+    for (size_t i = 0; i < cache->size; ++i)
+        _call_cache_entry_clean(&cache->entries[i]);
+    cache->hits      = 0;
+    cache->misses    = 0;
+    cache->impure    = 0;
+    cache->evictions = 0;
+}
+
+void call_cache_clean(call_cache_t* cache) {
+    call_cache_clear(cache);
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->size = 0;
+}
+
+/* hash a call
+ *
+ * @function the function's definition
+ * @fingerprint the function's fingerprint
+ * @arguments the function's evaluated arguments
+ * @return returns the call's hash
+ */
+uint64_t _call_cache_hash(variable_info_t* function, uint64_t fingerprint, expression_list_t* arguments) {
+    /* the generation identifies the definition, unlike it's address it's the same every time a program runs */
+    uint64_t hash = _call_cache_mix(0, function->generation);
+    hash = _call_cache_mix(hash, fingerprint);
+
+    expression_t* argument;
+    EXPRESSION_LIST_FOREACH(argument, arguments) {
+        hash = _call_cache_mix(hash, expression_hash(argument));
+    }
+    return hash;
+}
+
+/* check if two argument lists are identical
+ *
+ * @arguments1
+ * @arguments2
+ * @return returns true if every argument is identical
+ */
+bool _call_cache_arguments_identical(expression_list_t* arguments1, expression_list_t* arguments2) {
+    for (; arguments1 && arguments2; arguments1 = arguments1->next, arguments2 = arguments2->next) {
+        if (!arguments1->value || !arguments2->value)
+            return arguments1->value == arguments2->value;
+        if (!expression_identical(arguments1->value, arguments2->value))
+            return false;
+    }
+    return arguments1 == arguments2;
+}
+
+/* find the key a call's arguments are cached under. The operands of every sum and product are sorted (see
+ * canonical.h), so `f(a * b)` and `f(b * a)` share an entry. Arguments are usually numbers, those are used as they are.
+ *
+ * @arguments the function's evaluated arguments, they aren't changed
+ * @return returns `arguments` if they're already canonical, otherwise a canonical copy the caller must free
+ */
+expression_list_t* _call_cache_key(expression_list_t* arguments) {
+    expression_t* argument;
+    bool leaves = true;
+    EXPRESSION_LIST_FOREACH(argument, arguments) {
+        if (!EXPRESSION_IS_NUMBER(argument) && !EXPRESSION_IS_VARIABLE(argument))
+            leaves = false;
+    }
+    if (leaves)
+        return arguments;
+
+    expression_list_t* key = malloc(sizeof(expression_list_t));
+    expression_list_init(key);
+    expression_list_copy(arguments, key);
+    EXPRESSION_LIST_FOREACH(argument, key) {
+        expression_canonicalize(argument);
+    }
+    return key;
+}
+
+bool call_cache_lookup(call_cache_t* cache, scope_t* scope, variable_info_t* function, uint64_t fingerprint,
+                        expression_list_t* arguments, expression_t* result) {
+    const precision_policy_t* policy = scope_get_precision_policy(scope);
+    expression_list_t* key = _call_cache_key(arguments);
+    uint64_t hash = _call_cache_hash(function, fingerprint, key);
+    call_cache_entry_t* entry = &cache->entries[hash % cache->size];
+
+    bool hit = entry->used && entry->hash == hash && entry->function == function &&
+            entry->generation == function->generation && entry->fingerprint == fingerprint &&
+            entry->policy.minimum == policy->minimum && entry->policy.maximum == policy->maximum &&
+            entry->policy.round == policy->round && entry->policy.bounds == policy->bounds &&
+            _call_cache_arguments_identical(entry->arguments, key);
+    if (key != arguments)
+        expression_list_free(key);
+
+    if (hit) {
+        expression_copy(&entry->result, result);
+        ++cache->hits;
+        return true;
+    }
+
+    ++cache->misses;
+    return false;
+}
+
+void call_cache_store(call_cache_t* cache, scope_t* scope, variable_info_t* function, uint64_t fingerprint,
+                        expression_list_t* arguments, expression_t* result) {
+    expression_list_t* key = _call_cache_key(arguments);
+    uint64_t hash = _call_cache_hash(function, fingerprint, key);
+    call_cache_entry_t* entry = &cache->entries[hash % cache->size];
+
+    if (entry->used) {
+        _call_cache_entry_clean(entry);
+        ++cache->evictions;
+    }
+
+    entry->used        = true;
+    entry->hash        = hash;
+    entry->function    = function;
+    entry->generation  = function->generation;
+    entry->fingerprint = fingerprint;
+    entry->policy      = *scope_get_precision_policy(scope);
+
+    if (key == arguments) {
+        key = malloc(sizeof(expression_list_t));
+        expression_list_init(key);
+        expression_list_copy(arguments, key);
+    }
+    entry->arguments = key;
+    expression_copy(result, &entry->result);
+}
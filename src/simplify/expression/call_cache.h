@@ -0,0 +1,123 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_CALL_CACHE_H_
+#define SIMPLIFY_EXPRESSION_CALL_CACHE_H_
+
+#include <stdint.h>
+
+#include "simplify/expression/expression.h"
+
+/* the number of results a call cache holds if no size is given */
+#ifndef CALL_CACHE_DEFAULT_SIZE
+#   define CALL_CACHE_DEFAULT_SIZE 1024
+#endif
+
+/* A single function call's arguments and result */
+typedef struct call_cache_entry call_cache_entry_t;
+
+/* A call cache remembers the results of calls to pure functions.
+ *
+ * A call is identified by the function's definition, the values of it's arguments, the precision policy,
+ * and a fingerprint of every definition the function's body can reach (see `call_cache_fingerprint`).
+ * Redefining the function, or anything it uses, changes the fingerprint so old results are never returned.
+ * Arguments are compared in canonical form (see canonical.h), so calls whose arguments only differ in the order of
+ * a sum or product's operands share a result.
+ *
+ * The cache is a fixed size table, a new result replaces whatever result was in the same slot.
+ */
+struct call_cache_entry {
+    bool     used;
+    uint64_t hash;
+
+    variable_info_t*   function;
+    unsigned long      generation;
+    uint64_t           fingerprint;
+    precision_policy_t policy;
+
+    /* the arguments, in canonical form */
+    expression_list_t* arguments;
+    expression_t       result;
+};
+
+struct call_cache {
+    call_cache_entry_t* entries;
+    size_t              size;
+
+    size_t hits;
+    size_t misses;
+
+    /* calls that couldn't be cached because the function isn't pure */
+    size_t impure;
+
+    /* results that were replaced by another call's result */
+    size_t evictions;
+};
+
+/* initialize a call cache
+ *
+ * @cache the cache to initialize
+ * @size the number of results the cache can hold, must be greater than zero
+ */
+void call_cache_init(call_cache_t* cache, size_t size);
+
+/* free every result in the cache, and reset it's statistics
+ *
+ * @cache the cache to clear
+ */
+void call_cache_clear(call_cache_t* cache);
+
+/* free all resources used by the cache
+ *
+ * @cache the cache to clean
+ */
+void call_cache_clean(call_cache_t* cache);
+
+/* get the fraction of lookups that found a result
+ *
+ * @cache
+ * @return returns the hit rate between 0 and 1
+ */
+static inline double call_cache_hit_rate(call_cache_t* cache) {
+    size_t lookups = cache->hits + cache->misses;
+    return lookups ? (double)cache->hits / (double)lookups : 0;
+}
+
+/* check if a function is pure, and fingerprint the definitions it uses.
+ *
+ * A function is pure if it's marked pure (see `scope_mark_pure`), or it's body doesn't assign anything
+ * and doesn't reach an impure definition through any variable or function it uses.
+ * Internal functions are pure unless they're marked impure.
+ *
+ * @scope the scope the function is called from
+ * @function the function's definition
+ * @fingerprint location to store a hash of the generations of every definition the function can reach
+ * @return returns true if the function is pure
+ */
+bool call_cache_fingerprint(scope_t* scope, variable_info_t* function, uint64_t* fingerprint);
+
+/* find the result of a previous call
+ *
+ * @cache the cache to search
+ * @scope the scope the function is called from
+ * @function the function's definition
+ * @fingerprint the function's fingerprint
+ * @arguments the function's evaluated arguments
+ * @result location to store a copy of the result
+ * @return returns true if the result was found
+ */
+bool call_cache_lookup(call_cache_t* cache, scope_t* scope, variable_info_t* function, uint64_t fingerprint,
+                        expression_list_t* arguments, expression_t* result);
+
+/* store the result of a call
+ *
+ * @cache the cache to store in
+ * @scope the scope the function was called from
+ * @function the function's definition
+ * @fingerprint the function's fingerprint
+ * @arguments the function's evaluated arguments, they're copied
+ * @result the result of the call, it's copied
+ */
+void call_cache_store(call_cache_t* cache, scope_t* scope, variable_info_t* function, uint64_t fingerprint,
+                        expression_list_t* arguments, expression_t* result);
+
+#endif  // SIMPLIFY_EXPRESSION_CALL_CACHE_H_
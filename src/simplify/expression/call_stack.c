@@ -0,0 +1,372 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/call_stack.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/symbol.h"
+
+/* the segment the top of this thread's stack is in */
+static CALL_STACK_THREAD_LOCAL call_stack_segment_t* _g_call_stack;
+
+variable_info_t* call_stack_push(size_t count) {
+    call_stack_segment_t* segment = _g_call_stack;
+
+    if (!segment || segment->used + count > segment->capacity) {
+        call_stack_segment_t* next = segment ? segment->next : NULL;
+
+        /* segments are kept after they're emptied, only replace the next one if the frame doesn't fit */
+        if (next && next->capacity < count) {
+            call_stack_segment_t* after = next->next;
+            free(next);
+            next = NULL;
+            if (segment) segment->next = after;
+        }
+
+        if (!next) {
+            size_t capacity = count > CALL_STACK_SEGMENT_SIZE ? count : CALL_STACK_SEGMENT_SIZE;
+            next = malloc(sizeof(call_stack_segment_t) + capacity * sizeof(variable_info_t));
+            next->previous = segment;
+            next->next     = segment ? segment->next : NULL;
+            next->capacity = capacity;
+            if (next->next) next->next->previous = next;
+            if (segment) segment->next = next;
+        }
+
+        next->used = 0;
+        segment = _g_call_stack = next;
+    }
+
+    variable_info_t* slots = &segment->slots[segment->used];
+    segment->used += count;
+    return slots;
+}
+
+void call_stack_pop(size_t count) {
+    call_stack_segment_t* segment = _g_call_stack;
+    if (!count)
+        return;
+
+    /* the frame is in the most recent segment that isn't empty */
+    while (segment->used == 0 && segment->previous)
+        segment = segment->previous;
+
+    assert(segment->used >= count);
+    segment->used -= count;
+
+    while (segment->used == 0 && segment->previous)
+        segment = segment->previous;
+    _g_call_stack = segment;
+}
+
+void call_stack_free(void) {
+    call_stack_segment_t* segment = _g_call_stack;
+    if (!segment)
+        return;
+
+    while (segment->previous)
+        segment = segment->previous;
+
+    while (segment) {
+        call_stack_segment_t* next = segment->next;
+        free(segment);
+        segment = next;
+    }
+    _g_call_stack = NULL;
+}
+
+/* push a frame onto this thread's value stack, and move the arguments into it
+ *
+ * @frame the frame to initialize
+ * @function the function being called
+ * @arguments the call's evaluated arguments
+ * @detached if true the arguments aren't given generations, or counted as definitions
+ */
+void _call_frame_enter(call_frame_t* frame, variable_info_t* function, expression_list_t* arguments, bool detached) {
+    size_t count = 0;
+    expression_list_t* param;
+    expression_list_t* arg;
+    for (param = function->named_inputs, arg = arguments;
+            param && param->value && arg && arg->value;
+            param = param->next, arg = arg->next)
+        ++count;
+
+    frame->function = function;
+    frame->names    = function->named_inputs;
+    frame->slots    = call_stack_push(count);
+    frame->count    = 0;
+    frame->detached = detached;
+
+    arg = arguments;
+    while (arg && arg->value) {
+        expression_list_t* next = arg->next;
+        if (frame->count < count) {
+            variable_info_t* slot = &frame->slots[frame->count++];
+            slot->constant         = 0;
+            slot->is_internal      = 0;
+            slot->named_inputs     = NULL;
+            slot->value.expression = arg->value;
+            slot->impure           = 0;
+            slot->pure             = 0;
+            slot->thread_safe      = 0;
+            slot->shape            = FUNCTION_SHAPE_UNKNOWN;
+            slot->generation       = detached ? 0 : scope_next_generation();
+            slot->cached           = NULL;
+            slot->lazy_inputs      = 0;
+            slot->thunk            = NULL;
+        } else {
+            expression_free(arg->value);
+        }
+
+        if (arg != arguments)
+            free(arg);
+        arg = next;
+    }
+
+    arguments->value = NULL;
+    arguments->next  = NULL;
+    if (detached)
+        return;
+
+    /* the arguments shadow definitions with the same name, so they're counted with the other definitions */
+    param = function->named_inputs;
+    for (size_t i = 0; i < frame->count; ++i, param = param->next) {
+        if (!EXPRESSION_IS_VARIABLE(param->value))
+            continue;
+        if (!param->value->variable.symbol)
+            param->value->variable.symbol = symbol_intern(param->value->variable.value);
+        symbol_define(param->value->variable.symbol, NULL, 0);
+    }
+}
+
+void call_frame_enter(call_frame_t* frame, variable_info_t* function, expression_list_t* arguments) {
+    _call_frame_enter(frame, function, arguments, false);
+}
+
+void call_frame_enter_detached(call_frame_t* frame, variable_info_t* function, expression_list_t* arguments) {
+    _call_frame_enter(frame, function, arguments, true);
+}
+
+void call_frame_leave(call_frame_t* frame) {
+    expression_list_t* param = frame->names;
+    for (size_t i = 0; i < frame->count; ++i, param = param->next) {
+        expression_free(frame->slots[i].value.expression);
+        if (!frame->detached && EXPRESSION_IS_VARIABLE(param->value))
+            symbol_undefine(param->value->variable.symbol);
+    }
+
+    /* the slots reserved for missing arguments are popped too, so count them again */
+    size_t count = frame->count;
+    frame->count = 0;
+    call_stack_pop(count);
+}
+
+error_t call_frame_search(call_frame_t* frame, char* name, variable_info_t** info) {
+    size_t i = 0;
+    for (expression_list_t* param = frame->names; param && param->value && i < frame->count; param = param->next, ++i) {
+        if (EXPRESSION_IS_VARIABLE(param->value) && strcmp(param->value->variable.value, name) == 0) {
+            *info = &frame->slots[i];
+            return ERROR_NO_ERROR;
+        }
+    }
+    return ERROR_NONEXISTANT_KEY;
+}
+
+/* the definitions already searched by call_frame_is_visible, so recursive definitions terminate */
+typedef struct {
+    variable_info_t** infos;
+    size_t            count;
+    size_t            capacity;
+} _call_frame_visited_t;
+
+/* mark a definition as searched
+ *
+ * @visited the set of searched definitions
+ * @info the definition
+ * @return returns false if the definition was already searched
+ */
+bool _call_frame_visit(_call_frame_visited_t* visited, variable_info_t* info) {
+    for (size_t i = 0; i < visited->count; ++i) {
+        if (visited->infos[i] == info)
+            return false;
+    }
+
+    if (visited->count >= visited->capacity) {
+        visited->capacity = visited->capacity ? visited->capacity * 2 : 8;
+        visited->infos = realloc(visited->infos, visited->capacity * sizeof(variable_info_t*));
+    }
+    visited->infos[visited->count++] = info;
+    return true;
+}
+
+bool _call_frame_is_visible_recursive(call_frame_t* frame, scope_t* scope, expression_t* expr, _call_frame_visited_t* visited);
+
+/* check if a name refers to one of a frame's parameters, or to a definition that reads one
+ *
+ * @frame the frame
+ * @scope the scope the name is looked up in
+ * @name the name
+ * @visited the definitions that have been searched
+ * @return returns true if the frame's arguments may be read
+ */
+bool _call_frame_is_visible_name(call_frame_t* frame, scope_t* scope, char* name, _call_frame_visited_t* visited) {
+    variable_info_t* info;
+    size_t i = 0;
+    for (expression_list_t* param = frame->names; param && param->value && i < frame->count; param = param->next, ++i) {
+        if (EXPRESSION_IS_VARIABLE(param->value) && strcmp(param->value->variable.value, name) == 0)
+            return true;
+    }
+
+    if (scope_get_variable_info(scope, name, &info) || info->is_internal || !_call_frame_visit(visited, info))
+        return false;
+    return _call_frame_is_visible_recursive(frame, scope, info->value.expression, visited);
+}
+
+/* search an expression for references to a frame's parameters
+ *
+ * @frame the frame
+ * @scope the scope the expression is evaluated in
+ * @expr the expression
+ * @visited the definitions that have been searched
+ * @return returns true if the frame's arguments may be read
+ */
+bool _call_frame_is_visible_recursive(call_frame_t* frame, scope_t* scope, expression_t* expr, _call_frame_visited_t* visited) {
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return false;
+        case EXPRESSION_TYPE_VARIABLE:
+            /* resolved parameters are read from the frame of the function they belong to */
+            if (expr->variable.slot >= 0)
+                return false;
+            return _call_frame_is_visible_name(frame, scope, expr->variable.value, visited);
+        case EXPRESSION_TYPE_PREFIX:
+            return _call_frame_is_visible_recursive(frame, scope, expr->prefix.right, visited);
+        case EXPRESSION_TYPE_OPERATOR:
+            return _call_frame_is_visible_recursive(frame, scope, expr->operator.left, visited)
+                || _call_frame_is_visible_recursive(frame, scope, expr->operator.right, visited);
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            if (_call_frame_is_visible_name(frame, scope, expr->function.name, visited))
+                return true;
+
+            expression_t* param;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                if (_call_frame_is_visible_recursive(frame, scope, param, visited))
+                    return true;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool call_frame_is_visible(call_frame_t* frame, scope_t* scope, variable_info_t* function) {
+    if (function->is_internal)
+        return false;
+
+    _call_frame_visited_t visited = { NULL, 0, 0 };
+    _call_frame_visit(&visited, function);
+    bool visible = _call_frame_is_visible_recursive(frame, scope, function->value.expression, &visited);
+    free(visited.infos);
+    return visible;
+}
+
+/* get the index of a parameter
+ *
+ * @params the function's parameters
+ * @name the name to search for
+ * @return returns the parameter's index, or -1 if `name` isn't a parameter
+ */
+int _call_frame_parameter_index(expression_list_t* params, char* name) {
+    int i = 0;
+    for (; params && params->value; params = params->next, ++i) {
+        if (EXPRESSION_IS_VARIABLE(params->value) && strcmp(params->value->variable.value, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void call_frame_resolve_parameters(expression_t* body, expression_list_t* params) {
+    switch (body->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            break;
+        case EXPRESSION_TYPE_VARIABLE:
+            body->variable.slot = _call_frame_parameter_index(params, body->variable.value);
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            call_frame_resolve_parameters(body->prefix.right, params);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            call_frame_resolve_parameters(body->operator.left, params);
+            call_frame_resolve_parameters(body->operator.right, params);
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            expression_t* param;
+            EXPRESSION_LIST_FOREACH(param, body->function.parameters) {
+                call_frame_resolve_parameters(param, params);
+            }
+            break;
+        }
+    }
+}
+
+/* find the parameters an expression always uses
+ *
+ * @expr the expression
+ * @return returns a mask with bit `i` set if the `i`th parameter is always used
+ */
+uint64_t _call_frame_used_parameters(expression_t* expr) {
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return 0;
+        case EXPRESSION_TYPE_VARIABLE:
+            return expr->variable.slot >= 0 && expr->variable.slot < 64 ? (uint64_t)1 << expr->variable.slot : 0;
+        case EXPRESSION_TYPE_PREFIX:
+            return _call_frame_used_parameters(expr->prefix.right);
+        case EXPRESSION_TYPE_OPERATOR:
+            /* a function's definition isn't evaluated, and the variable being assigned isn't read */
+            if (expr->operator.infix == ':')
+                return EXPRESSION_IS_FUNCTION(expr->operator.left) ? 0 : _call_frame_used_parameters(expr->operator.right);
+            return _call_frame_used_parameters(expr->operator.left) | _call_frame_used_parameters(expr->operator.right);
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            expression_t* param;
+            uint64_t used = 0;
+
+            /* only a conditional's first condition is always evaluated, and then one of it's branches.
+                The conditions after the first are skipped if an earlier condition is true */
+            if (expression_is_conditional(expr)) {
+                uint64_t branches = ~(uint64_t)0;
+                size_t i = 0;
+                EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                    if (i == 0)
+                        used = _call_frame_used_parameters(param);
+                    else if (i % 2 == 1 || !__item->next || !__item->next->value)
+                        branches &= _call_frame_used_parameters(param);
+                    ++i;
+                }
+                return used | branches;
+            }
+
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                used |= _call_frame_used_parameters(param);
+            }
+            return used;
+        }
+    }
+    return 0;
+}
+
+uint64_t call_frame_lazy_parameters(expression_t* body, expression_list_t* params) {
+    uint64_t all = 0;
+    size_t count = 0;
+    for (; params && params->value && count < 64; params = params->next)
+        all |= (uint64_t)1 << count++;
+
+    return all & ~_call_frame_used_parameters(body);
+}
+
+error_t call_frame_force(variable_info_t* slot) {
+    scope_t* scope = slot->thunk;
+    slot->thunk = NULL;
+    return expression_evaluate(slot->value.expression, scope);
+}
@@ -0,0 +1,134 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_CALL_STACK_H_
+#define SIMPLIFY_EXPRESSION_CALL_STACK_H_
+
+#include "simplify/expression/expr_types.h"
+
+/* the number of argument slots allocated at once, frames never span two segments */
+#ifndef CALL_STACK_SEGMENT_SIZE
+#   define CALL_STACK_SEGMENT_SIZE 1024
+#endif
+
+/* the storage class used for the value stack, each thread gets it's own stack */
+#ifndef CALL_STACK_THREAD_LOCAL
+#   define CALL_STACK_THREAD_LOCAL __thread
+#endif
+
+/* A contiguous block of argument slots on the value stack */
+typedef struct call_stack_segment call_stack_segment_t;
+
+/* A call frame holds a function's arguments while it's body is evaluated.
+ *
+ * The arguments are stored in consecutive slots on a per-thread value stack, in the same order as the function's parameters.
+ * Parameter references in the function's body are resolved to slot indices when the function is defined,
+ * so reading an argument is an indexed load. Other code can still find arguments by name (see `call_frame_search`),
+ * since scoping is dynamic, and functions called from the body may use the caller's parameters.
+ */
+struct call_frame {
+    variable_info_t*   function;
+    expression_list_t* names;
+    variable_info_t*   slots;
+    size_t             count;
+
+    /* detached frames don't count their arguments as definitions, see call_frame_enter_detached */
+    bool               detached;
+};
+
+struct call_stack_segment {
+    call_stack_segment_t* previous;
+    call_stack_segment_t* next;
+    size_t                used;
+    size_t                capacity;
+    variable_info_t       slots[];
+};
+
+/* reserve `count` consecutive slots on this thread's value stack
+ *
+ * @count the number of slots to reserve
+ * @return returns a pointer to the first slot, the slots aren't initialized
+ */
+variable_info_t* call_stack_push(size_t count);
+
+/* release the `count` slots that were reserved most recently, the values in the slots aren't freed
+ *
+ * @count the number of slots to release, it must match the count given to call_stack_push
+ */
+void call_stack_pop(size_t count);
+
+/* free every segment of this thread's value stack, it must be empty
+ */
+void call_stack_free(void);
+
+/* push a frame for a function call onto this thread's value stack
+ *
+ * @frame the frame to initialize
+ * @function the function being called
+ * @arguments the call's evaluated arguments. Their values are moved into the frame,
+ *      and every node of the list except the first is freed. Arguments without a matching parameter are freed.
+ */
+void call_frame_enter(call_frame_t* frame, variable_info_t* function, expression_list_t* arguments);
+
+/* push a frame for a function call onto this thread's value stack, without touching any state shared between threads.
+ * The arguments aren't counted as definitions of their parameters' symbols, so they can only be read by index
+ * (see scope_get_argument), which makes detached frames suitable for calling internal functions from worker threads.
+ *
+ * @frame the frame to initialize
+ * @function the function being called
+ * @arguments the call's evaluated arguments, they're moved into the frame like call_frame_enter
+ */
+void call_frame_enter_detached(call_frame_t* frame, variable_info_t* function, expression_list_t* arguments);
+
+/* free a frame's arguments, and pop it from the value stack. It must be the most recent frame on this thread's stack.
+ *
+ * @frame the frame to leave
+ */
+void call_frame_leave(call_frame_t* frame);
+
+/* find a parameter in a frame by name
+ *
+ * @frame the frame to search
+ * @name the parameter's name
+ * @info location to store the argument's slot
+ * @return returns ERROR_NONEXISTANT_KEY if the frame doesn't have a parameter named `name`
+ */
+error_t call_frame_search(call_frame_t* frame, char* name, variable_info_t** info);
+
+/* check if a function may read one of a frame's arguments by name.
+ * Scoping is dynamic, so a call made from inside the frame's function can see it's arguments.
+ * The function's body and every definition it can reach are searched.
+ *
+ * @frame the frame
+ * @scope the scope the function is called from
+ * @function the function
+ * @return returns true if the function, or anything it uses, refers to one of the frame's parameters by name
+ */
+bool call_frame_is_visible(call_frame_t* frame, scope_t* scope, variable_info_t* function);
+
+/* resolve references to a function's parameters to frame slots.
+ * Variables that aren't parameters are unresolved, so they're looked up by name
+ *
+ * @body the function's body
+ * @params the function's parameters
+ */
+void call_frame_resolve_parameters(expression_t* body, expression_list_t* params);
+
+/* find the parameters a function's body may not use, their arguments can be passed without evaluating them.
+ * A parameter is used if the body reads it outside of a conditional's branches, or every branch reads it.
+ * The body's parameters must already be resolved.
+ *
+ * @body the function's body
+ * @params the function's parameters
+ * @return returns a mask with bit `i` set if the `i`th parameter may not be used, see variable_info_t.lazy_inputs
+ */
+uint64_t call_frame_lazy_parameters(expression_t* body, expression_list_t* params);
+
+/* evaluate an argument that was passed unevaluated, in the scope it was passed from.
+ * The argument is only evaluated once, even if it can't be evaluated.
+ *
+ * @slot the argument's slot
+ * @return returns an error code
+ */
+error_t call_frame_force(variable_info_t* slot);
+
+#endif  // SIMPLIFY_EXPRESSION_CALL_STACK_H_
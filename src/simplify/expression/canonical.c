@@ -0,0 +1,324 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <ctype.h>
+
+#include "simplify/expression/canonical.h"
+#include "simplify/expression/chain.h"
+
+/* find where expressions of a type are ordered, variables come first and numbers last
+ *
+ * @type the expression's type
+ * @return returns the type's rank
+ */
+int _canonical_rank(expression_type_t type) {
+    switch (type) {
+        case EXPRESSION_TYPE_VARIABLE: return 0;
+        case EXPRESSION_TYPE_FUNCTION: return 1;
+        case EXPRESSION_TYPE_PREFIX:   return 2;
+        case EXPRESSION_TYPE_OPERATOR: return 3;
+        case EXPRESSION_TYPE_NUMBER:   return 4;
+    }
+    return 5;
+}
+
+/* order two numbers by value, NaN comes last, -0 before 0, and less precise numbers before more precise ones
+ *
+ * @x
+ * @y
+ * @return returns a negative number if x comes first, a positive number if y does, or zero if they're identical
+ */
+int _canonical_order_numbers(mpfr_srcptr x, mpfr_srcptr y) {
+    if (mpfr_nan_p(x) || mpfr_nan_p(y)) {
+        if (!mpfr_nan_p(x) || !mpfr_nan_p(y))
+            return mpfr_nan_p(x) ? 1 : -1;
+    } else if (!mpfr_equal_p(x, y)) {
+        return mpfr_less_p(x, y) ? -1 : 1;
+    } else if (mpfr_signbit(x) != mpfr_signbit(y)) {
+        return mpfr_signbit(x) ? -1 : 1;
+    }
+
+    if (mpfr_get_prec(x) != mpfr_get_prec(y))
+        return mpfr_get_prec(x) < mpfr_get_prec(y) ? -1 : 1;
+    return 0;
+}
+
+/* order two names, runs of digits are ordered by their value, so `x2` comes before `x10`
+ *
+ * @name1
+ * @name2
+ * @return returns a negative number if name1 comes first, a positive number if name2 does, or zero if they're the same
+ */
+int _canonical_order_names(const char* name1, const char* name2) {
+    const char* c1 = name1;
+    const char* c2 = name2;
+
+    while (*c1 && *c2) {
+        if (isdigit((unsigned char)*c1) && isdigit((unsigned char)*c2)) {
+            while (*c1 == '0') ++c1;
+            while (*c2 == '0') ++c2;
+
+            size_t length1 = 0;
+            size_t length2 = 0;
+            while (isdigit((unsigned char)c1[length1])) ++length1;
+            while (isdigit((unsigned char)c2[length2])) ++length2;
+            if (length1 != length2)
+                return length1 < length2 ? -1 : 1;
+
+            int order = strncmp(c1, c2, length1);
+            if (order)
+                return order;
+            c1 += length1;
+            c2 += length2;
+        } else if (*c1 != *c2) {
+            return (unsigned char)*c1 < (unsigned char)*c2 ? -1 : 1;
+        } else {
+            ++c1;
+            ++c2;
+        }
+    }
+
+    if (*c1 || *c2)
+        return *c1 ? 1 : -1;
+
+    /* names that only differ by leading zeros */
+    return strcmp(name1, name2);
+}
+
+/* order two expressions by their labels, and add their operands to a list to be ordered next
+ *
+ * @expr1
+ * @expr2
+ * @pending the list, each of expr1's operands is added followed by expr2's
+ * @return returns the order of the expressions' labels
+ */
+int _canonical_order_node(expression_t* expr1, expression_t* expr2, expression_chain_t* pending) {
+    if (expr1->type != expr2->type)
+        return _canonical_rank(expr1->type) - _canonical_rank(expr2->type);
+
+    switch (expr1->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return _canonical_order_numbers(expr1->number.value, expr2->number.value);
+        case EXPRESSION_TYPE_VARIABLE:
+            return _canonical_order_names(expr1->variable.value, expr2->variable.value);
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            int order = _canonical_order_names(expr1->function.name, expr2->function.name);
+            if (order)
+                return order;
+
+            expression_list_t* param1 = expr1->function.parameters;
+            expression_list_t* param2 = expr2->function.parameters;
+            for (; param1 && param2 && param1->value && param2->value; param1 = param1->next, param2 = param2->next) {
+                order = expression_order(param1->value, param2->value);
+                if (order)
+                    return order;
+            }
+
+            /* a call with fewer arguments comes first */
+            bool more1 = param1 && param1->value;
+            bool more2 = param2 && param2->value;
+            return more1 - more2;
+        }
+        case EXPRESSION_TYPE_PREFIX:
+            if (expr1->prefix.prefix != expr2->prefix.prefix)
+                return expr1->prefix.prefix < expr2->prefix.prefix ? -1 : 1;
+            expression_chain_append(pending, expr1->prefix.right);
+            expression_chain_append(pending, expr2->prefix.right);
+            return 0;
+        case EXPRESSION_TYPE_OPERATOR:
+            if (expr1->operator.infix != expr2->operator.infix)
+                return expr1->operator.infix < expr2->operator.infix ? -1 : 1;
+            expression_chain_append(pending, expr1->operator.right);
+            expression_chain_append(pending, expr2->operator.right);
+            expression_chain_append(pending, expr1->operator.left);
+            expression_chain_append(pending, expr2->operator.left);
+            return 0;
+    }
+    return 0;
+}
+
+int expression_order(expression_t* expr1, expression_t* expr2) {
+    /* operands are ordered from a list instead of by recursion, so long sums don't overflow the stack */
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+
+    int order = _canonical_order_node(expr1, expr2, &pending);
+    while (!order && pending.count) {
+        expression_t* next2 = pending.operands[--pending.count];
+        expression_t* next1 = pending.operands[--pending.count];
+        order = _canonical_order_node(next1, next2, &pending);
+    }
+
+    expression_chain_clean(&pending);
+    return order;
+}
+
+/* compare two operands for qsort
+ *
+ * @a a pointer to the first operand
+ * @b a pointer to the second operand
+ * @return returns the operands' order
+ */
+int _canonical_compare(const void* a, const void* b) {
+    return expression_order(*(expression_t* const*)a, *(expression_t* const*)b);
+}
+
+/* collect a chain's operands, and the operators that join them
+ *
+ * @chain the chain, it's operator must be set
+ * @joints set to every operator in the chain except `expr` itself
+ * @expr the chain's root
+ * @return returns true if the chain is nested to the left
+ */
+bool _canonical_collect(expression_chain_t* chain, expression_chain_t* joints, expression_t* expr) {
+    bool left = true;
+    expression_chain_t pending;
+    expression_chain_init(&pending, chain->operator);
+    expression_chain_append(&pending, expr->operator.right);
+    expression_chain_append(&pending, expr->operator.left);
+
+    while (pending.count) {
+        expression_t* next = pending.operands[--pending.count];
+        if (EXPRESSION_IS_OPERATOR(next) && next->operator.infix == chain->operator) {
+            /* in a chain nested to the left every operand but the first is a right operand */
+            left = left && chain->count == 0;
+            expression_chain_append(joints, next);
+            expression_chain_append(&pending, next->operator.right);
+            expression_chain_append(&pending, next->operator.left);
+        } else {
+            expression_chain_append(chain, next);
+        }
+    }
+
+    expression_chain_clean(&pending);
+    return left;
+}
+
+/* add or multiply two numbers, if the result is exact
+ *
+ * @operator the chain's operator, '+' or '*'
+ * @number1 the first number, it's replaced by the result
+ * @number2 the second number
+ * @return returns true if the numbers were folded
+ */
+bool _canonical_fold(operator_t operator, expression_t* number1, expression_t* number2) {
+    /* numbers that are only known to lie within bounds are kept as they are, folding them would lose the bounds */
+    if (number1->number.upper || number2->number.upper || number1->number.inexact || number2->number.inexact)
+        return false;
+
+    mpfr_prec_t precision = mpfr_get_prec(number1->number.value);
+    if (mpfr_get_prec(number2->number.value) > precision)
+        precision = mpfr_get_prec(number2->number.value);
+
+    mpfr_t result;
+    mpfr_init2(result, precision);
+    int inexact = operator == '+'
+        ? mpfr_add(result, number1->number.value, number2->number.value, MPFR_RNDN)
+        : mpfr_mul(result, number1->number.value, number2->number.value, MPFR_RNDN);
+
+    if (!inexact)
+        mpfr_swap(result, number1->number.value);
+    mpfr_clear(result);
+    return !inexact;
+}
+
+/* sort a chain's operands, and fold the numbers at it's end
+ *
+ * @chain the chain
+ * @return returns true if the operands were reordered or folded
+ */
+bool _canonical_sort(expression_chain_t* chain) {
+    bool changed = false;
+    for (size_t i = 1; i < chain->count && !changed; ++i)
+        changed = expression_order(chain->operands[i - 1], chain->operands[i]) > 0;
+    if (changed)
+        qsort(chain->operands, chain->count, sizeof(expression_t*), _canonical_compare);
+
+    size_t numbers = chain->count;
+    while (numbers > 0 && EXPRESSION_IS_NUMBER(chain->operands[numbers - 1]))
+        --numbers;
+
+    bool folded = false;
+    size_t count = numbers;
+    for (size_t i = numbers; i < chain->count; ++i) {
+        if (count > numbers && _canonical_fold(chain->operator, chain->operands[count - 1], chain->operands[i])) {
+            expression_free(chain->operands[i]);
+            folded = true;
+        } else {
+            chain->operands[count++] = chain->operands[i];
+        }
+    }
+    chain->count = count;
+
+    if (folded)
+        qsort(chain->operands + numbers, count - numbers, sizeof(expression_t*), _canonical_compare);
+    return changed || folded;
+}
+
+bool expression_canonicalize(expression_t* expr) {
+    bool changed = false;
+
+    /* the sums and products in the expression, each is found before the sums and products in it's operands */
+    expression_chain_t roots;
+    expression_chain_init(&roots, 0);
+
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+    expression_chain_append(&pending, expr);
+    while (pending.count) {
+        expression_t* next = pending.operands[--pending.count];
+        expression_t* param;
+
+        switch (next->type) {
+            case EXPRESSION_TYPE_FUNCTION:
+                EXPRESSION_LIST_FOREACH(param, next->function.parameters) {
+                    expression_chain_append(&pending, param);
+                }
+                break;
+            case EXPRESSION_TYPE_PREFIX:
+                expression_chain_append(&pending, next->prefix.right);
+                break;
+            case EXPRESSION_TYPE_OPERATOR:
+                if (EXPRESSION_IS_CHAIN(next)) {
+                    expression_chain_append(&roots, next);
+                    expression_chain_t operands;
+                    expression_chain_init(&operands, next->operator.infix);
+                    expression_chain_collect(&operands, next);
+                    for (size_t i = 0; i < operands.count; ++i)
+                        expression_chain_append(&pending, operands.operands[i]);
+                    expression_chain_clean(&operands);
+                } else {
+                    expression_chain_append(&pending, next->operator.right);
+                    expression_chain_append(&pending, next->operator.left);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    expression_chain_clean(&pending);
+
+    /* every sum and product is canonical before the one it's an operand of is sorted */
+    while (roots.count) {
+        expression_t* root = roots.operands[--roots.count];
+        expression_chain_t chain;
+        expression_chain_t joints;
+        expression_chain_init(&chain, root->operator.infix);
+        expression_chain_init(&joints, 0);
+
+        bool left = _canonical_collect(&chain, &joints, root);
+        bool sorted = _canonical_sort(&chain);
+        if (!left || sorted) {
+            changed = true;
+            for (size_t i = 0; i < joints.count; ++i)
+                free(joints.operands[i]);
+            expression_chain_build(&chain, root);
+        }
+
+        expression_chain_clean(&chain);
+        expression_chain_clean(&joints);
+    }
+
+    expression_chain_clean(&roots);
+    return changed;
+}
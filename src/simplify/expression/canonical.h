@@ -0,0 +1,36 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_CANONICAL_H_
+#define SIMPLIFY_EXPRESSION_CANONICAL_H_
+
+#include "simplify/expression/expression.h"
+
+/* Sums and products don't depend on the order of their operands, but `a * b` and `b * a` are different trees, so
+ * anything keyed on an expression's structure treats them as different expressions.
+ *
+ * An expression is canonical if the operands of every sum and product are sorted by expression_order, and nested to
+ * the left. Numbers sort after everything else, so a sum or product's constants are gathered at it's end, and
+ * constants that can be added or multiplied exactly are folded into one. Two sums or products that only differ in the
+ * order of their operands have identical canonical forms.
+ */
+
+/* order two expressions.
+ *
+ * The order is total: expressions are ordered by type, variables first and numbers last, then by their label
+ * (a number's value, a name, or an operator), then by their children from left to right.
+ * Only expressions with the same structure are ordered the same.
+ *
+ * @expr1
+ * @expr2
+ * @return returns a negative number if expr1 comes first, a positive number if expr2 does, or zero if neither does
+ */
+int expression_order(expression_t* expr1, expression_t* expr2);
+
+/* sort the operands of every sum and product in an expression, and fold their constants
+ *
+ * @expr the expression
+ * @return returns true if the expression was changed
+ */
+bool expression_canonicalize(expression_t* expr);
+
+#endif  // SIMPLIFY_EXPRESSION_CANONICAL_H_
@@ -0,0 +1,93 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/chain.h"
+#include "simplify/expression/expression.h"
+
+/* An operand and the key it's sorted by */
+typedef struct {
+    uint64_t      key;
+    size_t        index;
+    expression_t* operand;
+} _chain_sort_item_t;
+
+void expression_chain_init(expression_chain_t* chain, operator_t operator) {
+    chain->operator = operator;
+    chain->operands = chain->local;
+    chain->count    = 0;
+    chain->capacity = EXPRESSION_CHAIN_LOCAL_SIZE;
+}
+
+void expression_chain_clean(expression_chain_t* chain) {
+    if (chain->operands != chain->local)
+        free(chain->operands);
+    expression_chain_init(chain, chain->operator);
+}
+
+void expression_chain_append(expression_chain_t* chain, expression_t* operand) {
+    if (chain->count == chain->capacity) {
+        chain->capacity *= 2;
+        if (chain->operands == chain->local) {
+            chain->operands = malloc(sizeof(expression_t*) * chain->capacity);
+            memcpy(chain->operands, chain->local, sizeof(chain->local));
+        } else {
+            chain->operands = realloc(chain->operands, sizeof(expression_t*) * chain->capacity);
+        }
+    }
+    chain->operands[chain->count++] = operand;
+}
+
+void expression_chain_collect(expression_chain_t* chain, expression_t* expr) {
+    /* the operators still to be opened, the last is opened next, so operands are added from left to right */
+    expression_chain_t pending;
+    expression_chain_init(&pending, chain->operator);
+    expression_chain_append(&pending, expr);
+
+    while (pending.count) {
+        expression_t* next = pending.operands[--pending.count];
+        if (EXPRESSION_IS_OPERATOR(next) && next->operator.infix == chain->operator) {
+            expression_chain_append(&pending, next->operator.right);
+            expression_chain_append(&pending, next->operator.left);
+        } else {
+            expression_chain_append(chain, next);
+        }
+    }
+
+    expression_chain_clean(&pending);
+}
+
+int _chain_sort_compare(const void* a, const void* b) {
+    const _chain_sort_item_t* item1 = a;
+    const _chain_sort_item_t* item2 = b;
+    if (item1->key != item2->key)
+        return item1->key < item2->key ? -1 : 1;
+    return item1->index < item2->index ? -1 : item1->index > item2->index;
+}
+
+void expression_chain_sort(expression_chain_t* chain, uint64_t (*key)(expression_t*)) {
+    if (chain->count < 2)
+        return;
+
+    _chain_sort_item_t* items = malloc(sizeof(_chain_sort_item_t) * chain->count);
+    for (size_t i = 0; i < chain->count; ++i)
+        items[i] = (_chain_sort_item_t){ key(chain->operands[i]), i, chain->operands[i] };
+
+    qsort(items, chain->count, sizeof(_chain_sort_item_t), _chain_sort_compare);
+    for (size_t i = 0; i < chain->count; ++i)
+        chain->operands[i] = items[i].operand;
+    free(items);
+}
+
+void expression_chain_build(expression_chain_t* chain, expression_t* out) {
+    assert(chain->count > 0);
+
+    if (chain->count == 1) {
+        *out = *chain->operands[0];
+        free(chain->operands[0]);
+    } else {
+        expression_t* left = chain->operands[0];
+        for (size_t i = 1; i + 1 < chain->count; ++i)
+            left = expression_new_operator(left, chain->operator, chain->operands[i]);
+        expression_init_operator(out, left, chain->operator, chain->operands[chain->count - 1]);
+    }
+    chain->count = 0;
+}
@@ -0,0 +1,86 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_CHAIN_H_
+#define SIMPLIFY_EXPRESSION_CHAIN_H_
+
+#include <stdint.h>
+
+#include "simplify/expression/expr_types.h"
+
+/* the number of operands a chain can hold before it allocates */
+#ifndef EXPRESSION_CHAIN_LOCAL_SIZE
+#   define EXPRESSION_CHAIN_LOCAL_SIZE 16
+#endif
+
+/* check if an operator is associative, so a chain of it may be flattened into a list of operands */
+#define EXPRESSION_OPERATOR_IS_ASSOCIATIVE(OP) ((OP) == '+' || (OP) == '*')
+
+/* check if an expression is a sum or product */
+#define EXPRESSION_IS_CHAIN(EXPR) \
+    (EXPRESSION_IS_OPERATOR(EXPR) && EXPRESSION_OPERATOR_IS_ASSOCIATIVE((EXPR)->operator.infix))
+
+/* The operands of a chain of sums or products, in order */
+typedef struct expression_chain expression_chain_t;
+
+/* Sums and products are stored as binary operators, so the rest of the library can treat every operator alike, but
+ * `a + b + c + d` is a chain three operators deep. Walking a long chain one operator at a time takes stack space
+ * proportional to it's length, and only ever sees two operands at once.
+ *
+ * A chain is an n-ary view of a sum or product: the operands of every directly nested operator of the same kind,
+ * from left to right, however the chain is parenthesized. It's collected without recursion, and may be sorted so two
+ * chains can be matched operand by operand in n log n time. The operands are borrowed from the expression, unless
+ * the chain is built back into an expression.
+ */
+struct expression_chain {
+    operator_t     operator;
+    expression_t** operands;
+    size_t         count;
+    size_t         capacity;
+
+    /* the operands are stored here until there are too many */
+    expression_t*  local[EXPRESSION_CHAIN_LOCAL_SIZE];
+};
+
+/* initialize an empty chain
+ *
+ * @chain the chain to initialize
+ * @operator the chain's operator
+ */
+void expression_chain_init(expression_chain_t* chain, operator_t operator);
+
+/* free the resources used by a chain, it's operands aren't freed
+ *
+ * @chain the chain to clean
+ */
+void expression_chain_clean(expression_chain_t* chain);
+
+/* add an operand to the end of a chain
+ *
+ * @chain the chain
+ * @operand the operand
+ */
+void expression_chain_append(expression_chain_t* chain, expression_t* operand);
+
+/* add the operands of an expression to the end of a chain. If the expression uses the chain's operator, each operand of
+ * it, and of the operators of the same kind it's made of, is added; otherwise the expression itself is added.
+ *
+ * @chain the chain
+ * @expr the expression
+ */
+void expression_chain_collect(expression_chain_t* chain, expression_t* expr);
+
+/* sort a chain's operands by a key, operands with the same key keep their order
+ *
+ * @chain the chain
+ * @key a function that finds an operand's key, it's called once per operand
+ */
+void expression_chain_sort(expression_chain_t* chain, uint64_t (*key)(expression_t*));
+
+/* build an expression from a chain's operands, nested to the left. The chain is left empty.
+ *
+ * @chain the chain, it must have at least one operand, the operands are taken by the new expression
+ * @out set to the expression
+ */
+void expression_chain_build(expression_chain_t* chain, expression_t* out);
+
+#endif  // SIMPLIFY_EXPRESSION_CHAIN_H_
@@ -0,0 +1,783 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <math.h>
+#include <stdarg.h>
+
+#include "simplify/expression/codegen.h"
+#include "simplify/expression/symbol.h"
+
+/* A builtin function generated code can call */
+typedef struct {
+    const char* name;
+    size_t      arguments;
+
+    /* the C library function doubles are passed to, or NULL if `helper` is written and called instead */
+    const char* function;
+
+    /* the source of a static function, named `name`__`builtin`. The generated function's name replaces %s */
+    const char* helper;
+
+    /* the MPFR function, or NULL if the operation is written inline */
+    const char* mpfr_function;
+
+    /* if false the MPFR function doesn't take a rounding mode */
+    bool        rounded;
+} _codegen_builtin_t;
+
+/* A value computed by MPFR code, either an argument or a temporary */
+typedef struct {
+    const char* parameter;
+    size_t      temporary;
+} _codegen_value_t;
+
+/* A list of names */
+typedef struct {
+    char** names;
+    size_t count;
+    size_t capacity;
+} _codegen_names_t;
+
+typedef struct {
+    scope_t*           scope;
+    codegen_type_t     type;
+    char*              name;
+
+    stringifier_t      helpers;
+    stringifier_t      declarations;
+    stringifier_t      definitions;
+    bool*              helper_written;
+
+    /* the user functions that have been generated, each is generated once */
+    _codegen_names_t   functions;
+
+    /* the names bound by a generated function's parameters */
+    _codegen_names_t   bound;
+
+    /* the names user functions use that aren't their own parameters */
+    _codegen_names_t   free;
+
+    /* the function being generated */
+    stringifier_t*     body;
+    expression_list_t* parameters;
+    size_t             temporaries;
+    bool               in_function;
+    size_t             inline_depth;
+} _codegen_t;
+
+#define _CODEGEN_HELPER_SEC      "static double %s__sec(double x) { return 1 / cos(x); }\n"
+#define _CODEGEN_HELPER_CSC      "static double %s__csc(double x) { return 1 / sin(x); }\n"
+#define _CODEGEN_HELPER_COT      "static double %s__cot(double x) { return 1 / tan(x); }\n"
+#define _CODEGEN_HELPER_SECH     "static double %s__sech(double x) { return 1 / cosh(x); }\n"
+#define _CODEGEN_HELPER_CSCH     "static double %s__csch(double x) { return 1 / sinh(x); }\n"
+#define _CODEGEN_HELPER_COTH     "static double %s__coth(double x) { return 1 / tanh(x); }\n"
+#define _CODEGEN_HELPER_FRAC     "static double %s__frac(double x) { return x - trunc(x); }\n"
+#define _CODEGEN_HELPER_LOG      "static double %s__log(double b, double y) { return log(y) / log(b); }\n"
+
+/* the `n`th root of `x`, like `a \ n`. It's written if the expression uses the \ operator */
+#define _CODEGEN_HELPER_ROOT \
+    "static double %s__root(double x, double n) {\n" \
+    "    double k = nearbyint(n);\n" \
+    "    if (!(k >= 1))\n" \
+    "        return NAN;\n" \
+    "    if (k == 2)\n" \
+    "        return sqrt(x);\n" \
+    "    if (k == 3)\n" \
+    "        return cbrt(x);\n" \
+    "    if (x < 0)\n" \
+    "        return fmod(k, 2) == 1 ? -pow(-x, 1 / k) : NAN;\n" \
+    "    return pow(x, 1 / k);\n" \
+    "}\n"
+
+static const _codegen_builtin_t _g_codegen_builtins[] = {
+    { "sin",       1,  "sin",       NULL,                  "mpfr_sin",        true  },
+    { "cos",       1,  "cos",       NULL,                  "mpfr_cos",        true  },
+    { "tan",       1,  "tan",       NULL,                  "mpfr_tan",        true  },
+    { "asin",      1,  "asin",      NULL,                  "mpfr_asin",       true  },
+    { "acos",      1,  "acos",      NULL,                  "mpfr_acos",       true  },
+    { "atan",      1,  "atan",      NULL,                  "mpfr_atan",       true  },
+    { "sec",       1,  NULL,        _CODEGEN_HELPER_SEC,   "mpfr_sec",        true  },
+    { "csc",       1,  NULL,        _CODEGEN_HELPER_CSC,   "mpfr_csc",        true  },
+    { "cot",       1,  NULL,        _CODEGEN_HELPER_COT,   "mpfr_cot",        true  },
+    { "sinh",      1,  "sinh",      NULL,                  "mpfr_sinh",       true  },
+    { "cosh",      1,  "cosh",      NULL,                  "mpfr_cosh",       true  },
+    { "tanh",      1,  "tanh",      NULL,                  "mpfr_tanh",       true  },
+    { "asinh",     1,  "asinh",     NULL,                  "mpfr_asinh",      true  },
+    { "acosh",     1,  "acosh",     NULL,                  "mpfr_acosh",      true  },
+    { "atanh",     1,  "atanh",     NULL,                  "mpfr_atanh",      true  },
+    { "sech",      1,  NULL,        _CODEGEN_HELPER_SECH,  "mpfr_sech",       true  },
+    { "csch",      1,  NULL,        _CODEGEN_HELPER_CSCH,  "mpfr_csch",       true  },
+    { "coth",      1,  NULL,        _CODEGEN_HELPER_COTH,  "mpfr_coth",       true  },
+    { "ceil",      1,  "ceil",      NULL,                  "mpfr_ceil",       false },
+    { "floor",     1,  "floor",     NULL,                  "mpfr_floor",      false },
+    { "round",     1,  "round",     NULL,                  "mpfr_round",      false },
+    { "roundeven", 1,  "nearbyint", NULL,                  "mpfr_roundeven",  false },
+    { "trunc",     1,  "trunc",     NULL,                  "mpfr_trunc",      false },
+    { "frac",      1,  NULL,        _CODEGEN_HELPER_FRAC,  "mpfr_frac",       true  },
+    { "ln",        1,  "log",       NULL,                  "mpfr_log",        true  },
+    { "log",       2,  NULL,        _CODEGEN_HELPER_LOG,   NULL,              true  },
+    { "min",       2,  "fmin",      NULL,                  "mpfr_min",        true  },
+    { "max",       2,  "fmax",      NULL,                  "mpfr_max",        true  },
+};
+
+#define _CODEGEN_BUILTIN_COUNT (sizeof(_g_codegen_builtins) / sizeof(_g_codegen_builtins[0]))
+
+/* write formatted text
+ *
+ * @st the stringifier to write to
+ * @format the printf format
+ * @return returns the number of bytes written
+ */
+size_t _codegen_printf(stringifier_t* st, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    _STRINGIFIER_FIT(st, (size_t)length + 1);
+    va_start(args, format);
+    vsnprintf(st->buffer + st->index, st->length - st->index, format, args);
+    va_end(args);
+    st->index += length;
+    return length;
+}
+
+/* check if a list has a name
+ *
+ * @names the list
+ * @name the name
+ * @return returns true if the name is in the list
+ */
+bool _codegen_has_name(_codegen_names_t* names, char* name) {
+    for (size_t i = 0; i < names->count; ++i) {
+        if (strcmp(names->names[i], name) == 0)
+            return true;
+    }
+    return false;
+}
+
+/* add a name to a list, unless it's already in the list
+ *
+ * @names the list
+ * @name the name, it isn't copied
+ */
+void _codegen_add_name(_codegen_names_t* names, char* name) {
+    if (_codegen_has_name(names, name))
+        return;
+
+    if (names->count >= names->capacity) {
+        names->capacity = names->capacity ? names->capacity * 2 : 8;
+        names->names = realloc(names->names, names->capacity * sizeof(char*));
+    }
+    names->names[names->count++] = name;
+}
+
+/* check if a name is a parameter of the function being generated
+ *
+ * @cg the generator
+ * @name the name
+ * @return returns true if it's a parameter
+ */
+bool _codegen_is_parameter(_codegen_t* cg, char* name) {
+    expression_t* param;
+    if (!cg->parameters)
+        return false;
+    EXPRESSION_LIST_FOREACH(param, cg->parameters) {
+        if (strcmp(param->variable.value, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+/* write a function's signature, without a semicolon or body
+ *
+ * @cg the generator
+ * @st the stringifier to write to
+ * @function the user function's name, or NULL for the exported function
+ * @parameters the function's parameters
+ */
+void _codegen_write_signature(_codegen_t* cg, stringifier_t* st, char* function, expression_list_t* parameters) {
+    const char* number = cg->type == CODEGEN_DOUBLE ? "double" : "mpfr_srcptr";
+    expression_t* param;
+
+    if (function)
+        stringifier_write(st, "static ");
+    _codegen_printf(st, "%s %s%s%s(", cg->type == CODEGEN_DOUBLE ? "double" : "void", cg->name,
+                    function ? "_" : "", function ? function : "");
+
+    if (cg->type == CODEGEN_MPFR)
+        stringifier_write(st, "mpfr_ptr result");
+    if (parameters) {
+        EXPRESSION_LIST_FOREACH(param, parameters) {
+            if (cg->type == CODEGEN_MPFR || __item != parameters)
+                stringifier_write(st, ", ");
+            _codegen_printf(st, "%s v_%s", number, param->variable.value);
+        }
+    }
+
+    if (cg->type == CODEGEN_MPFR)
+        stringifier_write(st, ", mpfr_rnd_t rnd");
+    else if (!parameters || !parameters->value)
+        stringifier_write(st, "void");
+    stringifier_write_byte(st, ')');
+}
+
+/* write a function's definition, from the body generated for it
+ *
+ * @cg the generator, it's `body` and `temporaries` describe the function
+ * @st the stringifier to write to
+ * @function the user function's name, or NULL for the exported function
+ * @parameters the function's parameters
+ * @result for MPFR code, the function's result
+ */
+void _codegen_write_definition(_codegen_t* cg, stringifier_t* st, char* function, expression_list_t* parameters,
+                               _codegen_value_t result) {
+    _codegen_write_signature(cg, st, function, parameters);
+    stringifier_write(st, " {\n");
+
+    if (cg->type == CODEGEN_DOUBLE) {
+        stringifier_write(st, "    return ");
+        stringifier_write_len(st, cg->body->buffer, cg->body->index);
+        stringifier_write(st, ";\n}\n");
+        return;
+    }
+
+    if (cg->temporaries) {
+        _codegen_printf(st, "    mpfr_t t[%zu];\n", cg->temporaries);
+        _codegen_printf(st, "    for (int i = 0; i < %zu; ++i)\n", cg->temporaries);
+        stringifier_write(st, "        mpfr_init2(t[i], mpfr_get_prec(result));\n\n");
+    }
+    stringifier_write_len(st, cg->body->buffer, cg->body->index);
+
+    if (result.parameter)
+        _codegen_printf(st, "    mpfr_set(result, v_%s, rnd);\n", result.parameter);
+    else
+        _codegen_printf(st, "    mpfr_set(result, t[%zu], rnd);\n", result.temporary);
+
+    if (cg->temporaries) {
+        _codegen_printf(st, "\n    for (int i = 0; i < %zu; ++i)\n", cg->temporaries);
+        stringifier_write(st, "        mpfr_clear(t[i]);\n");
+    }
+    stringifier_write(st, "}\n");
+}
+
+/* write a number as a double literal
+ *
+ * @st the stringifier to write to
+ * @value the number
+ */
+void _codegen_write_double(stringifier_t* st, mpfr_ptr value) {
+    double d = mpfr_get_d(value, MPFR_RNDN);
+    if (isnan(d)) {
+        stringifier_write(st, "NAN");
+        return;
+    }
+    if (isinf(d)) {
+        stringifier_write(st, d < 0 ? "(-INFINITY)" : "INFINITY");
+        return;
+    }
+
+    /* numbers without a decimal point or exponent would be integers */
+    char buffer[40];
+    snprintf(buffer, sizeof(buffer), "%.17g", d);
+    if (!strpbrk(buffer, ".e"))
+        strcat(buffer, ".0");
+    _codegen_printf(st, d < 0 || signbit(d) ? "(%s)" : "%s", buffer);
+}
+
+/* write a value's name, as an argument to an MPFR function
+ *
+ * @st the stringifier to write to
+ * @value the value
+ */
+void _codegen_write_value(stringifier_t* st, _codegen_value_t value) {
+    if (value.parameter)
+        _codegen_printf(st, "v_%s", value.parameter);
+    else
+        _codegen_printf(st, "t[%zu]", value.temporary);
+}
+
+/* start a statement that stores an MPFR operation's result in a new temporary
+ *
+ * @cg the generator
+ * @function the MPFR function
+ * @out location to store the temporary
+ */
+void _codegen_begin_operation(_codegen_t* cg, const char* function, _codegen_value_t* out) {
+    out->parameter = NULL;
+    out->temporary = cg->temporaries++;
+    _codegen_printf(cg->body, "    %s(t[%zu]", function, out->temporary);
+}
+
+/* write a number to a new MPFR temporary
+ *
+ * @cg the generator
+ * @value the number
+ * @out location to store the temporary
+ */
+void _codegen_mpfr_number(_codegen_t* cg, mpfr_ptr value, _codegen_value_t* out) {
+    out->parameter = NULL;
+    out->temporary = cg->temporaries++;
+
+    int sign = mpfr_signbit(value) ? -1 : 1;
+    if (mpfr_nan_p(value)) {
+        _codegen_printf(cg->body, "    mpfr_set_nan(t[%zu]);\n", out->temporary);
+    } else if (mpfr_inf_p(value)) {
+        _codegen_printf(cg->body, "    mpfr_set_inf(t[%zu], %d);\n", out->temporary, sign);
+    } else if (mpfr_zero_p(value)) {
+        _codegen_printf(cg->body, "    mpfr_set_zero(t[%zu], %d);\n", out->temporary, sign);
+    } else {
+        /* enough digits are written that the number is read back exactly */
+        mpfr_exp_t exponent;
+        char* digits = mpfr_get_str(NULL, &exponent, 10, 0, value, MPFR_RNDN);
+        bool neg = digits[0] == '-';
+        _codegen_printf(cg->body, "    mpfr_set_str(t[%zu], \"%s0.%se%ld\", 10, rnd);\n", out->temporary,
+                        neg ? "-" : "", digits + neg, (long)exponent);
+        mpfr_free_str(digits);
+    }
+}
+
+error_t _codegen_expression(_codegen_t* cg, expression_t* expr, _codegen_value_t* out);
+
+/* generate a reference to a variable, arguments are used directly and everything else is inlined
+ *
+ * @cg the generator
+ * @expr the variable expression
+ * @out for MPFR code, location to store the variable's value
+ * @return returns an error code
+ */
+error_t _codegen_variable(_codegen_t* cg, expression_t* expr, _codegen_value_t* out) {
+    char* name = expr->variable.value;
+    if (_codegen_is_parameter(cg, name)) {
+        if (cg->type == CODEGEN_DOUBLE)
+            _codegen_printf(cg->body, "v_%s", name);
+        else
+            out->parameter = name;
+        return ERROR_NO_ERROR;
+    }
+
+    /* the definition is found when the code is generated, not when it's run */
+    if (cg->in_function)
+        _codegen_add_name(&cg->free, name);
+
+    symbol_t* symbol = expr->variable.symbol ? expr->variable.symbol : symbol_intern(name);
+    variable_info_t* info;
+    if (scope_get_symbol_info(cg->scope, symbol, &info) || info->impure)
+        return ERROR_NOT_COMPILABLE;
+    if (info->named_inputs)
+        return ERROR_IS_A_FUNCTION;
+
+    if (info->is_internal) {
+        expression_t value;
+        error_t err = scope_get_symbol_value(cg->scope, symbol, &value);
+        if (err) return err;
+
+        if (!EXPRESSION_IS_NUMBER(&value)) {
+            expression_clean(&value);
+            return ERROR_NOT_COMPILABLE;
+        }
+        if (cg->type == CODEGEN_DOUBLE)
+            _codegen_write_double(cg->body, value.number.value);
+        else
+            _codegen_mpfr_number(cg, value.number.value, out);
+        expression_clean(&value);
+        return ERROR_NO_ERROR;
+    }
+
+    if (cg->inline_depth >= CODEGEN_MAX_INLINE_DEPTH)
+        return ERROR_NOT_COMPILABLE;
+
+    ++cg->inline_depth;
+    error_t err = _codegen_expression(cg, info->value.expression, out);
+    --cg->inline_depth;
+    return err;
+}
+
+/* generate a user function, unless it's already been generated
+ *
+ * @cg the generator
+ * @name the function's name
+ * @info the function's definition
+ * @return returns an error code
+ */
+error_t _codegen_function(_codegen_t* cg, char* name, variable_info_t* info) {
+    if (_codegen_has_name(&cg->functions, name))
+        return ERROR_NO_ERROR;
+
+    /* the function is added first, so recursive calls don't generate it again */
+    _codegen_add_name(&cg->functions, name);
+
+    expression_t* param;
+    EXPRESSION_LIST_FOREACH(param, info->named_inputs) {
+        _codegen_add_name(&cg->bound, param->variable.value);
+    }
+
+    stringifier_t* body = cg->body;
+    expression_list_t* parameters = cg->parameters;
+    size_t temporaries = cg->temporaries;
+    bool in_function = cg->in_function;
+    size_t inline_depth = cg->inline_depth;
+
+    stringifier_t function_body = STRINGIFIER_DEFAULT();
+    cg->body         = &function_body;
+    cg->parameters   = info->named_inputs;
+    cg->temporaries  = 0;
+    cg->in_function  = true;
+    cg->inline_depth = 0;
+
+    _codegen_value_t result = { NULL, 0 };
+    error_t err = _codegen_expression(cg, info->value.expression, &result);
+    if (!err) {
+        _codegen_write_signature(cg, &cg->declarations, name, info->named_inputs);
+        stringifier_write(&cg->declarations, ";\n");
+        _codegen_write_definition(cg, &cg->definitions, name, info->named_inputs, result);
+        stringifier_write_byte(&cg->definitions, '\n');
+    }
+
+    free(function_body.buffer);
+    cg->body         = body;
+    cg->parameters   = parameters;
+    cg->temporaries  = temporaries;
+    cg->in_function  = in_function;
+    cg->inline_depth = inline_depth;
+    return err;
+}
+
+/* generate a call to a builtin
+ *
+ * @cg the generator
+ * @builtin_index the builtin's index in `_g_codegen_builtins`
+ * @expr the function expression
+ * @out for MPFR code, location to store the result
+ * @return returns an error code
+ */
+error_t _codegen_builtin(_codegen_t* cg, size_t builtin_index, expression_t* expr, _codegen_value_t* out) {
+    const _codegen_builtin_t* builtin = &_g_codegen_builtins[builtin_index];
+    _codegen_value_t arguments[2] = { { NULL, 0 }, { NULL, 0 } };
+    expression_t* param;
+    size_t i = 0;
+    error_t err;
+
+    if (cg->type == CODEGEN_DOUBLE) {
+        if (builtin->function) {
+            _codegen_printf(cg->body, "%s(", builtin->function);
+        } else {
+            if (!cg->helper_written[builtin_index]) {
+                _codegen_printf(&cg->helpers, builtin->helper, cg->name);
+                cg->helper_written[builtin_index] = true;
+            }
+            _codegen_printf(cg->body, "%s__%s(", cg->name, builtin->name);
+        }
+
+        EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+            if (i++)
+                stringifier_write(cg->body, ", ");
+            err = _codegen_expression(cg, param, NULL);
+            if (err) return err;
+        }
+        stringifier_write_byte(cg->body, ')');
+        return ERROR_NO_ERROR;
+    }
+
+    EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+        err = _codegen_expression(cg, param, &arguments[i++]);
+        if (err) return err;
+    }
+
+    if (!builtin->mpfr_function) {
+        /* log(b, y) is ln(y) / ln(b) */
+        _codegen_value_t numerator, denominator;
+        _codegen_begin_operation(cg, "mpfr_log", &numerator);
+        stringifier_write(cg->body, ", ");
+        _codegen_write_value(cg->body, arguments[1]);
+        stringifier_write(cg->body, ", rnd);\n");
+
+        _codegen_begin_operation(cg, "mpfr_log", &denominator);
+        stringifier_write(cg->body, ", ");
+        _codegen_write_value(cg->body, arguments[0]);
+        stringifier_write(cg->body, ", rnd);\n");
+
+        arguments[0] = numerator;
+        arguments[1] = denominator;
+        builtin = &(const _codegen_builtin_t){ "log", 2, NULL, NULL, "mpfr_div", true };
+    }
+
+    _codegen_begin_operation(cg, builtin->mpfr_function, out);
+    for (size_t j = 0; j < builtin->arguments; ++j) {
+        stringifier_write(cg->body, ", ");
+        _codegen_write_value(cg->body, arguments[j]);
+    }
+    stringifier_write(cg->body, builtin->rounded ? ", rnd);\n" : ");\n");
+    return ERROR_NO_ERROR;
+}
+
+/* generate a function call, builtins are called directly and user functions are generated
+ *
+ * @cg the generator
+ * @expr the function expression
+ * @out for MPFR code, location to store the result
+ * @return returns an error code
+ */
+error_t _codegen_call(_codegen_t* cg, expression_t* expr, _codegen_value_t* out) {
+    symbol_t* symbol = expr->function.symbol ? expr->function.symbol : symbol_intern(expr->function.name);
+    variable_info_t* info;
+    expression_t* param;
+    size_t count = 0;
+    size_t parameters = 0;
+    error_t err;
+
+    if (scope_get_symbol_info(cg->scope, symbol, &info) || info->impure)
+        return ERROR_NOT_COMPILABLE;
+    if (!info->named_inputs)
+        return ERROR_IS_A_VARIABLE;
+
+    EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+        ++count;
+    }
+
+    if (info->is_internal) {
+        for (size_t i = 0; i < _CODEGEN_BUILTIN_COUNT; ++i) {
+            if (strcmp(_g_codegen_builtins[i].name, expr->function.name) != 0)
+                continue;
+            if (_g_codegen_builtins[i].arguments != count)
+                return ERROR_MISSING_ARGUMENTS;
+            return _codegen_builtin(cg, i, expr, out);
+        }
+        return ERROR_NOT_COMPILABLE;
+    }
+
+    EXPRESSION_LIST_FOREACH(param, info->named_inputs) {
+        ++parameters;
+    }
+    if (parameters != count)
+        return ERROR_MISSING_ARGUMENTS;
+
+    err = _codegen_function(cg, expr->function.name, info);
+    if (err) return err;
+
+    if (cg->type == CODEGEN_DOUBLE) {
+        size_t i = 0;
+        _codegen_printf(cg->body, "%s_%s(", cg->name, expr->function.name);
+        EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+            if (i++)
+                stringifier_write(cg->body, ", ");
+            err = _codegen_expression(cg, param, NULL);
+            if (err) return err;
+        }
+        stringifier_write_byte(cg->body, ')');
+        return ERROR_NO_ERROR;
+    }
+
+    _codegen_value_t* arguments = malloc((count ? count : 1) * sizeof(_codegen_value_t));
+    size_t i = 0;
+    EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+        err = _codegen_expression(cg, param, &arguments[i++]);
+        if (err) {
+            free(arguments);
+            return err;
+        }
+    }
+
+    char* function = malloc(strlen(cg->name) + strlen(expr->function.name) + 2);
+    sprintf(function, "%s_%s", cg->name, expr->function.name);
+    _codegen_begin_operation(cg, function, out);
+    free(function);
+
+    for (i = 0; i < count; ++i) {
+        stringifier_write(cg->body, ", ");
+        _codegen_write_value(cg->body, arguments[i]);
+    }
+    stringifier_write(cg->body, ", rnd);\n");
+    free(arguments);
+    return ERROR_NO_ERROR;
+}
+
+/* generate an operator, the operands of MPFR code are computed left to right
+ *
+ * @cg the generator
+ * @expr the operator expression
+ * @out for MPFR code, location to store the result
+ * @return returns an error code
+ */
+error_t _codegen_operator(_codegen_t* cg, expression_t* expr, _codegen_value_t* out) {
+    const char* infix;
+    const char* function;
+    switch (expr->operator.infix) {
+        case '+': infix = " + ";  function = "mpfr_add";      break;
+        case '-': infix = " - ";  function = "mpfr_sub";      break;
+        case '(':
+        case '*': infix = " * ";  function = "mpfr_mul";      break;
+        case '/': infix = " / ";  function = "mpfr_div";      break;
+        case '^': infix = NULL;   function = "mpfr_pow";      break;
+        case '\\': infix = NULL;  function = "mpfr_rootn_ui"; break;
+        default:
+            return ERROR_NOT_COMPILABLE;
+    }
+
+    error_t err;
+    if (cg->type == CODEGEN_DOUBLE) {
+        if (infix) {
+            stringifier_write_byte(cg->body, '(');
+        } else if (expr->operator.infix == '^') {
+            stringifier_write(cg->body, "pow(");
+        } else {
+            if (!cg->helper_written[_CODEGEN_BUILTIN_COUNT]) {
+                _codegen_printf(&cg->helpers, _CODEGEN_HELPER_ROOT, cg->name);
+                cg->helper_written[_CODEGEN_BUILTIN_COUNT] = true;
+            }
+            _codegen_printf(cg->body, "%s__root(", cg->name);
+        }
+
+        err = _codegen_expression(cg, expr->operator.left, NULL);
+        if (err) return err;
+        stringifier_write(cg->body, infix ? (char*)infix : ", ");
+        err = _codegen_expression(cg, expr->operator.right, NULL);
+        if (err) return err;
+        stringifier_write_byte(cg->body, ')');
+        return ERROR_NO_ERROR;
+    }
+
+    _codegen_value_t left, right;
+    err = _codegen_expression(cg, expr->operator.left, &left);
+    if (err) return err;
+    err = _codegen_expression(cg, expr->operator.right, &right);
+    if (err) return err;
+
+    _codegen_begin_operation(cg, function, out);
+    stringifier_write(cg->body, ", ");
+    _codegen_write_value(cg->body, left);
+    if (expr->operator.infix == '\\') {
+        stringifier_write(cg->body, ", mpfr_get_ui(");
+        _codegen_write_value(cg->body, right);
+        stringifier_write(cg->body, ", MPFR_RNDN), rnd);\n");
+    } else {
+        stringifier_write(cg->body, ", ");
+        _codegen_write_value(cg->body, right);
+        stringifier_write(cg->body, ", rnd);\n");
+    }
+    return ERROR_NO_ERROR;
+}
+
+/* generate an expression. Double code is written as a C expression, MPFR code as statements
+ *
+ * @cg the generator
+ * @expr the expression
+ * @out for MPFR code, location to store the argument or temporary holding the expression's value
+ * @return returns an error code
+ */
+error_t _codegen_expression(_codegen_t* cg, expression_t* expr, _codegen_value_t* out) {
+    error_t err;
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            if (cg->type == CODEGEN_DOUBLE)
+                _codegen_write_double(cg->body, expr->number.value);
+            else
+                _codegen_mpfr_number(cg, expr->number.value, out);
+            return ERROR_NO_ERROR;
+        case EXPRESSION_TYPE_VARIABLE:
+            return _codegen_variable(cg, expr, out);
+        case EXPRESSION_TYPE_FUNCTION:
+            return _codegen_call(cg, expr, out);
+        case EXPRESSION_TYPE_OPERATOR:
+            return _codegen_operator(cg, expr, out);
+        case EXPRESSION_TYPE_PREFIX:
+            if (expr->prefix.prefix == '+')
+                return _codegen_expression(cg, expr->prefix.right, out);
+            if (expr->prefix.prefix != '-')
+                return ERROR_NOT_COMPILABLE;
+
+            if (cg->type == CODEGEN_DOUBLE) {
+                stringifier_write(cg->body, "(-");
+                err = _codegen_expression(cg, expr->prefix.right, NULL);
+                stringifier_write_byte(cg->body, ')');
+                return err;
+            }
+
+            _codegen_value_t right;
+            err = _codegen_expression(cg, expr->prefix.right, &right);
+            if (err) return err;
+            _codegen_begin_operation(cg, "mpfr_neg", out);
+            stringifier_write(cg->body, ", ");
+            _codegen_write_value(cg->body, right);
+            stringifier_write(cg->body, ", rnd);\n");
+            return ERROR_NO_ERROR;
+    }
+    return ERROR_NOT_COMPILABLE;
+}
+
+error_t codegen_write_expression(stringifier_t* st, expression_t* expr, scope_t* scope, char* name,
+                                 expression_list_t* parameters, codegen_type_t type) {
+    _codegen_t cg;
+    stringifier_t body = STRINGIFIER_DEFAULT();
+    stringifier_t exported = STRINGIFIER_DEFAULT();
+
+    cg.scope          = scope;
+    cg.type           = type;
+    cg.name           = name;
+    cg.helpers        = (stringifier_t)STRINGIFIER_DEFAULT();
+    cg.declarations   = (stringifier_t)STRINGIFIER_DEFAULT();
+    cg.definitions    = (stringifier_t)STRINGIFIER_DEFAULT();
+    cg.helper_written = calloc(_CODEGEN_BUILTIN_COUNT + 1, sizeof(bool));
+    cg.functions      = (_codegen_names_t){ NULL, 0, 0 };
+    cg.bound          = (_codegen_names_t){ NULL, 0, 0 };
+    cg.free           = (_codegen_names_t){ NULL, 0, 0 };
+    cg.body           = &body;
+    cg.parameters     = parameters;
+    cg.temporaries    = 0;
+    cg.in_function    = false;
+    cg.inline_depth   = 0;
+
+    expression_t* param;
+    if (parameters) {
+        EXPRESSION_LIST_FOREACH(param, parameters) {
+            _codegen_add_name(&cg.bound, param->variable.value);
+        }
+    }
+
+    _codegen_value_t result = { NULL, 0 };
+    error_t err = _codegen_expression(&cg, expr, &result);
+
+    /* a name a user function uses is found in the scope, so it can't be bound by a caller when it's evaluated */
+    for (size_t i = 0; !err && i < cg.free.count; ++i) {
+        if (_codegen_has_name(&cg.bound, cg.free.names[i]))
+            err = ERROR_NOT_COMPILABLE;
+    }
+
+    if (!err) {
+        _codegen_write_definition(&cg, &exported, NULL, parameters, result);
+
+        stringifier_write(st, type == CODEGEN_DOUBLE ? "#include <math.h>\n\n" : "#include <mpfr.h>\n\n");
+        if (cg.helpers.index) {
+            stringifier_write_len(st, cg.helpers.buffer, cg.helpers.index);
+            stringifier_write_byte(st, '\n');
+        }
+        if (cg.declarations.index) {
+            stringifier_write_len(st, cg.declarations.buffer, cg.declarations.index);
+            stringifier_write_byte(st, '\n');
+        }
+        stringifier_write_len(st, cg.definitions.buffer, cg.definitions.index);
+        stringifier_write_len(st, exported.buffer, exported.index);
+    }
+
+    free(body.buffer);
+    free(exported.buffer);
+    free(cg.helpers.buffer);
+    free(cg.declarations.buffer);
+    free(cg.definitions.buffer);
+    free(cg.helper_written);
+    free(cg.functions.names);
+    free(cg.bound.names);
+    free(cg.free.names);
+    return err;
+}
+
+error_t codegen_write_function(stringifier_t* st, scope_t* scope, char* name, codegen_type_t type) {
+    variable_info_t* info;
+    if (scope_get_variable_info(scope, name, &info))
+        return ERROR_VARIABLE_NOT_PRESENT;
+    if (!info->named_inputs)
+        return ERROR_IS_A_VARIABLE;
+    if (info->is_internal || info->impure)
+        return ERROR_NOT_COMPILABLE;
+
+    return codegen_write_expression(st, info->value.expression, scope, name, info->named_inputs, type);
+}
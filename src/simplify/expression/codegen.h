@@ -0,0 +1,57 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_CODEGEN_H_
+#define SIMPLIFY_EXPRESSION_CODEGEN_H_
+
+#include "simplify/expression/stringify.h"
+
+/* the deepest variables are inlined, deeper expressions can't be generated */
+#ifndef CODEGEN_MAX_INLINE_DEPTH
+#   define CODEGEN_MAX_INLINE_DEPTH 64
+#endif
+
+/* The kind of numbers generated code computes with */
+typedef enum {
+    /* functions take and return doubles, and use the C math library */
+    CODEGEN_DOUBLE,
+
+    /* functions take MPFR numbers, they're declared
+     *     void name(mpfr_ptr result, mpfr_srcptr x, ..., mpfr_rnd_t rnd)
+     * intermediate values use the result's precision, and every operation is rounded with `rnd`
+     */
+    CODEGEN_MPFR,
+} codegen_type_t;
+
+/* write C source code for a function that evaluates an expression
+ *
+ * The code is self-contained, it only includes math.h or mpfr.h.
+ * User functions the expression calls are written as static functions named `name`_function,
+ * and variables and internal constants are inlined with their current value.
+ * Builtin functions are recognized by name, like `jit_compile`.
+ *
+ * Generated functions can't look up their caller's arguments, so an expression where a user function uses a name
+ * bound by a caller (or by `parameters`) isn't generated.
+ *
+ * @st the stringifier to write to
+ * @expr the expression, it isn't changed
+ * @scope the scope variables and functions are found in
+ * @name the name of the generated function, it must be a C identifier
+ * @parameters the names of the function's arguments, they shadow definitions in `scope`. May be NULL.
+ * @type the kind of numbers the code uses
+ * @return returns ERROR_NOT_COMPILABLE if the expression uses something that can't be generated,
+ *          like an assignment, an impure definition, or an undefined name. Nothing is written if there's an error.
+ */
+error_t codegen_write_expression(stringifier_t* st, expression_t* expr, scope_t* scope, char* name,
+                                 expression_list_t* parameters, codegen_type_t type);
+
+/* write C source code for a user function, the generated function takes the same arguments
+ *
+ * @st the stringifier to write to
+ * @scope the scope the function is defined in
+ * @name the function's name, the generated function has the same name
+ * @type the kind of numbers the code uses
+ * @return returns an error code, see `codegen_write_expression`
+ */
+error_t codegen_write_function(stringifier_t* st, scope_t* scope, char* name, codegen_type_t type);
+
+#endif  // SIMPLIFY_EXPRESSION_CODEGEN_H_
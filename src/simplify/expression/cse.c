@@ -0,0 +1,448 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/cse.h"
+#include "simplify/expression/call_cache.h"
+#include "simplify/expression/hashcons.h"
+
+/* Which of an expression's children are always evaluated when it is */
+typedef struct {
+    /* children at or after this index may not be evaluated */
+    size_t   limit;
+
+    /* bit `i` is set if the `i`th child may not be evaluated, children after the 64th are always evaluated */
+    uint64_t lazy;
+} _cse_eager_t;
+
+/* What's known about every copy of a subexpression */
+typedef struct {
+    /* the number of copies that are always evaluated */
+    size_t        count;
+
+    /* the number of those copies that are inside a copy of a larger subexpression that's reused */
+    size_t        removed;
+
+    /* the number of expressions in the subexpression */
+    size_t        size;
+
+    bool          pure;
+    bool          reused;
+    _cse_eager_t  eager;
+
+    /* the temporary, once it's been evaluated */
+    expression_t* value;
+} _cse_info_t;
+
+/* The subexpressions in a run of statements */
+typedef struct {
+    expression_hashcons_t hashcons;
+
+    /* indexed by identity */
+    _cse_info_t*          infos;
+    size_t                info_capacity;
+
+    /* the identity of each copy in the statement being searched that's always evaluated */
+    size_t*               occurrences;
+    size_t                occurrence_count;
+    size_t                occurrence_capacity;
+} _cse_t;
+
+/* An expression on the walk's stack, and the next of it's children to visit */
+typedef struct {
+    expression_t*      expr;
+    size_t             visited;
+    expression_list_t* param;
+    bool               eager;
+    _cse_eager_t       children;
+} _cse_frame_t;
+
+/* initialize an empty set of subexpressions
+ *
+ * @cse
+ */
+void _cse_init(_cse_t* cse) {
+    expression_hashcons_init(&cse->hashcons);
+    cse->hashcons.commutative = true;
+    cse->infos               = NULL;
+    cse->info_capacity       = 0;
+    cse->occurrences         = NULL;
+    cse->occurrence_count    = 0;
+    cse->occurrence_capacity = 0;
+}
+
+/* free every subexpression, and their temporaries
+ *
+ * @cse
+ */
+void _cse_clean(_cse_t* cse) {
+    for (size_t i = 0; i < cse->hashcons.node_count; ++i) {
+        if (cse->infos[i].value)
+            expression_free(cse->infos[i].value);
+    }
+    expression_hashcons_clean(&cse->hashcons);
+    free(cse->infos);
+    free(cse->occurrences);
+}
+
+/* check if a child is always evaluated
+ *
+ * @eager the children of an expression that are always evaluated
+ * @index the child's index
+ * @return returns true if the child is always evaluated
+ */
+static inline bool _cse_is_eager(_cse_eager_t eager, size_t index) {
+    return index < eager.limit && (index >= 64 || !((eager.lazy >> index) & 1));
+}
+
+/* find which of an expression's children are always evaluated when it is
+ *
+ * @expr the expression
+ * @scope the scope it's evaluated in
+ * @return returns the children that are always evaluated
+ */
+_cse_eager_t _cse_eager_children(expression_t* expr, scope_t* scope) {
+    _cse_eager_t eager = { SIZE_MAX, 0 };
+    variable_info_t* info;
+
+    if (!EXPRESSION_IS_FUNCTION(expr))
+        return eager;
+
+    /* functions that aren't defined are left as they are, only a conditional's first condition is always evaluated */
+    if (scope_get_variable_info(scope, expr->function.name, &info))
+        eager.limit = expression_is_conditional(expr) ? 1 : 0;
+    else if (!info->named_inputs)
+        eager.limit = 0;
+    else if (!info->is_internal)
+        eager.lazy = info->lazy_inputs;
+    return eager;
+}
+
+/* check if an expression's label is pure, without looking at it's children
+ *
+ * @expr the expression
+ * @scope the scope it's evaluated in
+ * @return returns false if the expression assigns something, or uses an impure definition
+ */
+bool _cse_label_pure(expression_t* expr, scope_t* scope) {
+    variable_info_t* info;
+    uint64_t fingerprint;
+    char* name;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_OPERATOR:
+            return expr->operator.infix != ':';
+        case EXPRESSION_TYPE_VARIABLE:
+            name = expr->variable.value;
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            name = expr->function.name;
+            break;
+        default:
+            return true;
+    }
+
+    if (scope_get_variable_info(scope, name, &info))
+        return true;
+    return call_cache_fingerprint(scope, info, &fingerprint);
+}
+
+/* find an expression's identity, and make room for what's known about it
+ *
+ * @cse
+ * @expr the expression
+ * @children the identity of each of the expression's children
+ * @count the number of children
+ * @fresh set to true if the expression hadn't been seen before
+ * @return returns the expression's identity
+ */
+size_t _cse_identify(_cse_t* cse, expression_t* expr, size_t* children, size_t count, bool* fresh) {
+    size_t seen = cse->hashcons.node_count;
+    size_t id = expression_hashcons_identify(&cse->hashcons, expr, children, count);
+    if (id >= cse->info_capacity) {
+        size_t capacity = cse->hashcons.node_capacity;
+        cse->infos = realloc(cse->infos, sizeof(_cse_info_t) * capacity);
+        memset(cse->infos + cse->info_capacity, 0, sizeof(_cse_info_t) * (capacity - cse->info_capacity));
+        cse->info_capacity = capacity;
+    }
+    *fresh = cse->hashcons.node_count != seen;
+    return id;
+}
+
+/* get the next of an expression's children to visit
+ *
+ * @frame the expression's frame
+ * @return returns the child, or NULL if every child has been visited
+ */
+expression_t* _cse_next_child(_cse_frame_t* frame) {
+    expression_t* expr = frame->expr;
+    expression_t* child = NULL;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_FUNCTION:
+            if (frame->param && frame->param->value) {
+                child = frame->param->value;
+                frame->param = frame->param->next;
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            child = frame->visited == 0 ? expr->prefix.right : NULL;
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            child = frame->visited == 0 ? expr->operator.left : frame->visited == 1 ? expr->operator.right : NULL;
+            break;
+        default:
+            break;
+    }
+
+    if (child)
+        ++frame->visited;
+    return child;
+}
+
+/* push an expression onto the walk's stack
+ *
+ * @frames the stack
+ * @frame_count the number of frames on the stack
+ * @frame_capacity the stack's capacity
+ * @expr the expression
+ * @eager true if the expression is always evaluated
+ * @scope the scope it's evaluated in
+ */
+void _cse_push(_cse_frame_t** frames, size_t* frame_count, size_t* frame_capacity,
+               expression_t* expr, bool eager, scope_t* scope) {
+    if (*frame_count == *frame_capacity) {
+        *frame_capacity *= 2;
+        *frames = realloc(*frames, sizeof(_cse_frame_t) * *frame_capacity);
+    }
+
+    _cse_eager_t lazy = { 0, 0 };
+    (*frames)[(*frame_count)++] = (_cse_frame_t){
+        expr, 0, EXPRESSION_IS_FUNCTION(expr) ? expr->function.parameters : NULL,
+        eager, eager ? _cse_eager_children(expr, scope) : lazy
+    };
+}
+
+/* walk a statement from the bottom up, identifying each subexpression.
+ *
+ * When searching, the identity of each copy that's always evaluated is added to the occurrences.
+ * Otherwise, the first copy of each reused subexpression is evaluated, and the others are replaced by it's value.
+ *
+ * @cse
+ * @expr the statement
+ * @scope the scope it's evaluated in
+ * @search if true the statement is searched, otherwise the temporaries are evaluated
+ * @assigns set to true if the statement assigns anything
+ * @return returns an error code
+ */
+error_t _cse_walk(_cse_t* cse, expression_t* expr, scope_t* scope, bool search, bool* assigns) {
+    error_t err = ERROR_NO_ERROR;
+
+    size_t frame_count = 0;
+    size_t frame_capacity = 16;
+    _cse_frame_t* frames = malloc(sizeof(_cse_frame_t) * frame_capacity);
+
+    /* the identity of each expression whose parent hasn't been finished */
+    size_t id_count = 0;
+    size_t id_capacity = 16;
+    size_t* ids = malloc(sizeof(size_t) * id_capacity);
+
+    _cse_push(&frames, &frame_count, &frame_capacity, expr, true, scope);
+    while (frame_count && !err) {
+        _cse_frame_t* frame = &frames[frame_count - 1];
+        expression_t* child = _cse_next_child(frame);
+        if (child) {
+            bool eager = frame->eager && _cse_is_eager(frame->children, frame->visited - 1);
+            _cse_push(&frames, &frame_count, &frame_capacity, child, eager, scope);
+            continue;
+        }
+
+        /* every child has been visited, so their identities are on top of the stack */
+        _cse_frame_t done = *frame;
+        --frame_count;
+        id_count -= done.visited;
+
+        bool fresh;
+        size_t id = _cse_identify(cse, done.expr, ids + id_count, done.visited, &fresh);
+        _cse_info_t* info = &cse->infos[id];
+
+        if (search) {
+            if (fresh) {
+                info->size = 1;
+                info->pure = _cse_label_pure(done.expr, scope);
+                info->eager = done.children;
+                for (size_t i = 0; i < done.visited; ++i) {
+                    info->size += cse->infos[ids[id_count + i]].size;
+                    info->pure = info->pure && cse->infos[ids[id_count + i]].pure;
+                }
+            }
+            if (EXPRESSION_IS_OPERATOR(done.expr) && done.expr->operator.infix == ':')
+                *assigns = true;
+
+            if (done.eager) {
+                if (cse->occurrence_count == cse->occurrence_capacity) {
+                    cse->occurrence_capacity = cse->occurrence_capacity ? cse->occurrence_capacity * 2 : 64;
+                    cse->occurrences = realloc(cse->occurrences, sizeof(size_t) * cse->occurrence_capacity);
+                }
+                cse->occurrences[cse->occurrence_count++] = id;
+            }
+        } else if (done.eager && info->reused) {
+            if (info->value) {
+                expression_clean(done.expr);
+                expression_copy(info->value, done.expr);
+            } else {
+                err = expression_evaluate(done.expr, scope);
+                if (!err) {
+                    info->value = malloc(sizeof(expression_t));
+                    expression_copy(done.expr, info->value);
+                }
+            }
+        }
+
+        if (id_count == id_capacity) {
+            id_capacity *= 2;
+            ids = realloc(ids, sizeof(size_t) * id_capacity);
+        }
+        ids[id_count++] = id;
+    }
+
+    free(frames);
+    free(ids);
+    return err;
+}
+
+/* search a statement, and count it's subexpressions unless it assigns something
+ *
+ * @cse
+ * @expr the statement
+ * @scope the scope it's evaluated in
+ * @assigns set to true if the statement assigns anything, it's subexpressions aren't counted
+ */
+void _cse_search(_cse_t* cse, expression_t* expr, scope_t* scope, bool* assigns) {
+    *assigns = false;
+    cse->occurrence_count = 0;
+    _cse_walk(cse, expr, scope, true, assigns);
+
+    if (!*assigns) {
+        for (size_t i = 0; i < cse->occurrence_count; ++i)
+            ++cse->infos[cse->occurrences[i]].count;
+    }
+    cse->occurrence_count = 0;
+}
+
+/* choose the subexpressions to reuse, from the largest down, so copies inside a reused subexpression aren't counted
+ *
+ * @cse
+ * @stats the work saved is added to it
+ */
+void _cse_choose(_cse_t* cse, expression_cse_stats_t* stats) {
+    for (size_t id = cse->hashcons.node_count; id-- > 0;) {
+        expression_hashcons_node_t* node = &cse->hashcons.nodes[id];
+        _cse_info_t* info = &cse->infos[id];
+        size_t count = info->count - info->removed;
+
+        info->reused = node->count && count >= 2 && info->size >= EXPRESSION_CSE_MIN_SIZE && info->pure;
+        if (info->reused) {
+            ++stats->temporaries;
+            stats->reused += count - 1;
+        }
+
+        size_t removed = info->removed + (info->reused ? count - 1 : 0);
+        if (!removed)
+            continue;
+        for (size_t i = 0; i < node->count; ++i) {
+            if (_cse_is_eager(info->eager, i))
+                cse->infos[node->children[i]].removed += removed;
+        }
+    }
+}
+
+/* evaluate a run of statements that don't assign anything, they've already been searched
+ *
+ * @cse
+ * @run the statements
+ * @count the number of statements
+ * @scope the scope to evaluate them in
+ * @callback the function to call with each evaluated statement, or NULL
+ * @data the data given to `callback`
+ * @stats the work saved is added to it
+ * @return returns an error code
+ */
+error_t _cse_evaluate_run(_cse_t* cse, expression_t** run, size_t count, scope_t* scope,
+                          expression_statement_callback_t callback, void* data, expression_cse_stats_t* stats) {
+    error_t err = ERROR_NO_ERROR;
+    bool assigns;
+
+    _cse_choose(cse, stats);
+    for (size_t i = 0; i < count && !err; ++i) {
+        err = _cse_walk(cse, run[i], scope, false, &assigns);
+        if (!err)
+            err = expression_evaluate(run[i], scope);
+        if (!err && callback)
+            err = callback(run[i], data);
+    }
+    return err;
+}
+
+error_t expression_cse_evaluate(expression_t* expr, scope_t* scope, expression_cse_stats_t* stats) {
+    expression_cse_stats_t ignored;
+    if (!stats)
+        stats = &ignored;
+
+    bool assigns;
+    _cse_t cse;
+    _cse_init(&cse);
+    _cse_search(&cse, expr, scope, &assigns);
+
+    error_t err = assigns ? expression_evaluate(expr, scope) : _cse_evaluate_run(&cse, &expr, 1, scope, NULL, NULL, stats);
+    _cse_clean(&cse);
+    return err;
+}
+
+error_t expression_cse_evaluate_statements(expression_list_t* statements, scope_t* scope,
+                                           expression_statement_callback_t callback, void* data,
+                                           expression_cse_stats_t* stats) {
+    expression_cse_stats_t ignored;
+    if (!stats)
+        stats = &ignored;
+
+    error_t err = ERROR_NO_ERROR;
+    expression_t* expr;
+    bool assigns;
+    _cse_t cse;
+    _cse_init(&cse);
+
+    size_t run_count = 0;
+    size_t run_capacity = 16;
+    expression_t** run = malloc(sizeof(expression_t*) * run_capacity);
+
+    EXPRESSION_LIST_FOREACH(expr, statements) {
+        _cse_search(&cse, expr, scope, &assigns);
+        if (!assigns) {
+            if (run_count == run_capacity) {
+                run_capacity *= 2;
+                run = realloc(run, sizeof(expression_t*) * run_capacity);
+            }
+            run[run_count++] = expr;
+            continue;
+        }
+
+        /* the assignment may change the definitions the run used, so the next run starts from nothing */
+        err = _cse_evaluate_run(&cse, run, run_count, scope, callback, data, stats);
+        if (!err)
+            err = expression_evaluate(expr, scope);
+        if (!err && callback)
+            err = callback(expr, data);
+        if (err)
+            break;
+
+        _cse_clean(&cse);
+        _cse_init(&cse);
+        run_count = 0;
+    }
+
+    if (!err)
+        err = _cse_evaluate_run(&cse, run, run_count, scope, callback, data, stats);
+
+    _cse_clean(&cse);
+    free(run);
+    return err;
+}
@@ -0,0 +1,65 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_CSE_H_
+#define SIMPLIFY_EXPRESSION_CSE_H_
+
+#include "simplify/expression/evaluate.h"
+
+/* the fewest expressions a repeated subexpression must contain to be evaluated once and reused.
+ * Smaller subexpressions are cheaper to evaluate again than to copy.
+ */
+#ifndef EXPRESSION_CSE_MIN_SIZE
+#   define EXPRESSION_CSE_MIN_SIZE 3
+#endif
+
+/* Counts the work saved by expression_cse_evaluate */
+typedef struct expression_cse_stats expression_cse_stats_t;
+
+/* Common subexpression elimination finds the subexpressions that are repeated in a tree, and evaluates each one
+ * once, as if it were bound to a temporary. Every other copy of the subexpression is replaced by the temporary's value.
+ *
+ * Subexpressions are found by their structure (see hashcons.h), with a sum or product's operands in either order.
+ * Only copies that are always evaluated are counted: operands, arguments to internal functions, arguments a user
+ * function always uses, and a conditional's first condition. A subexpression is only reused if it's pure: it doesn't assign anything, and every definition it uses is
+ * pure (see call_cache_fingerprint). Copies inside a larger subexpression that's reused aren't counted separately,
+ * so nothing is hoisted just because the expression around it was repeated.
+ *
+ * The temporary is evaluated where it first appears, in the scope the expression is evaluated in,
+ * so the result is the same as evaluating the expression with expression_evaluate.
+ */
+struct expression_cse_stats {
+    /* the number of subexpressions that were evaluated once and reused */
+    size_t temporaries;
+
+    /* the number of copies replaced by a temporary's value, instead of being evaluated */
+    size_t reused;
+};
+
+/* evaluate an expression, evaluating each repeated subexpression once.
+ * If the expression assigns anything it's evaluated by expression_evaluate, without looking for repeats.
+ *
+ * @expr the expression
+ * @scope the scope to evaluate the expression in
+ * @stats the work saved is added to it, or NULL
+ * @return returns an error code
+ */
+error_t expression_cse_evaluate(expression_t* expr, scope_t* scope, expression_cse_stats_t* stats);
+
+/* evaluate a list of statements in order, like expression_evaluate_statements.
+ *
+ * Consecutive statements that don't assign anything share their temporaries, so a subexpression repeated anywhere in
+ * them is only evaluated once. Statements that assign something are evaluated by expression_evaluate, and end the run.
+ * The statements are always evaluated on the calling thread.
+ *
+ * @statements the statements to evaluate
+ * @scope the scope to evaluate the statements in
+ * @callback the function to call with each evaluated statement, or NULL
+ * @data the data given to `callback`
+ * @stats the work saved is added to it, or NULL
+ * @return returns the first error from evaluating a statement or from the callback
+ */
+error_t expression_cse_evaluate_statements(expression_list_t* statements, scope_t* scope,
+                                           expression_statement_callback_t callback, void* data,
+                                           expression_cse_stats_t* stats);
+
+#endif  // SIMPLIFY_EXPRESSION_CSE_H_
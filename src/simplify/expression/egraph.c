@@ -0,0 +1,945 @@
+/* Copyright Ian Shehadeh 2018 */
+
+/* clock_gettime isn't part of C99 */
+#ifndef _POSIX_C_SOURCE
+#   define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <math.h>
+#include <time.h>
+
+#include "simplify/expression/egraph.h"
+#include "simplify/expression/budget.h"
+
+/* the number of buckets the e-node table starts with, must be a power of two */
+#define _EGRAPH_INITIAL_BUCKETS 64
+
+/* the largest exponent a power of two numbers is folded for */
+#define _EGRAPH_MAX_FOLDED_POWER 64
+
+/* A place one of a rule's patterns matched */
+typedef struct {
+    size_t rule;
+    size_t class;
+    size_t bindings[REWRITE_MAX_VARIABLES];
+} _egraph_match_t;
+
+/* The state of a search for the places a pattern matches */
+typedef struct {
+    egraph_t*        graph;
+    rewrite_rules_t* rules;
+    size_t           rule;
+    size_t           root;
+
+    /* the parts of the pattern that still have to be matched, and the e-class each must match, the last is next */
+    expression_t**   patterns;
+    size_t*          classes;
+    size_t           pending_count;
+
+    /* the e-class each of the rule's variables matched, or SIZE_MAX */
+    size_t           bindings[REWRITE_MAX_VARIABLES];
+
+    _egraph_match_t* matches;
+    size_t           match_count;
+    size_t           match_capacity;
+    size_t           max_matches;
+} _egraph_search_t;
+
+/* get the time, in seconds since an unspecified point
+ *
+ * @return returns the time
+ */
+double _egraph_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/* mix a value into a hash
+ *
+ * @hash the hash so far
+ * @value the value to mix
+ * @return returns the new hash
+ */
+static inline uint64_t _egraph_mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+/* count the children of an expression
+ *
+ * @expr the expression
+ * @return returns the number of children, or a function's number of arguments
+ */
+size_t _egraph_child_count(expression_t* expr) {
+    size_t count = 0;
+    switch (expr->type) {
+        case EXPRESSION_TYPE_FUNCTION:
+            for (expression_list_t* param = expr->function.parameters; param && param->value; param = param->next)
+                ++count;
+            return count;
+        case EXPRESSION_TYPE_PREFIX:
+            return 1;
+        case EXPRESSION_TYPE_OPERATOR:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+/* get one of an expression's children
+ *
+ * @expr the expression
+ * @index the child's index, it must be less than the expression's number of children
+ * @return returns the child
+ */
+expression_t* _egraph_child(expression_t* expr, size_t index) {
+    switch (expr->type) {
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            expression_list_t* param = expr->function.parameters;
+            while (index--)
+                param = param->next;
+            return param->value;
+        }
+        case EXPRESSION_TYPE_PREFIX:
+            return expr->prefix.right;
+        default:
+            return index ? expr->operator.right : expr->operator.left;
+    }
+}
+
+/* hash an e-node's label and children, the children must be representatives
+ *
+ * @node the e-node
+ * @return returns the hash
+ */
+uint64_t _egraph_node_hash(egraph_node_t* node) {
+    uint64_t hash = _egraph_mix(0xcbf29ce484222325ULL, node->type);
+
+    switch (node->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        {
+            /* numbers are compared by value, zero and negative zero are equal, so they must hash the same */
+            double value = mpfr_nan_p(node->leaf->number.value) || mpfr_zero_p(node->leaf->number.value)
+                ? 0 : mpfr_get_d(node->leaf->number.value, MPFR_RNDN);
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            hash = _egraph_mix(hash, bits);
+            break;
+        }
+        case EXPRESSION_TYPE_VARIABLE:
+            hash = _egraph_mix(hash, expression_hash(node->leaf));
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            for (char* c = node->name; *c; ++c)
+                hash = _egraph_mix(hash, (unsigned char)*c);
+            break;
+        default:
+            hash = _egraph_mix(hash, (unsigned char)node->operator);
+            break;
+    }
+
+    for (size_t i = 0; i < node->count; ++i)
+        hash = _egraph_mix(hash, node->children[i]);
+    return _egraph_mix(hash, node->count);
+}
+
+/* check if two e-nodes have the same label and children
+ *
+ * @node1
+ * @node2
+ * @return returns true if the e-nodes are the same
+ */
+bool _egraph_node_equal(egraph_node_t* node1, egraph_node_t* node2) {
+    if (node1->hash != node2->hash || node1->type != node2->type || node1->count != node2->count)
+        return false;
+
+    switch (node1->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            if (!mpfr_equal_p(node1->leaf->number.value, node2->leaf->number.value))
+                return false;
+            break;
+        case EXPRESSION_TYPE_VARIABLE:
+            if (!expression_identical(node1->leaf, node2->leaf))
+                return false;
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            if (strcmp(node1->name, node2->name) != 0)
+                return false;
+            break;
+        default:
+            if (node1->operator != node2->operator)
+                return false;
+            break;
+    }
+    return node1->count == 0 || memcmp(node1->children, node2->children, sizeof(size_t) * node1->count) == 0;
+}
+
+/* check if an e-node's label matches a part of a pattern that isn't a variable
+ *
+ * @node the e-node
+ * @pattern the part of the pattern
+ * @return returns true if the pattern has the same type, and the same operator, name and argument count or value
+ */
+bool _egraph_node_matches(egraph_node_t* node, expression_t* pattern) {
+    if (node->type != pattern->type)
+        return false;
+
+    switch (node->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return mpfr_equal_p(node->leaf->number.value, pattern->number.value);
+        case EXPRESSION_TYPE_FUNCTION:
+            return strcmp(node->name, pattern->function.name) == 0 && node->count == _egraph_child_count(pattern);
+        case EXPRESSION_TYPE_VARIABLE:
+            return false;
+        default:
+            return node->operator == EXPRESSION_OPERATOR(pattern);
+    }
+}
+
+/* make an expression with an e-node's label, for a cost model. Nothing is allocated, so it isn't cleaned.
+ *
+ * @node the e-node
+ * @label set to the label
+ * @return returns the label
+ */
+expression_t* _egraph_label(egraph_node_t* node, expression_t* label) {
+    switch (node->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        case EXPRESSION_TYPE_VARIABLE:
+            return node->leaf;
+        case EXPRESSION_TYPE_FUNCTION:
+            label->type = EXPRESSION_TYPE_FUNCTION;
+            label->function.name = node->name;
+            label->function.parameters = NULL;
+            label->function.symbol = NULL;
+            return label;
+        case EXPRESSION_TYPE_PREFIX:
+            expression_init_prefix(label, node->operator, NULL);
+            return label;
+        case EXPRESSION_TYPE_OPERATOR:
+            expression_init_operator(label, NULL, node->operator, NULL);
+            return label;
+    }
+    return label;
+}
+
+/* free the parts of an e-node it owns
+ *
+ * @node the e-node
+ */
+void _egraph_node_clean(egraph_node_t* node) {
+    if (node->leaf)
+        expression_free(node->leaf);
+    free(node->name);
+    free(node->children);
+    node->leaf = NULL;
+    node->name = NULL;
+    node->children = NULL;
+}
+
+/* find an e-node in the table
+ *
+ * @graph the graph
+ * @node the e-node to look for, it's hash must be set
+ * @bucket set to the bucket the e-node is in, or the empty bucket it would be in
+ * @return returns the e-node's index plus one, or zero if it isn't in the table
+ */
+size_t _egraph_find_node(egraph_t* graph, egraph_node_t* node, size_t* bucket) {
+    size_t index = node->hash & (graph->bucket_count - 1);
+    for (; graph->buckets[index]; index = (index + 1) & (graph->bucket_count - 1)) {
+        if (_egraph_node_equal(&graph->nodes[graph->buckets[index] - 1], node)) {
+            *bucket = index;
+            return graph->buckets[index];
+        }
+    }
+    *bucket = index;
+    return 0;
+}
+
+/* put every live e-node in a table with at least `bucket_count` buckets
+ *
+ * @graph the graph
+ * @bucket_count the number of buckets, it must be a power of two
+ */
+void _egraph_rehash(egraph_t* graph, size_t bucket_count) {
+    free(graph->buckets);
+    graph->buckets = calloc(bucket_count, sizeof(size_t));
+    graph->bucket_count = bucket_count;
+
+    for (size_t i = 0; i < graph->node_count; ++i) {
+        if (graph->nodes[i].dead)
+            continue;
+
+        size_t bucket = graph->nodes[i].hash & (bucket_count - 1);
+        while (graph->buckets[bucket])
+            bucket = (bucket + 1) & (bucket_count - 1);
+        graph->buckets[bucket] = i + 1;
+    }
+}
+
+/* add an e-node to an e-class' list
+ *
+ * @class the e-class
+ * @node the e-node's index
+ */
+void _egraph_class_append(egraph_class_t* class, size_t node) {
+    if (class->node_count == class->node_capacity) {
+        class->node_capacity = class->node_capacity ? class->node_capacity * 2 : 2;
+        class->nodes = realloc(class->nodes, sizeof(size_t) * class->node_capacity);
+    }
+    class->nodes[class->node_count++] = node;
+}
+
+size_t _egraph_add_node(egraph_t* graph, egraph_node_t* node);
+
+/* if an e-node's children are all known numbers, and it's value can be found exactly, add the value to it's
+ * e-class
+ *
+ * @graph the graph
+ * @index the e-node's index
+ */
+void _egraph_fold(egraph_t* graph, size_t index) {
+    egraph_node_t* node = &graph->nodes[index];
+    size_t class = egraph_find(graph, node->class);
+    if (graph->classes[class].constant)
+        return;
+
+    if (node->type == EXPRESSION_TYPE_NUMBER) {
+        mpfr_ptr constant = malloc(sizeof(mpfr_t));
+        mpfr_init2(constant, mpfr_get_prec(node->leaf->number.value));
+        mpfr_set(constant, node->leaf->number.value, MPFR_RNDN);
+        graph->classes[class].constant = constant;
+        return;
+    }
+
+    if (node->type != EXPRESSION_TYPE_OPERATOR && node->type != EXPRESSION_TYPE_PREFIX)
+        return;
+
+    mpfr_ptr operands[2];
+    mpfr_prec_t precision = mpfr_get_default_prec();
+    for (size_t i = 0; i < node->count; ++i) {
+        operands[i] = graph->classes[egraph_find(graph, node->children[i])].constant;
+        if (!operands[i])
+            return;
+        precision = mpfr_get_prec(operands[i]) > precision ? mpfr_get_prec(operands[i]) : precision;
+    }
+
+    mpfr_ptr value = malloc(sizeof(mpfr_t));
+    mpfr_init2(value, precision);
+
+    int inexact = 1;
+    if (node->type == EXPRESSION_TYPE_PREFIX) {
+        if (node->operator == '-')
+            inexact = mpfr_neg(value, operands[0], MPFR_RNDN);
+        else if (node->operator == '+')
+            inexact = mpfr_set(value, operands[0], MPFR_RNDN);
+    } else {
+        switch (node->operator) {
+            case '+':
+                inexact = mpfr_add(value, operands[0], operands[1], MPFR_RNDN);
+                break;
+            case '-':
+                inexact = mpfr_sub(value, operands[0], operands[1], MPFR_RNDN);
+                break;
+            case '*':
+                inexact = mpfr_mul(value, operands[0], operands[1], MPFR_RNDN);
+                break;
+            case '/':
+                if (!mpfr_zero_p(operands[1]))
+                    inexact = mpfr_div(value, operands[0], operands[1], MPFR_RNDN);
+                break;
+            case '^':
+                if (mpfr_integer_p(operands[1])
+                        && mpfr_cmp_si(operands[1], _EGRAPH_MAX_FOLDED_POWER) <= 0
+                        && mpfr_cmp_si(operands[1], -_EGRAPH_MAX_FOLDED_POWER) >= 0)
+                    inexact = mpfr_pow(value, operands[0], operands[1], MPFR_RNDN);
+                break;
+            default:
+                break;
+        }
+    }
+
+    /* a fold that rounded, or isn't a number, would make the e-class equal to something it isn't */
+    if (inexact || !mpfr_number_p(value)) {
+        mpfr_clear(value);
+        free(value);
+        return;
+    }
+
+    egraph_node_t number = { 0 };
+    number.type = EXPRESSION_TYPE_NUMBER;
+    number.leaf = expression_new_number(value);
+    size_t folded = _egraph_add_node(graph, &number);
+    egraph_merge(graph, graph->nodes[index].class, folded);
+}
+
+/* add an e-node to the graph, unless it's already in it
+ *
+ * @graph the graph
+ * @node the e-node, it's label and children are taken by the graph or freed
+ * @return returns the e-class the e-node belongs to
+ */
+size_t _egraph_add_node(egraph_t* graph, egraph_node_t* node) {
+    for (size_t i = 0; i < node->count; ++i)
+        node->children[i] = egraph_find(graph, node->children[i]);
+    node->hash = _egraph_node_hash(node);
+    node->dead = false;
+
+    if ((graph->live_count + 1) * 2 > graph->bucket_count)
+        _egraph_rehash(graph, graph->bucket_count ? graph->bucket_count * 2 : _EGRAPH_INITIAL_BUCKETS);
+
+    size_t bucket;
+    size_t found = _egraph_find_node(graph, node, &bucket);
+    if (found) {
+        _egraph_node_clean(node);
+        return egraph_find(graph, graph->nodes[found - 1].class);
+    }
+
+    graph->classes = realloc(graph->classes, sizeof(egraph_class_t) * (graph->class_count + 1));
+    graph->classes[graph->class_count] = (egraph_class_t){ graph->class_count, NULL, 0, 0, NULL };
+    node->class = graph->class_count++;
+
+    if (graph->node_count == graph->node_capacity) {
+        graph->node_capacity = graph->node_capacity ? graph->node_capacity * 2 : _EGRAPH_INITIAL_BUCKETS;
+        graph->nodes = realloc(graph->nodes, sizeof(egraph_node_t) * graph->node_capacity);
+    }
+    size_t index = graph->node_count++;
+    graph->nodes[index] = *node;
+    graph->buckets[bucket] = index + 1;
+    ++graph->live_count;
+
+    _egraph_class_append(&graph->classes[node->class], index);
+    _egraph_fold(graph, index);
+    return egraph_find(graph, graph->nodes[index].class);
+}
+
+/* add an expression to the graph, with the variables of a rule replaced by the e-classes they matched
+ *
+ * @graph the graph
+ * @expr the expression
+ * @rule the rule, or NULL if the expression's variables aren't replaced
+ * @bindings the e-class each of the rule's variables matched
+ * @return returns the expression's e-class
+ */
+size_t _egraph_add_expression(egraph_t* graph, expression_t* expr, rewrite_rule_t* rule, size_t* bindings) {
+    egraph_node_t node = { 0 };
+    node.type = expr->type;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_VARIABLE:
+            if (rule) {
+                size_t index = rewrite_rule_variable(rule, expr->variable.value);
+                if (index < rule->variable_count && bindings[index] != SIZE_MAX)
+                    return egraph_find(graph, bindings[index]);
+            }
+            /* fallthrough */
+        case EXPRESSION_TYPE_NUMBER:
+            node.leaf = malloc(sizeof(expression_t));
+            expression_copy(expr, node.leaf);
+            return _egraph_add_node(graph, &node);
+        case EXPRESSION_TYPE_FUNCTION:
+            node.name = malloc(strlen(expr->function.name) + 1);
+            strcpy(node.name, expr->function.name);
+            break;
+        default:
+            node.operator = EXPRESSION_OPERATOR(expr);
+            break;
+    }
+
+    node.count = _egraph_child_count(expr);
+    node.children = node.count ? malloc(sizeof(size_t) * node.count) : NULL;
+    for (size_t i = 0; i < node.count; ++i)
+        node.children[i] = _egraph_add_expression(graph, _egraph_child(expr, i), rule, bindings);
+
+    return _egraph_add_node(graph, &node);
+}
+
+void egraph_init(egraph_t* graph) {
+    graph->nodes = NULL;
+    graph->node_count = 0;
+    graph->node_capacity = 0;
+    graph->live_count = 0;
+    graph->classes = NULL;
+    graph->class_count = 0;
+    graph->buckets = NULL;
+    graph->bucket_count = 0;
+    graph->dirty = false;
+    graph->stopped = EGRAPH_STOP_SATURATED;
+    graph->applied = 0;
+}
+
+void egraph_clean(egraph_t* graph) {
+    for (size_t i = 0; i < graph->node_count; ++i)
+        _egraph_node_clean(&graph->nodes[i]);
+    for (size_t i = 0; i < graph->class_count; ++i) {
+        free(graph->classes[i].nodes);
+        if (graph->classes[i].constant) {
+            mpfr_clear(graph->classes[i].constant);
+            free(graph->classes[i].constant);
+        }
+    }
+    free(graph->nodes);
+    free(graph->classes);
+    free(graph->buckets);
+    egraph_init(graph);
+}
+
+size_t egraph_add(egraph_t* graph, expression_t* expr) {
+    size_t class = _egraph_add_expression(graph, expr, NULL, NULL);
+    egraph_rebuild(graph);
+    return egraph_find(graph, class);
+}
+
+size_t egraph_find(egraph_t* graph, size_t class) {
+    size_t root = class;
+    while (graph->classes[root].parent != root)
+        root = graph->classes[root].parent;
+
+    /* point everything on the path at the representative, so the next search is shorter */
+    while (graph->classes[class].parent != root) {
+        size_t next = graph->classes[class].parent;
+        graph->classes[class].parent = root;
+        class = next;
+    }
+    return root;
+}
+
+bool egraph_merge(egraph_t* graph, size_t class1, size_t class2) {
+    class1 = egraph_find(graph, class1);
+    class2 = egraph_find(graph, class2);
+    if (class1 == class2)
+        return false;
+
+    /* the e-class with fewer e-nodes is merged into the other, so an e-node's list is copied O(log n) times */
+    egraph_class_t* to = &graph->classes[class1];
+    egraph_class_t* from = &graph->classes[class2];
+    if (from->node_count > to->node_count) {
+        egraph_class_t* swap = to;
+        to = from;
+        from = swap;
+    }
+
+    for (size_t i = 0; i < from->node_count; ++i)
+        _egraph_class_append(to, from->nodes[i]);
+    free(from->nodes);
+    from->nodes = NULL;
+    from->node_count = 0;
+    from->node_capacity = 0;
+
+    if (!to->constant) {
+        to->constant = from->constant;
+    } else if (from->constant) {
+        mpfr_clear(from->constant);
+        free(from->constant);
+    }
+    from->constant = NULL;
+
+    from->parent = (size_t)(to - graph->classes);
+    graph->dirty = true;
+    return true;
+}
+
+void egraph_rebuild(egraph_t* graph) {
+    while (graph->dirty) {
+        graph->dirty = false;
+
+        /* put each e-node back in the table with it's children's new representatives,
+         * an e-node that's now the same as another is a duplicate, and their e-classes are equal */
+        if (graph->bucket_count)
+            memset(graph->buckets, 0, sizeof(size_t) * graph->bucket_count);
+        for (size_t i = 0; i < graph->node_count; ++i) {
+            egraph_node_t* node = &graph->nodes[i];
+            if (node->dead)
+                continue;
+
+            for (size_t j = 0; j < node->count; ++j)
+                node->children[j] = egraph_find(graph, node->children[j]);
+            node->hash = _egraph_node_hash(node);
+
+            size_t bucket;
+            size_t found = _egraph_find_node(graph, node, &bucket);
+            if (found) {
+                egraph_merge(graph, graph->nodes[found - 1].class, node->class);
+                _egraph_node_clean(node);
+                node->dead = true;
+                --graph->live_count;
+            } else {
+                graph->buckets[bucket] = i + 1;
+            }
+        }
+
+        /* an e-class merged with a number may let the e-classes that use it be folded */
+        for (size_t i = 0; i < graph->node_count; ++i) {
+            if (!graph->nodes[i].dead)
+                _egraph_fold(graph, i);
+        }
+    }
+
+    for (size_t i = 0; i < graph->class_count; ++i) {
+        egraph_class_t* class = &graph->classes[i];
+        size_t kept = 0;
+        for (size_t j = 0; j < class->node_count; ++j) {
+            if (!graph->nodes[class->nodes[j]].dead)
+                class->nodes[kept++] = class->nodes[j];
+        }
+        class->node_count = kept;
+    }
+}
+
+/* find every way the pending parts of a pattern match, and record each match
+ *
+ * @search the search
+ */
+void _egraph_search(_egraph_search_t* search) {
+    if (search->match_count >= search->max_matches)
+        return;
+
+    if (!search->pending_count) {
+        if (search->match_count == search->match_capacity) {
+            search->match_capacity = search->match_capacity ? search->match_capacity * 2 : 16;
+            search->matches = realloc(search->matches, sizeof(_egraph_match_t) * search->match_capacity);
+        }
+        _egraph_match_t* match = &search->matches[search->match_count++];
+        match->rule = search->rule;
+        match->class = search->root;
+        memcpy(match->bindings, search->bindings, sizeof(search->bindings));
+        return;
+    }
+
+    egraph_t* graph = search->graph;
+    size_t pending_count = --search->pending_count;
+    expression_t* pattern = search->patterns[pending_count];
+    size_t class = egraph_find(graph, search->classes[pending_count]);
+
+    if (EXPRESSION_IS_VARIABLE(pattern)) {
+        rewrite_rule_t* rule = search->rules->rules[search->rule];
+        size_t* binding = &search->bindings[rewrite_rule_variable(rule, pattern->variable.value)];
+        if (*binding == SIZE_MAX) {
+            *binding = class;
+            _egraph_search(search);
+            *binding = SIZE_MAX;
+        } else if (*binding == class) {
+            _egraph_search(search);
+        }
+    } else {
+        egraph_class_t* eclass = &graph->classes[class];
+        for (size_t i = 0; i < eclass->node_count; ++i) {
+            egraph_node_t* node = &graph->nodes[eclass->nodes[i]];
+            if (!_egraph_node_matches(node, pattern))
+                continue;
+
+            /* the children are pushed in reverse, so the first child is matched next */
+            for (size_t j = node->count; j-- > 0;) {
+                search->patterns[search->pending_count] = _egraph_child(pattern, j);
+                search->classes[search->pending_count++] = node->children[j];
+            }
+            _egraph_search(search);
+            search->pending_count = pending_count;
+        }
+    }
+
+    search->patterns[pending_count] = pattern;
+    search->classes[pending_count] = class;
+    search->pending_count = pending_count + 1;
+}
+
+error_t egraph_saturate(egraph_t* graph, rewrite_rules_t* rules, const egraph_limits_t* limits) {
+    error_t err = ERROR_NO_ERROR;
+    egraph_limits_t default_limits = EGRAPH_LIMITS_DEFAULT();
+    if (!limits)
+        limits = &default_limits;
+
+    double started = limits->max_seconds > 0 ? _egraph_now() : 0;
+    graph->applied = 0;
+    graph->stopped = EGRAPH_STOP_ITERATION_LIMIT;
+    egraph_rebuild(graph);
+
+    /* the pending stack never holds more than the pattern has expressions */
+    size_t longest = rules->longest;
+
+    _egraph_search_t search;
+    search.graph = graph;
+    search.rules = rules;
+    search.patterns = malloc(sizeof(expression_t*) * (longest + 1));
+    search.classes = malloc(sizeof(size_t) * (longest + 1));
+    search.matches = NULL;
+    search.match_capacity = 0;
+    for (size_t i = 0; i < REWRITE_MAX_VARIABLES; ++i)
+        search.bindings[i] = SIZE_MAX;
+
+    for (size_t iteration = 0; !limits->max_iterations || iteration < limits->max_iterations; ++iteration) {
+        /* every match is found before the graph is changed, so no rule sees what another added this iteration */
+        search.match_count = 0;
+        bool truncated = false;
+        for (size_t i = 0; i < rules->rule_count && !err; ++i) {
+            rewrite_rule_t* rule = rules->rules[i];
+            search.rule = i;
+
+            /* each rule finds at most as many matches as there may be e-nodes, so one rule can't starve the rest */
+            search.max_matches = limits->max_nodes ? search.match_count + limits->max_nodes : SIZE_MAX;
+            for (size_t j = 0; j < rule->variant_count && !err; ++j) {
+                for (size_t class = 0; class < graph->class_count; ++class) {
+                    if (graph->classes[class].parent != class || !graph->classes[class].node_count)
+                        continue;
+
+                    err = budget_step();
+                    if (err) break;
+
+                    search.root = class;
+                    search.patterns[0] = rule->variants[j];
+                    search.classes[0] = class;
+                    search.pending_count = 1;
+                    _egraph_search(&search);
+                }
+            }
+            truncated = truncated || search.match_count == search.max_matches;
+        }
+        if (err) break;
+
+        size_t live_count = graph->live_count;
+        bool merged = false;
+        bool full = false;
+        for (size_t i = 0; i < search.match_count && !full; ++i) {
+            _egraph_match_t* match = &search.matches[i];
+            rewrite_rule_t* rule = rules->rules[match->rule];
+            size_t class = _egraph_add_expression(graph, &rule->replacement, rule, match->bindings);
+            if (egraph_merge(graph, match->class, class)) {
+                merged = true;
+                ++graph->applied;
+            }
+            full = limits->max_nodes && graph->live_count >= limits->max_nodes;
+        }
+        egraph_rebuild(graph);
+
+        if (!merged && graph->live_count == live_count && !truncated) {
+            graph->stopped = EGRAPH_STOP_SATURATED;
+            break;
+        }
+        if (full || (!merged && graph->live_count == live_count)) {
+            graph->stopped = EGRAPH_STOP_NODE_LIMIT;
+            break;
+        }
+        if (limits->max_seconds > 0 && _egraph_now() - started > limits->max_seconds) {
+            graph->stopped = EGRAPH_STOP_TIME_LIMIT;
+            break;
+        }
+    }
+
+    free(search.patterns);
+    free(search.classes);
+    free(search.matches);
+    return err;
+}
+
+/* build the expression chosen for an e-class
+ *
+ * @graph the graph
+ * @choices the index of the e-node chosen for each representative
+ * @class the e-class
+ * @return returns a new expression
+ */
+expression_t* _egraph_build(egraph_t* graph, size_t* choices, size_t class) {
+    egraph_node_t* node = &graph->nodes[choices[egraph_find(graph, class)]];
+    expression_t* expr;
+
+    switch (node->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        case EXPRESSION_TYPE_VARIABLE:
+            expr = malloc(sizeof(expression_t));
+            expression_copy(node->leaf, expr);
+            return expr;
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            expression_list_t* params = malloc(sizeof(expression_list_t));
+            expression_list_init(params);
+            for (size_t i = 0; i < node->count; ++i)
+                expression_list_append(params, _egraph_build(graph, choices, node->children[i]));
+            expr = malloc(sizeof(expression_t));
+            expression_init_function(expr, node->name, strlen(node->name), params);
+            return expr;
+        }
+        case EXPRESSION_TYPE_PREFIX:
+            return expression_new_prefix(node->operator, _egraph_build(graph, choices, node->children[0]));
+        case EXPRESSION_TYPE_OPERATOR:
+            break;
+    }
+
+    expression_t* left = _egraph_build(graph, choices, node->children[0]);
+    return expression_new_operator(left, node->operator, _egraph_build(graph, choices, node->children[1]));
+}
+
+expression_t* egraph_extract(egraph_t* graph, size_t class, egraph_cost_t cost, double* out_cost) {
+    egraph_rebuild(graph);
+
+    double* best = malloc(sizeof(double) * graph->class_count);
+    size_t* choices = malloc(sizeof(size_t) * graph->class_count);
+    for (size_t i = 0; i < graph->class_count; ++i)
+        best[i] = INFINITY;
+
+    size_t widest = 1;
+    for (size_t i = 0; i < graph->node_count; ++i)
+        widest = graph->nodes[i].count > widest ? graph->nodes[i].count : widest;
+    double* children = malloc(sizeof(double) * widest);
+
+    /* lower each e-class' cost until none can be lowered, an e-node can only be used once all it's children have
+     * a cost, so the expressions chosen are never cyclic */
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < graph->node_count; ++i) {
+            egraph_node_t* node = &graph->nodes[i];
+            if (node->dead)
+                continue;
+
+            bool ready = true;
+            for (size_t j = 0; j < node->count && ready; ++j) {
+                children[j] = best[egraph_find(graph, node->children[j])];
+                ready = children[j] != INFINITY;
+            }
+            if (!ready)
+                continue;
+
+            expression_t label;
+            double node_cost = cost(_egraph_label(node, &label), children, node->count);
+            size_t node_class = egraph_find(graph, node->class);
+            if (node_cost < best[node_class]) {
+                best[node_class] = node_cost;
+                choices[node_class] = i;
+                changed = true;
+            }
+        }
+    }
+
+    class = egraph_find(graph, class);
+    if (out_cost)
+        *out_cost = best[class];
+    expression_t* expr = _egraph_build(graph, choices, class);
+
+    free(best);
+    free(choices);
+    free(children);
+    return expr;
+}
+
+double egraph_expression_cost(expression_t* expr, egraph_cost_t cost) {
+    size_t count = _egraph_child_count(expr);
+    double children[count ? count : 1];
+    for (size_t i = 0; i < count; ++i)
+        children[i] = egraph_expression_cost(_egraph_child(expr, i), cost);
+    return cost(expr, children, count);
+}
+
+double egraph_cost_size(expression_t* label, const double* children, size_t count) {
+    (void)label;
+    double cost = 1;
+    for (size_t i = 0; i < count; ++i)
+        cost += children[i];
+    return cost;
+}
+
+double egraph_cost_speed(expression_t* label, const double* children, size_t count) {
+    /* roughly the relative time mpfr takes for each operation, at the default precision */
+    double cost;
+    switch (label->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        case EXPRESSION_TYPE_VARIABLE:
+            cost = 1;
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            cost = 64;
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            cost = 2;
+            break;
+        default:
+            switch (label->operator.infix) {
+                case '*':
+                    cost = 4;
+                    break;
+                case '/':
+                    cost = 16;
+                    break;
+                case '^':
+                case '\\':
+                    cost = 48;
+                    break;
+                default:
+                    cost = 2;
+                    break;
+            }
+            break;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        cost += children[i];
+    return cost;
+}
+
+void egraph_default_rules(rewrite_rules_t* rules) {
+    static char* rule_strings[] = {
+        "a + b = b + a",
+        "a * b = b * a",
+        "a + (b + c) = a + b + c",
+        "a + b + c = a + (b + c)",
+        "a * (b * c) = a * b * c",
+        "a * b * c = a * (b * c)",
+        "a * (b + c) = a * b + a * c",
+        "a * b + a * c = a * (b + c)",
+        "a * (b - c) = a * b - a * c",
+        "a * b - a * c = a * (b - c)",
+        "a + b - b = a",
+        "a - b + b = a",
+        "a - a = 0",
+        "a + 0 = a",
+        "a - 0 = a",
+        "a * 1 = a",
+        "a * 0 = 0",
+        "a / 1 = a",
+        "a ^ 1 = a",
+        "a ^ 0 = 1",
+        "a + a = 2 * a",
+        "a * a = a ^ 2",
+        "a ^ 2 = a * a",
+        "a ^ b * a = a ^ (b + 1)",
+        "a ^ b * a ^ c = a ^ (b + c)",
+    };
+
+    for (size_t i = 0; i < sizeof(rule_strings) / sizeof(rule_strings[0]); ++i)
+        rewrite_rules_add_string(rules, rule_strings[i]);
+}
+
+error_t egraph_simplify(expression_t* expr, rewrite_rules_t* rules, const egraph_limits_t* limits,
+                        egraph_cost_t cost) {
+    rewrite_rules_t all_rules;
+    rewrite_rules_init(&all_rules);
+    egraph_default_rules(&all_rules);
+
+    for (size_t i = 0; rules && i < rules->rule_count; ++i) {
+        expression_t rule;
+        expression_init_operator(&rule, &rules->rules[i]->pattern, '=', &rules->rules[i]->replacement);
+        rewrite_rules_add(&all_rules, &rule);
+    }
+
+    egraph_t graph;
+    egraph_init(&graph);
+    size_t root = egraph_add(&graph, expr);
+
+    error_t err = egraph_saturate(&graph, &all_rules, limits);
+    if (!err) {
+        double found_cost;
+        expression_t* found = egraph_extract(&graph, root, cost, &found_cost);
+        if (found_cost < egraph_expression_cost(expr, cost)) {
+            expression_clean(expr);
+            *expr = *found;
+            free(found);
+        } else {
+            expression_free(found);
+        }
+    }
+
+    egraph_clean(&graph);
+    rewrite_rules_clean(&all_rules);
+    return err;
+}
@@ -0,0 +1,234 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_EGRAPH_H_
+#define SIMPLIFY_EXPRESSION_EGRAPH_H_
+
+#include <stdint.h>
+
+#include "simplify/expression/expression.h"
+#include "simplify/expression/rewrite.h"
+
+/* the most e-nodes a graph may grow to while it's saturated, unless the limits say otherwise */
+#ifndef EGRAPH_DEFAULT_MAX_NODES
+#   define EGRAPH_DEFAULT_MAX_NODES 10000
+#endif
+
+/* the most times every rule is matched against the graph while it's saturated, unless the limits say otherwise */
+#ifndef EGRAPH_DEFAULT_MAX_ITERATIONS
+#   define EGRAPH_DEFAULT_MAX_ITERATIONS 16
+#endif
+
+/* the most seconds spent saturating a graph, unless the limits say otherwise */
+#ifndef EGRAPH_DEFAULT_MAX_SECONDS
+#   define EGRAPH_DEFAULT_MAX_SECONDS 0.25
+#endif
+
+/* the limits used if none are given */
+#define EGRAPH_LIMITS_DEFAULT() \
+    ((egraph_limits_t){ EGRAPH_DEFAULT_MAX_NODES, EGRAPH_DEFAULT_MAX_ITERATIONS, EGRAPH_DEFAULT_MAX_SECONDS })
+
+/* An expression with its children replaced by the e-classes they belong to */
+typedef struct egraph_node egraph_node_t;
+
+/* A set of expressions known to be equal */
+typedef struct egraph_class egraph_class_t;
+
+/* An e-graph, a compact representation of many equal expressions */
+typedef struct egraph egraph_t;
+
+/* The limits on how far a graph is saturated, a zero limit means there's no limit */
+typedef struct egraph_limits egraph_limits_t;
+
+/* Why saturation stopped */
+typedef enum {
+    /* no rule could add anything to the graph, it holds every form the rules can reach */
+    EGRAPH_STOP_SATURATED,
+    EGRAPH_STOP_NODE_LIMIT,
+    EGRAPH_STOP_ITERATION_LIMIT,
+    EGRAPH_STOP_TIME_LIMIT,
+} egraph_stop_t;
+
+/* A cost model, it's used to pick the best expression in an e-class.
+ * A cost must be greater than the cost of each child, so the best expression in an e-class is never cyclic.
+ *
+ * @label the expression to find the cost of, only it's type, operator, name or value may be used,
+ *          it's children, or a function's arguments, aren't set
+ * @children the cost of each of the expression's children, in order
+ * @count the number of children
+ * @return returns the expression's cost
+ */
+typedef double (*egraph_cost_t)(expression_t* label, const double* children, size_t count);
+
+/* An e-graph stores a set of expressions, grouped into e-classes of expressions known to be equal.
+ * Each e-node is an operator, prefix, function call, number or variable whose children are e-classes instead of
+ * expressions, so one e-class stands for every way each of it's children could be written.
+ *
+ * E-nodes are hash-consed, an e-node is only stored once. E-classes are kept in a union-find structure, and merged
+ * when they're found to be equal; after a merge the graph is rebuilt, e-nodes that became the same are found and
+ * their e-classes are merged too (congruence closure). An e-class whose children are all known numbers is folded
+ * into a number when the result is exact.
+ *
+ * The graph is saturated with a set of rewrite rules (see rewrite.h), each rule says it's pattern is equal to it's
+ * replacement. Unlike rewriting an expression in place, nothing is replaced: the replacement is added to the
+ * pattern's e-class. So the order rules are applied in doesn't matter, and a rule that makes an expression larger
+ * can still lead to a smaller one. Once the rules stop adding to the graph, or a limit is reached, the cheapest
+ * expression in an e-class is extracted under a cost model.
+ */
+struct egraph_node {
+    /* the e-node's label: it's type, and it's operator, function name, or for numbers and variables a copy */
+    expression_type_t  type;
+    operator_t         operator;
+    char*              name;
+    expression_t*      leaf;
+
+    size_t*            children;
+    size_t             count;
+
+    size_t             class;
+    uint64_t           hash;
+
+    /* true if the e-node was found to be a duplicate of another while the graph was rebuilt */
+    bool               dead;
+};
+
+struct egraph_class {
+    /* the e-class this one was merged into, or it's own index if it's the representative */
+    size_t   parent;
+
+    /* the e-nodes in the e-class, only kept for representatives */
+    size_t*  nodes;
+    size_t   node_count;
+    size_t   node_capacity;
+
+    /* the e-class' value, if it's known to be a number, or NULL */
+    mpfr_ptr constant;
+};
+
+struct egraph_limits {
+    size_t max_nodes;
+    size_t max_iterations;
+    double max_seconds;
+};
+
+struct egraph {
+    egraph_node_t*  nodes;
+    size_t          node_count;
+    size_t          node_capacity;
+
+    /* the number of e-nodes that aren't dead */
+    size_t          live_count;
+
+    egraph_class_t* classes;
+    size_t          class_count;
+
+    /* open addressed, each bucket holds an e-node's index plus one, or zero if it's empty */
+    size_t*         buckets;
+    size_t          bucket_count;
+
+    /* true if e-classes were merged since the graph was last rebuilt */
+    bool            dirty;
+
+    /* why the last saturation stopped, and the number of rules it applied */
+    egraph_stop_t   stopped;
+    size_t          applied;
+};
+
+/* initialize an empty e-graph
+ *
+ * @graph the graph to initialize
+ */
+void egraph_init(egraph_t* graph);
+
+/* free all resources used by an e-graph
+ *
+ * @graph the graph to clean
+ */
+void egraph_clean(egraph_t* graph);
+
+/* add an expression to an e-graph
+ *
+ * @graph the graph
+ * @expr the expression, it's copied
+ * @return returns the e-class the expression belongs to
+ */
+size_t egraph_add(egraph_t* graph, expression_t* expr);
+
+/* find an e-class' representative
+ *
+ * @graph the graph
+ * @class the e-class
+ * @return returns the representative, two e-classes are equal if they have the same representative
+ */
+size_t egraph_find(egraph_t* graph, size_t class);
+
+/* record that two e-classes are equal. The graph must be rebuilt before it's searched again.
+ *
+ * @graph the graph
+ * @class1
+ * @class2
+ * @return returns true if the e-classes weren't already equal
+ */
+bool egraph_merge(egraph_t* graph, size_t class1, size_t class2);
+
+/* restore the graph's invariants after e-classes were merged: each e-node is stored once, and e-nodes with
+ * equal children are in the same e-class
+ *
+ * @graph the graph
+ */
+void egraph_rebuild(egraph_t* graph);
+
+/* apply a set of rules to an e-graph until nothing changes or a limit is reached, see `graph->stopped` for why it
+ * stopped. Each e-class searched counts as a step against the calling thread's budget, see budget.h.
+ *
+ * @graph the graph
+ * @rules the rules
+ * @limits the limits, or NULL to use EGRAPH_LIMITS_DEFAULT
+ * @return returns an error code, reaching one of the limits isn't an error
+ */
+error_t egraph_saturate(egraph_t* graph, rewrite_rules_t* rules, const egraph_limits_t* limits);
+
+/* build the cheapest expression in an e-class
+ *
+ * @graph the graph
+ * @class the e-class
+ * @cost the cost model
+ * @out_cost set to the expression's cost, may be NULL
+ * @return returns a new expression
+ */
+expression_t* egraph_extract(egraph_t* graph, size_t class, egraph_cost_t cost, double* out_cost);
+
+/* find the cost of an expression
+ *
+ * @expr the expression
+ * @cost the cost model
+ * @return returns the cost
+ */
+double egraph_expression_cost(expression_t* expr, egraph_cost_t cost);
+
+/* a cost model that counts the expressions in a tree, it finds the shortest form */
+double egraph_cost_size(expression_t* label, const double* children, size_t count);
+
+/* a cost model that estimates the time to evaluate a tree, it finds the fastest form */
+double egraph_cost_speed(expression_t* label, const double* children, size_t count);
+
+/* add the rules used by egraph_simplify to a rule set: sums and products are commutative and associative,
+ * products distribute over sums, and identities like `a * 1 = a` and `a * a = a ^ 2`
+ *
+ * @rules the rule set
+ */
+void egraph_default_rules(rewrite_rules_t* rules);
+
+/* replace an expression with the cheapest equal expression that can be found by saturating an e-graph with the
+ * default rules (see egraph_default_rules) and another set of rules.
+ * The expression is only replaced if what's found is cheaper.
+ *
+ * @expr the expression
+ * @rules the rules to use as well as the default rules, or NULL
+ * @limits the limits, or NULL to use EGRAPH_LIMITS_DEFAULT
+ * @cost the cost model
+ * @return returns an error code
+ */
+error_t egraph_simplify(expression_t* expr, rewrite_rules_t* rules, const egraph_limits_t* limits,
+                        egraph_cost_t cost);
+
+#endif  // SIMPLIFY_EXPRESSION_EGRAPH_H_
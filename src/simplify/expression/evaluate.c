@@ -2,16 +2,118 @@
 
 #include "simplify/expression/isolate.h"
 #include "simplify/expression/evaluate.h"
+#include "simplify/expression/bounds.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/canonical.h"
+#include "simplify/expression/memo.h"
+#include "simplify/expression/call_stack.h"
+#include "simplify/expression/call_cache.h"
+#include "simplify/expression/symbol.h"
+#include "simplify/expression/thread_pool.h"
+#include "simplify/expression/value_cache.h"
 
-/* evaluate an expression, try to put it in it's simplest terms. Only apply operator and expand variables and function.
+/* the most function calls and variable substitutions that may be nested */
+static size_t _g_recursion_limit = EVALUATE_DEFAULT_RECURSION_LIMIT;
+
+/* the number of function calls and variable substitutions being evaluated on this thread */
+static CALL_STACK_THREAD_LOCAL size_t _g_evaluate_depth;
+
+/* set when a condition is decided on bounds that don't settle it, see expression_evaluate_adaptive */
+static CALL_STACK_THREAD_LOCAL bool _g_evaluate_uncertain;
+
+/* The steps of evaluating an expression.
+ * Evaluation is driven by a stack of tasks instead of recursion, so deep expressions and recursive functions
+ * don't overflow the C stack. Evaluating a node pushes a task to finish it, followed by tasks to evaluate it's children.
+ */
+typedef enum {
+    _EVALUATE_STEP_ENTER,          /* evaluate an expression, checking the memo first */
+    _EVALUATE_STEP_MEMO_END,       /* store a memoized expression's result */
+    _EVALUATE_STEP_SUBSTITUTED,    /* a variable's value has been evaluated */
+    _EVALUATE_STEP_PREFIX,         /* apply a prefix, it's right arm has been evaluated */
+    _EVALUATE_STEP_ASSIGNMENT,     /* apply an assignment, it's right arm has been evaluated */
+    _EVALUATE_STEP_OPERATOR_LEFT,  /* an operator's right arm has been evaluated, evaluate it's left */
+    _EVALUATE_STEP_OPERATOR,       /* apply an operator, both arms have been evaluated */
+    _EVALUATE_STEP_CALL_ARGUMENT,  /* evaluate a call's next argument, or make the call */
+    _EVALUATE_STEP_CALL_RETURN,    /* a function's body has been evaluated */
+    _EVALUATE_STEP_ARGUMENT,       /* an argument that was passed unevaluated has been evaluated, substitute it */
+    _EVALUATE_STEP_CONDITION,      /* a conditional's condition has been evaluated, evaluate the value it selects */
+} _evaluate_step_t;
+
+/* A function call being evaluated */
+typedef struct {
+    variable_info_t*   function;
+    expression_list_t  arguments;
+    expression_list_t* next_argument;
+    size_t             next_index;
+
+    /* bit `i` is set if the `i`th argument is passed without evaluating it */
+    uint64_t           lazy;
+
+    /* the cache the result is stored in, the result is stored under the caller's function if the call was a tail call */
+    call_cache_t*      cache;
+    variable_info_t*   key_function;
+    uint64_t           fingerprint;
+    expression_list_t* key;
+    scope_t*           caller;
+
+    bool               entered;
+    call_frame_t       frame;
+    scope_t            scope;
+    expression_t*      body;
+
+    /* the number of calls counted against the recursion limit. Tail calls reuse the frame without using more memory,
+     * so they aren't counted
+     */
+    size_t             depth;
+} _evaluate_call_t;
+
+typedef struct {
+    _evaluate_step_t step;
+    expression_t*    expr;
+    scope_t*         scope;
+    union {
+        _evaluate_call_t* call;
+        value_cache_recording_t* recording;
+        variable_info_t* argument;
+        expression_list_t* condition;
+        struct {
+            uint64_t     hash;
+            expression_t key;
+        } memo;
+    } data;
+} _evaluate_task_t;
+
+typedef struct {
+    _evaluate_task_t* tasks;
+    size_t            count;
+    size_t            capacity;
+} _evaluate_stack_t;
+
+/* push a task onto the work stack
  *
- * @expr the expression to evaluate
+ * @stack the work stack
+ * @step the task's step
+ * @expr the expression the task works on
  * @scope the expression's scope
- * @return returns an error code
+ * @return returns the new task, it's only valid until the next push
  */
-error_t _expression_evaluate_recursive(expression_t* expr, scope_t* scope);
+_evaluate_task_t* _evaluate_stack_push(_evaluate_stack_t* stack, _evaluate_step_t step, expression_t* expr, scope_t* scope) {
+    if (stack->count >= stack->capacity) {
+        stack->capacity = stack->capacity ? stack->capacity * 2 : EVALUATE_STACK_INITIAL_SIZE;
+        stack->tasks = realloc(stack->tasks, stack->capacity * sizeof(_evaluate_task_t));
+    }
+
+    _evaluate_task_t* task = &stack->tasks[stack->count++];
+    task->step  = step;
+    task->expr  = expr;
+    task->scope = scope;
+    return task;
+}
+
+error_t _expression_evaluate_stack(expression_t* expr, scope_t* scope);
 
 /* apply a assignment operator expression, assume the left side of the expression contains a variable or function.
+ * If the left side isn't a function the right side must already be evaluated.
  *
  * @expr the expression to apply
  * @scope the expression's scope
@@ -20,7 +122,7 @@ error_t _expression_evaluate_recursive(expression_t* expr, scope_t* scope);
 error_t _expression_apply_assignment(expression_t* expr, scope_t* scope) {
     assert(EXPRESSION_IS_OPERATOR(expr));
 
-    error_t err;
+    error_t err = ERROR_NO_ERROR;
     if (EXPRESSION_IS_FUNCTION(expr->operator.left)) {
         expression_t* body = malloc(sizeof(expression_t));
         expression_list_t* params = malloc(sizeof(expression_list_t));
@@ -34,18 +136,15 @@ error_t _expression_apply_assignment(expression_t* expr, scope_t* scope) {
 
         expression_collapse_left(expr);
     } else {
-        err = _expression_evaluate_recursive(expr->operator.right, scope);
-        if (err) return err;
-
         /* if there's not a variable on the left try to simplify the expression to get one */
         if (!EXPRESSION_IS_VARIABLE(expr->operator.left)) {
-            err = _expression_evaluate_recursive(expr->operator.left, scope);
+            err = _expression_evaluate_stack(expr->operator.left, scope);
             if (err) return err;
 
             variable_t varname = expression_find_variable(expr->operator.left);
             if (varname) {
                 expression_isolate_variable(expr, varname);
-                err = _expression_evaluate_recursive(expr->operator.right, scope);
+                err = _expression_evaluate_stack(expr->operator.right, scope);
                 if (err) return err;
             }
         }
@@ -53,7 +152,16 @@ error_t _expression_apply_assignment(expression_t* expr, scope_t* scope) {
         if (EXPRESSION_IS_VARIABLE(expr->operator.left)) {
             expression_t* value_copy = malloc(sizeof(expression_t));
             expression_copy(expr->operator.right, value_copy);
-            scope_define(scope, expr->operator.left->variable.value, value_copy);
+
+            variable_info_t* slot;
+            if (scope->frame && !call_frame_search(scope->frame, expr->operator.left->variable.value, &slot)) {
+                /* assigning to a parameter replaces the argument, so references resolved to the slot see the new value */
+                expression_free(slot->value.expression);
+                slot->value.expression = value_copy;
+                slot->generation = scope_next_generation();
+            } else {
+                scope_define(scope, expr->operator.left->variable.value, value_copy);
+            }
 
             expression_collapse_left(expr);
         }
@@ -62,7 +170,52 @@ error_t _expression_apply_assignment(expression_t* expr, scope_t* scope) {
     return err;
 }
 
-/* apply a prefix expression's prefix to it's right arm
+/* get the bounds on an evaluated number's exact value, a number without an upper bound is exact
+ *
+ * @expr the number
+ * @lower set to the lower bound
+ * @upper set to the upper bound
+ */
+void _evaluate_number_bounds(expression_t* expr, mpfr_srcptr* lower, mpfr_srcptr* upper) {
+    *lower = expr->number.value;
+    *upper = expr->number.upper ? expr->number.upper : expr->number.value;
+}
+
+/* round a number to the policy's precision. If the policy computes bounds (see expression_evaluate_adaptive) a number
+ * that isn't exact is given bounds, otherwise the number's bounds are dropped.
+ *
+ * @policy the precision policy
+ * @expr the number
+ */
+void _evaluate_number(const precision_policy_t* policy, expression_t* expr) {
+    if (!policy->bounds) {
+        expression_number_unbound(expr);
+        precision_policy_trim(policy, expr->number.value);
+        return;
+    }
+
+    mpfr_ptr value = expr->number.value;
+    mpfr_prec_t maximum = precision_policy_maximum(policy);
+    if (!expr->number.upper && (expr->number.inexact || mpfr_get_prec(value) > maximum)) {
+        mpfr_ptr upper = malloc(sizeof(mpfr_t));
+        mpfr_init2(upper, mpfr_get_prec(value));
+        mpfr_set(upper, value, MPFR_RNDN);
+
+        /* inexact numbers were rounded to nearest, so the exact number is less than an ulp away */
+        if (expr->number.inexact) {
+            mpfr_nextbelow(value);
+            mpfr_nextabove(upper);
+        }
+        expression_number_bound(expr, upper);
+    }
+
+    if (mpfr_get_prec(value) > maximum) {
+        mpfr_prec_round(value, maximum, MPFR_RNDD);
+        mpfr_prec_round(expr->number.upper, maximum, MPFR_RNDU);
+    }
+}
+
+/* apply a prefix expression's prefix to it's right arm, the right arm must already be evaluated
  *
  * @expr the prefix expression to apply
  * @scope the expression's scope
@@ -70,18 +223,26 @@ error_t _expression_apply_assignment(expression_t* expr, scope_t* scope) {
  */
 error_t _expression_apply_prefix(expression_t* expr, scope_t* scope) {
     assert(EXPRESSION_IS_PREFIX(expr));
-    error_t err;
-
-    err = _expression_evaluate_recursive(expr->prefix.right, scope);
-    if (err) return err;
+    (void)scope;
 
     if (EXPRESSION_IS_NUMBER(EXPRESSION_RIGHT(expr))) {
         switch (expr->prefix.prefix) {
             case '+':
                 break;
             case '-':
-                mpfr_neg(expr->prefix.right->number.value, expr->prefix.right->number.value, MPFR_RNDF);
+            {
+                struct expression_number* number = &expr->prefix.right->number;
+                mpfr_neg(number->value, number->value, MPFR_RNDF);
+
+                /* negating the bounds swaps them */
+                if (number->upper) {
+                    mpfr_ptr lower = number->upper;
+                    mpfr_neg(lower, lower, MPFR_RNDF);
+                    number->upper = number->value;
+                    number->value = lower;
+                }
                 break;
+            }
             default:
                 return ERROR_INVALID_PREFIX;
         }
@@ -97,54 +258,92 @@ error_t _expression_apply_prefix(expression_t* expr, scope_t* scope) {
  * @scope the expression's scope
  * @return returns an  error code
  */
-error_t _expression_apply_operator(expression_t* expr) {
+error_t _expression_apply_operator(expression_t* expr, scope_t* scope) {
     assert(EXPRESSION_IS_OPERATOR(expr));
 
-    static const int round_mode = MPFR_RNDF;
+    switch (expr->operator.infix) {
+        case '+':
+        case '-':
+        case '/':
+        case '*':
+        case '(':
+        case '^':
+        case '\\':
+            break;
+        case '=':
+        case '>':
+        case '<':
+            return ERROR_NO_ERROR;
+        default:
+            return ERROR_INVALID_OPERATOR;
+    }
 
-    mpfr_ptr result;
+    const precision_policy_t* policy = scope_get_precision_policy(scope);
+    const mpfr_rnd_t round_mode = policy->round;
 
     mpfr_ptr left  = expr->operator.left->number.value;
     mpfr_ptr right = expr->operator.right->number.value;
 
+    error_t err = budget_number(precision_policy_result(policy, mpfr_get_prec(left), mpfr_get_prec(right)));
+    if (err) return err;
+    mpfr_ptr result = precision_policy_new_number(policy, mpfr_get_prec(left), mpfr_get_prec(right));
+
+    if (policy->bounds) {
+        mpfr_srcptr lower1, upper1, lower2, upper2;
+        _evaluate_number_bounds(expr->operator.left, &lower1, &upper1);
+        _evaluate_number_bounds(expr->operator.right, &lower2, &upper2);
+        mpfr_ptr upper = precision_policy_new_number(policy, mpfr_get_prec(left), mpfr_get_prec(right));
+
+        switch (expr->operator.infix) {
+            case '+':
+                bounds_add(result, upper, lower1, upper1, lower2, upper2);
+                break;
+            case '-':
+                bounds_sub(result, upper, lower1, upper1, lower2, upper2);
+                break;
+            case '/':
+                bounds_div(result, upper, lower1, upper1, lower2, upper2);
+                break;
+            case '*':
+            case '(':
+                bounds_mul(result, upper, lower1, upper1, lower2, upper2);
+                break;
+            case '^':
+                bounds_pow(result, upper, lower1, upper1, lower2, upper2);
+                break;
+            case '\\':
+                bounds_rootn(result, upper, lower1, upper1, lower2, upper2);
+                break;
+        }
+
+        expression_free(expr->operator.left);
+        expression_free(expr->operator.right);
+
+        expression_init_number(expr, result);
+        expression_number_bound(expr, upper);
+        return ERROR_NO_ERROR;
+    }
+
     switch (expr->operator.infix) {
         case '+':
-            result = malloc(sizeof(mpfr_t));
-            mpfr_init(result);
             mpfr_add(result, left, right, round_mode);
             break;
         case '-':
-            result = malloc(sizeof(mpfr_t));
-            mpfr_init(result);
             mpfr_sub(result, left, right, round_mode);
             break;
         case '/':
-            result = malloc(sizeof(mpfr_t));
-            mpfr_init(result);
             mpfr_div(result, left, right, round_mode);
             break;
         case '*':
         case '(':
-            result = malloc(sizeof(mpfr_t));
-            mpfr_init(result);
             mpfr_mul(result, left, right, round_mode);
             break;
         case '^':
-            result = malloc(sizeof(mpfr_t));
-            mpfr_init(result);
             mpfr_pow(result, left, right, round_mode);
             break;
         case '\\':
-            result = malloc(sizeof(mpfr_t));
-            mpfr_init(result);
             mpfr_rootn_ui(result, left, mpfr_get_ui(right, MPFR_RNDN), round_mode);
             break;
-        case '=':
-        case '>':
-        case '<':
-            return ERROR_NO_ERROR;
-        default:
-            return ERROR_INVALID_OPERATOR;
     }
 
     expression_free(expr->operator.left);
@@ -157,28 +356,75 @@ error_t _expression_apply_operator(expression_t* expr) {
 
 
 /* subsitute a variable expression with the variable's value, if available.
+ * The value is evaluated by a task pushed onto the work stack, unless it's a parameter, which are already evaluated.
  *
- * This function will __not__ simplify the variable's result. 
- * 
+ * @stack the work stack
  * @expr the variable expression to substitute
  * @scope the scope to search for the variable
  * @return returns an error code
- */ 
-error_t _expression_substitute_variable(expression_t* expr, scope_t* scope) {
+ */
+error_t _expression_substitute_variable(_evaluate_stack_t* stack, expression_t* expr, scope_t* scope) {
     assert(EXPRESSION_IS_VARIABLE(expr));
 
     expression_t variable_value;
+    value_cache_t* values = NULL;
+    variable_info_t* info;
     error_t err;
 
-    if (expr->variable.binding)
-        err = scope_get_value(expr->variable.binding, expr->variable.value, &variable_value);
-    else
-        err = scope_get_value(scope, expr->variable.value, &variable_value);
+    /* parameters are read straight from the call frame, arguments that weren't evaluated by the caller are
+        evaluated in the caller's scope the first time they're read */
+    if (expr->variable.slot >= 0 && scope->frame && (size_t)expr->variable.slot < scope->frame->count) {
+        variable_info_t* slot = &scope->frame->slots[expr->variable.slot];
+        if (slot->thunk) {
+            _evaluate_stack_push(stack, _EVALUATE_STEP_ARGUMENT, expr, scope)->data.argument = slot;
+            _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, slot->value.expression, slot->thunk);
+            slot->thunk = NULL;
+            return ERROR_NO_ERROR;
+        }
+
+        expression_copy(slot->value.expression, &variable_value);
+        expression_clean(expr);
+        *expr = variable_value;
+        return ERROR_NO_ERROR;
+    }
+
+    if (!expr->variable.symbol)
+        expr->variable.symbol = symbol_intern(expr->variable.value);
+    symbol_t* symbol = expr->variable.symbol;
+
+    /* values are only cached where they can't be shadowed by a call's arguments or local definitions */
+    if (scope->values && !scope->parent && !scope->frame && !expression_memo_is_recording() &&
+            (!expr->variable.binding || expr->variable.binding == scope)) {
+        err = scope_get_symbol_info(scope, expr->variable.symbol, &info);
+        if (!err && !info->is_internal && !info->named_inputs && !info->impure &&
+                info->index < scope->slot_count && scope->slots[info->index].info == info) {
+            values = scope->values;
+            if (value_cache_lookup(values, info, scope_get_precision_policy(scope), &variable_value)) {
+                expression_clean(expr);
+                *expr = variable_value;
+                return ERROR_NO_ERROR;
+            }
+            expression_copy(info->value.expression, &variable_value);
+        } else if (!err) {
+            err = scope_get_symbol_value(scope, expr->variable.symbol, &variable_value);
+        }
+    } else if (expr->variable.binding) {
+        err = scope_get_symbol_value(expr->variable.binding, expr->variable.symbol, &variable_value);
+    } else {
+        err = scope_get_symbol_value(scope, expr->variable.symbol, &variable_value);
+    }
 
     if (!err) {
         expression_clean(expr);
         *expr = variable_value;
-        _expression_evaluate_recursive(expr, scope);
+
+        if (++_g_evaluate_depth > _g_recursion_limit) {
+            --_g_evaluate_depth;
+            return ERROR_RECURSION_LIMIT;
+        }
+        _evaluate_task_t* task = _evaluate_stack_push(stack, _EVALUATE_STEP_SUBSTITUTED, expr, scope);
+        task->data.recording = values ? value_cache_begin(values, info, symbol) : NULL;
+        _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, expr, scope);
     } else if (!expr->variable.binding) {
         /* couldn't find the variable. let future executor know that this is the
             scope where the variable's value should be found */
@@ -187,96 +433,1423 @@ error_t _expression_substitute_variable(expression_t* expr, scope_t* scope) {
     return ERROR_NO_ERROR;
 }
 
-error_t _expression_evaluate_recursive(expression_t* expr, scope_t* scope) {
+/* free a function call, and leave it's frame if it was entered
+ *
+ * @call the call to free
+ */
+void _evaluate_call_free(_evaluate_call_t* call) {
+    if (call->entered) {
+        call_frame_leave(&call->frame);
+        scope_clean(&call->scope);
+    }
+
+    expression_list_free(call->arguments.next);
+    if (call->arguments.value)
+        expression_free(call->arguments.value);
+    if (call->key)
+        expression_list_free(call->key);
+    if (call->body)
+        expression_free(call->body);
+    free(call);
+}
+
+/* check if an expression is the whole body of the function call below it on the work stack
+ *
+ * @stack the work stack
+ * @expr the expression
+ * @return returns true if the expression is the result of the function being called
+ */
+bool _evaluate_is_tail_position(_evaluate_stack_t* stack, expression_t* expr) {
+    if (stack->count == 0)
+        return false;
+
+    _evaluate_task_t* top = &stack->tasks[stack->count - 1];
+    return top->step == _EVALUATE_STEP_CALL_RETURN && top->data.call->body == expr;
+}
+
+/* check if an expression assigns anything
+ *
+ * @expr the expression
+ * @return returns true if the expression contains an assignment
+ */
+bool _evaluate_has_assignment(expression_t* expr) {
+    expression_t* param;
     switch (expr->type) {
         case EXPRESSION_TYPE_NUMBER:
-            /* numbers can't be evaluated */
-            break;
         case EXPRESSION_TYPE_VARIABLE:
-            return _expression_substitute_variable(expr, scope);
-        case EXPRESSION_TYPE_FUNCTION:
-        {
-            expression_t old = *expr;
-            error_t err = scope_call(scope, expr->function.name, expr->function.parameters, expr);
-            if (err && err != ERROR_NONEXISTANT_KEY) return err;
-            if (!err) expression_clean(&old);
-            return ERROR_NO_ERROR;
-        }
+            return false;
         case EXPRESSION_TYPE_PREFIX:
-            return _expression_apply_prefix(expr, scope);
+            return _evaluate_has_assignment(expr->prefix.right);
         case EXPRESSION_TYPE_OPERATOR:
-        {
-            if (expr->operator.infix == ':') {
-                return _expression_apply_assignment(expr, scope);
-            } else {
-                error_t err = _expression_evaluate_recursive(expr->operator.right, scope);
-                if (err) return err;
-
-                err = _expression_evaluate_recursive(expr->operator.left, scope);
-                if (!expression_is_comparison(expr) && expr->operator.right->type == expr->operator.left->type &&
-                        expr->operator.left->type == EXPRESSION_TYPE_NUMBER) {
-                    return _expression_apply_operator(expr);
-                }
-                return err;
+            return expr->operator.infix == ':' || _evaluate_has_assignment(expr->operator.left) ||
+                   _evaluate_has_assignment(expr->operator.right);
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                if (_evaluate_has_assignment(param))
+                    return true;
             }
-        }
+            return false;
     }
-    return ERROR_NO_ERROR;
+    return false;
 }
 
-expression_result_t _expression_evaluate_comparisons_recursive(expression_t* expr) {
-    expression_result_t result;
+/* choose the arguments of a call that are passed without evaluating them
+ *
+ * @stack the work stack
+ * @expr the function call expression
+ * @function the function being called
+ * @return returns a mask with bit `i` set if the `i`th argument isn't evaluated until it's used
+ */
+uint64_t _evaluate_lazy_arguments(_evaluate_stack_t* stack, expression_t* expr, variable_info_t* function) {
+    /* a call that may reuse the caller's frame couldn't read the caller's arguments once it's replaced them */
+    if (!function->lazy_inputs || function->is_internal || _evaluate_is_tail_position(stack, expr))
+        return 0;
 
-    switch (expr->type) {
-        case EXPRESSION_TYPE_NUMBER:
-            return EXPRESSION_RESULT_NONBINARY;
-        case EXPRESSION_TYPE_VARIABLE:
-            return EXPRESSION_RESULT_NONBINARY;
-        case EXPRESSION_TYPE_FUNCTION:
-            return EXPRESSION_RESULT_NONBINARY;
-        case EXPRESSION_TYPE_PREFIX:
+    uint64_t lazy = 0;
+    size_t i = 0;
+    expression_t* arg;
+    EXPRESSION_LIST_FOREACH(arg, expr->function.parameters) {
+        /* numbers are as cheap to copy as to delay, and an argument's definitions are made even if it isn't used */
+        if (i < 64 && ((function->lazy_inputs >> i) & 1) && !EXPRESSION_IS_NUMBER(arg) && !_evaluate_has_assignment(arg))
+            lazy |= (uint64_t)1 << i;
+        ++i;
+    }
+    return lazy;
+}
+
+/* start evaluating one of a conditional's conditions, a task is pushed to evaluate the value it selects
+ *
+ * @stack the work stack
+ * @expr the conditional
+ * @scope the conditional's scope
+ * @condition the argument holding the condition
+ */
+void _evaluate_condition_begin(_evaluate_stack_t* stack, expression_t* expr, scope_t* scope, expression_list_t* condition) {
+    _evaluate_stack_push(stack, _EVALUATE_STEP_CONDITION, expr, scope)->data.condition = condition;
+    _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, condition->value, scope);
+}
+
+/* decide an evaluated condition
+ *
+ * @condition the condition
+ * @return returns EXPRESSION_RESULT_NONBINARY if the condition can't be decided
+ */
+expression_result_t _evaluate_condition_result(expression_t* condition) {
+    if (EXPRESSION_IS_NUMBER(condition)) {
+        if (mpfr_nan_p(condition->number.value))
             return EXPRESSION_RESULT_NONBINARY;
-        case EXPRESSION_TYPE_OPERATOR:
-        {
-            expression_result_t right = _expression_evaluate_comparisons_recursive(expr->operator.right);
-            expression_result_t left = _expression_evaluate_comparisons_recursive(expr->operator.left);
+        return mpfr_zero_p(condition->number.value) ? EXPRESSION_RESULT_FALSE : EXPRESSION_RESULT_TRUE;
+    }
+    if (!expression_is_comparison(condition))
+        return EXPRESSION_RESULT_NONBINARY;
 
-            if (right == EXPRESSION_RESULT_FALSE || left == EXPRESSION_RESULT_FALSE) {
-                result = EXPRESSION_RESULT_FALSE;
-                break;
-            }
+    /* only equality is decided within the compare tolerance */
+    compare_result_t x = condition->operator.infix == '='
+        ? expression_compare(EXPRESSION_LEFT(condition), EXPRESSION_RIGHT(condition))
+        : expression_compare_strict(EXPRESSION_LEFT(condition), EXPRESSION_RIGHT(condition));
+    if (x == COMPARE_RESULT_INCOMPARABLE)
+        return EXPRESSION_RESULT_NONBINARY;
+    if ((condition->operator.infix == '<' && x == COMPARE_RESULT_LESS) ||
+            (condition->operator.infix == '>' && x == COMPARE_RESULT_GREATER) ||
+            (condition->operator.infix == '=' && x == COMPARE_RESULT_EQUAL))
+        return EXPRESSION_RESULT_TRUE;
+    return EXPRESSION_RESULT_FALSE;
+}
 
-            if (expression_is_comparison(expr)) {
-                compare_result_t x = expression_compare(EXPRESSION_LEFT(expr), EXPRESSION_RIGHT(expr));
-                if (x == COMPARE_RESULT_INCOMPARABLE)
-                    return  EXPRESSION_RESULT_NONBINARY;
-                else if (expr->operator.infix == '<' && x == COMPARE_RESULT_LESS)
-                    result = EXPRESSION_RESULT_TRUE;
-                else if (expr->operator.infix == '>' && x == COMPARE_RESULT_GREATER)
-                    result = EXPRESSION_RESULT_TRUE;
-                else if (expr->operator.infix == '=' && x == COMPARE_RESULT_EQUAL)
-                    result = EXPRESSION_RESULT_TRUE;
-                else
-                    result = EXPRESSION_RESULT_FALSE;
-                break;
-            }
+/* check if an evaluated condition is decided the same way for any numbers within the bounds of it's numbers
+ *
+ * @condition the condition
+ * @return returns false if the exact numbers could decide the condition differently
+ */
+bool _evaluate_condition_is_certain(expression_t* condition) {
+    mpfr_srcptr lower1, upper1, lower2, upper2;
+    if (EXPRESSION_IS_NUMBER(condition)) {
+        if (!condition->number.upper)
+            return true;
+        _evaluate_number_bounds(condition, &lower1, &upper1);
+        return bounds_are_exact(lower1, upper1) || mpfr_sgn(lower1) > 0 || mpfr_sgn(upper1) < 0;
+    }
+    if (!expression_is_comparison(condition) || !EXPRESSION_IS_NUMBER(EXPRESSION_LEFT(condition)) ||
+            !EXPRESSION_IS_NUMBER(EXPRESSION_RIGHT(condition)))
+        return true;
+    if (!EXPRESSION_LEFT(condition)->number.upper && !EXPRESSION_RIGHT(condition)->number.upper)
+        return true;
 
-            if (right == EXPRESSION_RESULT_TRUE || left == EXPRESSION_RESULT_TRUE) {
-                result = EXPRESSION_RESULT_TRUE;
-            } else {
-                return EXPRESSION_RESULT_NONBINARY;
+    /* the comparison is settled if the bounds don't overlap, or if both numbers are exact */
+    _evaluate_number_bounds(EXPRESSION_LEFT(condition), &lower1, &upper1);
+    _evaluate_number_bounds(EXPRESSION_RIGHT(condition), &lower2, &upper2);
+    return mpfr_less_p(upper1, lower2) || mpfr_less_p(upper2, lower1) ||
+           (bounds_are_exact(lower1, upper1) && bounds_are_exact(lower2, upper2));
+}
+
+/* replace a conditional with the value selected by an evaluated condition, or evaluate the next condition
+ *
+ * @stack the work stack
+ * @expr the conditional
+ * @scope the conditional's scope
+ * @condition the argument holding the evaluated condition
+ * @return returns an error code
+ */
+error_t _evaluate_condition(_evaluate_stack_t* stack, expression_t* expr, scope_t* scope, expression_list_t* condition) {
+    expression_list_t* selected;
+    if (!_evaluate_condition_is_certain(condition->value))
+        _g_evaluate_uncertain = true;
+
+    switch (_evaluate_condition_result(condition->value)) {
+        case EXPRESSION_RESULT_TRUE:
+            selected = condition->next;
+            break;
+        case EXPRESSION_RESULT_FALSE:
+            /* the argument after the value is another condition, unless it's the last */
+            selected = condition->next->next;
+            if (selected->next && selected->next->value) {
+                _evaluate_condition_begin(stack, expr, scope, selected);
+                return ERROR_NO_ERROR;
             }
-        }
+            break;
+        default:
+            return ERROR_NO_ERROR;
     }
 
-    expression_collapse_left(expr);
-    return result;
+    /* the value replaces the conditional before it's evaluated, so a call it makes can reuse the caller's frame */
+    expression_t* value = selected->value;
+    selected->value = NULL;
+    expression_clean(expr);
+    *expr = *value;
+    free(value);
+
+    _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, expr, scope);
+    return ERROR_NO_ERROR;
 }
 
-error_t expression_evaluate(expression_t* expr, scope_t* scope) {
-    return _expression_evaluate_recursive(expr, scope);
+/* start evaluating a function call, a task is pushed to evaluate it's arguments
+ *
+ * @stack the work stack
+ * @expr the function call expression
+ * @scope the scope the function is called from
+ * @return returns an error code
+ */
+error_t _evaluate_call_begin(_evaluate_stack_t* stack, expression_t* expr, scope_t* scope) {
+    variable_info_t* info;
+
+    if (!expr->function.symbol)
+        expr->function.symbol = symbol_intern(expr->function.name);
+
+    /* functions that aren't defined are left as they are, except for the conditional */
+    if (scope_get_symbol_info(scope, expr->function.symbol, &info)) {
+        if (expression_is_conditional(expr))
+            _evaluate_condition_begin(stack, expr, scope, expr->function.parameters);
+        return ERROR_NO_ERROR;
+    }
+    if (!info->named_inputs)
+        return ERROR_IS_A_VARIABLE;
+
+    _evaluate_call_t* call = malloc(sizeof(_evaluate_call_t));
+    call->function = info;
+    expression_list_init(&call->arguments);
+    expression_list_copy(expr->function.parameters, &call->arguments);
+    call->next_argument = &call->arguments;
+    call->next_index    = 0;
+    call->lazy          = _evaluate_lazy_arguments(stack, expr, info);
+
+    call->cache        = scope_get_call_cache(scope);
+    call->key_function = info;
+    call->fingerprint  = 0;
+    call->key          = NULL;
+    call->caller       = scope;
+    call->entered      = false;
+    call->body         = NULL;
+    call->depth        = 0;
+
+    if (call->cache && !call_cache_fingerprint(scope, info, &call->fingerprint)) {
+        ++call->cache->impure;
+        call->cache = NULL;
+    }
+
+    /* the cache is keyed on evaluated arguments */
+    if (call->lazy)
+        call->cache = NULL;
+
+    _evaluate_stack_push(stack, _EVALUATE_STEP_CALL_ARGUMENT, expr, scope)->data.call = call;
+    return ERROR_NO_ERROR;
 }
 
-expression_result_t expression_evaluate_comparisons(expression_t* expr) {
-    return _expression_evaluate_comparisons_recursive(expr);
+/* finish a function call, replacing the call expression with the function's result
+ *
+ * @expr the function call expression
+ * @call the call, it's freed
+ * @err the error returned by the function's body
+ * @return returns an error code
+ */
+error_t _evaluate_call_end(expression_t* expr, _evaluate_call_t* call, error_t err) {
+    _g_evaluate_depth -= call->depth;
+
+    /* functions that can't be applied (like builtins given a variable) leave the call as it is */
+    if (!err && call->body) {
+        if (call->key)
+            call_cache_store(call->cache, call->caller, call->key_function, call->fingerprint, call->key, call->body);
+
+        expression_clean(expr);
+        *expr = *call->body;
+        free(call->body);
+        call->body = NULL;
+    }
+
+    _evaluate_call_free(call);
+    return err == ERROR_NONEXISTANT_KEY ? ERROR_NO_ERROR : err;
+}
+
+/* try to make a call in the frame of the function whose body it is the result of.
+ * The calling function's frame is reused if the call is the root of the body, and the callee can't see the caller's arguments.
+ *
+ * @stack the work stack
+ * @expr the function call expression
+ * @call the call, it's arguments must be evaluated. It's freed if the caller's frame was reused
+ * @return returns true if the caller's frame was reused
+ */
+bool _evaluate_tail_call(_evaluate_stack_t* stack, expression_t* expr, _evaluate_call_t* call) {
+    if (call->function->is_internal || call->lazy || !_evaluate_is_tail_position(stack, expr))
+        return false;
+
+    _evaluate_task_t* top = &stack->tasks[stack->count - 1];
+
+    /* definitions made by the caller would be visible to the callee, they're kept in a new scope */
+    _evaluate_call_t* caller = top->data.call;
+    if (caller->scope.variables.root)
+        return false;
+
+    /* parameters without an argument are looked up by name, and may be found in the caller's frame */
+    expression_list_t* param;
+    expression_list_t* arg;
+    for (param = call->function->named_inputs, arg = &call->arguments;
+            param && param->value && arg && arg->value;
+            param = param->next, arg = arg->next)
+        continue;
+    if (param && param->value)
+        return false;
+
+    if (call_frame_is_visible(&caller->frame, &caller->scope, call->function))
+        return false;
+
+    call_frame_leave(&caller->frame);
+    call_frame_enter(&caller->frame, call->function, &call->arguments);
+    caller->function = call->function;
+
+    expression_free(caller->body);
+    caller->body = malloc(sizeof(expression_t));
+    expression_copy(call->function->value.expression, caller->body);
+
+    _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, caller->body, &caller->scope);
+    _evaluate_call_free(call);
+    return true;
+}
+
+/* check if a call's arguments are all exact, see expression_evaluate_adaptive
+ *
+ * @call the call, it's frame must be entered
+ * @return returns false if an argument is a number that's only known to lie within bounds
+ */
+bool _evaluate_call_is_exact(_evaluate_call_t* call) {
+    for (size_t i = 0; i < call->frame.count; ++i) {
+        expression_t* arg = call->frame.slots[i].value.expression;
+        if (arg && EXPRESSION_IS_NUMBER(arg) && arg->number.upper &&
+                !bounds_are_exact(arg->number.value, arg->number.upper))
+            return false;
+    }
+    return true;
+}
+
+/* swap the lower and upper bounds of a call's arguments, so the function reads their upper bounds as their values
+ *
+ * @call the call, it's frame must be entered
+ */
+void _evaluate_call_swap_bounds(_evaluate_call_t* call) {
+    for (size_t i = 0; i < call->frame.count; ++i) {
+        expression_t* arg = call->frame.slots[i].value.expression;
+        if (arg && EXPRESSION_IS_NUMBER(arg) && arg->number.upper) {
+            mpfr_ptr lower = arg->number.value;
+            arg->number.value = arg->number.upper;
+            arg->number.upper = lower;
+        }
+    }
+}
+
+/* call an internal function with each argument at one of it's bounds, rounding the result in one direction
+ *
+ * @call the call, it's frame must be entered
+ * @upper if true the arguments are at their upper bounds, otherwise they're at their lower bounds
+ * @round the rounding mode the function should use
+ * @out location to store the result, it's NULL if the function doesn't produce one
+ * @return returns an error code
+ */
+error_t _evaluate_call_endpoint(_evaluate_call_t* call, bool upper, mpfr_rnd_t round, expression_t** out) {
+    precision_policy_t* old_policy = call->scope.precision;
+    precision_policy_t  policy     = *scope_get_precision_policy(&call->scope);
+    policy.round = round;
+    scope_set_precision_policy(&call->scope, &policy);
+
+    if (upper)
+        _evaluate_call_swap_bounds(call);
+    *out = NULL;
+    error_t err = call->function->value.internal(&call->scope, out);
+    if (upper)
+        _evaluate_call_swap_bounds(call);
+
+    scope_set_precision_policy(&call->scope, old_policy);
+    return err;
+}
+
+/* call an internal function. If the policy computes bounds (see expression_evaluate_adaptive) the result is bounded
+ * using the function's shape (see scope_mark_shape). Builtins are trusted to round the way the policy says, so with
+ * exact arguments rounding down and rounding up bound any function. Otherwise the result is unbounded.
+ *
+ * @call the call, it's frame must be entered. The result is stored in it's body
+ * @return returns an error code
+ */
+error_t _evaluate_call_internal(_evaluate_call_t* call) {
+    variable_info_t* function = call->function;
+    if (!scope_get_precision_policy(&call->scope)->bounds || function->impure)
+        return function->value.internal(&call->scope, &call->body);
+
+    function_shape_t shape = _evaluate_call_is_exact(call) ? FUNCTION_SHAPE_INCREASING : function->shape;
+    if (shape == FUNCTION_SHAPE_SLOPE_ONE && call->frame.count != 1)
+        shape = FUNCTION_SHAPE_UNKNOWN;
+
+    if (shape == FUNCTION_SHAPE_UNKNOWN) {
+        error_t err = function->value.internal(&call->scope, &call->body);
+        if (!err && call->body && EXPRESSION_IS_NUMBER(call->body)) {
+            expression_number_unbound(call->body);
+            mpfr_ptr upper = malloc(sizeof(mpfr_t));
+            mpfr_init2(upper, mpfr_get_prec(call->body->number.value));
+            bounds_set_unbounded(call->body->number.value, upper);
+            expression_number_bound(call->body, upper);
+        }
+        return err;
+    }
+
+    /* an increasing function's lower bound is at it's arguments' lower bounds, a decreasing function's is at their
+        upper bounds. A function that changes no faster than it's argument is bounded near one end, then widened */
+    expression_t* lower = NULL;
+    expression_t* upper = NULL;
+    error_t err = _evaluate_call_endpoint(call, shape == FUNCTION_SHAPE_DECREASING, MPFR_RNDD, &lower);
+    if (!err && lower && EXPRESSION_IS_NUMBER(lower))
+        err = _evaluate_call_endpoint(call, shape == FUNCTION_SHAPE_INCREASING, MPFR_RNDU, &upper);
+
+    if (err || !lower || !EXPRESSION_IS_NUMBER(lower) || !upper || !EXPRESSION_IS_NUMBER(upper)) {
+        if (upper)
+            expression_free(upper);
+        if (err && lower)
+            expression_free(lower);
+        else
+            call->body = lower;
+        return err;
+    }
+
+    mpfr_prec_t precision = mpfr_get_prec(lower->number.value);
+    if (mpfr_get_prec(upper->number.value) > precision)
+        precision = mpfr_get_prec(upper->number.value);
+
+    mpfr_ptr result_lower = malloc(sizeof(mpfr_t));
+    mpfr_ptr result_upper = malloc(sizeof(mpfr_t));
+    mpfr_init2(result_lower, precision);
+    mpfr_init2(result_upper, precision);
+
+    mpfr_srcptr lower1, upper1, lower2, upper2;
+    _evaluate_number_bounds(lower, &lower1, &upper1);
+    _evaluate_number_bounds(upper, &lower2, &upper2);
+    bounds_hull(result_lower, result_upper, lower1, upper1, lower2, upper2);
+    if (shape == FUNCTION_SHAPE_SLOPE_ONE) {
+        _evaluate_number_bounds(call->frame.slots[0].value.expression, &lower1, &upper1);
+        bounds_widen(result_lower, result_upper, lower1, upper1);
+    }
+
+    expression_free(lower);
+    expression_free(upper);
+    call->body = expression_new_number(result_lower);
+    expression_number_bound(call->body, result_upper);
+    return ERROR_NO_ERROR;
+}
+
+/* evaluate a call's next argument, or make the call once they've all been evaluated
+ *
+ * @stack the work stack
+ * @expr the function call expression
+ * @scope the scope the function is called from
+ * @call the call
+ * @err the error from evaluating the last argument
+ * @return returns an error code
+ */
+error_t _evaluate_call_argument(_evaluate_stack_t* stack, expression_t* expr, scope_t* scope, _evaluate_call_t* call, error_t err) {
+    if (err) {
+        _evaluate_call_free(call);
+        return err;
+    }
+
+    /* arguments are evaluated in the caller's scope, one at a time. Lazy arguments are skipped */
+    expression_list_t* next = call->next_argument;
+    for (; next && next->value && call->next_index < 64 && ((call->lazy >> call->next_index) & 1); next = next->next)
+        ++call->next_index;
+
+    if (next && next->value) {
+        call->next_argument = next->next;
+        ++call->next_index;
+        _evaluate_stack_push(stack, _EVALUATE_STEP_CALL_ARGUMENT, expr, scope)->data.call = call;
+        _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, next->value, scope);
+        return ERROR_NO_ERROR;
+    }
+
+    if (call->cache) {
+        expression_t result;
+        if (call_cache_lookup(call->cache, scope, call->function, call->fingerprint, &call->arguments, &result)) {
+            _evaluate_call_free(call);
+            expression_clean(expr);
+            *expr = result;
+            return ERROR_NO_ERROR;
+        }
+
+        call->key = malloc(sizeof(expression_list_t));
+        expression_list_init(call->key);
+        expression_list_copy(&call->arguments, call->key);
+    }
+
+    if (_g_evaluate_depth + 1 > _g_recursion_limit) {
+        _evaluate_call_free(call);
+        return ERROR_RECURSION_LIMIT;
+    }
+
+    /* internal functions compute their result at the precision of their widest argument */
+    if (call->function->is_internal) {
+        mpfr_prec_t widest = 0;
+        expression_t* arg;
+        EXPRESSION_LIST_FOREACH(arg, &call->arguments) {
+            if (EXPRESSION_IS_NUMBER(arg) && mpfr_get_prec(arg->number.value) > widest)
+                widest = mpfr_get_prec(arg->number.value);
+        }
+
+        err = budget_number(precision_policy_result(scope_get_precision_policy(scope), widest, 0));
+        if (err) {
+            _evaluate_call_free(call);
+            return err;
+        }
+    }
+
+    if (_evaluate_tail_call(stack, expr, call))
+        return ERROR_NO_ERROR;
+
+    ++_g_evaluate_depth;
+    call->depth = 1;
+
+    call_frame_enter(&call->frame, call->function, &call->arguments);
+    scope_init_child(&call->scope, scope);
+    call->scope.frame = &call->frame;
+    call->entered = true;
+
+    for (size_t i = 0; i < call->frame.count && i < 64; ++i) {
+        if ((call->lazy >> i) & 1)
+            call->frame.slots[i].thunk = scope;
+    }
+
+    if (call->function->is_internal) {
+        err = _evaluate_call_internal(call);
+        return _evaluate_call_end(expr, call, err);
+    }
+
+    call->body = malloc(sizeof(expression_t));
+    expression_copy(call->function->value.expression, call->body);
+
+    _evaluate_stack_push(stack, _EVALUATE_STEP_CALL_RETURN, expr, scope)->data.call = call;
+    _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, call->body, &call->scope);
+    return ERROR_NO_ERROR;
+}
+
+/* start evaluating a single expression, tasks are pushed to evaluate it's children and finish it.
+ *
+ * @stack the work stack
+ * @expr the expression to evaluate
+ * @scope the expression's scope
+ * @return returns an error code
+ */
+error_t _evaluate_node(_evaluate_stack_t* stack, expression_t* expr, scope_t* scope) {
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            /* numbers can't be evaluated, but they may be more precise than the policy allows */
+            _evaluate_number(scope_get_precision_policy(scope), expr);
+            break;
+        case EXPRESSION_TYPE_VARIABLE:
+            return _expression_substitute_variable(stack, expr, scope);
+        case EXPRESSION_TYPE_FUNCTION:
+            return _evaluate_call_begin(stack, expr, scope);
+        case EXPRESSION_TYPE_PREFIX:
+            _evaluate_stack_push(stack, _EVALUATE_STEP_PREFIX, expr, scope);
+            _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, expr->prefix.right, scope);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            if (expr->operator.infix == ':') {
+                if (EXPRESSION_IS_FUNCTION(expr->operator.left))
+                    return _expression_apply_assignment(expr, scope);
+                _evaluate_stack_push(stack, _EVALUATE_STEP_ASSIGNMENT, expr, scope);
+            } else {
+                _evaluate_stack_push(stack, _EVALUATE_STEP_OPERATOR_LEFT, expr, scope);
+            }
+            _evaluate_stack_push(stack, _EVALUATE_STEP_ENTER, expr->operator.right, scope);
+            break;
+    }
+    return ERROR_NO_ERROR;
+}
+
+/* start evaluating an expression, reusing the result of an identical expression if the scope's memo has one.
+ * Expressions are remembered in canonical form (see canonical.h), so `a * b` reuses the result of `b * a`.
+ *
+ * @stack the work stack
+ * @expr the expression to evaluate
+ * @scope the expression's scope
+ * @return returns an error code
+ */
+error_t _evaluate_enter(_evaluate_stack_t* stack, expression_t* expr, scope_t* scope) {
+    expression_memo_t* memo = scope->memo;
+    if (memo && expression_memo_is_candidate(expr)) {
+        expression_t key;
+        expression_t result;
+
+        /* the expression itself is evaluated as it was written, only the key is canonical */
+        expression_copy(expr, &key);
+        expression_canonicalize(&key);
+        uint64_t hash = expression_hash(&key);
+
+        if (expression_memo_lookup(memo, scope, &key, hash, &result)) {
+            expression_clean(&key);
+            expression_clean(expr);
+            *expr = result;
+            return ERROR_NO_ERROR;
+        }
+
+        _evaluate_task_t* task = _evaluate_stack_push(stack, _EVALUATE_STEP_MEMO_END, expr, scope);
+        task->data.memo.hash = hash;
+        task->data.memo.key = key;
+        expression_memo_begin(memo);
+    }
+    return _evaluate_node(stack, expr, scope);
+}
+
+/* evaluate an expression, try to put it in it's simplest terms. Only apply operator and expand variables and function.
+ * Once a task fails the remaining tasks are only run to clean up, expressions that haven't been entered are skipped.
+ *
+ * @expr the expression to evaluate
+ * @scope the expression's scope
+ * @return returns an error code
+ */
+error_t _expression_evaluate_stack(expression_t* expr, scope_t* scope) {
+    _evaluate_stack_t stack = { NULL, 0, 0 };
+    error_t err = ERROR_NO_ERROR;
+
+    _evaluate_stack_push(&stack, _EVALUATE_STEP_ENTER, expr, scope);
+    while (stack.count > 0) {
+        _evaluate_task_t task = stack.tasks[--stack.count];
+
+        switch (task.step) {
+            case _EVALUATE_STEP_ENTER:
+                if (!err)
+                    err = budget_step();
+                if (!err)
+                    err = _evaluate_enter(&stack, task.expr, task.scope);
+                break;
+            case _EVALUATE_STEP_MEMO_END:
+                expression_memo_end(task.scope->memo, task.scope, &task.data.memo.key, task.data.memo.hash,
+                                    err ? NULL : task.expr);
+                break;
+            case _EVALUATE_STEP_SUBSTITUTED:
+                if (task.data.recording)
+                    value_cache_end(task.data.recording, err ? NULL : task.expr, scope_get_precision_policy(task.scope));
+
+                /* a variable's value is substituted even if it can't be evaluated */
+                --_g_evaluate_depth;
+                if (err != ERROR_RECURSION_LIMIT && err != ERROR_BUDGET_EXCEEDED)
+                    err = ERROR_NO_ERROR;
+                break;
+            case _EVALUATE_STEP_PREFIX:
+                if (!err)
+                    err = _expression_apply_prefix(task.expr, task.scope);
+                break;
+            case _EVALUATE_STEP_ASSIGNMENT:
+                if (!err)
+                    err = _expression_apply_assignment(task.expr, task.scope);
+                break;
+            case _EVALUATE_STEP_OPERATOR_LEFT:
+                if (!err) {
+                    _evaluate_stack_push(&stack, _EVALUATE_STEP_OPERATOR, task.expr, task.scope);
+                    _evaluate_stack_push(&stack, _EVALUATE_STEP_ENTER, task.expr->operator.left, task.scope);
+                }
+                break;
+            case _EVALUATE_STEP_OPERATOR:
+                if (!err && !expression_is_comparison(task.expr) &&
+                        task.expr->operator.right->type == task.expr->operator.left->type &&
+                        task.expr->operator.left->type == EXPRESSION_TYPE_NUMBER) {
+                    err = _expression_apply_operator(task.expr, task.scope);
+                }
+                break;
+            case _EVALUATE_STEP_CALL_ARGUMENT:
+                err = _evaluate_call_argument(&stack, task.expr, task.scope, task.data.call, err);
+                break;
+            case _EVALUATE_STEP_CALL_RETURN:
+                err = _evaluate_call_end(task.expr, task.data.call, err);
+                break;
+            case _EVALUATE_STEP_ARGUMENT:
+                if (!err) {
+                    expression_t value;
+                    expression_copy(task.data.argument->value.expression, &value);
+                    expression_clean(task.expr);
+                    *task.expr = value;
+                }
+                break;
+            case _EVALUATE_STEP_CONDITION:
+                if (!err)
+                    err = _evaluate_condition(&stack, task.expr, task.scope, task.data.condition);
+                break;
+        }
+    }
+
+    free(stack.tasks);
+    return err;
+}
+
+expression_result_t _expression_evaluate_comparisons_recursive(expression_t* expr) {
+    expression_result_t result;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return EXPRESSION_RESULT_NONBINARY;
+        case EXPRESSION_TYPE_VARIABLE:
+            return EXPRESSION_RESULT_NONBINARY;
+        case EXPRESSION_TYPE_FUNCTION:
+            return EXPRESSION_RESULT_NONBINARY;
+        case EXPRESSION_TYPE_PREFIX:
+            return EXPRESSION_RESULT_NONBINARY;
+        case EXPRESSION_TYPE_OPERATOR:
+        {
+            expression_result_t right = _expression_evaluate_comparisons_recursive(expr->operator.right);
+            expression_result_t left = _expression_evaluate_comparisons_recursive(expr->operator.left);
+
+            if (right == EXPRESSION_RESULT_FALSE || left == EXPRESSION_RESULT_FALSE) {
+                result = EXPRESSION_RESULT_FALSE;
+                break;
+            }
+
+            if (expression_is_comparison(expr)) {
+                compare_result_t x = expr->operator.infix == '='
+                    ? expression_compare(EXPRESSION_LEFT(expr), EXPRESSION_RIGHT(expr))
+                    : expression_compare_strict(EXPRESSION_LEFT(expr), EXPRESSION_RIGHT(expr));
+                if (x == COMPARE_RESULT_INCOMPARABLE)
+                    return  EXPRESSION_RESULT_NONBINARY;
+                else if (expr->operator.infix == '<' && x == COMPARE_RESULT_LESS)
+                    result = EXPRESSION_RESULT_TRUE;
+                else if (expr->operator.infix == '>' && x == COMPARE_RESULT_GREATER)
+                    result = EXPRESSION_RESULT_TRUE;
+                else if (expr->operator.infix == '=' && x == COMPARE_RESULT_EQUAL)
+                    result = EXPRESSION_RESULT_TRUE;
+                else
+                    result = EXPRESSION_RESULT_FALSE;
+                break;
+            }
+
+            if (right == EXPRESSION_RESULT_TRUE || left == EXPRESSION_RESULT_TRUE) {
+                result = EXPRESSION_RESULT_TRUE;
+            } else {
+                return EXPRESSION_RESULT_NONBINARY;
+            }
+        }
+    }
+
+    expression_collapse_left(expr);
+    return result;
+}
+
+/* A closed subexpression planned for parallel evaluation.
+ * Closed subexpressions only contain numbers, and operators and thread safe internal functions applied to them
+ * (see scope_mark_thread_safe), so they don't depend on, or change, anything another part of the expression can see.
+ */
+typedef struct _evaluate_parallel_node _evaluate_parallel_node_t;
+
+struct _evaluate_parallel_node {
+    expression_t*              expr;
+    bool                       closed;
+
+    /* the internal function called by a function call expression */
+    variable_info_t*           function;
+
+    /* the estimated precision of the result, and the estimated cost of evaluating the whole subexpression */
+    mpfr_prec_t                precision;
+    uint64_t                   cost;
+
+    /* the operands of an operator or prefix (in the order left, right), or the arguments of a call */
+    _evaluate_parallel_node_t* children;
+    size_t                     count;
+};
+
+/* An expression being evaluated in parallel */
+typedef struct _evaluate_parallel _evaluate_parallel_t;
+
+/* A closed subexpression evaluated as a thread pool task */
+typedef struct {
+    _evaluate_parallel_t*      parallel;
+    _evaluate_parallel_node_t* node;
+    thread_pool_task_t         task;
+} _evaluate_parallel_job_t;
+
+struct _evaluate_parallel {
+    thread_pool_t*             pool;
+
+    /* a child of the scope the expression is evaluated in, it's settings are copied so workers only read it */
+    scope_t                    scope;
+    const precision_policy_t*  policy;
+    mpfr_prec_t                default_precision;
+    mpfr_rnd_t                 default_round;
+
+    /* set if the expression assigns anything, which could change the functions it calls */
+    bool                       assigns;
+
+    /* the largest closed subexpressions that are expensive enough to evaluate in parallel */
+    _evaluate_parallel_node_t* roots;
+    size_t                     count;
+    size_t                     capacity;
+
+    /* the tasks evaluating the roots, NULL if none were spawned */
+    _evaluate_parallel_job_t*  jobs;
+};
+
+/* free the plan of a subexpression, but not the node itself
+ *
+ * @node the node to free
+ */
+void _evaluate_parallel_node_clean(_evaluate_parallel_node_t* node) {
+    for (size_t i = 0; i < node->count; ++i)
+        _evaluate_parallel_node_clean(&node->children[i]);
+    free(node->children);
+    node->children = NULL;
+    node->count = 0;
+}
+
+/* keep a planned subexpression if it's closed and expensive enough to evaluate in parallel, otherwise free it's plan
+ *
+ * @parallel the expression being evaluated
+ * @node the planned subexpression
+ */
+void _evaluate_parallel_keep(_evaluate_parallel_t* parallel, _evaluate_parallel_node_t* node) {
+    if (!node->closed || node->cost < EVALUATE_PARALLEL_THRESHOLD) {
+        _evaluate_parallel_node_clean(node);
+        return;
+    }
+
+    if (parallel->count >= parallel->capacity) {
+        parallel->capacity = parallel->capacity ? parallel->capacity * 2 : 8;
+        parallel->roots = realloc(parallel->roots, parallel->capacity * sizeof(_evaluate_parallel_node_t));
+    }
+    parallel->roots[parallel->count++] = *node;
+}
+
+/* get the cost of an operator, per bit of it's result
+ *
+ * @infix the operator
+ * @return returns the operator's weight, or zero if it can't be evaluated in parallel
+ */
+uint64_t _evaluate_parallel_weight(char infix) {
+    switch (infix) {
+        case '+':
+        case '-':
+            return 1;
+        case '*':
+        case '(':
+            return 4;
+        case '/':
+            return 8;
+        case '^':
+        case '\\':
+            return EVALUATE_PARALLEL_FUNCTION_WEIGHT;
+        default:
+            return 0;
+    }
+}
+
+/* plan the parallel evaluation of an expression.
+ * If the expression isn't closed, it's closed subexpressions are kept or freed, see _evaluate_parallel_keep.
+ *
+ * @parallel the expression being evaluated
+ * @expr the (sub)expression to plan
+ * @node location to store the plan
+ * @return returns true if the expression is closed
+ */
+bool _evaluate_parallel_plan(_evaluate_parallel_t* parallel, expression_t* expr, _evaluate_parallel_node_t* node) {
+    node->expr      = expr;
+    node->closed    = true;
+    node->function  = NULL;
+    node->precision = 0;
+    node->cost      = 0;
+    node->children  = NULL;
+    node->count     = 0;
+
+    uint64_t weight = 0;
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        {
+            mpfr_prec_t maximum = precision_policy_maximum(parallel->policy);
+            node->precision = mpfr_get_prec(expr->number.value);
+            if (node->precision > maximum)
+                node->precision = maximum;
+            return true;
+        }
+        case EXPRESSION_TYPE_VARIABLE:
+            node->closed = false;
+            return false;
+        case EXPRESSION_TYPE_PREFIX:
+            node->count = 1;
+            node->children = malloc(sizeof(_evaluate_parallel_node_t));
+            _evaluate_parallel_plan(parallel, expr->prefix.right, &node->children[0]);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            if (expr->operator.infix == ':')
+                parallel->assigns = true;
+            weight = _evaluate_parallel_weight(expr->operator.infix);
+            node->closed = weight > 0;
+            node->count = 2;
+            node->children = malloc(2 * sizeof(_evaluate_parallel_node_t));
+            _evaluate_parallel_plan(parallel, expr->operator.left, &node->children[0]);
+            _evaluate_parallel_plan(parallel, expr->operator.right, &node->children[1]);
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            expression_t* param;
+            size_t parameters = 0;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                ++node->count;
+            }
+
+            /* only internal functions marked thread safe, given every argument, can run on a worker */
+            weight = EVALUATE_PARALLEL_FUNCTION_WEIGHT;
+            node->closed = !scope_get_symbol_info(&parallel->scope, expr->function.symbol, &node->function) &&
+                           node->function->is_internal && node->function->thread_safe && !node->function->impure &&
+                           node->function->named_inputs;
+            if (node->closed) {
+                EXPRESSION_LIST_FOREACH(param, node->function->named_inputs) {
+                    ++parameters;
+                }
+                node->closed = parameters == node->count;
+            }
+
+            /* only a conditional's first condition is sure to be evaluated */
+            if (!node->closed && expression_is_conditional(expr))
+                node->count = 1;
+
+            size_t i = 0;
+            node->children = node->count ? malloc(node->count * sizeof(_evaluate_parallel_node_t)) : NULL;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                if (i == node->count)
+                    break;
+                _evaluate_parallel_plan(parallel, param, &node->children[i++]);
+            }
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < node->count; ++i) {
+        node->closed = node->closed && node->children[i].closed;
+        node->cost += node->children[i].cost;
+    }
+
+    if (!node->closed) {
+        for (size_t i = 0; i < node->count; ++i)
+            _evaluate_parallel_keep(parallel, &node->children[i]);
+        free(node->children);
+        node->children = NULL;
+        node->count = 0;
+        return false;
+    }
+
+    node->precision = precision_policy_result(parallel->policy,
+                                              node->count > 0 ? node->children[0].precision : 0,
+                                              node->count > 1 ? node->children[1].precision : 0);
+    node->cost += weight * (uint64_t)node->precision;
+    return true;
+}
+
+/* call an internal function from a worker thread, replacing the call with it's result
+ *
+ * @parallel the expression being evaluated
+ * @node the call, every argument must be a number
+ */
+void _evaluate_parallel_call(_evaluate_parallel_t* parallel, _evaluate_parallel_node_t* node) {
+    expression_t* expr = node->expr;
+    expression_list_t arguments;
+    call_frame_t frame;
+    scope_t scope;
+
+    expression_list_init(&arguments);
+    expression_list_copy(expr->function.parameters, &arguments);
+    call_frame_enter_detached(&frame, node->function, &arguments);
+    scope_init_child(&scope, &parallel->scope);
+    scope.frame = &frame;
+
+    /* calls that fail are left as they are, evaluating them again reports the error */
+    expression_t* body = NULL;
+    error_t err = node->function->value.internal(&scope, &body);
+    if (!err && body) {
+        expression_clean(expr);
+        *expr = *body;
+        free(body);
+    } else if (body) {
+        expression_free(body);
+    }
+
+    call_frame_leave(&frame);
+    scope_clean(&scope);
+}
+
+void _evaluate_parallel_task(void* data);
+
+/* evaluate a closed subexpression, expensive operands and arguments are evaluated as separate tasks
+ *
+ * @parallel the expression being evaluated
+ * @node the planned subexpression
+ */
+void _evaluate_parallel_run(_evaluate_parallel_t* parallel, _evaluate_parallel_node_t* node) {
+    expression_t* expr = node->expr;
+    _evaluate_parallel_job_t* jobs = NULL;
+
+    /* every expensive child except the last is spawned, the last one is evaluated by this thread while they run */
+    for (size_t i = 0; i + 1 < node->count; ++i) {
+        if (node->children[i].cost < EVALUATE_PARALLEL_THRESHOLD)
+            continue;
+        if (!jobs)
+            jobs = malloc(node->count * sizeof(_evaluate_parallel_job_t));
+
+        jobs[i].parallel = parallel;
+        jobs[i].node     = &node->children[i];
+        thread_pool_spawn(parallel->pool, &jobs[i].task, _evaluate_parallel_task, &jobs[i]);
+    }
+
+    for (size_t i = 0; i < node->count; ++i) {
+        if (!jobs || i + 1 == node->count || node->children[i].cost < EVALUATE_PARALLEL_THRESHOLD)
+            _evaluate_parallel_run(parallel, &node->children[i]);
+    }
+
+    if (jobs) {
+        for (size_t i = 0; i + 1 < node->count; ++i) {
+            if (node->children[i].cost >= EVALUATE_PARALLEL_THRESHOLD)
+                thread_pool_join(parallel->pool, &jobs[i].task);
+        }
+        free(jobs);
+    }
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            precision_policy_trim(parallel->policy, expr->number.value);
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            _expression_apply_prefix(expr, &parallel->scope);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            if (EXPRESSION_IS_NUMBER(expr->operator.left) && EXPRESSION_IS_NUMBER(expr->operator.right))
+                _expression_apply_operator(expr, &parallel->scope);
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            expression_t* param;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                if (!EXPRESSION_IS_NUMBER(param))
+                    return;
+            }
+            _evaluate_parallel_call(parallel, node);
+            break;
+        }
+        case EXPRESSION_TYPE_VARIABLE:
+            break;
+    }
+}
+
+/* evaluate a closed subexpression on a worker thread
+ *
+ * @data the subexpression's job
+ */
+void _evaluate_parallel_task(void* data) {
+    _evaluate_parallel_job_t* job = data;
+
+    /* MPFR's defaults are per thread, they're copied from the thread that started evaluating the expression */
+    mpfr_set_default_prec(job->parallel->default_precision);
+    mpfr_set_default_rounding_mode(job->parallel->default_round);
+    _evaluate_parallel_run(job->parallel, job->node);
+}
+
+/* start evaluating an expression's expensive closed subexpressions in parallel, before it's evaluated in order.
+ * The subexpressions are replaced with the same results they'd get from serial evaluation,
+ * anything that fails is left for the serial evaluation to report.
+ * Nothing else may change the expression, or redefine the functions it calls, until _evaluate_parallel_end returns.
+ *
+ * @parallel location to store the evaluation's state
+ * @expr the expression, it's names must be resolved to symbols
+ * @scope the expression's scope
+ * @pool the pool to run the subexpressions on
+ */
+void _evaluate_parallel_begin(_evaluate_parallel_t* parallel, expression_t* expr, scope_t* scope, thread_pool_t* pool) {
+    _evaluate_parallel_node_t root;
+
+    parallel->pool              = pool;
+    parallel->policy            = scope_get_precision_policy(scope);
+    parallel->default_precision = mpfr_get_default_prec();
+    parallel->default_round     = mpfr_get_default_rounding_mode();
+    parallel->assigns           = false;
+    parallel->roots             = NULL;
+    parallel->count             = 0;
+    parallel->capacity          = 0;
+    parallel->jobs              = NULL;
+    scope_init_child(&parallel->scope, scope);
+
+    /* every call counts towards the recursion limit, even if it doesn't nest */
+    if (_g_recursion_limit == 0)
+        return;
+
+    _evaluate_parallel_plan(parallel, expr, &root);
+    _evaluate_parallel_keep(parallel, &root);
+
+    /* an assignment could redefine a function called later in the expression, so it's evaluated in order */
+    if (parallel->assigns || parallel->count == 0)
+        return;
+
+    parallel->jobs = malloc(parallel->count * sizeof(_evaluate_parallel_job_t));
+    for (size_t i = 0; i < parallel->count; ++i) {
+        parallel->jobs[i].parallel = parallel;
+        parallel->jobs[i].node     = &parallel->roots[i];
+        thread_pool_spawn(pool, &parallel->jobs[i].task, _evaluate_parallel_task, &parallel->jobs[i]);
+    }
+}
+
+/* wait for an expression's closed subexpressions to be evaluated, running tasks in the meantime, and free it's plan
+ *
+ * @parallel the evaluation started by _evaluate_parallel_begin
+ */
+void _evaluate_parallel_end(_evaluate_parallel_t* parallel) {
+    /* joined newest first, so this thread runs the tasks that haven't been stolen in the order they were spawned */
+    if (parallel->jobs) {
+        for (size_t i = parallel->count; i > 0; --i)
+            thread_pool_join(parallel->pool, &parallel->jobs[i - 1].task);
+        free(parallel->jobs);
+        parallel->jobs = NULL;
+    }
+
+    for (size_t i = 0; i < parallel->count; ++i)
+        _evaluate_parallel_node_clean(&parallel->roots[i]);
+    free(parallel->roots);
+    parallel->roots = NULL;
+    parallel->count = 0;
+    scope_clean(&parallel->scope);
+}
+
+error_t expression_evaluate(expression_t* expr, scope_t* scope) {
+    expression_memo_t* memo = scope->memo;
+    thread_pool_t* pool = scope_get_thread_pool(scope);
+    budget_t* budget = scope_get_budget(scope);
+    symbol_resolve(expr);
+
+    /* the memo records the order results are used in, budgets count the work done on this thread, and bounds are
+        computed differently for every internal function, so they need serial evaluation */
+    if (pool && !memo && !budget && !scope_get_precision_policy(scope)->bounds) {
+        _evaluate_parallel_t parallel;
+        _evaluate_parallel_begin(&parallel, expr, scope, pool);
+        _evaluate_parallel_end(&parallel);
+    }
+
+    if (budget)
+        budget_enter(budget);
+    if (memo)
+        expression_memo_enter(memo);
+
+    error_t err = _expression_evaluate_stack(expr, scope);
+
+    if (memo)
+        expression_memo_leave(memo);
+    if (budget)
+        budget_leave(budget);
+    return err;
+}
+
+/* A top level statement, it's closed subexpressions may be evaluated before the statements in front of it */
+typedef struct {
+    expression_t*        expr;
+    bool                 started;
+    _evaluate_parallel_t parallel;
+} _evaluate_statement_t;
+
+/* start planning the closed subexpressions of statements, up to and including the next one that assigns anything.
+ * Closed subexpressions call internal functions by name, so the statements after an assignment, which may redefine
+ * one, have to wait for it. Assignments in a function's body are local to the call, so only the statement matters.
+ *
+ * @statements the statements
+ * @count the number of statements
+ * @next the first statement that hasn't been started, it's moved past the statements that are started
+ * @scope the scope the statements are evaluated in
+ * @pool the pool to evaluate closed subexpressions on
+ */
+void _evaluate_statements_prefetch(_evaluate_statement_t* statements, size_t count, size_t* next, scope_t* scope,
+                                   thread_pool_t* pool) {
+    while (*next < count) {
+        _evaluate_statement_t* statement = &statements[(*next)++];
+        _evaluate_parallel_begin(&statement->parallel, statement->expr, scope, pool);
+        statement->started = true;
+        if (_evaluate_has_assignment(statement->expr))
+            return;
+    }
+}
+
+error_t expression_evaluate_statements(expression_list_t* statements, scope_t* scope,
+                                       expression_statement_callback_t callback, void* data) {
+    thread_pool_t* pool = scope_get_thread_pool(scope);
+    error_t err = ERROR_NO_ERROR;
+    expression_t* expr;
+    size_t count = 0;
+
+    if (!pool || scope->memo || scope_get_budget(scope)) {
+        EXPRESSION_LIST_FOREACH(expr, statements) {
+            err = expression_evaluate(expr, scope);
+            if (!err && callback)
+                err = callback(expr, data);
+            if (err) return err;
+        }
+        return ERROR_NO_ERROR;
+    }
+
+    EXPRESSION_LIST_FOREACH(expr, statements) {
+        ++count;
+    }
+    if (!count)
+        return ERROR_NO_ERROR;
+
+    _evaluate_statement_t* order = malloc(count * sizeof(_evaluate_statement_t));
+
+    size_t i = 0;
+    EXPRESSION_LIST_FOREACH(expr, statements) {
+        symbol_resolve(expr);
+        order[i].expr = expr;
+        order[i].started = false;
+        ++i;
+    }
+
+    size_t next = 0;
+    _evaluate_statements_prefetch(order, count, &next, scope, pool);
+
+    /* statements are evaluated in order on this thread, only their closed subexpressions ran on the pool.
+        Once a statement fails the rest are only waited for */
+    for (i = 0; i < count; ++i) {
+        if (order[i].started)
+            _evaluate_parallel_end(&order[i].parallel);
+        if (err)
+            continue;
+
+        err = expression_evaluate(order[i].expr, scope);
+        if (!err && callback)
+            err = callback(order[i].expr, data);
+
+        /* the statement that ended the last batch is done, so the next batch can be planned */
+        if (!err && i + 1 == next)
+            _evaluate_statements_prefetch(order, count, &next, scope, pool);
+    }
+
+    free(order);
+    return err;
+}
+
+void expression_set_recursion_limit(size_t limit) {
+    _g_recursion_limit = limit;
+}
+
+size_t expression_get_recursion_limit(void) {
+    return _g_recursion_limit;
+}
+
+/* check if two numbers are the same when rounded to `digits` significant digits
+ *
+ * @x
+ * @y
+ * @digits the number of significant digits to compare
+ * @return returns true if the numbers agree
+ */
+bool _number_agrees_to_digits(mpfr_ptr x, mpfr_ptr y, size_t digits) {
+    if (!mpfr_regular_p(x) || !mpfr_regular_p(y)) {
+        if (mpfr_nan_p(x) || mpfr_nan_p(y))
+            return mpfr_nan_p(x) && mpfr_nan_p(y);
+        return mpfr_equal_p(x, y);
+    }
+
+    mpfr_exp_t x_exponent;
+    mpfr_exp_t y_exponent;
+    char* x_digits = mpfr_get_str(NULL, &x_exponent, 10, digits, x, MPFR_RNDN);
+    char* y_digits = mpfr_get_str(NULL, &y_exponent, 10, digits, y, MPFR_RNDN);
+
+    bool agrees = x_exponent == y_exponent && strcmp(x_digits, y_digits) == 0;
+
+    mpfr_free_str(x_digits);
+    mpfr_free_str(y_digits);
+    return agrees;
+}
+
+/* check if an expression evaluated with bounds is settled. Every number's bounds must agree to `digits` significant
+ * digits, except the numbers of a comparison whose bounds settle it
+ *
+ * @expr the evaluated expression
+ * @digits the number of significant digits to compare
+ * @return returns true if the expression is settled
+ */
+bool _expression_bounds_agree(expression_t* expr, size_t digits) {
+    expression_t* param;
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return !expr->number.upper || _number_agrees_to_digits(expr->number.value, expr->number.upper, digits);
+        case EXPRESSION_TYPE_VARIABLE:
+            return true;
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                if (!_expression_bounds_agree(param, digits))
+                    return false;
+            }
+            return true;
+        case EXPRESSION_TYPE_PREFIX:
+            return _expression_bounds_agree(expr->prefix.right, digits);
+        case EXPRESSION_TYPE_OPERATOR:
+            if (expression_is_comparison(expr) && EXPRESSION_IS_NUMBER(expr->operator.left) &&
+                    EXPRESSION_IS_NUMBER(expr->operator.right) && _evaluate_condition_is_certain(expr))
+                return true;
+            return _expression_bounds_agree(expr->operator.left, digits)
+                && _expression_bounds_agree(expr->operator.right, digits);
+    }
+    return false;
+}
+
+/* drop the bounds of every number in an expression, each number's lower bound is used as it's value
+ *
+ * @expr the expression
+ */
+void _expression_drop_bounds(expression_t* expr) {
+    expression_t* param;
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            expression_number_unbound(expr);
+            break;
+        case EXPRESSION_TYPE_VARIABLE:
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                _expression_drop_bounds(param);
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            _expression_drop_bounds(expr->prefix.right);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            _expression_drop_bounds(expr->operator.left);
+            _expression_drop_bounds(expr->operator.right);
+            break;
+    }
+}
+
+/* evaluate an expression with bounds, doubling the precision until they're settled, see expression_evaluate_adaptive
+ *
+ * @expr the expression to evaluate
+ * @scope the expression's scope, it's precision policy must be `policy`
+ * @policy the policy changed for each attempt
+ * @digits the number of significant digits the result should be correct to
+ * @return returns an error code
+ */
+error_t _evaluate_adaptive(expression_t* expr, scope_t* scope, precision_policy_t* policy, size_t digits) {
+    error_t err;
+
+    /* a variable's value is settled first, then it's assigned once */
+    if (EXPRESSION_IS_OPERATOR(expr) && expr->operator.infix == ':' && EXPRESSION_IS_VARIABLE(expr->operator.left)) {
+        err = _evaluate_adaptive(expr->operator.right, scope, policy, digits);
+        if (err) return err;
+        return _expression_evaluate_stack(expr, scope);
+    }
+
+    /* other assignments are made in a child scope until the precision is settled, then they're made once */
+    bool assigns = _evaluate_has_assignment(expr);
+    mpfr_prec_t precision = precision_for_digits(digits) + EVALUATE_ADAPTIVE_GUARD_BITS;
+    policy->bounds = true;
+    policy->round  = MPFR_RNDN;
+
+    for (;;) {
+        if (precision > EVALUATE_ADAPTIVE_MAX_PRECISION)
+            precision = EVALUATE_ADAPTIVE_MAX_PRECISION;
+        precision_policy_set_fixed(policy, precision);
+
+        expression_t attempt;
+        scope_t      child;
+        expression_copy(expr, &attempt);
+        if (assigns)
+            scope_init_child(&child, scope);
+
+        _g_evaluate_uncertain = false;
+        err = _expression_evaluate_stack(&attempt, assigns ? &child : scope);
+        bool settled = !err && !_g_evaluate_uncertain && _expression_bounds_agree(&attempt, digits);
+
+        if (assigns)
+            scope_clean(&child);
+        if (err || (!settled && precision < EVALUATE_ADAPTIVE_MAX_PRECISION)) {
+            expression_clean(&attempt);
+            if (err) return err;
+            precision *= 2;
+            continue;
+        }
+
+        if (!settled) {
+            /* the bounds never settled, so the result is only as good as the most precise evaluation */
+            expression_clean(&attempt);
+            policy->bounds = false;
+            return _expression_evaluate_stack(expr, scope);
+        }
+
+        if (assigns) {
+            expression_clean(&attempt);
+            err = _expression_evaluate_stack(expr, scope);
+        } else {
+            expression_clean(expr);
+            *expr = attempt;
+        }
+        if (!err)
+            _expression_drop_bounds(expr);
+        return err;
+    }
+}
+
+error_t expression_evaluate_adaptive(expression_t* expr, scope_t* scope, size_t digits) {
+    /* every attempt is evaluated under it's own precision policy, which is replaced when the scope is restored */
+    precision_policy_t* old_policy = scope->precision;
+    precision_policy_t  policy     = *scope_get_precision_policy(scope);
+    budget_t*           budget     = scope_get_budget(scope);
+    scope_set_precision_policy(scope, &policy);
+    if (scope->memo)
+        expression_memo_enter(scope->memo);
+
+    /* every attempt counts against the same budget, so escalating can't get around it */
+    if (budget)
+        budget_enter(budget);
+
+    error_t err = _evaluate_adaptive(expr, scope, &policy, digits);
+
+    if (budget)
+        budget_leave(budget);
+    if (scope->memo)
+        expression_memo_leave(scope->memo);
+    scope_set_precision_policy(scope, old_policy);
+    return err;
+}
+
+expression_result_t expression_evaluate_comparisons(expression_t* expr) {
+    return _expression_evaluate_comparisons_recursive(expr);
+}
+
+bool expression_is_conditional(expression_t* expr) {
+    if (!EXPRESSION_IS_FUNCTION(expr) || strcmp(expr->function.name, EVALUATE_CONDITIONAL_NAME) != 0)
+        return false;
+
+    size_t count = 0;
+    expression_t* param;
+    EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+        ++count;
+    }
+    return count >= 3 && count % 2 == 1;
 }
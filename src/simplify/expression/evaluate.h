@@ -7,6 +7,42 @@
 
 #include "simplify/expression/expression.h"
 
+/* number of bits added to the precision required by the output digits, before the first attempt at adaptive evaluation */
+#ifndef EVALUATE_ADAPTIVE_GUARD_BITS
+#   define EVALUATE_ADAPTIVE_GUARD_BITS PRECISION_GUARD_BITS
+#endif
+
+/* adaptive evaluation gives up on escalating once the working precision reaches this many bits */
+#ifndef EVALUATE_ADAPTIVE_MAX_PRECISION
+#   define EVALUATE_ADAPTIVE_MAX_PRECISION 65536
+#endif
+
+/* the default for the most function calls and variable substitutions that may be nested, see expression_set_recursion_limit */
+#ifndef EVALUATE_DEFAULT_RECURSION_LIMIT
+#   define EVALUATE_DEFAULT_RECURSION_LIMIT 10000
+#endif
+
+/* the number of tasks the evaluator's work stack has room for before it grows */
+#ifndef EVALUATE_STACK_INITIAL_SIZE
+#   define EVALUATE_STACK_INITIAL_SIZE 32
+#endif
+
+/* closed subexpressions estimated to cost at least this much are evaluated as separate tasks, if a thread pool is available.
+ * An operation's estimated cost is the precision of it's result in bits times a weight, which is
+ * 1 for addition and subtraction, 4 for multiplication, 8 for division and EVALUATE_PARALLEL_FUNCTION_WEIGHT for the rest.
+ */
+#ifndef EVALUATE_PARALLEL_THRESHOLD
+#   define EVALUATE_PARALLEL_THRESHOLD 65536
+#endif
+
+/* the weight of powers, roots and internal functions in the estimated cost of a subexpression */
+#ifndef EVALUATE_PARALLEL_FUNCTION_WEIGHT
+#   define EVALUATE_PARALLEL_FUNCTION_WEIGHT 64
+#endif
+
+/* the name of the conditional, `if(condition, value, ..., otherwise)`. It can be shadowed by defining a function */
+#define EVALUATE_CONDITIONAL_NAME "if"
+
 /* The boolean result of an expression, No Result (if there was no condition operator), true or false */
 typedef enum expression_result expression_result_t;
 
@@ -17,13 +53,103 @@ enum expression_result {
 };
 
 /* evaluate an expression as much as possible
- * 
+ *
+ * If the scope has a thread pool (see scope_set_thread_pool), and doesn't memoize or have a budget, closed subexpressions -
+ * numbers, and operators and thread safe internal functions applied to them - that are expensive enough are evaluated
+ * in parallel first, then the rest of the expression is evaluated in order. The result is the same as evaluating
+ * everything in order. Only internal functions marked thread safe (see scope_mark_thread_safe) are called from the
+ * pool's threads, every other function is called from the thread evaluating the expression.
+ * Expressions containing assignments are always evaluated in order.
+ *
+ * Arguments to user functions are evaluated when the function first uses them, and only once. Arguments the
+ * function's body always uses (see call_frame_lazy_parameters), arguments that assign something, and
+ * arguments to a call that reuses the caller's frame are evaluated before the call, as are arguments to internal functions.
+ * Calls with an unevaluated argument aren't cached.
+ *
+ * Unless `if` is defined, `if(condition, value, [condition, value, ...] otherwise)` evaluates it's conditions in order,
+ * and is replaced by the value following the first true condition, or by `otherwise` if none are true.
+ * Only that value is evaluated. A condition is true if it's a comparison that holds, or a number other than zero.
+ * If a condition can't be decided, evaluation stops there and the rest of the conditional is left as it is.
+ *
+ * If the scope has a budget (see scope_set_budget), the evaluation fails with ERROR_BUDGET_EXCEEDED once it's exceeded.
+ *
  * @expr the expression to simplify
  * @scope the where variables should be assigned and looked up.
  * @return returns an error
  */
 error_t expression_evaluate(expression_t* expr, scope_t* scope);
 
+/* called with each statement once it's evaluated, see expression_evaluate_statements
+ *
+ * @expr the evaluated statement
+ * @data the data given to expression_evaluate_statements
+ * @return returns an error code, an error stops the remaining statements from being evaluated
+ */
+typedef error_t (*expression_statement_callback_t)(expression_t* expr, void* data);
+
+/* evaluate a list of statements, in order, as if by expression_evaluate.
+ *
+ * The statements themselves are always evaluated one after the other on the calling thread. If the scope has a thread
+ * pool, and doesn't memoize or have a budget, the closed subexpressions of later statements (see expression_evaluate)
+ * are prefetched: they're evaluated on the pool while earlier statements are evaluated. Closed subexpressions call
+ * internal functions by name, so a statement's are only started once every statement before it that assigns anything
+ * has been evaluated, and the results are the same as evaluating the statements without a pool. The callback is given each statement in order, once it's finished.
+ *
+ * @statements the statements to evaluate
+ * @scope the scope to evaluate the statements in
+ * @callback the function to call with each evaluated statement, or NULL
+ * @data the data given to `callback`
+ * @return returns the first error from evaluating a statement or from the callback
+ */
+error_t expression_evaluate_statements(expression_list_t* statements, scope_t* scope,
+                                       expression_statement_callback_t callback, void* data);
+
+/* set the most function calls and variable substitutions that may be nested during evaluation.
+ * Evaluating a deeper expression fails with ERROR_RECURSION_LIMIT.
+ * A call that is the result of a function's body reuses the function's frame, so it doesn't use more memory, and it
+ * doesn't count towards the limit. A function that calls itself that way forever is only stopped by a budget
+ * (see budget.h).
+ *
+ * @limit the new limit
+ */
+void expression_set_recursion_limit(size_t limit);
+
+/* get the most function calls and variable substitutions that may be nested during evaluation
+ *
+ * @return returns the recursion limit
+ */
+size_t expression_get_recursion_limit(void);
+
+/* evaluate an expression, using the lowest precision that gives `digits` correct significant digits.
+ *
+ * The expression is evaluated once at a low working precision, computing bounds on the exact value of every number
+ * (see bounds.h): operators round their lower bound down and their upper bound up, and internal functions are bounded
+ * using their shape (see scope_mark_shape). If every number's bounds agree when rounded to `digits` significant
+ * digits, and every condition was decided the same way for any numbers within the bounds, the result is accepted.
+ * Otherwise the working precision is doubled and the expression is evaluated again. Escalation stops at
+ * EVALUATE_ADAPTIVE_MAX_PRECISION bits, if the bounds still don't agree the expression is evaluated without bounds at
+ * that precision. Every attempt counts against the scope's budget, so escalating past the budget's precision fails.
+ *
+ * Numbers that were rounded when they were parsed, like `0.1`, are only known to the precision they were parsed with.
+ *
+ * If the expression assigns a variable it's value is evaluated adaptively, then it's assigned once. Other expressions
+ * that assign anything are evaluated in a child scope until the precision is settled, then evaluated once in `scope`.
+ *
+ * @expr the expression to evaluate
+ * @scope the where variables should be assigned and looked up.
+ * @digits the number of significant decimal digits the result should be correct to
+ * @return returns an error
+ */
+error_t expression_evaluate_adaptive(expression_t* expr, scope_t* scope, size_t digits);
+
 expression_result_t expression_evaluate_comparisons(expression_t* expr);
 
+/* check if a call has the form of a conditional, `if` with an odd number of arguments, and at least three.
+ * It's only evaluated as a conditional if `if` isn't defined where it's called.
+ *
+ * @expr the expression
+ * @return returns true if the expression is a conditional
+ */
+bool expression_is_conditional(expression_t* expr);
+
 #endif  // SIMPLIFY_EXPRESSION_EVALUATE_H_
@@ -2,7 +2,21 @@
 
 #include "simplify/errors.h"
 #include "simplify/expression/expr_types.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/chain.h"
 #include "simplify/expression/evaluate.h"
+#include "simplify/expression/memo.h"
+#include "simplify/expression/call_cache.h"
+#include "simplify/expression/call_stack.h"
+#include "simplify/expression/symbol.h"
+#include "simplify/expression/value_cache.h"
+
+/* the generation of the most recent definition */
+static unsigned long _g_definition_generation;
+
+unsigned long scope_next_generation(void) {
+    return ++_g_definition_generation;
+}
 
 void expression_init_operator(expression_t* expr,  expression_t* left, operator_t op, expression_t* right) {
     expr->type = EXPRESSION_TYPE_OPERATOR;
@@ -22,24 +36,52 @@ void expression_init_variable(expression_t* expr, char* name, size_t len) {
     expr->variable.value = malloc(len + 1);
     expr->variable.value[len] = 0;
     expr->variable.binding = NULL;
+    expr->variable.slot = -1;
+    expr->variable.symbol = NULL;
     strncpy(expr->variable.value, name, len);
 }
 
 void expression_init_number(expression_t* expr, mpfr_ptr value) {
     expr->type = EXPRESSION_TYPE_NUMBER;
     expr->number.value = value;
+    expr->number.budgeted = budget_number_made(mpfr_get_prec(value));
+    expr->number.upper = NULL;
+    expr->number.inexact = false;
+}
+
+void expression_number_bound(expression_t* expr, mpfr_ptr upper) {
+    assert(EXPRESSION_IS_NUMBER(expr) && !expr->number.upper);
+    expr->number.upper = upper;
+
+    /* the bound is counted with the number, so they're uncounted together */
+    if (expr->number.budgeted)
+        budget_number_freed(expr->number.budgeted, mpfr_get_prec(expr->number.value));
+    expr->number.budgeted = budget_number_made(mpfr_get_prec(expr->number.value));
+    budget_number_made(mpfr_get_prec(upper));
+}
+
+void expression_number_unbound(expression_t* expr) {
+    assert(EXPRESSION_IS_NUMBER(expr));
+    if (!expr->number.upper)
+        return;
+
+    if (expr->number.budgeted)
+        budget_number_freed(expr->number.budgeted, mpfr_get_prec(expr->number.upper));
+    mpfr_clear(expr->number.upper);
+    free(expr->number.upper);
+    expr->number.upper = NULL;
 }
 
 void expression_init_number_d(expression_t* expr, double value) {
-    expr->type = EXPRESSION_TYPE_NUMBER;
-    expr->number.value = malloc(sizeof(mpfr_t));
-    mpfr_init_set_d(expr->number.value, value, MPFR_RNDF);
+    mpfr_ptr number = malloc(sizeof(mpfr_t));
+    mpfr_init_set_d(number, value, MPFR_RNDF);
+    expression_init_number(expr, number);
 }
 
 void expression_init_number_si(expression_t* expr, long value) {
-    expr->type = EXPRESSION_TYPE_NUMBER;
-    expr->number.value = malloc(sizeof(mpfr_t));
-    mpfr_init_set_si(expr->number.value, value, MPFR_RNDF);
+    mpfr_ptr number = malloc(sizeof(mpfr_t));
+    mpfr_init_set_si(number, value, MPFR_RNDF);
+    expression_init_number(expr, number);
 }
 
 void expression_init_function(expression_t* expr, char* name, size_t len, expression_list_t* params) {
@@ -48,21 +90,27 @@ void expression_init_function(expression_t* expr, char* name, size_t len, expres
     expr->function.name[len] = 0;
     strncpy(expr->function.name, name, len);
     expr->function.parameters = params;
+    expr->function.symbol = NULL;
 }
 
-void expression_clean(expression_t* expr) {
+/* free the data an expression owns, except it's operands, which are added to a list to be freed
+ *
+ * @expr the expression
+ * @pending the list
+ */
+void _expression_clean_node(expression_t* expr, expression_chain_t* pending) {
     switch (expr->type) {
         case EXPRESSION_TYPE_PREFIX:
-            expression_clean(expr->prefix.right);
-            free(expr->prefix.right);
+            expression_chain_append(pending, expr->prefix.right);
             break;
         case EXPRESSION_TYPE_OPERATOR:
-            expression_clean(expr->operator.left);
-            expression_clean(expr->operator.right);
-            free(expr->operator.left);
-            free(expr->operator.right);
+            expression_chain_append(pending, expr->operator.left);
+            expression_chain_append(pending, expr->operator.right);
             break;
         case EXPRESSION_TYPE_NUMBER:
+            expression_number_unbound(expr);
+            if (expr->number.budgeted)
+                budget_number_freed(expr->number.budgeted, mpfr_get_prec(expr->number.value));
             mpfr_clear(expr->number.value);
             free(expr->number.value);
             break;
@@ -78,39 +126,74 @@ void expression_clean(expression_t* expr) {
     }
 }
 
+void expression_clean(expression_t* expr) {
+    /* operands are freed from a list instead of by recursion, so long sums don't overflow the stack */
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+
+    _expression_clean_node(expr, &pending);
+    while (pending.count) {
+        expression_t* next = pending.operands[--pending.count];
+        _expression_clean_node(next, &pending);
+        free(next);
+    }
+
+    expression_chain_clean(&pending);
+}
+
 void expression_free(expression_t* expr) {
     expression_clean(expr);
     free(expr);
 }
 
-void expression_copy(expression_t* expr, expression_t* out) {
+/* copy an expression, except it's operands, which are allocated and added to a list to be copied
+ *
+ * @expr the expression to copy
+ * @out set to the copy
+ * @pending the list, each operand is added followed by where it should be copied to
+ */
+void _expression_copy_node(expression_t* expr, expression_t* out, expression_chain_t* pending) {
     switch (expr->type) {
         case EXPRESSION_TYPE_PREFIX:
         {
             expression_t* right = (expression_t*)malloc(sizeof(expression_t));
-            expression_copy(expr->prefix.right, right);
             expression_init_prefix(out, expr->prefix.prefix, right);
+            expression_chain_append(pending, expr->prefix.right);
+            expression_chain_append(pending, right);
             break;
         }
         case EXPRESSION_TYPE_OPERATOR:
         {
             expression_t* right = (expression_t*)malloc(sizeof(expression_t));
             expression_t* left = (expression_t*)malloc(sizeof(expression_t));
-            expression_copy(expr->operator.right, right);
-            expression_copy(expr->operator.left,  left);
             expression_init_operator(out, left, expr->operator.infix, right);
+            expression_chain_append(pending, expr->operator.right);
+            expression_chain_append(pending, right);
+            expression_chain_append(pending, expr->operator.left);
+            expression_chain_append(pending, left);
             break;
         }
         case EXPRESSION_TYPE_NUMBER:
         {
+            /* the copy keeps the number's precision, so a bound copied at a lower precision can't cut off the number */
             mpfr_ptr copy = malloc(sizeof(mpfr_t));
-            mpfr_init_set(copy, expr->number.value, MPFR_RNDN);
+            mpfr_init2(copy, mpfr_get_prec(expr->number.value));
+            mpfr_set(copy, expr->number.value, MPFR_RNDN);
             expression_init_number(out, copy);
+            out->number.inexact = expr->number.inexact;
+            if (expr->number.upper) {
+                copy = malloc(sizeof(mpfr_t));
+                mpfr_init2(copy, mpfr_get_prec(expr->number.upper));
+                mpfr_set(copy, expr->number.upper, MPFR_RNDN);
+                expression_number_bound(out, copy);
+            }
             break;
         }
         case EXPRESSION_TYPE_VARIABLE:
             expression_init_variable(out, expr->variable.value, strlen(expr->variable.value));
             out->variable.binding = expr->variable.binding;
+            out->variable.slot = expr->variable.slot;
+            out->variable.symbol = expr->variable.symbol;
             break;
         case EXPRESSION_TYPE_FUNCTION:
         {
@@ -118,6 +201,7 @@ void expression_copy(expression_t* expr, expression_t* out) {
             expression_list_init(params);
             expression_list_copy(expr->function.parameters, params);
             expression_init_function(out, expr->function.name, strlen(expr->function.name), params);
+            out->function.symbol = expr->function.symbol;
             break;
         }
 
@@ -127,6 +211,21 @@ void expression_copy(expression_t* expr, expression_t* out) {
     }
 }
 
+void expression_copy(expression_t* expr, expression_t* out) {
+    /* like expression_clean, operands are copied from a list instead of by recursion */
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+
+    _expression_copy_node(expr, out, &pending);
+    while (pending.count) {
+        expression_t* to = pending.operands[--pending.count];
+        expression_t* from = pending.operands[--pending.count];
+        _expression_copy_node(from, to, &pending);
+    }
+
+    expression_chain_clean(&pending);
+}
+
 inline operator_precedence_t operator_precedence(operator_t op) {
     switch (op) {
         case '=':
@@ -195,6 +294,8 @@ void expression_list_copy(expression_list_t* list1, expression_list_t* list2) {
 }
 
 void variable_info_free(variable_info_t* info) {
+    if (info->cached)
+        value_cache_forget(info);
     if (info->named_inputs)
         expression_list_free(info->named_inputs);
     if (!info->is_internal)
@@ -202,6 +303,49 @@ void variable_info_free(variable_info_t* info) {
     free(info);
 }
 
+/* add a definition to a scope, a definition with the same name is replaced in it's slot
+ *
+ * @scope the scope to define the name in
+ * @name the name
+ * @info the definition
+ * @return returns an error code
+ */
+error_t _scope_insert(scope_t* scope, char* name, variable_info_t* info) {
+    variable_info_t* old;
+    if (!rbtree_search(&scope->variables, name, (void**)&old)) {
+        info->index = old->index;
+        scope->slots[info->index].info = info;
+        if (old->cached)
+            value_cache_forget(old);
+        if (!scope->parent)
+            value_cache_defined(scope->slots[info->index].symbol);
+        return rbtree_insert(&scope->variables, name, info);
+    }
+
+    if (scope->slot_count >= scope->slot_capacity) {
+        scope->slot_capacity = scope->slot_capacity ? scope->slot_capacity * 2 : SCOPE_INITIAL_SLOTS;
+        scope->slots = realloc(scope->slots, scope->slot_capacity * sizeof(scope_slot_t));
+    }
+
+    info->index = scope->slot_count++;
+    scope->slots[info->index].info   = info;
+    scope->slots[info->index].symbol = symbol_intern(name);
+    symbol_define(scope->slots[info->index].symbol, scope, info->index);
+    if (!scope->parent)
+        value_cache_defined(scope->slots[info->index].symbol);
+    return rbtree_insert(&scope->variables, name, info);
+}
+
+void scope_clean(scope_t* scope) {
+    for (size_t i = 0; i < scope->slot_count; ++i)
+        symbol_undefine(scope->slots[i].symbol);
+
+    free(scope->slots);
+    scope->slots = NULL;
+    scope->slot_count = 0;
+    scope->slot_capacity = 0;
+    rbtree_clean(&scope->variables, (void(*)(void*))&variable_info_free);
+}
 
 error_t scope_define(scope_t* scope, char* variable, expression_t* value) {
     variable_info_t* info = malloc(sizeof(variable_info_t));
@@ -209,7 +353,15 @@ error_t scope_define(scope_t* scope, char* variable, expression_t* value) {
     info->is_internal = 0;
     info->named_inputs = NULL;
     info->constant = 0;
-    return rbtree_insert(&scope->variables, variable, info);
+    info->impure = 0;
+    info->pure = 0;
+    info->thread_safe = 0;
+    info->shape = FUNCTION_SHAPE_UNKNOWN;
+    info->generation = ++_g_definition_generation;
+    info->cached = NULL;
+    info->lazy_inputs = 0;
+    info->thunk = NULL;
+    return _scope_insert(scope, variable, info);
 }
 
 error_t scope_define_constant(scope_t* scope, char* variable, expression_t* value) {
@@ -218,28 +370,197 @@ error_t scope_define_constant(scope_t* scope, char* variable, expression_t* valu
     info->is_internal = 0;
     info->named_inputs = NULL;
     info->constant = 0;
-    return rbtree_insert(&scope->variables, variable, info);
+    info->impure = 0;
+    info->pure = 0;
+    info->thread_safe = 0;
+    info->shape = FUNCTION_SHAPE_UNKNOWN;
+    info->generation = ++_g_definition_generation;
+    info->cached = NULL;
+    info->lazy_inputs = 0;
+    info->thunk = NULL;
+    return _scope_insert(scope, variable, info);
 }
 
-error_t scope_get_variable_info(scope_t* scope, char* variable, variable_info_t** value) {
-    error_t err = rbtree_search(&scope->variables, variable, (void**)value);
+/* the precision policy used by scopes that don't have one, and don't have a parent with one */
+static precision_policy_t _g_default_precision_policy = {
+    .minimum = 0,
+    .maximum = 0,
+    .round   = MPFR_RNDF,
+    .digits  = 0
+};
+
+/* find the precision policy used by a scope
+ *
+ * @scope the scope
+ * @return returns the scope's policy, or it's nearest parent's policy
+ */
+static inline precision_policy_t* _scope_find_precision_policy(scope_t* scope) {
+    for (; scope; scope = scope->parent) {
+        if (scope->precision)
+            return scope->precision;
+    }
+    return &_g_default_precision_policy;
+}
 
-    /* check the parent scope(s) for the variable */
-    scope_t* parent = scope->parent;
-    while (err && parent != NULL) {
-        err = rbtree_search(&parent->variables, variable, (void**)value);
-        parent = parent->parent;
+const precision_policy_t* scope_get_precision_policy(scope_t* scope) {
+    return _scope_find_precision_policy(scope);
+}
+
+/* search a single scope for a variable, first it's definitions then the arguments of it's call frame
+ *
+ * @scope the scope to search
+ * @symbol the variable's symbol
+ * @value location to store the variable info
+ * @return returns an error code
+ */
+static inline error_t _scope_search(scope_t* scope, symbol_t* symbol, variable_info_t** value) {
+    error_t err = rbtree_search(&scope->variables, symbol->name, (void**)value);
+    if (!err) {
+        symbol_learn(symbol, scope, (*value)->index);
+    } else if (scope->frame) {
+        err = call_frame_search(scope->frame, symbol->name, value);
+
+        /* an argument that hasn't been evaluated is evaluated before it's read by name.
+            If it can't be evaluated it's read as it is, like any other variable */
+        if (!err && (*value)->thunk)
+            call_frame_force(*value);
     }
     return err;
 }
 
+/* get the outermost scope in a scope's chain of parents, it's cached in every scope between them
+ *
+ * @scope the scope
+ * @return returns the root scope
+ */
+static inline scope_t* _scope_root(scope_t* scope) {
+    if (scope->root)
+        return scope->root;
+
+    scope_t* root = scope;
+    while (root->parent && !root->root)
+        root = root->parent;
+    if (root->root)
+        root = root->root;
+
+    for (; scope && !scope->root; scope = scope->parent)
+        scope->root = root;
+    return root;
+}
+
+void scope_init_child(scope_t* scope, scope_t* parent) {
+    scope_init(scope);
+    scope->parent    = parent;
+    scope->root      = _scope_root(parent);
+    scope->precision = _scope_find_precision_policy(parent);
+    scope->calls     = scope_get_call_cache(parent);
+    scope->threads   = scope_get_thread_pool(parent);
+    scope->budget    = scope_get_budget(parent);
+}
+
+error_t scope_get_symbol_info(scope_t* scope, symbol_t* symbol, variable_info_t** value) {
+    error_t err = ERROR_NONEXISTANT_KEY;
+    scope_t* found = NULL;
+    scope_t* parent;
+
+    if (symbol->definitions == 1 && symbol->scope) {
+        /* the only definition is used if it's in one of the scopes that would be searched */
+        if (!symbol->scope->parent) {
+            if (_scope_root(scope) == symbol->scope)
+                found = symbol->scope;
+        } else {
+            for (parent = scope; parent && !found; parent = parent->parent) {
+                if (parent == symbol->scope)
+                    found = parent;
+            }
+        }
+
+        if (found) {
+            *value = found->slots[symbol->index].info;
+            err = ERROR_NO_ERROR;
+        }
+    }
+
+    if (!found && symbol->definitions > 0) {
+        for (parent = scope; err && parent != NULL; parent = parent->parent) {
+            err = _scope_search(parent, symbol, value);
+            found = parent;
+        }
+    }
+
+    if (value_cache_is_recording())
+        value_cache_record(symbol, err ? NULL : *value);
+
+    /* memos in the scopes that were searched are recording results that depend on this lookup */
+    if (!expression_memo_is_recording())
+        return err;
+
+    for (parent = scope; parent; parent = parent->parent) {
+        if (parent->memo)
+            expression_memo_record(parent->memo, symbol->name, err ? NULL : *value);
+        if (!err && parent == found)
+            break;
+    }
+    return err;
+}
+
+error_t scope_get_variable_info(scope_t* scope, char* variable, variable_info_t** value) {
+    return scope_get_symbol_info(scope, symbol_intern(variable), value);
+}
+
+error_t scope_mark_pure(scope_t* scope, char* name) {
+    variable_info_t* info;
+    error_t err = rbtree_search(&scope->variables, name, (void**)&info);
+    if (err) return err;
+    if (!info->named_inputs)
+        return ERROR_IS_A_VARIABLE;
+
+    info->pure = 1;
+    return ERROR_NO_ERROR;
+}
+
+error_t scope_mark_impure(scope_t* scope, char* name) {
+    variable_info_t* info;
+    error_t err = rbtree_search(&scope->variables, name, (void**)&info);
+    if (err) return err;
+
+    info->impure = 1;
+    return ERROR_NO_ERROR;
+}
+
+error_t scope_mark_thread_safe(scope_t* scope, char* name) {
+    variable_info_t* info;
+    error_t err = rbtree_search(&scope->variables, name, (void**)&info);
+    if (err) return err;
+
+    info->thread_safe = 1;
+    return ERROR_NO_ERROR;
+}
+
+error_t scope_mark_shape(scope_t* scope, char* name, function_shape_t shape) {
+    variable_info_t* info;
+    error_t err = rbtree_search(&scope->variables, name, (void**)&info);
+    if (err) return err;
+
+    info->shape = shape;
+    return ERROR_NO_ERROR;
+}
+
 error_t scope_define_internal_variable(scope_t* scope, char* name, simplify_func_t callback) {
     variable_info_t* info = malloc(sizeof(variable_info_t));
     info->value.internal = callback;
     info->is_internal = 1;
     info->named_inputs = NULL;
     info->constant = 0;
-    return rbtree_insert(&scope->variables, name, info);
+    info->impure = 1;
+    info->pure = 0;
+    info->thread_safe = 0;
+    info->shape = FUNCTION_SHAPE_UNKNOWN;
+    info->generation = ++_g_definition_generation;
+    info->cached = NULL;
+    info->lazy_inputs = 0;
+    info->thunk = NULL;
+    return _scope_insert(scope, name, info);
 }
 
 error_t scope_define_internal_const(scope_t* scope, char* name, simplify_func_t callback) {
@@ -248,16 +569,35 @@ error_t scope_define_internal_const(scope_t* scope, char* name, simplify_func_t
     info->is_internal = 1;
     info->named_inputs = NULL;
     info->constant = 1;
-    return rbtree_insert(&scope->variables, name, info);
+    info->impure = 0;
+    info->pure = 0;
+    info->thread_safe = 0;
+    info->shape = FUNCTION_SHAPE_UNKNOWN;
+    info->generation = ++_g_definition_generation;
+    info->cached = NULL;
+    info->lazy_inputs = 0;
+    info->thunk = NULL;
+    return _scope_insert(scope, name, info);
 }
 
 error_t scope_define_function(scope_t* scope, char* name, expression_t* body, expression_list_t* args) {
+    call_frame_resolve_parameters(body, args);
+    symbol_resolve(body);
+
     variable_info_t* info = malloc(sizeof(variable_info_t));
     info->value.expression = body;
     info->is_internal = 0;
     info->named_inputs = args;
     info->constant = 0;
-    return rbtree_insert(&scope->variables, name, info);
+    info->impure = 0;
+    info->pure = 0;
+    info->thread_safe = 0;
+    info->shape = FUNCTION_SHAPE_UNKNOWN;
+    info->generation = ++_g_definition_generation;
+    info->cached = NULL;
+    info->lazy_inputs = call_frame_lazy_parameters(body, args);
+    info->thunk = NULL;
+    return _scope_insert(scope, name, info);
 }
 
 error_t scope_define_internal_function(scope_t* scope, char* name, simplify_func_t callback, int args, ...) {
@@ -279,42 +619,36 @@ error_t scope_define_internal_function(scope_t* scope, char* name, simplify_func
     info->is_internal = 1;
     info->named_inputs = arg_list;
     info->constant = 0;
-    return rbtree_insert(&scope->variables, name, info);
+    info->impure = 0;
+    info->pure = 0;
+    info->thread_safe = 0;
+    info->shape = FUNCTION_SHAPE_UNKNOWN;
+    info->generation = ++_g_definition_generation;
+    info->cached = NULL;
+    info->lazy_inputs = 0;
+    info->thunk = NULL;
+    return _scope_insert(scope, name, info);
 }
 
 
-error_t _scope_run_function(scope_t* scope, variable_t name, expression_list_t* arg_values, expression_t* out) {
-    scope_t fn_scope;
-    variable_info_t* func_info;
-    expression_list_t arg_defs;
-    error_t err;
-
-    scope_init(&fn_scope);
-
-    err = scope_get_variable_info(scope, name, &func_info);
-    if (err)
-        goto cleanup;
-
-    if (err) goto cleanup;
+/* call a function, the arguments are stored in a frame on the value stack instead of a scope's definitions
+ *
+ * @scope the scope the function is called from
+ * @func_info the function's definition
+ * @arg_values the arguments, already evaluated in `scope`, the function takes ownership of them
+ * @out location to store the result, it isn't modified if the function doesn't produce a result
+ * @return returns an error code
+ */
+error_t _scope_run_function(scope_t* scope, variable_info_t* func_info, expression_list_t* arg_values, expression_t* out) {
+    error_t err = ERROR_NO_ERROR;
+    call_frame_t frame;
+    call_frame_enter(&frame, func_info, arg_values);
 
-    expression_list_init(&arg_defs);
-    expression_list_copy(func_info->named_inputs, &arg_defs);
-    expression_t* arg_def;
-    expression_t* arg_value;
-
-    EXPRESSION_LIST_FOREACH2(arg_def, arg_value, &arg_defs, arg_values) {
-        expression_t* op_expr = malloc(sizeof(expression_t));
-
-        expression_evaluate(arg_value, scope);
-        expression_init_operator(op_expr, arg_def, ':', arg_value);
+    scope_t fn_scope;
+    scope_init_child(&fn_scope, scope);
+    fn_scope.frame = &frame;
 
-        err = expression_evaluate(op_expr, &fn_scope);
-        if (err) goto cleanup;
-        expression_free(op_expr);
-    }
     expression_t* body = NULL;
-
-    fn_scope.parent = scope;
     if (!func_info->is_internal) {
         body = malloc(sizeof(expression_t));
         expression_copy(func_info->value.expression, body);
@@ -327,12 +661,23 @@ error_t _scope_run_function(scope_t* scope, variable_t name, expression_list_t*
     if (body && !err) {
         *out = *body;
         free(body);
+    } else if (body) {
+        expression_free(body);
     }
-cleanup:
+
+    call_frame_leave(&frame);
     scope_clean(&fn_scope);
     return err;
 }
 
+error_t scope_get_argument(scope_t* scope, size_t index, expression_t* expr) {
+    if (!scope->frame || index >= scope->frame->count)
+        return ERROR_MISSING_ARGUMENTS;
+
+    expression_copy(scope->frame->slots[index].value.expression, expr);
+    return ERROR_NO_ERROR;
+}
+
 error_t scope_call(scope_t* scope, char* name, expression_list_t* args, expression_t* out) {
     variable_info_t* info;
     error_t err = scope_get_variable_info(scope, name, &info);
@@ -344,22 +689,66 @@ error_t scope_call(scope_t* scope, char* name, expression_list_t* args, expressi
     expression_list_init(&args_copy);
     expression_list_copy(args, &args_copy);
 
-    err = _scope_run_function(scope, name, &args_copy, out);
+    /* the arguments are evaluated once, before the cache is checked, so equivalent arguments share a result */
+    expression_t* arg;
+    EXPRESSION_LIST_FOREACH(arg, &args_copy) {
+        err = expression_evaluate(arg, scope);
+        if (err) {
+            expression_list_free(args_copy.next);
+            if (args_copy.value)
+                expression_free(args_copy.value);
+            return err;
+        }
+    }
+
+    call_cache_t* cache = scope_get_call_cache(scope);
+    uint64_t fingerprint;
+    if (!cache)
+        return _scope_run_function(scope, info, &args_copy, out);
+
+    if (!call_cache_fingerprint(scope, info, &fingerprint)) {
+        ++cache->impure;
+        return _scope_run_function(scope, info, &args_copy, out);
+    }
+
+    if (call_cache_lookup(cache, scope, info, fingerprint, &args_copy, out)) {
+        expression_list_free(args_copy.next);
+        if (args_copy.value)
+            expression_free(args_copy.value);
+        return ERROR_NO_ERROR;
+    }
+
+    expression_list_t* key = malloc(sizeof(expression_list_t));
+    expression_list_init(key);
+    expression_list_copy(&args_copy, key);
+
+    err = _scope_run_function(scope, info, &args_copy, out);
+    if (!err)
+        call_cache_store(cache, scope, info, fingerprint, key, out);
+
+    expression_list_free(key);
     return err;
 }
 
-error_t scope_get_value(scope_t* scope, char* name, expression_t* expr) {
-    variable_info_t* info;
-    error_t err = scope_get_variable_info(scope, name, &info);
-    if (err) return err;
+/* get the value of a definition
+ *
+ * @scope the scope the value is used in
+ * @info the definition
+ * @expr location to store the value
+ * @return returns an error code
+ */
+error_t _scope_info_value(scope_t* scope, variable_info_t* info, expression_t* expr) {
     if (info->named_inputs)
         return ERROR_IS_A_FUNCTION;
 
     if (info->is_internal) {
         expression_t* new_expr = NULL;
-        err = info->value.internal(scope, &new_expr);
+        error_t err = info->value.internal(scope, &new_expr);
         if (err) return err;
         if (new_expr) {
+            /* constants like pi are rounded to the policy's precision */
+            if (EXPRESSION_IS_NUMBER(new_expr) && mpfr_regular_p(new_expr->number.value))
+                new_expr->number.inexact = true;
             *expr = *new_expr;
             free(new_expr);
         }
@@ -369,6 +758,17 @@ error_t scope_get_value(scope_t* scope, char* name, expression_t* expr) {
     return ERROR_NO_ERROR;
 }
 
+error_t scope_get_value(scope_t* scope, char* name, expression_t* expr) {
+    return scope_get_symbol_value(scope, symbol_intern(name), expr);
+}
+
+error_t scope_get_symbol_value(scope_t* scope, symbol_t* symbol, expression_t* expr) {
+    variable_info_t* info;
+    error_t err = scope_get_symbol_info(scope, symbol, &info);
+    if (err) return err;
+    return _scope_info_value(scope, info, expr);
+}
+
 void expression_collapse_right(expression_t* expr) {
     assert(EXPRESSION_IS_OPERATOR(expr));
 
@@ -10,12 +10,14 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <gmp.h>
 #include <mpfr.h>
 
 #include "simplify/errors.h"
 #include "simplify/rbtree/rbtree.h"
+#include "simplify/expression/precision.h"
 
 #define EXPRESSION_IS_OPERATOR(EXPR) ((EXPR)->type == (EXPRESSION_TYPE_OPERATOR))
 #define EXPRESSION_IS_VARIABLE(EXPR) ((EXPR)->type == (EXPRESSION_TYPE_VARIABLE))
@@ -76,12 +78,44 @@
 typedef union expression      expression_t;
 
 
+/* the number of definitions a scope has room for before it's slots grow */
+#ifndef SCOPE_INITIAL_SLOTS
+#   define SCOPE_INITIAL_SLOTS 8
+#endif
+
 /* A scope holds information about an expression's local variables, constants and functions. */
 typedef struct scope scope_t;
 
 /* Stores information about a single value. */
 typedef struct variable_info variable_info_t;
 
+/* Remembers the results of subexpressions evaluated in a scope, see memo.h */
+typedef struct expression_memo expression_memo_t;
+
+/* Remembers the results of calls to pure functions, see call_cache.h */
+typedef struct call_cache call_cache_t;
+
+/* Runs independent parts of an expression in parallel, see thread_pool.h */
+typedef struct thread_pool thread_pool_t;
+
+/* Remembers the values of variables until a name they use is redefined, see value_cache.h */
+typedef struct value_cache value_cache_t;
+
+/* A variable's remembered value, see value_cache.h */
+typedef struct value_cache_entry value_cache_entry_t;
+
+/* Limits on the work done by an evaluation, see budget.h */
+typedef struct budget budget_t;
+
+/* The arguments of a function call, see call_stack.h */
+typedef struct call_frame call_frame_t;
+
+/* An interned variable or function name, see symbol.h */
+typedef struct symbol symbol_t;
+
+/* A definition held by a scope, and the symbol it defines */
+typedef struct scope_slot scope_slot_t;
+
 /* Specifies an operator's type.
  * An operator represents a specific operation performed on one or more numbers.
  * At the moment an operator is just the literal token stored in a `char`. 
@@ -104,6 +138,9 @@ typedef enum operator_precedence operator_precedence_t;
 /* a variable, constant, or function's value */
 typedef union variable_value variable_value_t;
 
+/* Enumerates how an internal function's result changes with it's arguments, see scope_mark_shape */
+typedef enum function_shape function_shape_t;
+
 /* A function pointer which may be invoked as a `simplify` function or variable with scope_call, or scope_get_value.
  *
  * This function will be passed a valid `scope_t`, and a pointer to a `NULL` expression pointer.
@@ -141,16 +178,97 @@ union variable_value {
     expression_t*   expression;
 };
 
+enum function_shape {
+    /* nothing is known, so the result can only be bounded if the arguments are exact */
+    FUNCTION_SHAPE_UNKNOWN,
+
+    /* the result never decreases when an argument increases */
+    FUNCTION_SHAPE_INCREASING,
+
+    /* the result never increases when an argument increases */
+    FUNCTION_SHAPE_DECREASING,
+
+    /* the function has one argument, and the result changes no faster than it does, like sin and cos */
+    FUNCTION_SHAPE_SLOPE_ONE,
+};
+
 struct variable_info {
     bool               constant;
     bool               is_internal;
     expression_list_t* named_inputs;
     variable_value_t   value;
+
+    /* if true the value may be different each time it's used, so results that use it can't be memoized */
+    bool               impure;
+
+    /* if true calls are cached without checking the function's body, even if it uses variables that may change */
+    bool               pure;
+
+    /* if true the internal function only reads it's arguments and computes a number, so it may be called from a
+        worker thread, see scope_mark_thread_safe */
+    bool               thread_safe;
+
+    /* how the internal function's result changes with it's arguments, see scope_mark_shape */
+    function_shape_t   shape;
+
+    /* a number that's unique to this definition, it's never zero */
+    unsigned long      generation;
+
+    /* the index of the definition's slot in the scope that holds it */
+    size_t             index;
+
+    /* the definition's evaluated value, if it's in a value cache */
+    value_cache_entry_t* cached;
+
+    /* bit `i` is set if the function's body may not use it's `i`th parameter, the argument is only evaluated
+     * if it's used (see call_frame_lazy_parameters). Parameters after the 64th are always evaluated.
+     */
+    uint64_t           lazy_inputs;
+
+    /* if not NULL the value is an argument that hasn't been evaluated yet,
+     * it's evaluated in this scope (the caller's) the first time it's used
+     */
+    scope_t*           thunk;
+};
+
+struct scope_slot {
+    symbol_t*        symbol;
+    variable_info_t* info;
 };
 
 struct scope {
     scope_t* parent;
     rbtree_t variables;
+
+    /* the precision policy used in this scope, if NULL the parent's policy is used */
+    precision_policy_t* precision;
+
+    /* remembers the results of subexpressions evaluated in this scope, or NULL to not memoize */
+    expression_memo_t* memo;
+
+    /* remembers the results of pure function calls made in this scope, if NULL the parent's cache is used */
+    call_cache_t* calls;
+
+    /* the threads expensive subexpressions are evaluated on in parallel, if NULL the parent's pool is used */
+    thread_pool_t* threads;
+
+    /* remembers the values of the variables defined in this scope, or NULL. It's only used if the scope has no parent */
+    value_cache_t* values;
+
+    /* limits the work done by evaluations in this scope, if NULL the parent's budget is used */
+    budget_t* budget;
+
+    /* the arguments of the function call this scope was created for, or NULL */
+    call_frame_t* frame;
+
+    /* the outermost scope in the chain of parents, it's found the first time it's needed.
+     * A scope's parent can't change once it's been used */
+    scope_t* root;
+
+    /* every definition in the scope, in the order they were first defined. Redefining a name reuses it's slot */
+    scope_slot_t* slots;
+    size_t        slot_count;
+    size_t        slot_capacity;
 };
 
 
@@ -166,6 +284,15 @@ struct expression_number {
     expression_type_t type;
 
     mpfr_ptr value;
+
+    /* the generation of the budget that counts the number's limbs, or zero if it isn't counted, see budget.h */
+    size_t   budgeted;
+
+    /* if not NULL the number is only known to lie between `value` and `upper`, see expression_evaluate_adaptive */
+    mpfr_ptr upper;
+
+    /* set if `value` was rounded from a number that couldn't be stored exactly, like the literal `0.1` or pi */
+    bool     inexact;
 };
 
 struct expression_function {
@@ -173,6 +300,9 @@ struct expression_function {
 
     variable_t         name;
     expression_list_t* parameters;
+
+    /* the function's interned name, or NULL if it hasn't been resolved */
+    symbol_t*          symbol;
 };
 
 struct expression_prefix {
@@ -187,6 +317,12 @@ struct expression_variable {
     expression_type_t type;
     variable_t value;
     scope_t*   binding;
+
+    /* the variable's interned name, or NULL if it hasn't been resolved */
+    symbol_t*  symbol;
+
+    /* if the variable is a parameter of the function it's used in, the index of the parameter's slot in the call frame, otherwise -1 */
+    int        slot;
 };
 
 struct expression_operator {
@@ -257,6 +393,19 @@ void expression_init_function(expression_t* expression, char* name, size_t lengt
  */
 void expression_init_number(expression_t* expression, mpfr_ptr number);
 
+/* give a number an upper bound, so it's value is only it's lower bound (see expression_evaluate_adaptive)
+ *
+ * @expression the number, it mustn't already have an upper bound
+ * @upper the upper bound, the number takes ownership of it
+ */
+void expression_number_bound(expression_t* expression, mpfr_ptr upper);
+
+/* remove a number's upper bound, if it has one, so it's value is used as if it were exact
+ *
+ * @expression the number
+ */
+void expression_number_unbound(expression_t* expression);
+
 /* initialize a new number expression with a double
  *
  * @expression the expression to initialize
@@ -358,8 +507,181 @@ void expression_list_copy(expression_list_t* list1, expression_list_t* list2);
 static inline void scope_init(scope_t* scope) {
     rbtree_init(&scope->variables);
     scope->parent = NULL;
+    scope->precision = NULL;
+    scope->memo = NULL;
+    scope->calls = NULL;
+    scope->threads = NULL;
+    scope->values = NULL;
+    scope->budget = NULL;
+    scope->frame = NULL;
+    scope->root = NULL;
+    scope->slots = NULL;
+    scope->slot_count = 0;
+    scope->slot_capacity = 0;
+}
+
+/* initialize a scope inside of another scope.
+ * The child uses the parent's precision policy, call cache, thread pool and budget, changing them in the parent after the child is created
+ * doesn't change the child. Settings are copied so they aren't searched for every time the child uses them.
+ *
+ * @scope the scope to initialize
+ * @parent the scope's parent
+ */
+void scope_init_child(scope_t* scope, scope_t* parent);
+
+/* set the precision policy used by a scope and any scope that doesn't have it's own policy
+ *
+ * @scope the scope to modify
+ * @policy the policy to use, it isn't copied so it must outlive the scope. If NULL the parent's policy is used.
+ */
+static inline void scope_set_precision_policy(scope_t* scope, precision_policy_t* policy) {
+    scope->precision = policy;
+}
+
+/* get the precision policy that applies in a scope
+ *
+ * @scope the scope to search
+ * @return returns the policy of the nearest scope that has one, or a policy that uses MPFR's default precision
+ */
+const precision_policy_t* scope_get_precision_policy(scope_t* scope);
+
+/* memoize the results of subexpressions evaluated in a scope
+ *
+ * @scope the scope to modify
+ * @memo the memo to use, it isn't copied so it must outlive the scope. If NULL nothing is memoized.
+ */
+static inline void scope_set_memo(scope_t* scope, expression_memo_t* memo) {
+    scope->memo = memo;
+}
+
+/* cache the results of pure function calls made in a scope, or any scope that doesn't have it's own cache
+ *
+ * @scope the scope to modify
+ * @cache the cache to use, it isn't copied so it must outlive the scope. If NULL the parent's cache is used.
+ */
+static inline void scope_set_call_cache(scope_t* scope, call_cache_t* cache) {
+    scope->calls = cache;
+}
+
+/* get the call cache used by a scope
+ *
+ * @scope the scope to search
+ * @return returns the cache of the nearest scope that has one, or NULL if calls aren't cached
+ */
+static inline call_cache_t* scope_get_call_cache(scope_t* scope) {
+    for (; scope; scope = scope->parent) {
+        if (scope->calls)
+            return scope->calls;
+    }
+    return NULL;
+}
+
+/* evaluate expensive independent subexpressions in a scope, or any scope that doesn't have it's own pool,
+ * in parallel on a pool of threads. See expression_evaluate.
+ *
+ * @scope the scope to modify
+ * @pool the pool to use, it isn't copied so it must outlive the scope. If NULL the parent's pool is used.
+ */
+static inline void scope_set_thread_pool(scope_t* scope, thread_pool_t* pool) {
+    scope->threads = pool;
+}
+
+/* get the thread pool used by a scope
+ *
+ * @scope the scope to search
+ * @return returns the pool of the nearest scope that has one, or NULL if everything is evaluated on the calling thread
+ */
+static inline thread_pool_t* scope_get_thread_pool(scope_t* scope) {
+    for (; scope; scope = scope->parent) {
+        if (scope->threads)
+            return scope->threads;
+    }
+    return NULL;
+}
+
+/* remember the values of variables defined in a scope without a parent, until a name they use is redefined.
+ * See value_cache.h.
+ *
+ * @scope the scope to modify
+ * @cache the cache to use, it isn't copied so it must outlive the scope. If NULL values are evaluated every time they're used.
+ */
+static inline void scope_set_value_cache(scope_t* scope, value_cache_t* cache) {
+    scope->values = cache;
 }
 
+/* get the value cache used by a scope
+ *
+ * @scope the scope
+ * @return returns the scope's value cache, or NULL
+ */
+static inline value_cache_t* scope_get_value_cache(scope_t* scope) {
+    return scope->values;
+}
+
+/* limit the work done by evaluations in a scope, or any scope that doesn't have it's own budget. See budget.h.
+ *
+ * @scope the scope to modify
+ * @budget the budget to use, it isn't copied so it must outlive the scope. If NULL the parent's budget is used.
+ */
+static inline void scope_set_budget(scope_t* scope, budget_t* budget) {
+    scope->budget = budget;
+}
+
+/* get the budget used by a scope
+ *
+ * @scope the scope to search
+ * @return returns the budget of the nearest scope that has one, or NULL if evaluations aren't limited
+ */
+static inline budget_t* scope_get_budget(scope_t* scope) {
+    for (; scope; scope = scope->parent) {
+        if (scope->budget)
+            return scope->budget;
+    }
+    return NULL;
+}
+
+/* mark a function as pure, so it's calls are cached even if it uses variables that may be redefined
+ *
+ * @scope the scope to search for the function
+ * @name the function's name
+ * @return returns an error code
+ */
+error_t scope_mark_pure(scope_t* scope, char* name);
+
+/* mark a definition as impure, so results that use it are never memoized
+ *
+ * @scope the scope to search for the definition
+ * @name the definition's name
+ * @return returns an error code
+ */
+error_t scope_mark_impure(scope_t* scope, char* name);
+
+/* mark an internal function as thread safe, so it may be called from a worker thread (see thread_pool.h).
+ * Only functions that read their arguments by index and compute a number from them, like the MPFR builtins, are
+ * thread safe. Functions that evaluate expressions, or use any state of their own, must stay on the calling thread.
+ *
+ * @scope the scope to search for the function
+ * @name the function's name
+ * @return returns an error code
+ */
+error_t scope_mark_thread_safe(scope_t* scope, char* name);
+
+/* describe how an internal function's result changes with it's arguments, so adaptive evaluation can bound it's
+ * result when it's arguments are only known to lie between two bounds (see expression_evaluate_adaptive)
+ *
+ * @scope the scope to search for the function
+ * @name the function's name
+ * @shape the function's shape
+ * @return returns an error code
+ */
+error_t scope_mark_shape(scope_t* scope, char* name, function_shape_t shape);
+
+/* get a new definition generation, every definition is stamped with one so a redefinition can be detected
+ *
+ * @return returns a generation number, it's never zero
+ */
+unsigned long scope_next_generation(void);
+
 /* define a variable in the scope
  *
  * @scope the scope to define the variable in
@@ -397,6 +719,16 @@ error_t scope_define_function(scope_t* scope, char* name, expression_t* body, ex
  */
 error_t scope_get_variable_info(scope_t* scope, char* variable, variable_info_t** value);
 
+/* get information about a variable by it's symbol.
+ * If the symbol has only one definition it's loaded straight from it's slot, otherwise the scope chain is searched.
+ *
+ * @scope the scope to search for the variable
+ * @symbol the variable's symbol
+ * @value location to store the variable info
+ * @return returns an error code
+ */
+error_t scope_get_symbol_info(scope_t* scope, symbol_t* symbol, variable_info_t** value);
+
 /* get the value of a variable or constant
  * @scope the scope to search
  * @name the name to look for
@@ -405,6 +737,14 @@ error_t scope_get_variable_info(scope_t* scope, char* variable, variable_info_t*
  */
 error_t scope_get_value(scope_t* scope, char* name, expression_t* expr);
 
+/* get the value of a variable or constant by it's symbol
+ * @scope the scope to search
+ * @symbol the variable's symbol
+ * @expr variable's value
+ * @return returns an error code
+ */
+error_t scope_get_symbol_value(scope_t* scope, symbol_t* symbol, expression_t* expr);
+
 /* create a new internal variable
  * @scope the scope to insert into
  * @name the name of the item
@@ -431,6 +771,14 @@ error_t scope_define_internal_const(scope_t* scope, char* name, simplify_func_t
  */
 error_t scope_define_internal_function(scope_t* scope, char* name, simplify_func_t callback, int args, ...);
 
+/* get one of the arguments of the function call a scope was created for
+ * @scope the function's scope
+ * @index the argument's index
+ * @expr location to store a copy of the argument
+ * @return returns an error code
+ */
+error_t scope_get_argument(scope_t* scope, size_t index, expression_t* expr);
+
 /* call a function
  * @scope the scope to search
  * @name the name to look for
@@ -450,9 +798,7 @@ void variable_info_free(variable_info_t* info);
  *
  * @scope the scope to clean
  */
-static inline void scope_clean(scope_t* scope) {
-    rbtree_clean(&scope->variables, (void(*)(void*))&variable_info_free);
-}
+void scope_clean(scope_t* scope);
 
 
 #endif  // SIMPLIFY_EXPRESSION_EXPR_TYPES_H_
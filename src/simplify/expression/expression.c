@@ -1,141 +1,265 @@
 /* Copyright Ian Shehadeh 2018 */
 
+#include <float.h>
+#include <math.h>
+
 #include "simplify/expression/expression.h"
-#include "simplify/expression/stringify.h"
-
-
-int index_of(char* x, char* y) {
-    int i = 0;
-    int yi = 0;
-    while (x[i]) {
-        if (!y[yi])
-            return i;
-        if (y[yi] == x[i])
-            ++yi;
-        else
-            yi = 0;
-        ++i;
-    }
+#include "simplify/expression/canonical.h"
+#include "simplify/expression/chain.h"
+
+static compare_tolerance_t _g_compare_tolerance = { 0, 0, COMPARE_TOLERANCE_DEFAULT_ULPS };
+
+void expression_set_compare_tolerance(compare_tolerance_t tolerance) {
+    _g_compare_tolerance = tolerance;
+}
+
+compare_tolerance_t expression_get_compare_tolerance(void) {
+    return _g_compare_tolerance;
+}
 
-    return -1;
+/* check if a difference is within `limit` times 2^`exponent`
+ *
+ * @difference the difference, it must be a regular number
+ * @limit the limit's significand
+ * @exponent the limit's exponent
+ * @return returns true if |difference| <= limit * 2^exponent
+ */
+static inline bool _expression_difference_within(mpfr_srcptr difference, double limit, long exponent) {
+    long difference_exponent;
+    double significand = fabs(mpfr_get_d_2exp(&difference_exponent, difference, MPFR_RNDN));
+
+    /* both sides are scaled by 2^-exponent, so doubles can hold them whatever the numbers' exponents */
+    long scale = difference_exponent - exponent;
+    if (scale > DBL_MAX_EXP)
+        return false;
+    if (scale < DBL_MIN_EXP - DBL_MANT_DIG)
+        return limit > 0;
+    return ldexp(significand, (int)scale) <= limit;
 }
 
-int strintcmp(char* x, char* y, int lenx, int leny, bool dec) {
-    int xi = 0;
-    int yi = 0;
-    int cmp_mul = 1;
+/* check if two finite numbers that aren't equal are within the compare tolerance
+ *
+ * @x
+ * @y
+ * @return returns true if the numbers should compare equal
+ */
+bool _expression_numbers_within_tolerance(mpfr_srcptr x, mpfr_srcptr y) {
+    compare_tolerance_t* tolerance = &_g_compare_tolerance;
+    if (!(tolerance->relative > 0) && !(tolerance->absolute > 0) && !tolerance->ulps)
+        return false;
+
+    mpfr_prec_t x_precision = mpfr_get_prec(x);
+    mpfr_prec_t y_precision = mpfr_get_prec(y);
+    mpfr_srcptr larger = mpfr_cmpabs(x, y) >= 0 ? x : y;
 
-    int xp;
-    int yp;
+    /* one extra bit is enough for the rounded difference to be compared against a tolerance */
+    mpfr_t difference;
+    mpfr_init2(difference, (x_precision > y_precision ? x_precision : y_precision) + 1);
+    mpfr_sub(difference, x, y, MPFR_RNDN);
 
-    if (!dec) {
-        xp = pow(10, lenx - 1);
-        yp = pow(10, leny - 1);
-    } else {
-        xp = 1;
-        yp = 1;
+    bool within = false;
+    if (tolerance->absolute > 0) {
+        int exponent;
+        double significand = frexp(tolerance->absolute, &exponent);
+        within = _expression_difference_within(difference, significand, exponent);
     }
+    if (!within && tolerance->relative > 0 && !mpfr_zero_p(larger)) {
+        long exponent;
+        double significand = fabs(mpfr_get_d_2exp(&exponent, larger, MPFR_RNDN));
+        within = _expression_difference_within(difference, tolerance->relative * significand, exponent);
+    }
+    if (!within && tolerance->ulps) {
+        /* the last place of a number with exponent `e` and `p` bits is worth 2^(e - p), one has an exponent of 1 */
+        mpfr_prec_t precision = x_precision < y_precision ? x_precision : y_precision;
+        mpfr_srcptr smaller = larger == x ? y : x;
+        long exponent = mpfr_get_exp(larger);
 
-    if (y[0] == '-' || x[0] == '-') {
-        if (y[0] != '-') {
-            return -1;
-        } else if (x[0] != '-') {
-            return 1;
-        } else {
-            cmp_mul = -1;
-            ++yi;
-            ++xi;
-        }
+        /* a number that's zero, or too small to change the larger one, may be a rounding error left where the result
+            should have been zero, like sin(pi), so it's measured against one. Other small numbers are compared as
+            they are */
+        if (exponent < 1 && (mpfr_zero_p(smaller) || mpfr_get_exp(smaller) <= exponent - precision))
+            exponent = 1;
+        within = _expression_difference_within(difference, tolerance->ulps, exponent - precision);
     }
 
-    while (xi < lenx || yi < leny) {
-        int cmp = cmp_mul * ((x[xi] * xp) - (y[yi] * yp));
-        if (cmp != 0) {
-            return cmp;
-        }
+    mpfr_clear(difference);
+    return within;
+}
+
+/* compare two numbers
+ *
+ * @expr1
+ * @expr2
+ * @tolerant true if numbers within the compare tolerance are equal
+ * @return returns a comparison result
+ */
+compare_result_t _expression_compare_numbers(expression_t* expr1, expression_t* expr2, bool tolerant) {
+    mpfr_srcptr x = expr1->number.value;
+    mpfr_srcptr y = expr2->number.value;
 
-        if (!dec) {
-            xp /= 10;
-            yp /= 10;
-        } else {
-            xp *= 10;
-            yp *= 10;
+    if (mpfr_nan_p(x) || mpfr_nan_p(y))
+        return mpfr_nan_p(x) && mpfr_nan_p(y) ? COMPARE_RESULT_EQUAL : COMPARE_RESULT_INCOMPARABLE;
+
+    int cmp = mpfr_cmp(x, y);
+    if (cmp == 0)
+        return COMPARE_RESULT_EQUAL;
+
+    /* infinities are only ever equal to themselves */
+    if (tolerant && mpfr_number_p(x) && mpfr_number_p(y) && _expression_numbers_within_tolerance(x, y))
+        return COMPARE_RESULT_EQUAL;
+    return cmp < 0 ? COMPARE_RESULT_LESS : COMPARE_RESULT_GREATER;
+}
+
+/* mix `value` into a FNV-1a hash
+ *
+ * @hash the hash so far
+ * @value the data to mix
+ * @size the number of bytes in value
+ * @return returns the new hash
+ */
+static inline uint64_t _hash_bytes(uint64_t hash, const void* value, size_t size) {
+    const unsigned char* bytes = value;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* scramble a hash, so the sum of several hashes doesn't depend on which bits they share
+ *
+ * @hash the hash
+ * @return returns the scrambled hash
+ */
+static inline uint64_t _hash_scramble(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+/* hash an expression's shape: the same as expression_hash, except numbers aren't hashed by value, because numbers
+ * within the compare tolerance are equal, and the operands of sums and products are hashed in any order
+ *
+ * @expr the expression
+ * @return returns the hash
+ */
+uint64_t _expression_shape_hash(expression_t* expr) {
+    uint64_t hash = _hash_bytes(0xcbf29ce484222325ULL, &expr->type, sizeof(expr->type));
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return hash;
+        case EXPRESSION_TYPE_VARIABLE:
+            return _hash_bytes(hash, expr->variable.value, strlen(expr->variable.value));
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            hash = _hash_bytes(hash, expr->function.name, strlen(expr->function.name));
+
+            expression_t* param;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                uint64_t param_hash = _expression_shape_hash(param);
+                hash = _hash_bytes(hash, &param_hash, sizeof(param_hash));
+            }
+            return hash;
+        }
+        case EXPRESSION_TYPE_PREFIX:
+        {
+            uint64_t right = _expression_shape_hash(expr->prefix.right);
+            hash = _hash_bytes(hash, &expr->prefix.prefix, sizeof(expr->prefix.prefix));
+            return _hash_bytes(hash, &right, sizeof(right));
         }
+        case EXPRESSION_TYPE_OPERATOR:
+            hash = _hash_bytes(hash, &expr->operator.infix, sizeof(expr->operator.infix));
+            if (EXPRESSION_IS_CHAIN(expr)) {
+                expression_chain_t chain;
+                expression_chain_init(&chain, expr->operator.infix);
+                expression_chain_collect(&chain, expr);
 
-        if (xi < lenx)
-            ++xi;
-        else
-            xp = 0;
+                uint64_t operands = 0;
+                for (size_t i = 0; i < chain.count; ++i)
+                    operands += _hash_scramble(_expression_shape_hash(chain.operands[i]));
 
-        if (yi < leny)
-            ++yi;
-        else
-            yp = 0;
+                expression_chain_clean(&chain);
+                return _hash_bytes(hash, &operands, sizeof(operands));
+            } else {
+                uint64_t left = _expression_shape_hash(expr->operator.left);
+                uint64_t right = _expression_shape_hash(expr->operator.right);
+                hash = _hash_bytes(hash, &left, sizeof(left));
+                return _hash_bytes(hash, &right, sizeof(right));
+            }
     }
-    return 0;
+    return hash;
 }
 
-int strnumcmp(char* x, char* y, int lenx, int leny) {
-    int decx = index_of(x, ".") - 1;
-    int decy = index_of(y, ".") - 1;
-    if (decx < 0) decx = lenx;
-    if (decy < 0) decy = leny;
-
-    int cmp = strintcmp(x, y, decx, decy, false);
-    if (cmp != 0 || (decx == lenx && decy == leny))
-        return cmp;
-
-    return strintcmp(x + decx, y + decy, lenx - decx, leny - decy, true);
-}
-
-compare_result_t _expression_compare_numbers(expression_t* expr1, expression_t* expr2) {
-    stringifier_t st;
-    st.buffer = malloc(128);
-    st.length = 128;
-    st.index = 0;
-    /* incase these expressions aren't numbers, use invalid variable names for NAN and INF */
-    st.nan_string = "@";
-    st.inf_string = "#";
-    st.whitespace = "";
-    st.current_precedence = OPERATOR_PRECEDENCE_MINIMUM;
-    st.approximate_numbers = true;
-    st.approximate_tolerance = 5;
-
-    stringifier_write_expression(&st, expr1);
-    char* expr1str = st.buffer;
-    size_t expr1len = st.index;
-    expr1str[st.index] = 0;
-    st.buffer = malloc(128);
-    st.length = 128;
-    st.index = 0;
-    stringifier_write_expression(&st, expr2);
-    char* expr2str = st.buffer;
-    size_t expr2len = st.index;
-    expr2str[st.index] = 0;
-
-    int result = strnumcmp(expr1str, expr2str, expr1len, expr2len);
-
-    free(expr1str);
-    free(expr2str);
-
-    if (result < 0) {
-        return COMPARE_RESULT_LESS;
-    } else if (result > 0) {
-        return COMPARE_RESULT_GREATER;
-    } else if (result == 0) {
-        return COMPARE_RESULT_EQUAL;
+compare_result_t _expression_compare_recursive(expression_t* expr1, expression_t* expr2, bool tolerant);
+
+/* compare two sums or products of more than two operands, they're equal if each operand of one is equal to a
+ * different operand of the other. The operands are sorted by their shape, so only operands with the same shape are
+ * compared with each other.
+ *
+ * @chain1
+ * @chain2
+ * @tolerant true if numbers within the compare tolerance are equal
+ * @return returns COMPARE_RESULT_EQUAL or COMPARE_RESULT_INCOMPARABLE
+ */
+compare_result_t _expression_compare_chains(expression_chain_t* chain1, expression_chain_t* chain2, bool tolerant) {
+    if (chain1->count != chain2->count)
+        return COMPARE_RESULT_INCOMPARABLE;
+
+    expression_chain_sort(chain1, _expression_shape_hash);
+    expression_chain_sort(chain2, _expression_shape_hash);
+
+    compare_result_t result = COMPARE_RESULT_EQUAL;
+    bool* matched = calloc(chain2->count, sizeof(bool));
+    uint64_t* shapes = malloc(sizeof(uint64_t) * chain2->count);
+    for (size_t i = 0; i < chain2->count; ++i)
+        shapes[i] = _expression_shape_hash(chain2->operands[i]);
+
+    /* operands with the same shape are next to each other in both chains, and there are as many of them in each */
+    for (size_t start = 0; start < chain1->count && result == COMPARE_RESULT_EQUAL;) {
+        size_t end = start + 1;
+        while (end < chain2->count && shapes[end] == shapes[start])
+            ++end;
+
+        /* operands before `first` have all been matched, so a run of equal operands is matched in linear time */
+        size_t first = start;
+        for (size_t i = start; i < end && result == COMPARE_RESULT_EQUAL; ++i) {
+            if (_expression_shape_hash(chain1->operands[i]) != shapes[start]) {
+                result = COMPARE_RESULT_INCOMPARABLE;
+                break;
+            }
+
+            size_t j = first;
+            for (; j < end; ++j) {
+                if (!matched[j] && _expression_compare_recursive(chain1->operands[i], chain2->operands[j], tolerant)
+                        == COMPARE_RESULT_EQUAL)
+                    break;
+            }
+            if (j == end)
+                result = COMPARE_RESULT_INCOMPARABLE;
+            else
+                matched[j] = true;
+
+            while (first < end && matched[first])
+                ++first;
+        }
+        start = end;
     }
 
-    return COMPARE_RESULT_INCOMPARABLE;
+    free(matched);
+    free(shapes);
+    return result;
 }
 
-compare_result_t _expression_compare_recursive(expression_t* expr1, expression_t* expr2) {
+compare_result_t _expression_compare_recursive(expression_t* expr1, expression_t* expr2, bool tolerant) {
     if (expr1->type != expr2->type)
         return COMPARE_RESULT_INCOMPARABLE;
 
     switch (expr1->type) {
         case EXPRESSION_TYPE_NUMBER:
-            return _expression_compare_numbers(expr1, expr2);
+            return _expression_compare_numbers(expr1, expr2, tolerant);
         case EXPRESSION_TYPE_VARIABLE:
             if (!strcmp(expr1->variable.value, expr2->variable.value))
                 return COMPARE_RESULT_EQUAL;
@@ -147,7 +271,7 @@ compare_result_t _expression_compare_recursive(expression_t* expr1, expression_t
                 expression_t* arg2;
                 compare_result_t current = COMPARE_RESULT_EQUAL;
                 EXPRESSION_LIST_FOREACH2(arg1, arg2, expr1->function.parameters, expr2->function.parameters) {
-                    compare_result_t next = _expression_compare_recursive(arg1, arg2);
+                    compare_result_t next = _expression_compare_recursive(arg1, arg2, tolerant);
                     if (current == COMPARE_RESULT_EQUAL && next == COMPARE_RESULT_EQUAL) {
                             current = next;
                     } else {
@@ -162,24 +286,52 @@ compare_result_t _expression_compare_recursive(expression_t* expr1, expression_t
             if (expr1->prefix.prefix != expr2->prefix.prefix)
                 return COMPARE_RESULT_INCOMPARABLE;
             else
-                return _expression_compare_recursive(expr1->prefix.right, expr2->prefix.right);
+                return _expression_compare_recursive(expr1->prefix.right, expr2->prefix.right, tolerant);
         case EXPRESSION_TYPE_OPERATOR:
         {
             if (expr1->operator.infix != expr2->operator.infix)
                 return COMPARE_RESULT_INCOMPARABLE;
-            compare_result_t result_left = _expression_compare_recursive(expr1->operator.left, expr2->operator.left);
-            compare_result_t result_right = _expression_compare_recursive(expr1->operator.right, expr2->operator.right);
-            if (result_left == result_right && result_left != COMPARE_RESULT_INCOMPARABLE) {
-                return result_left;
-            } else if (expr1->operator.infix == '*' || expr1->operator.infix == '+') {
-                if (result_left == COMPARE_RESULT_INCOMPARABLE || result_right == COMPARE_RESULT_INCOMPARABLE) {
-                    result_left = _expression_compare_recursive(expr1->operator.left, expr2->operator.right);
-                    result_right = _expression_compare_recursive(expr1->operator.right, expr2->operator.left);
-                    if (result_left == result_right && result_left != COMPARE_RESULT_INCOMPARABLE) {
-                        return result_left;
-                    }
+
+            /* longer sums and products are compared as a whole, whatever order their operands are in */
+            if (EXPRESSION_IS_CHAIN(expr1)) {
+                expression_chain_t chain1;
+                expression_chain_t chain2;
+                expression_chain_init(&chain1, expr1->operator.infix);
+                expression_chain_init(&chain2, expr2->operator.infix);
+                expression_chain_collect(&chain1, expr1);
+                expression_chain_collect(&chain2, expr2);
+
+                compare_result_t result = COMPARE_RESULT_INCOMPARABLE;
+                bool binary = chain1.count == 2 && chain2.count == 2;
+                if (!binary)
+                    result = _expression_compare_chains(&chain1, &chain2, tolerant);
+
+                expression_chain_clean(&chain1);
+                expression_chain_clean(&chain2);
+                if (!binary)
+                    return result;
+            }
+
+            /* the operands of a sum or product are compared in canonical order, see canonical.h */
+            expression_t* left1 = expr1->operator.left;
+            expression_t* right1 = expr1->operator.right;
+            expression_t* left2 = expr2->operator.left;
+            expression_t* right2 = expr2->operator.right;
+            if (EXPRESSION_IS_CHAIN(expr1)) {
+                if (expression_order(left1, right1) > 0) {
+                    left1 = expr1->operator.right;
+                    right1 = expr1->operator.left;
+                }
+                if (expression_order(left2, right2) > 0) {
+                    left2 = expr2->operator.right;
+                    right2 = expr2->operator.left;
                 }
             }
+
+            compare_result_t result_left = _expression_compare_recursive(left1, left2, tolerant);
+            compare_result_t result_right = _expression_compare_recursive(right1, right2, tolerant);
+            if (result_left == result_right && result_left != COMPARE_RESULT_INCOMPARABLE)
+                return result_left;
             return COMPARE_RESULT_INCOMPARABLE;
         }
     }
@@ -187,9 +339,153 @@ compare_result_t _expression_compare_recursive(expression_t* expr1, expression_t
 }
 
 compare_result_t expression_compare(expression_t* expr1, expression_t* expr2) {
-    return _expression_compare_recursive(expr1, expr2);
+    return _expression_compare_recursive(expr1, expr2, true);
+}
+
+compare_result_t expression_compare_strict(expression_t* expr1, expression_t* expr2) {
+    return _expression_compare_recursive(expr1, expr2, false);
 }
 
+/* check if two expressions have the same label, and add their operands to a list to be checked next
+ *
+ * @expr1
+ * @expr2
+ * @pending the list, each of expr1's operands is added followed by expr2's
+ * @return returns false if the expressions aren't identical
+ */
+bool _expression_identical_node(expression_t* expr1, expression_t* expr2, expression_chain_t* pending) {
+    if (expr1->type != expr2->type)
+        return false;
+
+    switch (expr1->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            if (mpfr_get_prec(expr1->number.value) != mpfr_get_prec(expr2->number.value))
+                return false;
+
+            /* numbers with different bounds can't be used in place of each other, see expression_evaluate_adaptive */
+            if (expr1->number.inexact != expr2->number.inexact || !expr1->number.upper != !expr2->number.upper)
+                return false;
+            if (expr1->number.upper && !mpfr_equal_p(expr1->number.upper, expr2->number.upper) &&
+                    !(mpfr_nan_p(expr1->number.upper) && mpfr_nan_p(expr2->number.upper)))
+                return false;
+
+            if (mpfr_nan_p(expr1->number.value))
+                return mpfr_nan_p(expr2->number.value);
+            return mpfr_equal_p(expr1->number.value, expr2->number.value)
+                && mpfr_signbit(expr1->number.value) == mpfr_signbit(expr2->number.value);
+        case EXPRESSION_TYPE_VARIABLE:
+            return expr1->variable.binding == expr2->variable.binding
+                && expr1->variable.slot == expr2->variable.slot
+                && strcmp(expr1->variable.value, expr2->variable.value) == 0;
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            if (strcmp(expr1->function.name, expr2->function.name) != 0)
+                return false;
+
+            expression_list_t* param1 = expr1->function.parameters;
+            expression_list_t* param2 = expr2->function.parameters;
+            for (; param1 && param2; param1 = param1->next, param2 = param2->next) {
+                if (!param1->value || !param2->value)
+                    return param1->value == param2->value;
+                if (!expression_identical(param1->value, param2->value))
+                    return false;
+            }
+            return param1 == param2;
+        }
+        case EXPRESSION_TYPE_PREFIX:
+            if (expr1->prefix.prefix != expr2->prefix.prefix)
+                return false;
+            expression_chain_append(pending, expr1->prefix.right);
+            expression_chain_append(pending, expr2->prefix.right);
+            return true;
+        case EXPRESSION_TYPE_OPERATOR:
+            if (expr1->operator.infix != expr2->operator.infix)
+                return false;
+            expression_chain_append(pending, expr1->operator.right);
+            expression_chain_append(pending, expr2->operator.right);
+            expression_chain_append(pending, expr1->operator.left);
+            expression_chain_append(pending, expr2->operator.left);
+            return true;
+    }
+    return false;
+}
+
+bool expression_identical(expression_t* expr1, expression_t* expr2) {
+    /* operands are checked from a list instead of by recursion, so long sums don't overflow the stack */
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+
+    bool identical = _expression_identical_node(expr1, expr2, &pending);
+    while (identical && pending.count) {
+        expression_t* next2 = pending.operands[--pending.count];
+        expression_t* next1 = pending.operands[--pending.count];
+        identical = _expression_identical_node(next1, next2, &pending);
+    }
+
+    expression_chain_clean(&pending);
+    return identical;
+}
+
+/* mix an expression's label into a hash, and add it's operands to a list to be hashed next
+ *
+ * @expr the expression
+ * @hash the hash so far
+ * @pending the list, the operands are added in reverse, so the first operand is hashed next
+ * @return returns the new hash
+ */
+uint64_t _expression_hash_node(expression_t* expr, uint64_t hash, expression_chain_t* pending) {
+    hash = _hash_bytes(hash, &expr->type, sizeof(expr->type));
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        {
+            /* identical numbers round to the same double, so the double is enough to tell most numbers apart */
+            mpfr_prec_t precision = mpfr_get_prec(expr->number.value);
+            double value = mpfr_nan_p(expr->number.value) ? 0 : mpfr_get_d(expr->number.value, MPFR_RNDN);
+            hash = _hash_bytes(hash, &precision, sizeof(precision));
+            return _hash_bytes(hash, &value, sizeof(value));
+        }
+        case EXPRESSION_TYPE_VARIABLE:
+            return _hash_bytes(hash, expr->variable.value, strlen(expr->variable.value));
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            hash = _hash_bytes(hash, expr->function.name, strlen(expr->function.name));
+
+            size_t first = pending->count;
+            expression_t* param;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                expression_chain_append(pending, param);
+            }
+            for (size_t i = first, j = pending->count; i + 1 < j; ++i, --j) {
+                expression_t* swap = pending->operands[i];
+                pending->operands[i] = pending->operands[j - 1];
+                pending->operands[j - 1] = swap;
+            }
+            return hash;
+        }
+        case EXPRESSION_TYPE_PREFIX:
+            expression_chain_append(pending, expr->prefix.right);
+            return _hash_bytes(hash, &expr->prefix.prefix, sizeof(expr->prefix.prefix));
+        case EXPRESSION_TYPE_OPERATOR:
+            expression_chain_append(pending, expr->operator.right);
+            expression_chain_append(pending, expr->operator.left);
+            return _hash_bytes(hash, &expr->operator.infix, sizeof(expr->operator.infix));
+    }
+    return hash;
+}
+
+uint64_t expression_hash(expression_t* expr) {
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+    expression_chain_append(&pending, expr);
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    while (pending.count)
+        hash = _expression_hash_node(pending.operands[--pending.count], hash, &pending);
+
+    expression_chain_clean(&pending);
+    return hash;
+}
 
 variable_t _expression_find_variable_recursive(expression_t* expr) {
     switch (expr->type) {
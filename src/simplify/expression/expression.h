@@ -4,6 +4,7 @@
 #define SIMPLIFY_EXPRESSION_EXPRESSION_H_
 
 #include <stdarg.h>
+#include <stdint.h>
 
 #include "simplify/errors.h"
 #include "simplify/rbtree/rbtree.h"
@@ -19,6 +20,42 @@ enum compare_result {
     COMPARE_RESULT_GREATER      = 0x4,
 };
 
+/* the default number of units in the last place two numbers may differ by and still be equal */
+#ifndef COMPARE_TOLERANCE_DEFAULT_ULPS
+#   define COMPARE_TOLERANCE_DEFAULT_ULPS 16
+#endif
+
+/* How far apart two numbers may be, and still compare equal.
+ * The numbers are equal if they're within any one of the tolerances, a tolerance of zero is never met.
+ */
+typedef struct {
+    /* the most the difference may be, as a fraction of the larger number's magnitude */
+    double          relative;
+
+    /* the most the difference may be */
+    double          absolute;
+
+    /* the most the difference may be, in units in the last place of the larger number, using the lower precision.
+     * If the smaller number is zero, or too small to change the larger, numbers smaller than one are measured against
+     * one, so rounding errors near zero (like sin(pi)) are tolerated. Other small numbers are measured as they are.
+     */
+    unsigned long   ulps;
+} compare_tolerance_t;
+
+#define COMPARE_TOLERANCE_DEFAULT() ((compare_tolerance_t){ 0, 0, COMPARE_TOLERANCE_DEFAULT_ULPS })
+
+/* set the tolerance numbers are compared with, by expression_compare and expression_evaluate_comparisons
+ *
+ * @tolerance the new tolerance
+ */
+void expression_set_compare_tolerance(compare_tolerance_t tolerance);
+
+/* get the tolerance numbers are compared with
+ *
+ * @return returns the tolerance
+ */
+compare_tolerance_t expression_get_compare_tolerance(void);
+
 
 /* check for a variable or function in the expression
  *
@@ -28,6 +65,8 @@ enum compare_result {
 int expression_has_variable_or_function(expression_t* expr, variable_t var);
 
 /* Compare two expressions
+ * Numbers are compared by value, and are equal if they're within the compare tolerance.
+ * NaN is only equal to NaN, and can't be compared to anything else.
  *
  * @expr1
  * @expr2
@@ -35,6 +74,31 @@ int expression_has_variable_or_function(expression_t* expr, variable_t var);
  */
 compare_result_t expression_compare(expression_t* expr1, expression_t* expr2);
 
+/* Compare two expressions, like expression_compare, except numbers are only equal if they have the same value.
+ * Orderings, like `<` and `>`, are decided by this comparison, so numbers a rounding error apart are still ordered.
+ *
+ * @expr1
+ * @expr2
+ * @return returns a comparison result
+ */
+compare_result_t expression_compare_strict(expression_t* expr1, expression_t* expr2);
+
+/* check if two expressions are exactly the same, unlike expression_compare nothing is evaluated or reordered.
+ * Numbers must have the same value and precision, and variables must have the same binding.
+ *
+ * @expr1
+ * @expr2
+ * @return returns true if the expressions are identical
+ */
+bool expression_identical(expression_t* expr1, expression_t* expr2);
+
+/* hash an expression's structure, identical expressions always have the same hash
+ *
+ * @expr the expression to hash
+ * @return returns a 64 bit hash
+ */
+uint64_t expression_hash(expression_t* expr);
+
 /* get the name of the first variable that appears in an expression
  *
  * @expr the expression to search
@@ -0,0 +1,218 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/fixpoint.h"
+#include "simplify/expression/hashcons.h"
+#include "simplify/expression/simplify.h"
+
+/* the identity of an expression that changed during the current walk, it has to be found again on the next one */
+#define _FIXPOINT_CHANGED SIZE_MAX
+
+/* Every expression that's been seen, and the passes that have been applied to it without changing it */
+typedef struct {
+    expression_hashcons_t hashcons;
+
+    /* bit `i` of settled[id] is set if passes[i] didn't change the expression */
+    uint64_t*             settled;
+    size_t                settled_capacity;
+} _fixpoint_table_t;
+
+/* An expression on the walk's stack, and the next of it's children to visit */
+typedef struct {
+    expression_t*      expr;
+    expression_t*      parent;
+    size_t             visited;
+    expression_list_t* param;
+} _fixpoint_frame_t;
+
+/* find an expression's identity, and make room to record the passes applied to it
+ *
+ * @table the table
+ * @expr the expression
+ * @children the identity of each of the expression's children
+ * @count the number of children
+ * @return returns the expression's identity
+ */
+size_t _fixpoint_identify(_fixpoint_table_t* table, expression_t* expr, size_t* children, size_t count) {
+    size_t id = expression_hashcons_identify(&table->hashcons, expr, children, count);
+    if (id >= table->settled_capacity) {
+        size_t capacity = table->hashcons.node_capacity;
+        table->settled = realloc(table->settled, sizeof(uint64_t) * capacity);
+        memset(table->settled + table->settled_capacity, 0, sizeof(uint64_t) * (capacity - table->settled_capacity));
+        table->settled_capacity = capacity;
+    }
+    return id;
+}
+
+/* get the next of an expression's children to visit
+ *
+ * @frame the expression's frame
+ * @return returns the child, or NULL if every child has been visited
+ */
+expression_t* _fixpoint_next_child(_fixpoint_frame_t* frame) {
+    expression_t* expr = frame->expr;
+    expression_t* child = NULL;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_FUNCTION:
+            if (frame->param && frame->param->value) {
+                child = frame->param->value;
+                frame->param = frame->param->next;
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            child = frame->visited == 0 ? expr->prefix.right : NULL;
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            child = frame->visited == 0 ? expr->operator.left : frame->visited == 1 ? expr->operator.right : NULL;
+            break;
+        default:
+            break;
+    }
+
+    if (child)
+        ++frame->visited;
+    return child;
+}
+
+/* apply the passes to each expression in a tree that isn't settled, from the bottom up
+ *
+ * @table the expressions that have been seen
+ * @expr the tree's root
+ * @passes the passes
+ * @count the number of passes
+ * @stats the work done, it's updated
+ * @changed set to true if anything was changed
+ * @return returns an error code
+ */
+error_t _fixpoint_walk(_fixpoint_table_t* table, expression_t* expr, expression_pass_t* passes, size_t count,
+                       expression_fixpoint_stats_t* stats, bool* changed) {
+    error_t err = ERROR_NO_ERROR;
+
+    size_t frame_count = 0;
+    size_t frame_capacity = 16;
+    _fixpoint_frame_t* frames = malloc(sizeof(_fixpoint_frame_t) * frame_capacity);
+
+    /* the identity of each expression whose parent hasn't been finished */
+    size_t id_count = 0;
+    size_t id_capacity = 16;
+    size_t* ids = malloc(sizeof(size_t) * id_capacity);
+
+    frames[frame_count++] = (_fixpoint_frame_t){ expr, NULL, 0, EXPRESSION_IS_FUNCTION(expr) ? expr->function.parameters : NULL };
+    while (frame_count && !err) {
+        _fixpoint_frame_t* frame = &frames[frame_count - 1];
+        expression_t* child = _fixpoint_next_child(frame);
+        if (child) {
+            if (frame_count == frame_capacity) {
+                frame_capacity *= 2;
+                frames = realloc(frames, sizeof(_fixpoint_frame_t) * frame_capacity);
+                frame = &frames[frame_count - 1];
+            }
+            frames[frame_count++] = (_fixpoint_frame_t){
+                child, frame->expr, 0, EXPRESSION_IS_FUNCTION(child) ? child->function.parameters : NULL
+            };
+            continue;
+        }
+
+        /* every child has been visited, so their identities are on top of the stack */
+        _fixpoint_frame_t done = *frame;
+        --frame_count;
+        id_count -= done.visited;
+
+        size_t id = _FIXPOINT_CHANGED;
+        bool known = true;
+        for (size_t i = 0; i < done.visited; ++i)
+            known = known && ids[id_count + i] != _FIXPOINT_CHANGED;
+        if (known)
+            id = _fixpoint_identify(table, done.expr, ids + id_count, done.visited);
+
+        bool applied = false;
+        bool expr_changed = false;
+        for (size_t i = 0; i < count && !expr_changed && !err; ++i) {
+            if (id != _FIXPOINT_CHANGED && i < 64 && (table->settled[id] & (1ULL << i)))
+                continue;
+            if (passes[i].deferred && passes[i].deferred(done.expr, done.parent))
+                continue;
+
+            applied = true;
+            err = passes[i].apply(done.expr, passes[i].data, &expr_changed);
+            if (!err && !expr_changed && id != _FIXPOINT_CHANGED && i < 64)
+                table->settled[id] |= 1ULL << i;
+        }
+
+        if (applied)
+            ++stats->visited;
+        else
+            ++stats->skipped;
+
+        if (expr_changed) {
+            *changed = true;
+            id = _FIXPOINT_CHANGED;
+        }
+
+        if (id_count == id_capacity) {
+            id_capacity *= 2;
+            ids = realloc(ids, sizeof(size_t) * id_capacity);
+        }
+        ids[id_count++] = id;
+    }
+
+    free(frames);
+    free(ids);
+    return err;
+}
+
+error_t expression_fixpoint(expression_t* expr, expression_pass_t* passes, size_t count,
+                            expression_fixpoint_stats_t* stats) {
+    expression_fixpoint_stats_t ignored;
+    if (!stats)
+        stats = &ignored;
+    *stats = (expression_fixpoint_stats_t){ 0, 0, 0, false };
+
+    _fixpoint_table_t table;
+    expression_hashcons_init(&table.hashcons);
+    table.settled = NULL;
+    table.settled_capacity = 0;
+
+    error_t err = ERROR_NO_ERROR;
+    while (!err && !stats->converged && stats->iterations < EXPRESSION_FIXPOINT_MAX_ITERATIONS) {
+        bool changed = false;
+        ++stats->iterations;
+        err = _fixpoint_walk(&table, expr, passes, count, stats, &changed);
+        stats->converged = !changed;
+    }
+
+    expression_hashcons_clean(&table.hashcons);
+    free(table.settled);
+    return err;
+}
+
+/* apply expression_simplify_node as a pass
+ *
+ * @expr
+ * @data unused
+ * @changed
+ * @return returns an error code
+ */
+error_t _fixpoint_simplify(expression_t* expr, void* data, bool* changed) {
+    (void)data;
+    return expression_simplify_node(expr, changed);
+}
+
+/* apply rewrite_rules_apply_node as a pass
+ *
+ * @expr
+ * @data the rule set
+ * @changed
+ * @return returns an error code
+ */
+error_t _fixpoint_rewrite(expression_t* expr, void* data, bool* changed) {
+    return rewrite_rules_apply_node(data, expr, changed);
+}
+
+error_t expression_simplify_fixpoint(expression_t* expr, rewrite_rules_t* rules, expression_fixpoint_stats_t* stats) {
+    expression_pass_t passes[] = {
+        { _fixpoint_simplify, expression_simplify_deferred, NULL },
+        { _fixpoint_rewrite,  NULL,                         rules },
+    };
+    return expression_fixpoint(expr, passes, rules && rules->rule_count ? 2 : 1, stats);
+}
@@ -0,0 +1,77 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_FIXPOINT_H_
+#define SIMPLIFY_EXPRESSION_FIXPOINT_H_
+
+#include "simplify/expression/expression.h"
+#include "simplify/expression/rewrite.h"
+
+/* the most times the passes are applied to the whole tree, so passes that undo each other can't loop forever */
+#ifndef EXPRESSION_FIXPOINT_MAX_ITERATIONS
+#   define EXPRESSION_FIXPOINT_MAX_ITERATIONS 32
+#endif
+
+/* A simplification pass that's applied to one expression at a time */
+typedef struct expression_pass expression_pass_t;
+
+/* Counts the work done by expression_fixpoint */
+typedef struct expression_fixpoint_stats expression_fixpoint_stats_t;
+
+/* An expression is settled once every pass has been applied to it, and none of them changed it or anything in it.
+ * expression_fixpoint applies it's passes to the tree from the bottom up, again and again, until every expression in it
+ * is settled.
+ *
+ * Rather than flagging the expressions themselves, which are copied and replaced by every pass,
+ * each expression is identified by it's contents: it's type, operator, name or value, and the identity of each of it's
+ * children. Each pass over the tree finds the identity of every expression, and the passes are only applied to
+ * expressions that aren't settled, so the work done after the first pass depends on how much of the tree changed.
+ */
+struct expression_pass {
+    /* apply the pass to an expression, it's children are already settled.
+     * `changed` must be set to true if the expression was changed, otherwise it's left alone.
+     */
+    error_t (*apply)(expression_t* expr, void* data, bool* changed);
+
+    /* if not NULL, and it returns true, the pass isn't applied to the expression, it's applied along with it's parent */
+    bool (*deferred)(expression_t* expr, expression_t* parent);
+
+    /* passed to `apply` */
+    void* data;
+};
+
+struct expression_fixpoint_stats {
+    /* the number of times the tree was walked */
+    size_t iterations;
+
+    /* the number of expressions the passes were applied to */
+    size_t visited;
+
+    /* the number of expressions that weren't changed since they were settled, so the passes were skipped */
+    size_t skipped;
+
+    /* true if the last walk didn't change anything */
+    bool   converged;
+};
+
+/* apply a list of passes to an expression until none of them changes it.
+ * If the passes haven't converged after EXPRESSION_FIXPOINT_MAX_ITERATIONS walks, the expression is left as it is.
+ *
+ * @expr the expression
+ * @passes the passes, applied to each expression in order
+ * @count the number of passes
+ * @stats set to the work done, or NULL
+ * @return returns an error code, if an error is returned the expression is whole, but may be partially simplified
+ */
+error_t expression_fixpoint(expression_t* expr, expression_pass_t* passes, size_t count,
+                            expression_fixpoint_stats_t* stats);
+
+/* simplify an expression, and rewrite it with a set of rules, until neither changes it. See simplify.h.
+ *
+ * @expr the expression
+ * @rules the rules to apply, or NULL to only simplify the expression
+ * @stats set to the work done, or NULL
+ * @return returns an error code
+ */
+error_t expression_simplify_fixpoint(expression_t* expr, rewrite_rules_t* rules, expression_fixpoint_stats_t* stats);
+
+#endif  // SIMPLIFY_EXPRESSION_FIXPOINT_H_
@@ -0,0 +1,157 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "simplify/expression/hashcons.h"
+
+/* the number of buckets the table starts with, must be a power of two */
+#define _HASHCONS_INITIAL_BUCKETS 64
+
+/* mix a value into a hash
+ *
+ * @hash the hash so far
+ * @value the value to mix
+ * @return returns the new hash
+ */
+static inline uint64_t _hashcons_mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+/* set a node's label, and find it's hash. The label is borrowed from the expression
+ *
+ * @node the node, it's children must be set
+ * @expr the expression
+ */
+void _hashcons_node_label(expression_hashcons_node_t* node, expression_t* expr) {
+    node->type = expr->type;
+    node->operator = EXPRESSION_OPERATOR(expr);
+    node->leaf = NULL;
+    node->name = NULL;
+
+    uint64_t hash = _hashcons_mix(0xcbf29ce484222325ULL, node->type);
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        case EXPRESSION_TYPE_VARIABLE:
+            node->leaf = expr;
+            hash = _hashcons_mix(hash, expression_hash(expr));
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            node->name = expr->function.name;
+            for (char* c = node->name; *c; ++c)
+                hash = _hashcons_mix(hash, (unsigned char)*c);
+            break;
+        default:
+            hash = _hashcons_mix(hash, (unsigned char)node->operator);
+            break;
+    }
+
+    for (size_t i = 0; i < node->count; ++i)
+        hash = _hashcons_mix(hash, node->children[i]);
+    node->hash = _hashcons_mix(hash, node->count);
+}
+
+/* check if two nodes have the same label and children
+ *
+ * @node1
+ * @node2
+ * @return returns true if the nodes are the same
+ */
+bool _hashcons_node_equal(expression_hashcons_node_t* node1, expression_hashcons_node_t* node2) {
+    if (node1->hash != node2->hash
+            || node1->type != node2->type
+            || node1->operator != node2->operator
+            || node1->count != node2->count)
+        return false;
+    if (node1->leaf && !expression_identical(node1->leaf, node2->leaf))
+        return false;
+    if (node1->name && strcmp(node1->name, node2->name) != 0)
+        return false;
+    return node1->count == 0 || memcmp(node1->children, node2->children, sizeof(size_t) * node1->count) == 0;
+}
+
+/* put every node in a table with `bucket_count` buckets
+ *
+ * @table the table
+ * @bucket_count the number of buckets, it must be a power of two
+ */
+void _hashcons_rehash(expression_hashcons_t* table, size_t bucket_count) {
+    free(table->buckets);
+    table->buckets = calloc(bucket_count, sizeof(size_t));
+    table->bucket_count = bucket_count;
+
+    for (size_t i = 0; i < table->node_count; ++i) {
+        size_t bucket = table->nodes[i].hash & (bucket_count - 1);
+        while (table->buckets[bucket])
+            bucket = (bucket + 1) & (bucket_count - 1);
+        table->buckets[bucket] = i + 1;
+    }
+}
+
+size_t expression_hashcons_identify(expression_hashcons_t* table, expression_t* expr, size_t* children, size_t count) {
+    expression_hashcons_node_t node;
+    size_t ordered[2];
+
+    /* a commutative table sorts a sum or product's operands by identity, so either order finds the same node */
+    if (table->commutative && count == 2 && EXPRESSION_IS_OPERATOR(expr)
+            && (expr->operator.infix == '+' || expr->operator.infix == '*') && children[0] > children[1]) {
+        ordered[0] = children[1];
+        ordered[1] = children[0];
+        children = ordered;
+    }
+
+    node.children = children;
+    node.count = count;
+    _hashcons_node_label(&node, expr);
+
+    if ((table->node_count + 1) * 2 > table->bucket_count)
+        _hashcons_rehash(table, table->bucket_count ? table->bucket_count * 2 : _HASHCONS_INITIAL_BUCKETS);
+
+    size_t bucket = node.hash & (table->bucket_count - 1);
+    for (; table->buckets[bucket]; bucket = (bucket + 1) & (table->bucket_count - 1)) {
+        if (_hashcons_node_equal(&table->nodes[table->buckets[bucket] - 1], &node))
+            return table->buckets[bucket] - 1;
+    }
+
+    /* the label and children were borrowed, the table keeps copies */
+    if (node.leaf) {
+        node.leaf = malloc(sizeof(expression_t));
+        expression_copy(expr, node.leaf);
+    }
+    if (node.name) {
+        node.name = malloc(strlen(expr->function.name) + 1);
+        strcpy(node.name, expr->function.name);
+    }
+    node.children = count ? malloc(sizeof(size_t) * count) : NULL;
+    if (count)
+        memcpy(node.children, children, sizeof(size_t) * count);
+
+    if (table->node_count == table->node_capacity) {
+        table->node_capacity = table->node_capacity ? table->node_capacity * 2 : _HASHCONS_INITIAL_BUCKETS;
+        table->nodes = realloc(table->nodes, sizeof(expression_hashcons_node_t) * table->node_capacity);
+    }
+    table->nodes[table->node_count] = node;
+    table->buckets[bucket] = table->node_count + 1;
+    return table->node_count++;
+}
+
+void expression_hashcons_init(expression_hashcons_t* table) {
+    table->nodes         = NULL;
+    table->node_count    = 0;
+    table->node_capacity = 0;
+    table->buckets       = NULL;
+    table->bucket_count  = 0;
+    table->commutative   = false;
+}
+
+void expression_hashcons_clean(expression_hashcons_t* table) {
+    for (size_t i = 0; i < table->node_count; ++i) {
+        if (table->nodes[i].leaf)
+            expression_free(table->nodes[i].leaf);
+        free(table->nodes[i].name);
+        free(table->nodes[i].children);
+    }
+    free(table->nodes);
+    free(table->buckets);
+}
@@ -0,0 +1,78 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_HASHCONS_H_
+#define SIMPLIFY_EXPRESSION_HASHCONS_H_
+
+#include <stdint.h>
+
+#include "simplify/expression/expression.h"
+
+/* An expression's contents, without it's children: it's type, operator, name or value,
+ * and the identity of each of it's children
+ */
+typedef struct expression_hashcons_node expression_hashcons_node_t;
+
+/* A table of every distinct expression that's been seen.
+ *
+ * Each expression is identified by it's label and the identities of it's children, so two expressions have the same
+ * identity if, and only if, they're identical (see expression_identical). An expression's children are always
+ * identified before it is, so a child's identity is always less than it's parent's.
+ *
+ * Identities are found from the bottom up, so the identity of every expression in a tree is found in linear time,
+ * instead of hashing each subtree separately.
+ */
+struct expression_hashcons_node {
+    expression_type_t type;
+    operator_t        operator;
+
+    /* a copy of a number or variable */
+    expression_t*     leaf;
+
+    /* a function's name */
+    char*             name;
+
+    /* the identity of each child */
+    size_t*           children;
+    size_t            count;
+
+    uint64_t          hash;
+};
+
+typedef struct {
+    expression_hashcons_node_t* nodes;
+    size_t                      node_count;
+    size_t                      node_capacity;
+
+    /* open addressed, each bucket holds a node's index plus one, or zero if it's empty */
+    size_t*                     buckets;
+    size_t                      bucket_count;
+
+    /* if set, a sum or product's operands are identified in either order, so `a * b` and `b * a` are the same node.
+     * Off by default, users that only need identical trees (see expression_identical) shouldn't set it.
+     */
+    bool                        commutative;
+} expression_hashcons_t;
+
+/* initialize an empty table, that isn't commutative
+ *
+ * @table the table to initialize
+ */
+void expression_hashcons_init(expression_hashcons_t* table);
+
+/* free every node in a table
+ *
+ * @table the table to clean
+ */
+void expression_hashcons_clean(expression_hashcons_t* table);
+
+/* find an expression's identity, the expression is added to the table if it hasn't been seen before
+ *
+ * @table the table
+ * @expr the expression, only it's label is read
+ * @children the identity of each of the expression's children, in order. A function's children are it's arguments.
+ * @count the number of children
+ * @return returns the expression's identity, an index into the table's nodes
+ */
+size_t expression_hashcons_identify(expression_hashcons_t* table, expression_t* expr, size_t* children, size_t count);
+
+#endif  // SIMPLIFY_EXPRESSION_HASHCONS_H_
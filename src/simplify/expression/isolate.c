@@ -5,8 +5,145 @@
 #include "simplify/expression/isolate.h"
 #include "simplify/expression/expression.h"
 #include "simplify/expression/evaluate.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/chain.h"
 
-error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t** target, variable_t var);
+/* Whether each expression in a tree contains the variable being isolated.
+ *
+ * Isolating a variable asks which side of every operator on the path to it contains the variable, searching each
+ * side would take time proportional to the tree's size at every level. Instead every expression is checked once,
+ * from the bottom up, before anything is isolated, and the answers are looked up by the expression's address.
+ * Expressions that are changed in place while isolating are updated as they're changed.
+ */
+typedef struct {
+    expression_t* expr;
+    bool          occurs;
+} _isolate_occurrence_t;
+
+typedef struct {
+    variable_t             var;
+
+    /* open addressed, a bucket is empty if it's expression is NULL */
+    _isolate_occurrence_t* buckets;
+    size_t                 bucket_count;
+
+    /* the number of expressions in the tree the table was initialized with */
+    size_t                 count;
+} _isolate_occurrences_t;
+
+error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t** target, variable_t var,
+                                               _isolate_occurrences_t* occurrences);
+
+/* find an expression's bucket
+ *
+ * @occurrences the table
+ * @expr the expression
+ * @return returns the expression's bucket, or the empty bucket it would be stored in
+ */
+_isolate_occurrence_t* _isolate_occurrences_find(_isolate_occurrences_t* occurrences, expression_t* expr) {
+    size_t mask = occurrences->bucket_count - 1;
+    size_t index = (size_t)(((uintptr_t)expr >> 4) * 0x9e3779b97f4a7c15ULL) & mask;
+    while (occurrences->buckets[index].expr && occurrences->buckets[index].expr != expr)
+        index = (index + 1) & mask;
+    return &occurrences->buckets[index];
+}
+
+/* record whether an expression contains the table's variable
+ *
+ * @occurrences the table
+ * @expr the expression
+ * @occurs true if the expression contains the variable
+ */
+void _isolate_occurrences_set(_isolate_occurrences_t* occurrences, expression_t* expr, bool occurs) {
+    _isolate_occurrence_t* bucket = _isolate_occurrences_find(occurrences, expr);
+    bucket->expr = expr;
+    bucket->occurs = occurs;
+}
+
+/* check whether every expression in a tree contains a variable
+ *
+ * @occurrences the table to initialize
+ * @expr the tree
+ * @var the variable
+ */
+void _isolate_occurrences_init(_isolate_occurrences_t* occurrences, expression_t* expr, variable_t var) {
+    /* collect the tree in prefix order, so each expression's children come after it */
+    expression_chain_t order;
+    expression_chain_t pending;
+    expression_chain_init(&order, 0);
+    expression_chain_init(&pending, 0);
+    expression_chain_append(&pending, expr);
+    while (pending.count) {
+        expression_t* next = pending.operands[--pending.count];
+        expression_chain_append(&order, next);
+        if (EXPRESSION_IS_OPERATOR(next)) {
+            expression_chain_append(&pending, next->operator.right);
+            expression_chain_append(&pending, next->operator.left);
+        } else if (EXPRESSION_IS_PREFIX(next)) {
+            expression_chain_append(&pending, next->prefix.right);
+        }
+    }
+    expression_chain_clean(&pending);
+
+    /* leave room for the expressions made while isolating, and keep the table at most half full */
+    occurrences->var = var;
+    occurrences->count = order.count;
+    occurrences->bucket_count = 16;
+    while (occurrences->bucket_count < order.count * 4)
+        occurrences->bucket_count <<= 1;
+    occurrences->buckets = calloc(occurrences->bucket_count, sizeof(_isolate_occurrence_t));
+
+    /* a function's arguments aren't searched, only it's name, like expression_has_variable_or_function */
+    for (size_t i = order.count; i-- > 0;) {
+        expression_t* next = order.operands[i];
+        bool occurs = false;
+        switch (next->type) {
+            case EXPRESSION_TYPE_VARIABLE:
+                occurs = strcmp(var, next->variable.value) == 0;
+                break;
+            case EXPRESSION_TYPE_FUNCTION:
+                occurs = strcmp(var, next->function.name) == 0;
+                break;
+            case EXPRESSION_TYPE_PREFIX:
+                occurs = _isolate_occurrences_find(occurrences, next->prefix.right)->occurs;
+                break;
+            case EXPRESSION_TYPE_OPERATOR:
+                occurs = _isolate_occurrences_find(occurrences, next->operator.left)->occurs
+                      || _isolate_occurrences_find(occurrences, next->operator.right)->occurs;
+                break;
+            case EXPRESSION_TYPE_NUMBER:
+                break;
+        }
+        _isolate_occurrences_set(occurrences, next, occurs);
+    }
+    expression_chain_clean(&order);
+}
+
+/* free the resources used by a table
+ *
+ * @occurrences the table
+ */
+void _isolate_occurrences_clean(_isolate_occurrences_t* occurrences) {
+    free(occurrences->buckets);
+}
+
+/* check if an expression contains a variable
+ *
+ * @occurrences the table of expressions known to contain the variable or not, or NULL
+ * @expr the expression
+ * @var the variable
+ * @return returns true if the expression contains the variable
+ */
+bool _isolate_occurs(_isolate_occurrences_t* occurrences, expression_t* expr, variable_t var) {
+    if (occurrences && strcmp(occurrences->var, var) == 0) {
+        _isolate_occurrence_t* bucket = _isolate_occurrences_find(occurrences, expr);
+        if (bucket->expr)
+            return bucket->occurs;
+    }
+
+    /* the expression was made while isolating, or it's a search for another variable */
+    return expression_has_variable_or_function(expr, var);
+}
 
 void _expression_invert_operand(expression_t* expr) {
     switch (expr->operator.infix) {
@@ -58,9 +195,10 @@ error_t _expression_setup_natural_log(expression_t* y, expression_t* expr) {
 
     if (EXPRESSION_IS_NUMBER(y)) {
         mpfr_ptr loge = malloc(sizeof(mpfr_t));
-        mpfr_init(loge);
+        mpfr_init2(loge, mpfr_get_prec(y->number.value));
         mpfr_log(loge, y->number.value, MPFR_RNDF);
         expression_init_number(expr, loge);
+        expr->number.inexact = mpfr_regular_p(loge);
         expression_clean(y);
         return ERROR_NO_ERROR;
     }
@@ -79,26 +217,29 @@ error_t _expression_setup_natural_log(expression_t* y, expression_t* expr) {
                 '^',
                 expression_new_variable("x")));
 
-        err = _expression_isolate_variable_recursive(expr->operator.right, &expr->operator.left, "x");
+        err = _expression_isolate_variable_recursive(expr->operator.right, &expr->operator.left, "x", NULL);
         if (err) return err;
         expression_collapse_right(expr);
 #   endif
     return err;
 }
 
-error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t** target, variable_t var) {
+error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t** target, variable_t var,
+                                               _isolate_occurrences_t* occurrences) {
     switch (expr->type) {
         case EXPRESSION_TYPE_NUMBER:
             return ERROR_VARIABLE_NOT_PRESENT;
         case EXPRESSION_TYPE_OPERATOR:
         {
             if (expression_is_comparison(expr) || expr->operator.infix == ':') {
-                error_t err = _expression_isolate_variable_recursive(expr->operator.left, &expr->operator.right, var);
+                error_t err = _expression_isolate_variable_recursive(expr->operator.left, &expr->operator.right, var,
+                                                                     occurrences);
                 if (err && err != ERROR_VARIABLE_NOT_PRESENT)
                     return err;
 
                 if (err) {
-                    err = _expression_isolate_variable_recursive(expr->operator.right, &expr->operator.left, var);
+                    err = _expression_isolate_variable_recursive(expr->operator.right, &expr->operator.left, var,
+                                                                 occurrences);
                     if (err) return err;
                 }
                 return ERROR_NO_ERROR;
@@ -108,11 +249,11 @@ error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t*
             new_target->type = EXPRESSION_TYPE_OPERATOR;
             new_target->operator.infix = expr->operator.infix;
 
-            if (expression_has_variable_or_function(expr->operator.left, var)) {
+            if (_isolate_occurs(occurrences, expr->operator.left, var)) {
                 new_target->operator.right = expr->operator.right;
                 new_target->operator.left  = *target;
                 _expression_invert_operand(new_target);
-            } else if (expression_has_variable_or_function(expr->operator.right, var)) {
+            } else if (_isolate_occurs(occurrences, expr->operator.right, var)) {
                 if (expr->operator.infix == '^') {
                     // Looks Logarithm-ish so handle it as a special case
                     expression_t* y = expr->operator.right;
@@ -122,7 +263,7 @@ error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t*
                     if ((EXPRESSION_IS_VARIABLE(b) && !strcmp(b->variable.value, E_BUILTIN))) {
                         *expr = *y;
                         *target = expression_new_operator(expression_new_variable(E_BUILTIN), '^', *target);
-                        _expression_isolate_variable_recursive(expr, target, var);
+                        _expression_isolate_variable_recursive(expr, target, var, occurrences);
                         return ERROR_NO_ERROR;
                     }
                     error_t err = _expression_setup_natural_log(x, new_target);
@@ -134,8 +275,12 @@ error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t*
 
                     *expr->operator.left = oldy;
                     expr->operator.infix = '*';
+                    if (occurrences) {
+                        _isolate_occurrences_set(occurrences, expr->operator.left, true);
+                        _isolate_occurrences_set(occurrences, expr->operator.right, false);
+                    }
                     *target = new_target;
-                    _expression_isolate_variable_recursive(expr, target, var);
+                    _expression_isolate_variable_recursive(expr, target, var, occurrences);
                     break;
                 } else if (_expression_operator_is_reversible(expr)) {
                     new_target->operator.right = expr->operator.left;
@@ -152,9 +297,9 @@ error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t*
 
             *target = new_target;
             expression_t new_expr;
-            if (!_expression_isolate_variable_recursive(expr->operator.left, target, var)) {
+            if (!_expression_isolate_variable_recursive(expr->operator.left, target, var, occurrences)) {
                 new_expr = *expr->operator.left;
-            } else if (!_expression_isolate_variable_recursive(expr->operator.right, target, var)) {
+            } else if (!_expression_isolate_variable_recursive(expr->operator.right, target, var, occurrences)) {
                 new_expr = *expr->operator.right;
             } else {
                 return ERROR_VARIABLE_NOT_PRESENT;
@@ -165,7 +310,7 @@ error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t*
         }
         case EXPRESSION_TYPE_PREFIX:
         {
-            if (expression_has_variable_or_function(expr->prefix.right, var)) {
+            if (_isolate_occurs(occurrences, expr->prefix.right, var)) {
                 expression_t* new_target = malloc(sizeof(expression_t));
                 new_target->type = EXPRESSION_TYPE_PREFIX;
                 new_target->prefix.right = *target;
@@ -180,7 +325,7 @@ error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t*
                         return ERROR_INVALID_PREFIX;
                 }
                 *target = new_target;
-                if (!_expression_isolate_variable_recursive(expr->prefix.right, target, var)) {
+                if (!_expression_isolate_variable_recursive(expr->prefix.right, target, var, occurrences)) {
                     *expr = *expr->prefix.right;
                 } else {
                     return ERROR_VARIABLE_NOT_PRESENT;
@@ -206,8 +351,20 @@ error_t _expression_isolate_variable_recursive(expression_t* expr, expression_t*
 }
 
 error_t expression_isolate_variable(expression_t* expr, variable_t var) {
-    if (!expression_has_variable_or_function(expr, var))
+    _isolate_occurrences_t occurrences;
+    _isolate_occurrences_init(&occurrences, expr, var);
+    if (!_isolate_occurs(&occurrences, expr, var)) {
+        _isolate_occurrences_clean(&occurrences);
         return ERROR_VARIABLE_NOT_PRESENT;
+    }
+
+    /* the isolated expression is built from the nodes of the original, so it can't be stopped half way.
+        Instead the work is charged up front, a step for each expression found while looking for the variable */
+    error_t err = budget_steps(occurrences.count);
+    if (err) {
+        _isolate_occurrences_clean(&occurrences);
+        return err;
+    }
 
     if (!expression_is_comparison(expr) && expr->operator.infix != ':') {
         expression_t* new_left = malloc(sizeof(expression_t));
@@ -218,9 +375,12 @@ error_t expression_isolate_variable(expression_t* expr, variable_t var) {
         expr->operator.left = new_left;
         expr->operator.right = malloc(sizeof(expression_t));
         expression_init_number_si(expr->operator.right, 0);
+        _isolate_occurrences_set(&occurrences, new_left, true);
+        _isolate_occurrences_set(&occurrences, expr->operator.right, false);
     }
 
-    error_t err = _expression_isolate_variable_recursive(expr, NULL, var);
+    err = _expression_isolate_variable_recursive(expr, NULL, var, &occurrences);
+    _isolate_occurrences_clean(&occurrences);
     if (err) return err;
 
     /* make sure the variable is always on the left */
@@ -12,6 +12,9 @@
 
 /* isolate a variable on one side of an comparison operator.
  * If no comparison operator is present, append `= 0`
+ *
+ * Each node of the expression counts as a step against the calling thread's budget (see budget.h),
+ * the steps are counted before the expression is changed.
  * 
  * @expr the expression to work with
  * @var the variable to isolate
@@ -0,0 +1,853 @@
+/* Copyright Ian Shehadeh 2018 */
+
+/* mmap's MAP_ANONYMOUS isn't part of C99 */
+#ifndef _DEFAULT_SOURCE
+#   define _DEFAULT_SOURCE
+#endif
+
+#include <math.h>
+#include <stdint.h>
+
+#include "simplify/expression/jit.h"
+#include "simplify/expression/symbol.h"
+
+#if JIT_NATIVE
+#   include <sys/mman.h>
+#   include <unistd.h>
+#endif
+
+/* A part of a program, compiled from a subexpression */
+typedef struct {
+    jit_instruction_t* code;
+    size_t             count;
+    size_t             capacity;
+
+    /* the most values the part pushes onto the stack at once */
+    size_t             depth;
+} _jit_fragment_t;
+
+/* A name bound to an argument or a local, while the expression that uses it is compiled */
+typedef struct {
+    char*  name;
+    bool   argument;
+    size_t index;
+} _jit_binding_t;
+
+typedef struct {
+    scope_t*        scope;
+    _jit_binding_t* bindings;
+    size_t          binding_count;
+    size_t          binding_capacity;
+    size_t          locals;
+    size_t          inline_depth;
+} _jit_compiler_t;
+
+/* A builtin function that can be called from compiled code */
+typedef struct {
+    const char*  name;
+    size_t       arguments;
+    jit_unary_t  unary;
+    jit_binary_t binary;
+} _jit_builtin_t;
+
+static double _jit_sec(double x)  { return 1 / cos(x); }
+static double _jit_csc(double x)  { return 1 / sin(x); }
+static double _jit_cot(double x)  { return 1 / tan(x); }
+static double _jit_sech(double x) { return 1 / cosh(x); }
+static double _jit_csch(double x) { return 1 / sinh(x); }
+static double _jit_coth(double x) { return 1 / tanh(x); }
+static double _jit_frac(double x) { return x - trunc(x); }
+static double _jit_log(double b, double y) { return log(y) / log(b); }
+
+/* the `n`th root of `x`, n is rounded to the nearest whole number like the \ operator */
+static double _jit_root(double x, double n) {
+    double k = nearbyint(n);
+    if (!(k >= 1))
+        return NAN;
+    if (k == 2)
+        return sqrt(x);
+    if (k == 3)
+        return cbrt(x);
+    if (x < 0)
+        return fmod(k, 2) == 1 ? -pow(-x, 1 / k) : NAN;
+    return pow(x, 1 / k);
+}
+
+static const _jit_builtin_t _g_jit_builtins[] = {
+    { "sin",       1, sin,       NULL },
+    { "cos",       1, cos,       NULL },
+    { "tan",       1, tan,       NULL },
+    { "asin",      1, asin,      NULL },
+    { "acos",      1, acos,      NULL },
+    { "atan",      1, atan,      NULL },
+    { "sec",       1, _jit_sec,  NULL },
+    { "csc",       1, _jit_csc,  NULL },
+    { "cot",       1, _jit_cot,  NULL },
+    { "sinh",      1, sinh,      NULL },
+    { "cosh",      1, cosh,      NULL },
+    { "tanh",      1, tanh,      NULL },
+    { "asinh",     1, asinh,     NULL },
+    { "acosh",     1, acosh,     NULL },
+    { "atanh",     1, atanh,     NULL },
+    { "sech",      1, _jit_sech, NULL },
+    { "csch",      1, _jit_csch, NULL },
+    { "coth",      1, _jit_coth, NULL },
+    { "ceil",      1, ceil,      NULL },
+    { "floor",     1, floor,     NULL },
+    { "round",     1, round,     NULL },
+    { "roundeven", 1, nearbyint, NULL },
+    { "trunc",     1, trunc,     NULL },
+    { "frac",      1, _jit_frac, NULL },
+    { "ln",        1, log,       NULL },
+    { "log",       2, NULL,      _jit_log },
+    { "min",       2, NULL,      fmin },
+    { "max",       2, NULL,      fmax },
+};
+
+/* append an instruction to a fragment
+ *
+ * @fragment the fragment
+ * @op the instruction's operation
+ * @return returns the instruction, it's only valid until the next instruction is appended
+ */
+jit_instruction_t* _jit_emit(_jit_fragment_t* fragment, jit_opcode_t op) {
+    if (fragment->count >= fragment->capacity) {
+        fragment->capacity = fragment->capacity ? fragment->capacity * 2 : 16;
+        fragment->code = realloc(fragment->code, fragment->capacity * sizeof(jit_instruction_t));
+    }
+
+    jit_instruction_t* instruction = &fragment->code[fragment->count++];
+    instruction->op              = op;
+    instruction->swapped         = false;
+    instruction->index           = 0;
+    instruction->value           = 0;
+    instruction->function.binary = NULL;
+    return instruction;
+}
+
+/* append a fragment's instructions to another fragment, and free it
+ *
+ * @fragment the fragment to append to, the appended instructions run after it's own
+ * @other the fragment to append
+ */
+void _jit_append(_jit_fragment_t* fragment, _jit_fragment_t* other) {
+    size_t base = fragment->count ? 1 : 0;
+    for (size_t i = 0; i < other->count; ++i)
+        *_jit_emit(fragment, other->code[i].op) = other->code[i];
+
+    /* the appended instructions run with the fragment's result on the stack */
+    if (base + other->depth > fragment->depth)
+        fragment->depth = base + other->depth;
+    free(other->code);
+}
+
+/* bind a name while part of an expression is compiled
+ *
+ * @compiler the compiler
+ * @name the name
+ * @argument if true the name is an argument, otherwise it's a local
+ * @index the argument or local's index
+ */
+void _jit_bind(_jit_compiler_t* compiler, char* name, bool argument, size_t index) {
+    if (compiler->binding_count >= compiler->binding_capacity) {
+        compiler->binding_capacity = compiler->binding_capacity ? compiler->binding_capacity * 2 : 8;
+        compiler->bindings = realloc(compiler->bindings, compiler->binding_capacity * sizeof(_jit_binding_t));
+    }
+
+    _jit_binding_t* binding = &compiler->bindings[compiler->binding_count++];
+    binding->name     = name;
+    binding->argument = argument;
+    binding->index    = index;
+}
+
+error_t _jit_compile(_jit_compiler_t* compiler, expression_t* expr, _jit_fragment_t* fragment);
+
+/* compile an operation on two values, the operand that needs the deeper stack is compiled first
+ *
+ * @compiler the compiler
+ * @left the left operand
+ * @right the right operand
+ * @fragment the fragment to append to, it must be empty
+ * @op the operation
+ * @err location to store an error code
+ * @return returns the operation's instruction, or NULL if an operand couldn't be compiled
+ */
+jit_instruction_t* _jit_compile_binary(_jit_compiler_t* compiler, expression_t* left, expression_t* right,
+                                        _jit_fragment_t* fragment, jit_opcode_t op, error_t* err) {
+    _jit_fragment_t first  = { NULL, 0, 0, 0 };
+    _jit_fragment_t second = { NULL, 0, 0, 0 };
+
+    *err = _jit_compile(compiler, left, &first);
+    if (!*err)
+        *err = _jit_compile(compiler, right, &second);
+    if (*err) {
+        free(first.code);
+        free(second.code);
+        return NULL;
+    }
+
+    bool swapped = second.depth > first.depth;
+    _jit_append(fragment, swapped ? &second : &first);
+    _jit_append(fragment, swapped ? &first : &second);
+
+    jit_instruction_t* instruction = _jit_emit(fragment, op);
+    instruction->swapped = swapped;
+    return instruction;
+}
+
+/* compile a reference to a variable
+ *
+ * @compiler the compiler
+ * @expr the variable expression
+ * @fragment the fragment to append to
+ * @return returns an error code
+ */
+error_t _jit_compile_variable(_jit_compiler_t* compiler, expression_t* expr, _jit_fragment_t* fragment) {
+    /* scoping is dynamic, so the innermost binding of the name is used, even if it belongs to a caller */
+    for (size_t i = compiler->binding_count; i > 0; --i) {
+        _jit_binding_t* binding = &compiler->bindings[i - 1];
+        if (strcmp(binding->name, expr->variable.value) == 0) {
+            _jit_emit(fragment, binding->argument ? JIT_OP_ARGUMENT : JIT_OP_LOAD)->index = binding->index;
+            fragment->depth = 1;
+            return ERROR_NO_ERROR;
+        }
+    }
+
+    symbol_t* symbol = expr->variable.symbol ? expr->variable.symbol : symbol_intern(expr->variable.value);
+    scope_t* scope = compiler->scope;
+    variable_info_t* info;
+    if (scope_get_symbol_info(scope, symbol, &info) || info->impure)
+        return ERROR_NOT_COMPILABLE;
+    if (info->named_inputs)
+        return ERROR_IS_A_FUNCTION;
+
+    if (info->is_internal) {
+        expression_t value;
+        error_t err = scope_get_symbol_value(scope, symbol, &value);
+        if (err) return err;
+
+        if (!EXPRESSION_IS_NUMBER(&value)) {
+            expression_clean(&value);
+            return ERROR_NOT_COMPILABLE;
+        }
+        _jit_emit(fragment, JIT_OP_CONSTANT)->value = mpfr_get_d(value.number.value, MPFR_RNDN);
+        fragment->depth = 1;
+        expression_clean(&value);
+        return ERROR_NO_ERROR;
+    }
+
+    if (compiler->inline_depth >= JIT_MAX_INLINE_DEPTH)
+        return ERROR_NOT_COMPILABLE;
+
+    ++compiler->inline_depth;
+    error_t err = _jit_compile(compiler, info->value.expression, fragment);
+    --compiler->inline_depth;
+    return err;
+}
+
+/* compile a function call, builtins are called and user functions are inlined
+ *
+ * @compiler the compiler
+ * @expr the function expression
+ * @fragment the fragment to append to
+ * @return returns an error code
+ */
+error_t _jit_compile_call(_jit_compiler_t* compiler, expression_t* expr, _jit_fragment_t* fragment) {
+    symbol_t* symbol = expr->function.symbol ? expr->function.symbol : symbol_intern(expr->function.name);
+    variable_info_t* info;
+    expression_t* param;
+    size_t count = 0;
+    error_t err;
+
+    if (scope_get_symbol_info(compiler->scope, symbol, &info) || info->impure)
+        return ERROR_NOT_COMPILABLE;
+    if (!info->named_inputs)
+        return ERROR_IS_A_VARIABLE;
+
+    EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+        ++count;
+    }
+
+    if (info->is_internal) {
+        for (size_t i = 0; i < sizeof(_g_jit_builtins) / sizeof(_g_jit_builtins[0]); ++i) {
+            const _jit_builtin_t* builtin = &_g_jit_builtins[i];
+            if (strcmp(builtin->name, expr->function.name) != 0)
+                continue;
+            if (builtin->arguments != count)
+                return ERROR_MISSING_ARGUMENTS;
+
+            if (count == 1) {
+                err = _jit_compile(compiler, expr->function.parameters->value, fragment);
+                if (err) return err;
+                _jit_emit(fragment, JIT_OP_CALL1)->function.unary = builtin->unary;
+                return ERROR_NO_ERROR;
+            }
+
+            jit_instruction_t* call = _jit_compile_binary(compiler, expr->function.parameters->value,
+                                                          expr->function.parameters->next->value, fragment, JIT_OP_CALL2, &err);
+            if (err) return err;
+            call->function.binary = builtin->binary;
+            return ERROR_NO_ERROR;
+        }
+        return ERROR_NOT_COMPILABLE;
+    }
+
+    size_t parameters = 0;
+    EXPRESSION_LIST_FOREACH(param, info->named_inputs) {
+        ++parameters;
+    }
+    if (parameters != count)
+        return ERROR_MISSING_ARGUMENTS;
+    if (compiler->inline_depth >= JIT_MAX_INLINE_DEPTH)
+        return ERROR_NOT_COMPILABLE;
+
+    /* arguments are evaluated once, into locals, the body reads them like the call's frame */
+    size_t first = compiler->locals;
+    compiler->locals += count;
+
+    size_t i = 0;
+    EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+        _jit_fragment_t argument = { NULL, 0, 0, 0 };
+        err = _jit_compile(compiler, param, &argument);
+        if (err) {
+            free(argument.code);
+            return err;
+        }
+
+        /* each argument is popped into it's local before the next is pushed */
+        if (argument.depth > fragment->depth)
+            fragment->depth = argument.depth;
+        for (size_t j = 0; j < argument.count; ++j)
+            *_jit_emit(fragment, argument.code[j].op) = argument.code[j];
+        free(argument.code);
+        _jit_emit(fragment, JIT_OP_STORE)->index = first + i++;
+    }
+
+    size_t bindings = compiler->binding_count;
+    i = 0;
+    EXPRESSION_LIST_FOREACH(param, info->named_inputs) {
+        _jit_bind(compiler, param->variable.value, false, first + i++);
+    }
+
+    _jit_fragment_t body = { NULL, 0, 0, 0 };
+    ++compiler->inline_depth;
+    err = _jit_compile(compiler, info->value.expression, &body);
+    --compiler->inline_depth;
+    compiler->binding_count = bindings;
+
+    if (err) {
+        free(body.code);
+        return err;
+    }
+
+    if (body.depth > fragment->depth)
+        fragment->depth = body.depth;
+    for (size_t j = 0; j < body.count; ++j)
+        *_jit_emit(fragment, body.code[j].op) = body.code[j];
+    free(body.code);
+    return ERROR_NO_ERROR;
+}
+
+/* compile an expression into a fragment that pushes it's value
+ *
+ * @compiler the compiler
+ * @expr the expression
+ * @fragment the fragment to append to, it must be empty
+ * @return returns an error code
+ */
+error_t _jit_compile(_jit_compiler_t* compiler, expression_t* expr, _jit_fragment_t* fragment) {
+    error_t err = ERROR_NO_ERROR;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            _jit_emit(fragment, JIT_OP_CONSTANT)->value = mpfr_get_d(expr->number.value, MPFR_RNDN);
+            fragment->depth = 1;
+            return ERROR_NO_ERROR;
+        case EXPRESSION_TYPE_VARIABLE:
+            return _jit_compile_variable(compiler, expr, fragment);
+        case EXPRESSION_TYPE_FUNCTION:
+            return _jit_compile_call(compiler, expr, fragment);
+        case EXPRESSION_TYPE_PREFIX:
+            if (expr->prefix.prefix != '-' && expr->prefix.prefix != '+')
+                return ERROR_INVALID_PREFIX;
+
+            err = _jit_compile(compiler, expr->prefix.right, fragment);
+            if (!err && expr->prefix.prefix == '-')
+                _jit_emit(fragment, JIT_OP_NEGATE);
+            return err;
+        case EXPRESSION_TYPE_OPERATOR:
+        {
+            jit_instruction_t* instruction;
+            switch (expr->operator.infix) {
+                case '+':
+                    _jit_compile_binary(compiler, expr->operator.left, expr->operator.right, fragment, JIT_OP_ADD, &err);
+                    return err;
+                case '-':
+                    _jit_compile_binary(compiler, expr->operator.left, expr->operator.right, fragment, JIT_OP_SUBTRACT, &err);
+                    return err;
+                case '*':
+                case '(':
+                    _jit_compile_binary(compiler, expr->operator.left, expr->operator.right, fragment, JIT_OP_MULTIPLY, &err);
+                    return err;
+                case '/':
+                    _jit_compile_binary(compiler, expr->operator.left, expr->operator.right, fragment, JIT_OP_DIVIDE, &err);
+                    return err;
+                case '^':
+                    instruction = _jit_compile_binary(compiler, expr->operator.left, expr->operator.right, fragment,
+                                                      JIT_OP_CALL2, &err);
+                    if (instruction)
+                        instruction->function.binary = pow;
+                    return err;
+                case '\\':
+                    instruction = _jit_compile_binary(compiler, expr->operator.left, expr->operator.right, fragment,
+                                                      JIT_OP_CALL2, &err);
+                    if (instruction)
+                        instruction->function.binary = _jit_root;
+                    return err;
+                default:
+                    /* assignments and comparisons don't have a numeric value */
+                    return ERROR_NOT_COMPILABLE;
+            }
+        }
+    }
+    return ERROR_NOT_COMPILABLE;
+}
+
+#if JIT_NATIVE
+
+/* Machine code being generated */
+typedef struct {
+    uint8_t* bytes;
+    size_t   size;
+    size_t   capacity;
+
+    /* RIP relative loads that need the address of a constant, they're patched once the code's size is known */
+    size_t*  fixups;
+    size_t*  fixup_offsets;
+    size_t   fixup_count;
+    size_t   fixup_capacity;
+} _jit_buffer_t;
+
+/* the registers used as memory operands */
+enum {
+    _JIT_RBX = 3,
+    _JIT_RBP = 5,
+};
+
+/* append bytes to the machine code
+ *
+ * @buffer the buffer
+ * @bytes the bytes
+ * @count the number of bytes
+ */
+void _jit_write(_jit_buffer_t* buffer, const uint8_t* bytes, size_t count) {
+    if (buffer->size + count > buffer->capacity) {
+        while (buffer->size + count > buffer->capacity)
+            buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        buffer->bytes = realloc(buffer->bytes, buffer->capacity);
+    }
+    memcpy(&buffer->bytes[buffer->size], bytes, count);
+    buffer->size += count;
+}
+
+/* append a 32 bit little endian integer
+ *
+ * @buffer the buffer
+ * @value the integer
+ */
+void _jit_write32(_jit_buffer_t* buffer, uint32_t value) {
+    uint8_t bytes[4] = { value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, (value >> 24) & 0xff };
+    _jit_write(buffer, bytes, 4);
+}
+
+/* append an SSE instruction on two registers
+ *
+ * @buffer the buffer
+ * @prefix the instruction's mandatory prefix
+ * @opcode the byte following 0x0F
+ * @reg the destination register
+ * @rm the source register
+ */
+void _jit_sse_register(_jit_buffer_t* buffer, uint8_t prefix, uint8_t opcode, size_t reg, size_t rm) {
+    uint8_t bytes[5];
+    size_t count = 0;
+
+    bytes[count++] = prefix;
+    if (reg >= 8 || rm >= 8)
+        bytes[count++] = 0x40 | ((reg >> 3) << 2) | (rm >> 3);
+    bytes[count++] = 0x0f;
+    bytes[count++] = opcode;
+    bytes[count++] = 0xc0 | ((reg & 7) << 3) | (rm & 7);
+    _jit_write(buffer, bytes, count);
+}
+
+/* append an SSE instruction on a register and memory at an offset from a general purpose register
+ *
+ * @buffer the buffer
+ * @prefix the instruction's mandatory prefix
+ * @opcode the byte following 0x0F
+ * @reg the register
+ * @base the general purpose register holding the address, it can't be RSP or R12
+ * @offset the offset from the address
+ */
+void _jit_sse_memory(_jit_buffer_t* buffer, uint8_t prefix, uint8_t opcode, size_t reg, size_t base, int32_t offset) {
+    uint8_t bytes[5];
+    size_t count = 0;
+
+    bytes[count++] = prefix;
+    if (reg >= 8)
+        bytes[count++] = 0x44;
+    bytes[count++] = 0x0f;
+    bytes[count++] = opcode;
+    bytes[count++] = 0x80 | ((reg & 7) << 3) | base;
+    _jit_write(buffer, bytes, count);
+    _jit_write32(buffer, (uint32_t)offset);
+}
+
+/* append an SSE instruction on a register and a value in the constant pool
+ *
+ * @buffer the buffer
+ * @prefix the instruction's mandatory prefix
+ * @opcode the byte following 0x0F
+ * @reg the register
+ * @offset the offset of the value from the start of the constant pool
+ */
+void _jit_sse_constant(_jit_buffer_t* buffer, uint8_t prefix, uint8_t opcode, size_t reg, size_t offset) {
+    uint8_t bytes[5];
+    size_t count = 0;
+
+    bytes[count++] = prefix;
+    if (reg >= 8)
+        bytes[count++] = 0x44;
+    bytes[count++] = 0x0f;
+    bytes[count++] = opcode;
+    bytes[count++] = ((reg & 7) << 3) | 5;
+    _jit_write(buffer, bytes, count);
+
+    if (buffer->fixup_count >= buffer->fixup_capacity) {
+        buffer->fixup_capacity = buffer->fixup_capacity ? buffer->fixup_capacity * 2 : 16;
+        buffer->fixups = realloc(buffer->fixups, buffer->fixup_capacity * sizeof(size_t));
+        buffer->fixup_offsets = realloc(buffer->fixup_offsets, buffer->fixup_capacity * sizeof(size_t));
+    }
+    buffer->fixups[buffer->fixup_count] = buffer->size;
+    buffer->fixup_offsets[buffer->fixup_count++] = offset;
+    _jit_write32(buffer, 0);
+}
+
+#define _JIT_MOVSD_LOAD  0x10
+#define _JIT_MOVSD_STORE 0x11
+#define _JIT_ADDSD       0x58
+#define _JIT_MULSD       0x59
+#define _JIT_SUBSD       0x5c
+#define _JIT_DIVSD       0x5e
+#define _JIT_XORPD       0x57
+
+/* the offset from RBP of the slot a stack register is saved in while a function is called */
+static inline int32_t _jit_home(size_t reg) {
+    return -16 - 8 * (int32_t)reg;
+}
+
+/* the offset from RBP of a local */
+static inline int32_t _jit_local(const jit_function_t* function, size_t index) {
+    return -16 - 8 * (int32_t)(function->depth + index);
+}
+
+/* call a C function, it's arguments must already be in xmm0 and xmm1
+ *
+ * @buffer the buffer
+ * @target the function's address
+ */
+void _jit_call(_jit_buffer_t* buffer, uintptr_t target) {
+    uint8_t bytes[10] = { 0x48, 0xb8 };
+    for (size_t i = 0; i < 8; ++i)
+        bytes[2 + i] = (target >> (8 * i)) & 0xff;
+    _jit_write(buffer, bytes, 10);
+
+    static const uint8_t call[] = { 0xff, 0xd0 };
+    _jit_write(buffer, call, sizeof(call));
+}
+
+/* translate a function's program to machine code
+ *
+ * The value at stack depth `d` is kept in XMM register `d`. Every SSE register is caller-saved,
+ * so values below a call's arguments are saved in the frame while the function is called.
+ *
+ * @function the function, it's program must fit in JIT_REGISTERS registers
+ * @buffer location to store the machine code
+ * @return returns false if the program couldn't be translated
+ */
+bool _jit_generate(const jit_function_t* function, _jit_buffer_t* buffer) {
+    /* a constant pool with the sign mask first, 16 byte aligned for xorpd */
+    double* constants = malloc((function->count + 2) * sizeof(double));
+    size_t constant_count = 2;
+    uint64_t sign = 0x8000000000000000ULL;
+    memcpy(&constants[0], &sign, sizeof(double));
+    constants[1] = 0;
+
+    /* the frame holds a saved register and a slot for each stack register and local, and keeps RSP 16 byte aligned */
+    uint32_t frame = 8 * (uint32_t)(function->depth + function->locals);
+    if (frame % 16 != 8)
+        frame += 8;
+
+    static const uint8_t prologue[] = {
+        0x55,                   /* push rbp */
+        0x48, 0x89, 0xe5,       /* mov rbp, rsp */
+        0x53,                   /* push rbx */
+        0x48, 0x81, 0xec,       /* sub rsp, imm32 */
+    };
+    static const uint8_t save_arguments[] = { 0x48, 0x89, 0xfb };  /* mov rbx, rdi */
+    _jit_write(buffer, prologue, sizeof(prologue));
+    _jit_write32(buffer, frame);
+    _jit_write(buffer, save_arguments, sizeof(save_arguments));
+
+    size_t depth = 0;
+    for (size_t i = 0; i < function->count; ++i) {
+        const jit_instruction_t* instruction = &function->code[i];
+        size_t left  = depth - 2;
+        size_t right = depth - 1;
+
+        switch (instruction->op) {
+            case JIT_OP_CONSTANT:
+                constants[constant_count] = instruction->value;
+                _jit_sse_constant(buffer, 0xf2, _JIT_MOVSD_LOAD, depth++, 8 * constant_count++);
+                break;
+            case JIT_OP_ARGUMENT:
+                _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_LOAD, depth++, _JIT_RBX, 8 * (int32_t)instruction->index);
+                break;
+            case JIT_OP_LOAD:
+                _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_LOAD, depth++, _JIT_RBP, _jit_local(function, instruction->index));
+                break;
+            case JIT_OP_STORE:
+                _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_STORE, --depth, _JIT_RBP, _jit_local(function, instruction->index));
+                break;
+            case JIT_OP_NEGATE:
+                _jit_sse_constant(buffer, 0x66, _JIT_XORPD, depth - 1, 0);
+                break;
+            case JIT_OP_ADD:
+            case JIT_OP_MULTIPLY:
+                _jit_sse_register(buffer, 0xf2, instruction->op == JIT_OP_ADD ? _JIT_ADDSD : _JIT_MULSD, left, right);
+                --depth;
+                break;
+            case JIT_OP_SUBTRACT:
+            case JIT_OP_DIVIDE:
+            {
+                uint8_t opcode = instruction->op == JIT_OP_SUBTRACT ? _JIT_SUBSD : _JIT_DIVSD;
+                if (instruction->swapped) {
+                    /* the left operand is on top, so the result is computed there and moved down */
+                    _jit_sse_register(buffer, 0xf2, opcode, right, left);
+                    _jit_sse_register(buffer, 0xf2, _JIT_MOVSD_LOAD, left, right);
+                } else {
+                    _jit_sse_register(buffer, 0xf2, opcode, left, right);
+                }
+                --depth;
+                break;
+            }
+            case JIT_OP_CALL1:
+                for (size_t reg = 0; reg < right; ++reg)
+                    _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_STORE, reg, _JIT_RBP, _jit_home(reg));
+                if (right != 0)
+                    _jit_sse_register(buffer, 0xf2, _JIT_MOVSD_LOAD, 0, right);
+                _jit_call(buffer, (uintptr_t)instruction->function.unary);
+                if (right != 0)
+                    _jit_sse_register(buffer, 0xf2, _JIT_MOVSD_LOAD, right, 0);
+                for (size_t reg = 0; reg < right; ++reg)
+                    _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_LOAD, reg, _JIT_RBP, _jit_home(reg));
+                break;
+            case JIT_OP_CALL2:
+                /* the arguments are passed through their slots, since they may be in each other's registers */
+                for (size_t reg = 0; reg < depth; ++reg)
+                    _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_STORE, reg, _JIT_RBP, _jit_home(reg));
+                _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_LOAD, 0, _JIT_RBP, _jit_home(instruction->swapped ? right : left));
+                _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_LOAD, 1, _JIT_RBP, _jit_home(instruction->swapped ? left : right));
+                _jit_call(buffer, (uintptr_t)instruction->function.binary);
+                if (left != 0)
+                    _jit_sse_register(buffer, 0xf2, _JIT_MOVSD_LOAD, left, 0);
+                for (size_t reg = 0; reg < left; ++reg)
+                    _jit_sse_memory(buffer, 0xf2, _JIT_MOVSD_LOAD, reg, _JIT_RBP, _jit_home(reg));
+                --depth;
+                break;
+        }
+    }
+
+    /* the result is in xmm0 */
+    static const uint8_t epilogue[] = {
+        0x48, 0x8b, 0x5d, 0xf8, /* mov rbx, [rbp - 8] */
+        0xc9,                   /* leave */
+        0xc3,                   /* ret */
+    };
+    _jit_write(buffer, epilogue, sizeof(epilogue));
+
+    static const uint8_t padding[16] = { 0 };
+    _jit_write(buffer, padding, (16 - buffer->size % 16) % 16);
+    size_t pool = buffer->size;
+    _jit_write(buffer, (uint8_t*)constants, constant_count * sizeof(double));
+    free(constants);
+
+    for (size_t i = 0; i < buffer->fixup_count; ++i) {
+        int32_t displacement = (int32_t)(pool + buffer->fixup_offsets[i] - (buffer->fixups[i] + 4));
+        memcpy(&buffer->bytes[buffer->fixups[i]], &displacement, 4);
+    }
+    return depth == 1;
+}
+
+/* translate a function's program to machine code, and map it into executable memory
+ *
+ * @function the function, it's left interpreted if it can't be translated
+ */
+void _jit_load(jit_function_t* function) {
+    if (function->depth > JIT_REGISTERS)
+        return;
+
+    _jit_buffer_t buffer = { NULL, 0, 0, NULL, NULL, 0, 0 };
+    bool generated = _jit_generate(function, &buffer);
+    free(buffer.fixups);
+    free(buffer.fixup_offsets);
+
+    if (generated) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t size = (buffer.size + page - 1) / page * page;
+        void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mapping != MAP_FAILED) {
+            memcpy(mapping, buffer.bytes, buffer.size);
+            if (mprotect(mapping, size, PROT_READ | PROT_EXEC) == 0) {
+                function->mapping      = mapping;
+                function->mapping_size = size;
+                function->native       = (jit_native_t)mapping;
+            } else {
+                munmap(mapping, size);
+            }
+        }
+    }
+    free(buffer.bytes);
+}
+
+#else
+
+void _jit_load(jit_function_t* function) {
+    (void)function;
+}
+
+#endif
+
+error_t jit_compile(jit_function_t* function, expression_t* expr, scope_t* scope, expression_list_t* parameters) {
+    _jit_compiler_t compiler = { scope, NULL, 0, 0, 0, 0 };
+    _jit_fragment_t program = { NULL, 0, 0, 0 };
+    expression_t* param;
+
+    function->code         = NULL;
+    function->count        = 0;
+    function->parameters   = 0;
+    function->locals       = 0;
+    function->depth        = 0;
+    function->native       = NULL;
+    function->mapping      = NULL;
+    function->mapping_size = 0;
+
+    if (parameters) {
+        EXPRESSION_LIST_FOREACH(param, parameters) {
+            if (!EXPRESSION_IS_VARIABLE(param)) {
+                free(compiler.bindings);
+                return ERROR_INVALID_IDENTIFIER;
+            }
+            _jit_bind(&compiler, param->variable.value, true, function->parameters++);
+        }
+    }
+
+    error_t err = _jit_compile(&compiler, expr, &program);
+    free(compiler.bindings);
+    if (err) {
+        free(program.code);
+        return err;
+    }
+
+    function->code   = program.code;
+    function->count  = program.count;
+    function->locals = compiler.locals;
+    function->depth  = program.depth;
+    _jit_load(function);
+    return ERROR_NO_ERROR;
+}
+
+error_t jit_compile_function(jit_function_t* function, scope_t* scope, char* name) {
+    variable_info_t* info;
+    error_t err = scope_get_variable_info(scope, name, &info);
+    if (err) return err;
+    if (!info->named_inputs)
+        return ERROR_IS_A_VARIABLE;
+    if (info->is_internal)
+        return ERROR_NOT_COMPILABLE;
+
+    return jit_compile(function, info->value.expression, scope, info->named_inputs);
+}
+
+void jit_clean(jit_function_t* function) {
+#if JIT_NATIVE
+    if (function->mapping)
+        munmap(function->mapping, function->mapping_size);
+#endif
+    free(function->code);
+    function->code    = NULL;
+    function->count   = 0;
+    function->native  = NULL;
+    function->mapping = NULL;
+}
+
+double jit_interpret(const jit_function_t* function, const double* arguments) {
+    double storage[64];
+    size_t size = function->depth + function->locals;
+    double* stack = size <= sizeof(storage) / sizeof(storage[0]) ? storage : malloc(size * sizeof(double));
+    double* locals = &stack[function->depth];
+    size_t depth = 0;
+
+    for (size_t i = 0; i < function->count; ++i) {
+        const jit_instruction_t* instruction = &function->code[i];
+        double left = 0, right = 0;
+
+        if (instruction->op >= JIT_OP_ADD && instruction->op != JIT_OP_CALL1) {
+            left  = stack[instruction->swapped ? depth - 1 : depth - 2];
+            right = stack[instruction->swapped ? depth - 2 : depth - 1];
+        }
+
+        switch (instruction->op) {
+            case JIT_OP_CONSTANT:
+                stack[depth++] = instruction->value;
+                break;
+            case JIT_OP_ARGUMENT:
+                stack[depth++] = arguments[instruction->index];
+                break;
+            case JIT_OP_LOAD:
+                stack[depth++] = locals[instruction->index];
+                break;
+            case JIT_OP_STORE:
+                locals[instruction->index] = stack[--depth];
+                break;
+            case JIT_OP_NEGATE:
+                stack[depth - 1] = -stack[depth - 1];
+                break;
+            case JIT_OP_ADD:
+                stack[--depth - 1] = left + right;
+                break;
+            case JIT_OP_SUBTRACT:
+                stack[--depth - 1] = left - right;
+                break;
+            case JIT_OP_MULTIPLY:
+                stack[--depth - 1] = left * right;
+                break;
+            case JIT_OP_DIVIDE:
+                stack[--depth - 1] = left / right;
+                break;
+            case JIT_OP_CALL1:
+                stack[depth - 1] = instruction->function.unary(stack[depth - 1]);
+                break;
+            case JIT_OP_CALL2:
+                stack[--depth - 1] = instruction->function.binary(left, right);
+                break;
+        }
+    }
+
+    double result = stack[0];
+    if (stack != storage)
+        free(stack);
+    return result;
+}
@@ -0,0 +1,141 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_JIT_H_
+#define SIMPLIFY_EXPRESSION_JIT_H_
+
+#include "simplify/expression/expression.h"
+
+/* the deepest user functions and variables are inlined, deeper expressions can't be compiled */
+#ifndef JIT_MAX_INLINE_DEPTH
+#   define JIT_MAX_INLINE_DEPTH 64
+#endif
+
+/* the number of SSE registers values are kept in, programs that need more are interpreted */
+#ifndef JIT_REGISTERS
+#   define JIT_REGISTERS 16
+#endif
+
+/* if true programs are compiled to machine code, otherwise they're always interpreted */
+#ifndef JIT_NATIVE
+#   if defined(__x86_64__) && defined(__unix__) && !defined(JIT_DISABLE_NATIVE)
+#       define JIT_NATIVE 1
+#   else
+#       define JIT_NATIVE 0
+#   endif
+#endif
+
+typedef struct jit_instruction jit_instruction_t;
+typedef struct jit_function jit_function_t;
+
+typedef double (*jit_unary_t)(double);
+typedef double (*jit_binary_t)(double, double);
+
+/* a compiled function's machine code, it's given the arguments and returns the result */
+typedef double (*jit_native_t)(const double*);
+
+/* The operations of a program on a stack of doubles */
+typedef enum {
+    JIT_OP_CONSTANT,  /* push `value` */
+    JIT_OP_ARGUMENT,  /* push the argument `index` */
+    JIT_OP_LOAD,      /* push the local `index` */
+    JIT_OP_STORE,     /* pop a value into the local `index` */
+    JIT_OP_NEGATE,    /* negate the top value */
+    JIT_OP_ADD,       /* pop two values, and push the result of the operation */
+    JIT_OP_SUBTRACT,
+    JIT_OP_MULTIPLY,
+    JIT_OP_DIVIDE,
+    JIT_OP_CALL1,     /* replace the top value with `function.unary` of it */
+    JIT_OP_CALL2,     /* pop two values and push `function.binary` of them */
+} jit_opcode_t;
+
+struct jit_instruction {
+    jit_opcode_t op;
+
+    /* for operations on two values, if true the right operand was pushed first */
+    bool         swapped;
+
+    size_t       index;
+    double       value;
+    union {
+        jit_unary_t  unary;
+        jit_binary_t binary;
+    } function;
+};
+
+/* A function compiled from an expression, it evaluates the expression with doubles instead of MPFR numbers.
+ *
+ * The expression may use numbers, arithmetic, the parameters it was compiled with, builtin functions and constants
+ * (see `jit_compile`), and variables and functions defined in the scope it was compiled in.
+ * Variables and user functions are inlined, so redefining them doesn't change a compiled function.
+ *
+ * An expression is first compiled to a program for a stack machine, ordered so the stack stays as shallow as possible.
+ * On x86-64 the program is then translated to machine code, with the stack held in SSE registers.
+ * Elsewhere, or if the program needs more than `JIT_REGISTERS` registers, the program is interpreted.
+ */
+struct jit_function {
+    jit_instruction_t* code;
+    size_t             count;
+
+    size_t             parameters;
+    size_t             locals;
+
+    /* the most values on the stack at once */
+    size_t             depth;
+
+    /* the program's machine code, or NULL if it's interpreted */
+    jit_native_t       native;
+    void*              mapping;
+    size_t             mapping_size;
+};
+
+/* compile an expression
+ *
+ * Builtin functions are recognized by name, if their name is defined as an internal function: the trigonometric and
+ * hyperbolic functions, ceil, floor, round, roundeven, trunc, frac, ln, log, min and max.
+ * Internal constants, like pi, are evaluated when the expression is compiled.
+ *
+ * @function location to store the compiled function, it must be cleaned with `jit_clean`
+ * @expr the expression to compile, it isn't changed
+ * @scope the scope variables and functions are found in
+ * @parameters the names of the function's arguments, they shadow definitions in `scope`. May be NULL.
+ * @return returns ERROR_NOT_COMPILABLE if the expression uses something that can't be compiled,
+ *          like an assignment, an impure definition, or an undefined name
+ */
+error_t jit_compile(jit_function_t* function, expression_t* expr, scope_t* scope, expression_list_t* parameters);
+
+/* compile a user function, it's arguments are it's parameters
+ *
+ * @function location to store the compiled function
+ * @scope the scope the function is defined in
+ * @name the function's name
+ * @return returns an error code, see `jit_compile`
+ */
+error_t jit_compile_function(jit_function_t* function, scope_t* scope, char* name);
+
+/* free a compiled function
+ *
+ * @function the function to clean
+ */
+void jit_clean(jit_function_t* function);
+
+/* evaluate a function's program without it's machine code
+ *
+ * @function the function
+ * @arguments the function's arguments, in the order of it's parameters
+ * @return returns the result
+ */
+double jit_interpret(const jit_function_t* function, const double* arguments);
+
+/* call a compiled function
+ *
+ * @function the function
+ * @arguments the function's arguments, in the order of it's parameters
+ * @return returns the result
+ */
+static inline double jit_call(const jit_function_t* function, const double* arguments) {
+    if (function->native)
+        return function->native(arguments);
+    return jit_interpret(function, arguments);
+}
+
+#endif  // SIMPLIFY_EXPRESSION_JIT_H_
@@ -0,0 +1,231 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/memo.h"
+
+/* free an entry and everything it holds
+ *
+ * @entry the entry to free
+ */
+void _expression_memo_entry_free(expression_memo_entry_t* entry) {
+    for (size_t i = 0; i < entry->dependency_count; ++i)
+        free(entry->dependencies[i].name);
+    free(entry->dependencies);
+    expression_clean(&entry->key);
+    expression_clean(&entry->value);
+    free(entry);
+}
+
+/* add a dependency to a frame, unless the frame already has a dependency with the same name
+ *
+ * @frame the frame to add to
+ * @name the dependency's name, it's copied
+ * @generation the generation of the definition that was found
+ */
+void _expression_memo_frame_add(expression_memo_frame_t* frame, char* name, unsigned long generation) {
+    for (size_t i = 0; i < frame->dependency_count; ++i) {
+        if (strcmp(frame->dependencies[i].name, name) == 0)
+            return;
+    }
+
+    if (frame->dependency_count >= frame->dependency_capacity) {
+        frame->dependency_capacity = frame->dependency_capacity ? frame->dependency_capacity * 2 : 4;
+        frame->dependencies = realloc(frame->dependencies,
+                                        frame->dependency_capacity * sizeof(expression_memo_dependency_t));
+    }
+
+    size_t length = strlen(name);
+    char* copy = malloc(length + 1);
+    memcpy(copy, name, length + 1);
+
+    frame->dependencies[frame->dependency_count].name       = copy;
+    frame->dependencies[frame->dependency_count].generation = generation;
+    ++frame->dependency_count;
+}
+
+/* the number of frames recording dependencies, in every memo */
+static size_t _g_expression_memo_recording;
+
+bool expression_memo_is_recording(void) {
+    return _g_expression_memo_recording > 0;
+}
+
+void expression_memo_init(expression_memo_t* memo, bool persistent) {
+    memset(memo->buckets, 0, sizeof(memo->buckets));
+    memo->entries        = 0;
+    memo->frames         = NULL;
+    memo->frame_count    = 0;
+    memo->frame_capacity = 0;
+    memo->persistent     = persistent;
+    memo->depth          = 0;
+    memo->hits           = 0;
+    memo->misses         = 0;
+}
+
+void expression_memo_clear(expression_memo_t* memo) {
+    for (size_t i = 0; i < EXPRESSION_MEMO_BUCKETS; ++i) {
+        expression_memo_entry_t* entry = memo->buckets[i];
+        while (entry) {
+            expression_memo_entry_t* next = entry->next;
+            _expression_memo_entry_free(entry);
+            entry = next;
+        }
+        memo->buckets[i] = NULL;
+    }
+    memo->entries = 0;
+}
+
+void expression_memo_clean(expression_memo_t* memo) {
+    expression_memo_clear(memo);
+    for (size_t i = 0; i < memo->frame_count; ++i) {
+        for (size_t j = 0; j < memo->frames[i].dependency_count; ++j)
+            free(memo->frames[i].dependencies[j].name);
+        free(memo->frames[i].dependencies);
+    }
+    _g_expression_memo_recording -= memo->frame_count;
+    free(memo->frames);
+    memo->frames         = NULL;
+    memo->frame_count    = 0;
+    memo->frame_capacity = 0;
+}
+
+/* check if an expression assigns a value somewhere
+ *
+ * @expr the expression to search
+ * @return returns true if there is an assignment in the expression
+ */
+bool _expression_has_assignment_recursive(expression_t* expr) {
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        case EXPRESSION_TYPE_VARIABLE:
+            return false;
+        case EXPRESSION_TYPE_PREFIX:
+            return _expression_has_assignment_recursive(expr->prefix.right);
+        case EXPRESSION_TYPE_OPERATOR:
+            return expr->operator.infix == ':'
+                || _expression_has_assignment_recursive(expr->operator.left)
+                || _expression_has_assignment_recursive(expr->operator.right);
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            expression_t* param;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                if (_expression_has_assignment_recursive(param))
+                    return true;
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+bool expression_memo_is_candidate(expression_t* expr) {
+    /* numbers, variables and prefixes are cheaper to evaluate than to look up */
+    if (!EXPRESSION_IS_OPERATOR(expr) && !EXPRESSION_IS_FUNCTION(expr))
+        return false;
+    return !_expression_has_assignment_recursive(expr);
+}
+
+/* check that none of an entry's dependencies have been redefined
+ *
+ * @entry the entry to check
+ * @scope the scope the memo belongs to
+ * @return returns true if the entry's value can be used
+ */
+bool _expression_memo_entry_valid(expression_memo_entry_t* entry, scope_t* scope) {
+    for (size_t i = 0; i < entry->dependency_count; ++i) {
+        variable_info_t* info;
+        error_t err = scope_get_variable_info(scope, entry->dependencies[i].name, &info);
+        unsigned long generation = err ? 0 : info->generation;
+        if (generation != entry->dependencies[i].generation)
+            return false;
+    }
+    return true;
+}
+
+bool expression_memo_lookup(expression_memo_t* memo, scope_t* scope, expression_t* expr, uint64_t hash, expression_t* result) {
+    const precision_policy_t* policy = scope_get_precision_policy(scope);
+    expression_memo_entry_t** link = &memo->buckets[hash & (EXPRESSION_MEMO_BUCKETS - 1)];
+
+    for (; *link; link = &(*link)->next) {
+        expression_memo_entry_t* entry = *link;
+        if (entry->hash != hash || !precision_policy_equal(&entry->policy, policy) ||
+                !expression_identical(&entry->key, expr))
+            continue;
+
+        if (!_expression_memo_entry_valid(entry, scope)) {
+            /* the result is stale, the caller will store a fresh one */
+            *link = entry->next;
+            _expression_memo_entry_free(entry);
+            --memo->entries;
+            break;
+        }
+
+        expression_copy(&entry->value, result);
+        ++memo->hits;
+        return true;
+    }
+
+    ++memo->misses;
+    return false;
+}
+
+void expression_memo_begin(expression_memo_t* memo) {
+    if (memo->frame_count >= memo->frame_capacity) {
+        memo->frame_capacity = memo->frame_capacity ? memo->frame_capacity * 2 : 8;
+        memo->frames = realloc(memo->frames, memo->frame_capacity * sizeof(expression_memo_frame_t));
+    }
+
+    expression_memo_frame_t* frame = &memo->frames[memo->frame_count++];
+    frame->dependencies        = NULL;
+    frame->dependency_count    = 0;
+    frame->dependency_capacity = 0;
+    frame->impure              = false;
+    ++_g_expression_memo_recording;
+}
+
+void expression_memo_end(expression_memo_t* memo, scope_t* scope, expression_t* key, uint64_t hash, expression_t* value) {
+    assert(memo->frame_count > 0);
+    expression_memo_frame_t frame = memo->frames[--memo->frame_count];
+    --_g_expression_memo_recording;
+
+    /* whatever this subexpression depends on, the subexpression around it depends on too */
+    if (memo->frame_count > 0) {
+        expression_memo_frame_t* parent = &memo->frames[memo->frame_count - 1];
+        parent->impure = parent->impure || frame.impure;
+        for (size_t i = 0; i < frame.dependency_count; ++i)
+            _expression_memo_frame_add(parent, frame.dependencies[i].name, frame.dependencies[i].generation);
+    }
+
+    if (!value || frame.impure) {
+        for (size_t i = 0; i < frame.dependency_count; ++i)
+            free(frame.dependencies[i].name);
+        free(frame.dependencies);
+        expression_clean(key);
+        return;
+    }
+
+    if (memo->entries >= EXPRESSION_MEMO_MAX_ENTRIES)
+        expression_memo_clear(memo);
+
+    expression_memo_entry_t* entry = malloc(sizeof(expression_memo_entry_t));
+    entry->hash             = hash;
+    entry->key              = *key;
+    entry->policy           = *scope_get_precision_policy(scope);
+    entry->dependencies     = frame.dependencies;
+    entry->dependency_count = frame.dependency_count;
+    expression_copy(value, &entry->value);
+
+    expression_memo_entry_t** bucket = &memo->buckets[hash & (EXPRESSION_MEMO_BUCKETS - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    ++memo->entries;
+}
+
+void expression_memo_record(expression_memo_t* memo, char* name, variable_info_t* info) {
+    if (memo->frame_count == 0)
+        return;
+
+    expression_memo_frame_t* frame = &memo->frames[memo->frame_count - 1];
+    if (info && info->impure)
+        frame->impure = true;
+    _expression_memo_frame_add(frame, name, info ? info->generation : 0);
+}
@@ -0,0 +1,171 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_MEMO_H_
+#define SIMPLIFY_EXPRESSION_MEMO_H_
+
+#include <stdint.h>
+
+#include "simplify/expression/expression.h"
+
+/* the number of buckets in a memo's hash table, must be a power of two */
+#ifndef EXPRESSION_MEMO_BUCKETS
+#   define EXPRESSION_MEMO_BUCKETS 256
+#endif
+
+/* the most results a memo will hold, once it's full every result is forgotten */
+#ifndef EXPRESSION_MEMO_MAX_ENTRIES
+#   define EXPRESSION_MEMO_MAX_ENTRIES 4096
+#endif
+
+/* A variable or function that an evaluated subexpression looked up,
+ * and the generation of the definition it found (zero if it wasn't defined).
+ */
+typedef struct expression_memo_dependency expression_memo_dependency_t;
+
+/* A subexpression, the result it evaluated to, and the definitions that result depends on */
+typedef struct expression_memo_entry expression_memo_entry_t;
+
+/* The dependencies collected while a single subexpression is evaluated */
+typedef struct expression_memo_frame expression_memo_frame_t;
+
+/* An evaluation memo remembers the results of subexpressions evaluated in a scope.
+ *
+ * Each result is keyed by the subexpression's structure and the scope's precision policy. The evaluator keys
+ * subexpressions by their canonical form (see canonical.h), so sums and products share results whatever the order of
+ * their operands.
+ * While a subexpression is evaluated every definition it looks up, directly or through another variable or function,
+ * is recorded with the definition's generation. A result is only reused if none of those definitions changed.
+ * Subexpressions that assign a value, or use an impure definition (see `scope_mark_impure`), are never stored.
+ *
+ * Memos are attached to a scope with `scope_set_memo`. Unless the memo is persistent
+ * it's cleared when the outermost `expression_evaluate` call on the scope returns.
+ */
+struct expression_memo_dependency {
+    char*         name;
+    unsigned long generation;
+};
+
+struct expression_memo_entry {
+    uint64_t           hash;
+    expression_t       key;
+    expression_t       value;
+    precision_policy_t policy;
+
+    expression_memo_dependency_t* dependencies;
+    size_t                        dependency_count;
+
+    expression_memo_entry_t* next;
+};
+
+struct expression_memo_frame {
+    expression_memo_dependency_t* dependencies;
+    size_t                        dependency_count;
+    size_t                        dependency_capacity;
+    bool                          impure;
+};
+
+struct expression_memo {
+    expression_memo_entry_t* buckets[EXPRESSION_MEMO_BUCKETS];
+    size_t                   entries;
+
+    expression_memo_frame_t* frames;
+    size_t                   frame_count;
+    size_t                   frame_capacity;
+
+    /* keep results between calls to `expression_evaluate` */
+    bool persistent;
+
+    /* the number of `expression_evaluate` calls that are using the memo */
+    size_t depth;
+
+    size_t hits;
+    size_t misses;
+};
+
+/* initialize a memo
+ *
+ * @memo the memo to initialize
+ * @persistent if true results are kept until a definition they depend on changes,
+ *      otherwise they're only kept for a single call to expression_evaluate
+ */
+void expression_memo_init(expression_memo_t* memo, bool persistent);
+
+/* free every result in the memo, without cleaning the memo
+ *
+ * @memo the memo to clear
+ */
+void expression_memo_clear(expression_memo_t* memo);
+
+/* free all resources used by the memo
+ *
+ * @memo the memo to clean
+ */
+void expression_memo_clean(expression_memo_t* memo);
+
+/* check if a subexpression's result can be stored in a memo
+ *
+ * @expr the unevaluated subexpression
+ * @return returns true if the result may be memoized
+ */
+bool expression_memo_is_candidate(expression_t* expr);
+
+/* find the result of a subexpression evaluated in the same scope and under the same precision policy
+ *
+ * @memo the memo to search
+ * @scope the scope the memo belongs to, it's used to check that the result's dependencies haven't changed
+ * @expr the unevaluated subexpression
+ * @hash the subexpression's hash
+ * @result location to store a copy of the result
+ * @return returns true if a result was found
+ */
+bool expression_memo_lookup(expression_memo_t* memo, scope_t* scope, expression_t* expr, uint64_t hash, expression_t* result);
+
+/* start recording the definitions used by a subexpression
+ *
+ * @memo the memo to record in
+ */
+void expression_memo_begin(expression_memo_t* memo);
+
+/* stop recording a subexpression's definitions, and store the result if it's pure.
+ * The dependencies are passed on to the subexpression that's being evaluated around this one.
+ *
+ * @memo the memo
+ * @scope the scope the memo belongs to
+ * @key the unevaluated subexpression, the memo takes ownership of it
+ * @hash the key's hash
+ * @value the evaluated subexpression, it's copied, or NULL if the evaluation failed
+ */
+void expression_memo_end(expression_memo_t* memo, scope_t* scope, expression_t* key, uint64_t hash, expression_t* value);
+
+/* record that the subexpression being evaluated looked up a definition
+ *
+ * @memo the memo to record in, nothing is done if it isn't recording
+ * @name the name that was looked up
+ * @info the definition that was found, or NULL if the name isn't defined
+ */
+void expression_memo_record(expression_memo_t* memo, char* name, variable_info_t* info);
+
+/* check if any memo is recording dependencies, if not lookups don't have to be recorded
+ *
+ * @return returns true if a memo is recording
+ */
+bool expression_memo_is_recording(void);
+
+/* note that expression_evaluate started using the memo
+ *
+ * @memo
+ */
+static inline void expression_memo_enter(expression_memo_t* memo) {
+    ++memo->depth;
+}
+
+/* note that expression_evaluate stopped using the memo, if it's the outermost call and the memo isn't persistent it's cleared
+ *
+ * @memo
+ */
+static inline void expression_memo_leave(expression_memo_t* memo) {
+    if (--memo->depth == 0 && !memo->persistent)
+        expression_memo_clear(memo);
+}
+
+#endif  // SIMPLIFY_EXPRESSION_MEMO_H_
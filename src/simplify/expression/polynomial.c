@@ -0,0 +1,526 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <limits.h>
+
+#include "simplify/expression/polynomial.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/canonical.h"
+
+/* the number of buckets a hash table starts with, must be a power of two */
+#define _POLYNOMIAL_INITIAL_BUCKETS 16
+
+/* An atom, and it's index in the atom table */
+typedef struct {
+    expression_t* atom;
+    size_t        index;
+} _polynomial_ranked_atom_t;
+
+/* A term, and it's factors in canonical order. Each factor's atom is replaced by the atom's rank */
+typedef struct {
+    polynomial_term_t*   term;
+    polynomial_factor_t* factors;
+} _polynomial_ranked_term_t;
+
+/* mix a value into a hash
+ *
+ * @hash the hash so far
+ * @value the value to mix
+ * @return returns the new hash
+ */
+static inline uint64_t _polynomial_mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+/* hash a list of factors
+ *
+ * @factors the factors, ordered by atom
+ * @count the number of factors
+ * @return returns the hash
+ */
+uint64_t _polynomial_factors_hash(polynomial_factor_t* factors, size_t count) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < count; ++i) {
+        hash = _polynomial_mix(hash, factors[i].atom);
+        hash = _polynomial_mix(hash, factors[i].exponent);
+    }
+    return hash;
+}
+
+/* check if two lists of factors are the same
+ *
+ * @factors1
+ * @count1
+ * @factors2
+ * @count2
+ * @return returns true if the lists have the same atoms, with the same exponents
+ */
+bool _polynomial_factors_equal(polynomial_factor_t* factors1, size_t count1,
+                               polynomial_factor_t* factors2, size_t count2) {
+    if (count1 != count2)
+        return false;
+    for (size_t i = 0; i < count1; ++i) {
+        if (factors1[i].atom != factors2[i].atom || factors1[i].exponent != factors2[i].exponent)
+            return false;
+    }
+    return true;
+}
+
+/* multiply two lists of factors
+ *
+ * @factors1
+ * @count1
+ * @factors2
+ * @count2
+ * @count set to the number of factors in the product
+ * @return returns a new list of factors, ordered by atom, or NULL if there aren't any
+ */
+polynomial_factor_t* _polynomial_factors_multiply(polynomial_factor_t* factors1, size_t count1,
+                                                  polynomial_factor_t* factors2, size_t count2, size_t* count) {
+    *count = 0;
+    if (count1 + count2 == 0)
+        return NULL;
+
+    polynomial_factor_t* product = malloc(sizeof(polynomial_factor_t) * (count1 + count2));
+    size_t i = 0, j = 0;
+    while (i < count1 || j < count2) {
+        if (j == count2 || (i < count1 && factors1[i].atom < factors2[j].atom)) {
+            product[(*count)++] = factors1[i++];
+        } else if (i == count1 || factors2[j].atom < factors1[i].atom) {
+            product[(*count)++] = factors2[j++];
+        } else {
+            product[*count] = factors1[i++];
+            product[(*count)++].exponent += factors2[j++].exponent;
+        }
+    }
+    return product;
+}
+
+/* rebuild a polynomial's hash table, with room for at least twice as many terms as it has
+ *
+ * @poly the polynomial
+ */
+void _polynomial_rehash(polynomial_t* poly) {
+    size_t bucket_count = poly->bucket_count ? poly->bucket_count : _POLYNOMIAL_INITIAL_BUCKETS;
+    while (bucket_count < poly->count * 2 + 2)
+        bucket_count *= 2;
+
+    free(poly->buckets);
+    poly->buckets = calloc(bucket_count, sizeof(size_t));
+    poly->bucket_count = bucket_count;
+
+    for (size_t i = 0; i < poly->count; ++i) {
+        size_t bucket = poly->terms[i].hash & (bucket_count - 1);
+        while (poly->buckets[bucket])
+            bucket = (bucket + 1) & (bucket_count - 1);
+        poly->buckets[bucket] = i + 1;
+    }
+}
+
+/* add a term to a polynomial, if the polynomial already has a term with the same factors the coefficients are added
+ *
+ * @poly the polynomial
+ * @factors the term's factors, ordered by atom, the polynomial takes ownership of them
+ * @count the number of factors
+ * @hash the factors' hash
+ * @coefficient the term's coefficient
+ */
+void _polynomial_insert(polynomial_t* poly, polynomial_factor_t* factors, size_t count, uint64_t hash,
+                        mpfr_srcptr coefficient) {
+    if ((poly->count + 1) * 2 > poly->bucket_count)
+        _polynomial_rehash(poly);
+
+    size_t bucket = hash & (poly->bucket_count - 1);
+    for (; poly->buckets[bucket]; bucket = (bucket + 1) & (poly->bucket_count - 1)) {
+        polynomial_term_t* term = &poly->terms[poly->buckets[bucket] - 1];
+        if (term->hash == hash && _polynomial_factors_equal(term->factors, term->count, factors, count)) {
+            mpfr_add(term->coefficient, term->coefficient, coefficient, MPFR_RNDN);
+            free(factors);
+            return;
+        }
+    }
+
+    if (poly->count == poly->capacity) {
+        poly->capacity = poly->capacity ? poly->capacity * 2 : 8;
+        poly->terms = realloc(poly->terms, sizeof(polynomial_term_t) * poly->capacity);
+    }
+
+    polynomial_term_t* term = &poly->terms[poly->count];
+    mpfr_init2(term->coefficient, poly->precision);
+    mpfr_set(term->coefficient, coefficient, MPFR_RNDN);
+    term->factors = factors;
+    term->count = count;
+    term->hash = hash;
+    poly->buckets[bucket] = ++poly->count;
+}
+
+/* copy a list of factors
+ *
+ * @factors the factors
+ * @count the number of factors
+ * @return returns a new list, or NULL if it's empty
+ */
+polynomial_factor_t* _polynomial_factors_copy(polynomial_factor_t* factors, size_t count) {
+    if (!count)
+        return NULL;
+    polynomial_factor_t* copy = malloc(sizeof(polynomial_factor_t) * count);
+    memcpy(copy, factors, sizeof(polynomial_factor_t) * count);
+    return copy;
+}
+
+void polynomial_atoms_init(polynomial_atoms_t* atoms) {
+    atoms->atoms = NULL;
+    atoms->hashes = NULL;
+    atoms->count = 0;
+    atoms->capacity = 0;
+    atoms->buckets = NULL;
+    atoms->bucket_count = 0;
+}
+
+void polynomial_atoms_clean(polynomial_atoms_t* atoms) {
+    free(atoms->atoms);
+    free(atoms->hashes);
+    free(atoms->buckets);
+    polynomial_atoms_init(atoms);
+}
+
+/* rebuild an atom table's hash table, with room for at least twice as many atoms as it has
+ *
+ * @atoms the table
+ */
+void _polynomial_atoms_rehash(polynomial_atoms_t* atoms) {
+    size_t bucket_count = atoms->bucket_count ? atoms->bucket_count : _POLYNOMIAL_INITIAL_BUCKETS;
+    while (bucket_count < atoms->count * 2 + 2)
+        bucket_count *= 2;
+
+    free(atoms->buckets);
+    atoms->buckets = calloc(bucket_count, sizeof(size_t));
+    atoms->bucket_count = bucket_count;
+
+    for (size_t i = 0; i < atoms->count; ++i) {
+        size_t bucket = atoms->hashes[i] & (bucket_count - 1);
+        while (atoms->buckets[bucket])
+            bucket = (bucket + 1) & (bucket_count - 1);
+        atoms->buckets[bucket] = i + 1;
+    }
+}
+
+size_t polynomial_atoms_intern(polynomial_atoms_t* atoms, expression_t* atom) {
+    if ((atoms->count + 1) * 2 > atoms->bucket_count)
+        _polynomial_atoms_rehash(atoms);
+
+    uint64_t hash = expression_hash(atom);
+    size_t bucket = hash & (atoms->bucket_count - 1);
+    for (; atoms->buckets[bucket]; bucket = (bucket + 1) & (atoms->bucket_count - 1)) {
+        size_t index = atoms->buckets[bucket] - 1;
+        if (atoms->hashes[index] == hash && expression_identical(atoms->atoms[index], atom))
+            return index;
+    }
+
+    if (atoms->count == atoms->capacity) {
+        atoms->capacity = atoms->capacity ? atoms->capacity * 2 : 8;
+        atoms->atoms = realloc(atoms->atoms, sizeof(expression_t*) * atoms->capacity);
+        atoms->hashes = realloc(atoms->hashes, sizeof(uint64_t) * atoms->capacity);
+    }
+
+    atoms->atoms[atoms->count] = atom;
+    atoms->hashes[atoms->count] = hash;
+    atoms->buckets[bucket] = ++atoms->count;
+    return atoms->count - 1;
+}
+
+void polynomial_atoms_truncate(polynomial_atoms_t* atoms, size_t count) {
+    if (count >= atoms->count)
+        return;
+    atoms->count = count;
+    _polynomial_atoms_rehash(atoms);
+}
+
+void polynomial_init(polynomial_t* poly, mpfr_prec_t precision) {
+    poly->terms = NULL;
+    poly->count = 0;
+    poly->capacity = 0;
+    poly->buckets = NULL;
+    poly->bucket_count = 0;
+    poly->precision = precision;
+}
+
+void polynomial_clean(polynomial_t* poly) {
+    for (size_t i = 0; i < poly->count; ++i) {
+        mpfr_clear(poly->terms[i].coefficient);
+        free(poly->terms[i].factors);
+    }
+    free(poly->terms);
+    free(poly->buckets);
+    polynomial_init(poly, poly->precision);
+}
+
+void polynomial_add_number(polynomial_t* poly, mpfr_srcptr number) {
+    _polynomial_insert(poly, NULL, 0, _polynomial_factors_hash(NULL, 0), number);
+}
+
+void polynomial_add_atom(polynomial_t* poly, size_t atom) {
+    polynomial_factor_t* factor = malloc(sizeof(polynomial_factor_t));
+    factor->atom = atom;
+    factor->exponent = 1;
+
+    mpfr_t one;
+    mpfr_init2(one, poly->precision);
+    mpfr_set_ui(one, 1, MPFR_RNDN);
+    _polynomial_insert(poly, factor, 1, _polynomial_factors_hash(factor, 1), one);
+    mpfr_clear(one);
+}
+
+void polynomial_add(polynomial_t* poly, polynomial_t* other) {
+    for (size_t i = 0; i < other->count; ++i) {
+        polynomial_term_t* term = &other->terms[i];
+        _polynomial_insert(poly, _polynomial_factors_copy(term->factors, term->count), term->count, term->hash,
+                           term->coefficient);
+    }
+}
+
+void polynomial_scale(polynomial_t* poly, mpfr_srcptr number) {
+    for (size_t i = 0; i < poly->count; ++i)
+        mpfr_mul(poly->terms[i].coefficient, poly->terms[i].coefficient, number, MPFR_RNDN);
+}
+
+error_t polynomial_multiply(polynomial_t* poly, polynomial_t* other) {
+    if (poly->count * other->count > POLYNOMIAL_MAX_TERMS)
+        return ERROR_POLYNOMIAL_TOO_LARGE;
+
+    error_t err = ERROR_NO_ERROR;
+    polynomial_t product;
+    mpfr_t coefficient;
+    polynomial_init(&product, poly->precision);
+    mpfr_init2(coefficient, poly->precision);
+
+    for (size_t i = 0; i < poly->count && !err; ++i) {
+        for (size_t j = 0; j < other->count; ++j) {
+            err = budget_step();
+            if (err) break;
+
+            polynomial_term_t* term1 = &poly->terms[i];
+            polynomial_term_t* term2 = &other->terms[j];
+            size_t count;
+            polynomial_factor_t* factors = _polynomial_factors_multiply(term1->factors, term1->count,
+                                                                        term2->factors, term2->count, &count);
+            mpfr_mul(coefficient, term1->coefficient, term2->coefficient, MPFR_RNDN);
+            _polynomial_insert(&product, factors, count, _polynomial_factors_hash(factors, count), coefficient);
+        }
+    }
+    mpfr_clear(coefficient);
+
+    if (err) {
+        polynomial_clean(&product);
+        return err;
+    }
+
+    polynomial_clean(poly);
+    *poly = product;
+    return ERROR_NO_ERROR;
+}
+
+error_t polynomial_power(polynomial_t* poly, unsigned long exponent) {
+    assert(exponent > 0 && exponent <= POLYNOMIAL_MAX_POWER);
+
+    /* a single term is raised by multiplying it's exponents */
+    if (poly->count == 1) {
+        polynomial_term_t* term = &poly->terms[0];
+        for (size_t i = 0; i < term->count; ++i) {
+            if (term->factors[i].exponent > ULONG_MAX / exponent)
+                return ERROR_POLYNOMIAL_TOO_LARGE;
+        }
+        for (size_t i = 0; i < term->count; ++i)
+            term->factors[i].exponent *= exponent;
+        /* the term's hash changed, so it's bucket has to be found again */
+        term->hash = _polynomial_factors_hash(term->factors, term->count);
+        _polynomial_rehash(poly);
+        mpfr_pow_ui(term->coefficient, term->coefficient, exponent, MPFR_RNDN);
+        return budget_step();
+    }
+
+    polynomial_t result;
+    polynomial_init(&result, poly->precision);
+    polynomial_add(&result, poly);
+
+    for (unsigned long i = 1; i < exponent; ++i) {
+        error_t err = polynomial_multiply(&result, poly);
+        if (err) {
+            polynomial_clean(&result);
+            return err;
+        }
+    }
+
+    polynomial_clean(poly);
+    *poly = result;
+    return ERROR_NO_ERROR;
+}
+
+bool polynomial_is_number(polynomial_t* poly, mpfr_ptr number) {
+    if (number)
+        mpfr_set_ui(number, 0, MPFR_RNDN);
+
+    for (size_t i = 0; i < poly->count; ++i) {
+        if (poly->terms[i].count && !mpfr_zero_p(poly->terms[i].coefficient))
+            return false;
+        if (number && !poly->terms[i].count)
+            mpfr_set(number, poly->terms[i].coefficient, MPFR_RNDN);
+    }
+    return true;
+}
+
+size_t polynomial_term_count(polynomial_t* poly) {
+    size_t count = 0;
+    for (size_t i = 0; i < poly->count; ++i) {
+        if (!mpfr_zero_p(poly->terms[i].coefficient))
+            ++count;
+    }
+    return count;
+}
+
+/* create a number expression
+ *
+ * @number the expression's value
+ * @precision the number's precision
+ * @return returns a new expression
+ */
+expression_t* _polynomial_new_number(mpfr_srcptr number, mpfr_prec_t precision) {
+    mpfr_ptr value = malloc(sizeof(mpfr_t));
+    mpfr_init2(value, precision);
+    mpfr_set(value, number, MPFR_RNDN);
+    return expression_new_number(value);
+}
+
+/* build an expression for a term
+ *
+ * @poly the polynomial the term belongs to
+ * @ranked the term, and it's ranked factors
+ * @order the atoms, by rank
+ * @negate if true the term's coefficient is negated
+ * @return returns a new expression
+ */
+expression_t* _polynomial_term_to_expression(polynomial_t* poly, _polynomial_ranked_term_t* ranked,
+                                             _polynomial_ranked_atom_t* order, bool negate) {
+    polynomial_term_t* term = ranked->term;
+    expression_t* product = NULL;
+
+    for (size_t i = 0; i < term->count; ++i) {
+        expression_t* factor = malloc(sizeof(expression_t));
+        expression_copy(order[ranked->factors[i].atom].atom, factor);
+        if (ranked->factors[i].exponent != 1)
+            factor = expression_new_operator(factor, '^', expression_new_number_si((long)ranked->factors[i].exponent));
+
+        product = product ? expression_new_operator(product, '*', factor) : factor;
+    }
+
+    mpfr_t coefficient;
+    mpfr_init2(coefficient, poly->precision);
+    if (negate)
+        mpfr_neg(coefficient, term->coefficient, MPFR_RNDN);
+    else
+        mpfr_set(coefficient, term->coefficient, MPFR_RNDN);
+
+    if (!product) {
+        product = _polynomial_new_number(coefficient, poly->precision);
+    } else if (mpfr_cmp_si(coefficient, -1) == 0) {
+        product = expression_new_prefix('-', product);
+    } else if (mpfr_cmp_ui(coefficient, 1) != 0) {
+        product = expression_new_operator(product, '*', _polynomial_new_number(coefficient, poly->precision));
+    }
+
+    mpfr_clear(coefficient);
+    return product;
+}
+
+/* order two atoms canonically, see expression_order
+ *
+ * @atom1 the first ranked atom
+ * @atom2 the second ranked atom
+ * @return returns the atoms' order
+ */
+int _polynomial_atom_compare(const void* atom1, const void* atom2) {
+    return expression_order(((const _polynomial_ranked_atom_t*)atom1)->atom,
+                            ((const _polynomial_ranked_atom_t*)atom2)->atom);
+}
+
+/* order two factors by rank
+ *
+ * @factor1
+ * @factor2
+ * @return returns a negative number if the first factor comes first, or a positive number if the second factor does
+ */
+int _polynomial_factor_compare(const void* factor1, const void* factor2) {
+    size_t atom1 = ((const polynomial_factor_t*)factor1)->atom;
+    size_t atom2 = ((const polynomial_factor_t*)factor2)->atom;
+    return atom1 < atom2 ? -1 : atom1 > atom2;
+}
+
+/* order two terms, by the rank of their atoms, higher powers first, with numbers last
+ *
+ * @term1 the first ranked term
+ * @term2 the second ranked term
+ * @return returns a negative number if the first term comes first, or a positive number if the second term does
+ */
+int _polynomial_term_compare(const void* term1, const void* term2) {
+    const _polynomial_ranked_term_t* t1 = term1;
+    const _polynomial_ranked_term_t* t2 = term2;
+    size_t count1 = t1->term->count;
+    size_t count2 = t2->term->count;
+
+    for (size_t i = 0; i < count1 && i < count2; ++i) {
+        if (t1->factors[i].atom != t2->factors[i].atom)
+            return t1->factors[i].atom < t2->factors[i].atom ? -1 : 1;
+        if (t1->factors[i].exponent != t2->factors[i].exponent)
+            return t1->factors[i].exponent > t2->factors[i].exponent ? -1 : 1;
+    }
+
+    if (count1 != count2)
+        return count1 > count2 ? -1 : 1;
+    return 0;
+}
+
+expression_t* polynomial_to_expression(polynomial_t* poly, polynomial_atoms_t* atoms) {
+    /* rank the atoms in canonical order, so the result doesn't depend on the order they were found in */
+    _polynomial_ranked_atom_t* order = malloc(sizeof(_polynomial_ranked_atom_t) * (atoms->count + 1));
+    size_t* ranks = malloc(sizeof(size_t) * (atoms->count + 1));
+    for (size_t i = 0; i < atoms->count; ++i)
+        order[i] = (_polynomial_ranked_atom_t){ atoms->atoms[i], i };
+    qsort(order, atoms->count, sizeof(_polynomial_ranked_atom_t), _polynomial_atom_compare);
+    for (size_t i = 0; i < atoms->count; ++i)
+        ranks[order[i].index] = i;
+
+    expression_t* sum = NULL;
+    _polynomial_ranked_term_t* terms = malloc(sizeof(_polynomial_ranked_term_t) * (poly->count + 1));
+    size_t count = 0;
+
+    for (size_t i = 0; i < poly->count; ++i) {
+        polynomial_term_t* term = &poly->terms[i];
+        if (mpfr_zero_p(term->coefficient))
+            continue;
+
+        polynomial_factor_t* factors = malloc(sizeof(polynomial_factor_t) * (term->count + 1));
+        for (size_t j = 0; j < term->count; ++j)
+            factors[j] = (polynomial_factor_t){ ranks[term->factors[j].atom], term->factors[j].exponent };
+        qsort(factors, term->count, sizeof(polynomial_factor_t), _polynomial_factor_compare);
+        terms[count++] = (_polynomial_ranked_term_t){ term, factors };
+    }
+    qsort(terms, count, sizeof(_polynomial_ranked_term_t), _polynomial_term_compare);
+
+    for (size_t i = 0; i < count; ++i) {
+        polynomial_term_t* term = terms[i].term;
+
+        if (!sum) {
+            sum = _polynomial_term_to_expression(poly, &terms[i], order, false);
+        } else if (mpfr_sgn(term->coefficient) < 0) {
+            sum = expression_new_operator(sum, '-', _polynomial_term_to_expression(poly, &terms[i], order, true));
+        } else {
+            sum = expression_new_operator(sum, '+', _polynomial_term_to_expression(poly, &terms[i], order, false));
+        }
+        free(terms[i].factors);
+    }
+
+    free(terms);
+    free(order);
+    free(ranks);
+    return sum ? sum : expression_new_number_si(0);
+}
@@ -0,0 +1,193 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_POLYNOMIAL_H_
+#define SIMPLIFY_EXPRESSION_POLYNOMIAL_H_
+
+#include <stdint.h>
+
+#include "simplify/expression/expression.h"
+
+/* the most terms a product or power may expand to, larger products are left unexpanded */
+#ifndef POLYNOMIAL_MAX_TERMS
+#   define POLYNOMIAL_MAX_TERMS 4096
+#endif
+
+/* the largest integer power that's expanded */
+#ifndef POLYNOMIAL_MAX_POWER
+#   define POLYNOMIAL_MAX_POWER 64
+#endif
+
+/* An atom raised to a positive integer power */
+typedef struct polynomial_factor polynomial_factor_t;
+
+/* A coefficient multiplied by a product of factors */
+typedef struct polynomial_term polynomial_term_t;
+
+/* The expressions polynomials are built from */
+typedef struct polynomial_atoms polynomial_atoms_t;
+
+/* A sparse multivariate polynomial */
+typedef struct polynomial polynomial_t;
+
+/* A polynomial is a sum of terms, each term is a number multiplied by a product of atoms raised to integer powers.
+ * An atom is any expression that isn't a sum, product or integer power: a variable, a function call, or something
+ * like `x ^ y`. Atoms are interned in an atom table shared by every polynomial built from the same expression,
+ * and identified by their index in the table, so atoms are compared once, when they're interned.
+ *
+ * Terms are sparse, a term only lists the atoms it uses, ordered by index.
+ * Each polynomial keeps a hash table of it's terms keyed by their factors,
+ * so adding or multiplying polynomials collects like terms in a single pass.
+ * When a polynomial is turned back into an expression it's terms are sorted, by their atoms in canonical order
+ * (see canonical.h), higher powers first, with the number last, so the result doesn't depend on the order the atoms
+ * were interned. Terms that cancelled out are dropped.
+ *
+ * Coefficients are mpfr numbers, with the polynomial's precision.
+ */
+struct polynomial_factor {
+    size_t        atom;
+    unsigned long exponent;
+};
+
+struct polynomial_term {
+    mpfr_t               coefficient;
+    polynomial_factor_t* factors;
+    size_t               count;
+    uint64_t             hash;
+};
+
+struct polynomial_atoms {
+    /* the atoms are borrowed, they must outlive the table */
+    expression_t** atoms;
+    uint64_t*      hashes;
+    size_t         count;
+    size_t         capacity;
+
+    /* open addressed, each bucket holds an atom's index plus one, or zero if it's empty */
+    size_t*        buckets;
+    size_t         bucket_count;
+};
+
+struct polynomial {
+    polynomial_term_t* terms;
+    size_t             count;
+    size_t             capacity;
+
+    /* open addressed, each bucket holds a term's index plus one, or zero if it's empty */
+    size_t*            buckets;
+    size_t             bucket_count;
+
+    mpfr_prec_t        precision;
+};
+
+/* initialize an empty atom table
+ *
+ * @atoms the table to initialize
+ */
+void polynomial_atoms_init(polynomial_atoms_t* atoms);
+
+/* free all memory used by an atom table, the atoms themselves aren't freed
+ *
+ * @atoms the table to clean
+ */
+void polynomial_atoms_clean(polynomial_atoms_t* atoms);
+
+/* find an atom in the table, adding it if there isn't an identical atom already (see `expression_identical`)
+ *
+ * @atoms the table
+ * @atom the atom, it's borrowed by the table
+ * @return returns the atom's index
+ */
+size_t polynomial_atoms_intern(polynomial_atoms_t* atoms, expression_t* atom);
+
+/* forget the atoms added after the first `count`, no polynomial may still use them
+ *
+ * @atoms the table
+ * @count the number of atoms to keep
+ */
+void polynomial_atoms_truncate(polynomial_atoms_t* atoms, size_t count);
+
+/* initialize a polynomial equal to zero
+ *
+ * @poly the polynomial to initialize
+ * @precision the precision of the polynomial's coefficients
+ */
+void polynomial_init(polynomial_t* poly, mpfr_prec_t precision);
+
+/* free all memory used by a polynomial
+ *
+ * @poly the polynomial to clean
+ */
+void polynomial_clean(polynomial_t* poly);
+
+/* add a number to a polynomial
+ *
+ * @poly the polynomial
+ * @number the number to add
+ */
+void polynomial_add_number(polynomial_t* poly, mpfr_srcptr number);
+
+/* add an atom, with a coefficient of one, to a polynomial
+ *
+ * @poly the polynomial
+ * @atom the atom's index in the atom table
+ */
+void polynomial_add_atom(polynomial_t* poly, size_t atom);
+
+/* add one polynomial to another
+ *
+ * @poly the polynomial to add to
+ * @other the polynomial to add, it's left unchanged
+ */
+void polynomial_add(polynomial_t* poly, polynomial_t* other);
+
+/* multiply each of a polynomial's coefficients by a number
+ *
+ * @poly the polynomial
+ * @number the number
+ */
+void polynomial_scale(polynomial_t* poly, mpfr_srcptr number);
+
+/* multiply one polynomial by another
+ *
+ * @poly the polynomial to multiply, it's only changed if the product was expanded
+ * @other the polynomial to multiply by, it's left unchanged
+ * @return returns ERROR_NO_ERROR, ERROR_BUDGET_EXCEEDED,
+ *          or ERROR_POLYNOMIAL_TOO_LARGE if the product would have more than POLYNOMIAL_MAX_TERMS terms
+ */
+error_t polynomial_multiply(polynomial_t* poly, polynomial_t* other);
+
+/* raise a polynomial to a positive integer power
+ *
+ * @poly the polynomial, it's only changed if the power was expanded
+ * @exponent the power, at most POLYNOMIAL_MAX_POWER
+ * @return returns ERROR_NO_ERROR, ERROR_BUDGET_EXCEEDED,
+ *          or ERROR_POLYNOMIAL_TOO_LARGE if the power would have more than POLYNOMIAL_MAX_TERMS terms
+ */
+error_t polynomial_power(polynomial_t* poly, unsigned long exponent);
+
+/* check if a polynomial is a number, and get the number
+ *
+ * @poly the polynomial
+ * @number set to the number if it's not NULL and the polynomial is a number, it must be initialized
+ * @return returns true if the polynomial doesn't use any atoms
+ */
+bool polynomial_is_number(polynomial_t* poly, mpfr_ptr number);
+
+/* get the number of terms in a polynomial that don't cancel out
+ *
+ * @poly the polynomial
+ * @return returns the number of terms with a non-zero coefficient
+ */
+size_t polynomial_term_count(polynomial_t* poly);
+
+/* build an expression equal to a polynomial.
+ * Each term is written as it's factors followed by it's coefficient, e.g. `x ^ 2 * y * 3`,
+ * terms with a negative coefficient are subtracted.
+ *
+ * @poly the polynomial
+ * @atoms the atom table the polynomial was built with, each atom used is copied
+ * @return returns a new expression
+ */
+expression_t* polynomial_to_expression(polynomial_t* poly, polynomial_atoms_t* atoms);
+
+#endif  // SIMPLIFY_EXPRESSION_POLYNOMIAL_H_
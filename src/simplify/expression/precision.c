@@ -0,0 +1,29 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <stdlib.h>
+
+#include "simplify/expression/precision.h"
+
+mpfr_prec_t precision_policy_result(const precision_policy_t* policy, mpfr_prec_t operand1, mpfr_prec_t operand2) {
+    mpfr_prec_t minimum = precision_policy_minimum(policy);
+    mpfr_prec_t maximum = precision_policy_maximum(policy);
+    mpfr_prec_t widest  = operand1 > operand2 ? operand1 : operand2;
+
+    if (widest < minimum)
+        return minimum;
+    if (widest > maximum)
+        return maximum;
+    return widest;
+}
+
+void precision_policy_trim(const precision_policy_t* policy, mpfr_ptr number) {
+    mpfr_prec_t maximum = precision_policy_maximum(policy);
+    if (mpfr_get_prec(number) > maximum)
+        mpfr_prec_round(number, maximum, precision_policy_exact_round(policy));
+}
+
+mpfr_ptr precision_policy_new_number(const precision_policy_t* policy, mpfr_prec_t operand1, mpfr_prec_t operand2) {
+    mpfr_ptr number = malloc(sizeof(mpfr_t));
+    mpfr_init2(number, precision_policy_result(policy, operand1, operand2));
+    return number;
+}
@@ -0,0 +1,142 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_PRECISION_H_
+#define SIMPLIFY_EXPRESSION_PRECISION_H_
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <gmp.h>
+#include <mpfr.h>
+
+/* the number of bits added to the precision needed to hold a number of decimal digits,
+    so rounding errors don't reach the digits that are printed */
+#ifndef PRECISION_GUARD_BITS
+#   define PRECISION_GUARD_BITS 16
+#endif
+
+/* A precision policy decides how many bits each number produced while evaluating an expression gets.
+ *
+ * The result of an operation carries the precision of it's widest operand,
+ * but never less than `minimum` bits or more than `maximum` bits.
+ * Numbers that are wider than `maximum` (long literals, or values computed under a different policy)
+ * are trimmed to `maximum` bits as soon as the evaluator reads them.
+ *
+ * A zero `minimum` means MPFR's default precision, a zero `maximum` means the same as `minimum`,
+ * so a zeroed policy computes everything at MPFR's default precision.
+ */
+typedef struct precision_policy precision_policy_t;
+
+struct precision_policy {
+    mpfr_prec_t minimum;
+    mpfr_prec_t maximum;
+
+    /* the rounding mode used for every operation, builtin functions and constants round to nearest if it is MPFR_RNDF */
+    mpfr_rnd_t round;
+
+    /* the number of significant digits results should be printed with, or zero to print every digit */
+    size_t digits;
+
+    /* if true every number computed carries bounds on it's exact value, see expression_evaluate_adaptive */
+    bool bounds;
+};
+
+/* initialize a precision policy, so every result has MPFR's default precision
+ *
+ * @policy the policy to initialize
+ */
+static inline void precision_policy_init(precision_policy_t* policy) {
+    policy->minimum = 0;
+    policy->maximum = 0;
+    policy->round   = MPFR_RNDF;
+    policy->digits  = 0;
+    policy->bounds  = false;
+}
+
+/* make every result exactly `bits` wide
+ *
+ * @policy the policy to modify
+ * @bits the precision in bits
+ */
+static inline void precision_policy_set_fixed(precision_policy_t* policy, mpfr_prec_t bits) {
+    policy->minimum = bits;
+    policy->maximum = bits;
+}
+
+/* get the number of bits needed to hold `digits` decimal digits
+ *
+ * @digits the number of decimal digits
+ * @return returns the number of bits
+ */
+static inline mpfr_prec_t precision_for_digits(size_t digits) {
+    return (mpfr_prec_t)ceil(digits * log(10) / log(2));
+}
+
+/* get the least precision a result may have under `policy`
+ *
+ * @policy
+ * @return returns a precision in bits
+ */
+static inline mpfr_prec_t precision_policy_minimum(const precision_policy_t* policy) {
+    return policy->minimum ? policy->minimum : mpfr_get_default_prec();
+}
+
+/* get the greatest precision a number may have under `policy`
+ *
+ * @policy
+ * @return returns a precision in bits
+ */
+static inline mpfr_prec_t precision_policy_maximum(const precision_policy_t* policy) {
+    mpfr_prec_t minimum = precision_policy_minimum(policy);
+    return policy->maximum > minimum ? policy->maximum : minimum;
+}
+
+/* get the rounding mode for operations that can't use faithful rounding, like transcendental functions and constants.
+ *
+ * @policy
+ * @return returns the policy's rounding mode, or MPFR_RNDN if it's MPFR_RNDF
+ */
+static inline mpfr_rnd_t precision_policy_exact_round(const precision_policy_t* policy) {
+    return policy->round == MPFR_RNDF ? MPFR_RNDN : policy->round;
+}
+
+/* check if two precision policies produce the same numbers
+ *
+ * @policy1
+ * @policy2
+ * @return returns true if the policies are the same
+ */
+static inline bool precision_policy_equal(const precision_policy_t* policy1, const precision_policy_t* policy2) {
+    return precision_policy_minimum(policy1) == precision_policy_minimum(policy2)
+        && precision_policy_maximum(policy1) == precision_policy_maximum(policy2)
+        && policy1->round == policy2->round
+        && policy1->bounds == policy2->bounds;
+}
+
+/* get the precision of a result computed from two operands
+ *
+ * @policy the policy to apply
+ * @operand1 the precision of the first operand, or zero if there is none
+ * @operand2 the precision of the second operand, or zero if there is none
+ * @return returns the result's precision in bits
+ */
+mpfr_prec_t precision_policy_result(const precision_policy_t* policy, mpfr_prec_t operand1, mpfr_prec_t operand2);
+
+/* round `number` to the policy's maximum precision, if it's wider than the policy allows
+ *
+ * @policy the policy to apply
+ * @number the number to trim
+ */
+void precision_policy_trim(const precision_policy_t* policy, mpfr_ptr number);
+
+/* allocate and initialize a number for the result of an operation
+ *
+ * @policy the policy to apply
+ * @operand1 the precision of the first operand, or zero if there is none
+ * @operand2 the precision of the second operand, or zero if there is none
+ * @return returns a new number, it should be cleared and freed by the caller
+ */
+mpfr_ptr precision_policy_new_number(const precision_policy_t* policy, mpfr_prec_t operand1, mpfr_prec_t operand2);
+
+#endif  // SIMPLIFY_EXPRESSION_PRECISION_H_
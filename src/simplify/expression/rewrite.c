@@ -0,0 +1,812 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/rewrite.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/chain.h"
+#include "simplify/parser.h"
+
+/* the number of buckets the edge table starts with, must be a power of two */
+#define _REWRITE_INITIAL_BUCKETS 64
+
+/* The state of a search for the rules that match an expression */
+typedef struct {
+    rewrite_rules_t* rules;
+
+    /* the subexpressions that still have to be matched, the last one is matched next */
+    expression_t**   pending;
+    size_t           pending_count;
+
+    /* the subexpressions matched by each wildcard followed so far */
+    expression_t**   wildcards;
+    size_t           wildcard_count;
+
+    /* the first rule that matched, or rule_count if none did, and the expressions it's variables matched */
+    size_t           best;
+    expression_t*    bindings[REWRITE_MAX_VARIABLES];
+} _rewrite_match_t;
+
+/* mix a value into a hash
+ *
+ * @hash the hash so far
+ * @value the value to mix
+ * @return returns the new hash
+ */
+static inline uint64_t _rewrite_mix(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+/* count the expressions in a tree
+ *
+ * @expr the tree's root
+ * @return returns the number of expressions
+ */
+size_t _rewrite_size(expression_t* expr) {
+    size_t size = 1;
+    expression_t* param;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        case EXPRESSION_TYPE_VARIABLE:
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                size += _rewrite_size(param);
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            size += _rewrite_size(expr->prefix.right);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            size += _rewrite_size(expr->operator.left) + _rewrite_size(expr->operator.right);
+            break;
+    }
+    return size;
+}
+
+/* get the number of arguments a function call has
+ *
+ * @expr the function call
+ * @return returns the number of arguments, or SIZE_MAX if an argument is missing
+ */
+size_t _rewrite_arity(expression_t* expr) {
+    size_t arity = 0;
+    for (expression_list_t* param = expr->function.parameters; param; param = param->next) {
+        if (!param->value)
+            return SIZE_MAX;
+        ++arity;
+    }
+    return arity;
+}
+
+/* hash the part of an expression an edge is labeled with
+ *
+ * @label the expression, it can't be a variable
+ * @return returns the hash
+ */
+uint64_t _rewrite_label_hash(expression_t* label) {
+    uint64_t hash = _rewrite_mix(0xcbf29ce484222325ULL, label->type);
+
+    switch (label->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        {
+            /* zero and negative zero are equal, so they must hash the same */
+            double value = mpfr_nan_p(label->number.value) || mpfr_zero_p(label->number.value)
+                ? 0 : mpfr_get_d(label->number.value, MPFR_RNDN);
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return _rewrite_mix(hash, bits);
+        }
+        case EXPRESSION_TYPE_FUNCTION:
+            for (char* c = label->function.name; *c; ++c)
+                hash = _rewrite_mix(hash, (unsigned char)*c);
+            return _rewrite_mix(hash, _rewrite_arity(label));
+        case EXPRESSION_TYPE_PREFIX:
+        case EXPRESSION_TYPE_OPERATOR:
+            return _rewrite_mix(hash, (unsigned char)EXPRESSION_OPERATOR(label));
+        case EXPRESSION_TYPE_VARIABLE:
+            break;
+    }
+    return hash;
+}
+
+/* check if two expressions would be labeled the same
+ *
+ * @label1
+ * @label2
+ * @return returns true if the expressions have the same type, and the same operator, name and argument count or value
+ */
+bool _rewrite_label_equal(expression_t* label1, expression_t* label2) {
+    if (label1->type != label2->type)
+        return false;
+
+    switch (label1->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            return mpfr_equal_p(label1->number.value, label2->number.value);
+        case EXPRESSION_TYPE_FUNCTION:
+            return strcmp(label1->function.name, label2->function.name) == 0
+                && _rewrite_arity(label1) == _rewrite_arity(label2);
+        case EXPRESSION_TYPE_PREFIX:
+        case EXPRESSION_TYPE_OPERATOR:
+            return EXPRESSION_OPERATOR(label1) == EXPRESSION_OPERATOR(label2);
+        case EXPRESSION_TYPE_VARIABLE:
+            break;
+    }
+    return false;
+}
+
+/* find the child a node's edge labeled with an expression leads to
+ *
+ * @rules
+ * @parent the parent node
+ * @label the expression
+ * @hash the hash of the parent and the label
+ * @bucket set to the bucket the edge is in, or the empty bucket it would be in
+ * @return returns the child's index plus one, or zero if there's no edge
+ */
+size_t _rewrite_find_edge(rewrite_rules_t* rules, size_t parent, expression_t* label, uint64_t hash, size_t* bucket) {
+    size_t index = hash & (rules->bucket_count - 1);
+    for (; rules->buckets[index]; index = (index + 1) & (rules->bucket_count - 1)) {
+        rewrite_edge_t* edge = &rules->edges[rules->buckets[index] - 1];
+        if (edge->hash == hash && edge->parent == parent && _rewrite_label_equal(edge->label, label)) {
+            *bucket = index;
+            return edge->child + 1;
+        }
+    }
+    *bucket = index;
+    return 0;
+}
+
+/* add a node to the discrimination tree
+ *
+ * @rules
+ * @return returns the new node's index
+ */
+size_t _rewrite_new_node(rewrite_rules_t* rules) {
+    rules->nodes = realloc(rules->nodes, sizeof(rewrite_node_t) * (rules->node_count + 1));
+    rewrite_node_t* node = &rules->nodes[rules->node_count];
+    node->wildcard = 0;
+    node->leaves = NULL;
+    node->leaf_count = 0;
+    return rules->node_count++;
+}
+
+/* follow, or create, the edge from a node that's labeled with an expression
+ *
+ * @rules
+ * @parent the parent node
+ * @label the expression, it's borrowed by the edge
+ * @return returns the child node
+ */
+size_t _rewrite_add_edge(rewrite_rules_t* rules, size_t parent, expression_t* label) {
+    if ((rules->edge_count + 1) * 2 > rules->bucket_count) {
+        size_t bucket_count = rules->bucket_count ? rules->bucket_count * 2 : _REWRITE_INITIAL_BUCKETS;
+        free(rules->buckets);
+        rules->buckets = calloc(bucket_count, sizeof(size_t));
+        rules->bucket_count = bucket_count;
+
+        for (size_t i = 0; i < rules->edge_count; ++i) {
+            size_t bucket = rules->edges[i].hash & (bucket_count - 1);
+            while (rules->buckets[bucket])
+                bucket = (bucket + 1) & (bucket_count - 1);
+            rules->buckets[bucket] = i + 1;
+        }
+    }
+
+    uint64_t hash = _rewrite_mix(_rewrite_label_hash(label), parent);
+    size_t bucket;
+    size_t child = _rewrite_find_edge(rules, parent, label, hash, &bucket);
+    if (child)
+        return child - 1;
+
+    child = _rewrite_new_node(rules);
+    rules->edges = realloc(rules->edges, sizeof(rewrite_edge_t) * (rules->edge_count + 1));
+    rules->edges[rules->edge_count] = (rewrite_edge_t){ parent, child, hash, label };
+    rules->buckets[bucket] = ++rules->edge_count;
+    return child;
+}
+
+size_t rewrite_rule_variable(rewrite_rule_t* rule, char* name) {
+    size_t i = 0;
+    for (; i < rule->variable_count; ++i) {
+        if (strcmp(rule->variables[i], name) == 0)
+            break;
+    }
+    return i;
+}
+
+/* add the path for a pattern to the discrimination tree, starting at a node
+ *
+ * @rules
+ * @rule the rule the pattern belongs to
+ * @expr the part of the pattern to add
+ * @node the node to start from, set to the node the path ends at
+ * @wildcards set to the index of each variable on the path
+ * @wildcard_count the number of variables on the path so far
+ */
+void _rewrite_add_path(rewrite_rules_t* rules, rewrite_rule_t* rule, expression_t* expr,
+                       size_t* node, size_t* wildcards, size_t* wildcard_count) {
+    expression_t* param;
+
+    if (EXPRESSION_IS_VARIABLE(expr)) {
+        if (!rules->nodes[*node].wildcard) {
+            size_t child = _rewrite_new_node(rules);
+            rules->nodes[*node].wildcard = child + 1;
+        }
+        *node = rules->nodes[*node].wildcard - 1;
+        wildcards[(*wildcard_count)++] = rewrite_rule_variable(rule, expr->variable.value);
+        return;
+    }
+
+    *node = _rewrite_add_edge(rules, *node, expr);
+    switch (expr->type) {
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                _rewrite_add_path(rules, rule, param, node, wildcards, wildcard_count);
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            _rewrite_add_path(rules, rule, expr->prefix.right, node, wildcards, wildcard_count);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            _rewrite_add_path(rules, rule, expr->operator.left, node, wildcards, wildcard_count);
+            _rewrite_add_path(rules, rule, expr->operator.right, node, wildcards, wildcard_count);
+            break;
+        default:
+            break;
+    }
+}
+
+/* collect the variables a pattern uses
+ *
+ * @rule the rule, it's variables are added to
+ * @expr the part of the pattern to search
+ * @return returns ERROR_INVALID_REWRITE_RULE if the pattern has too many variables
+ */
+error_t _rewrite_collect_variables(rewrite_rule_t* rule, expression_t* expr) {
+    error_t err = ERROR_NO_ERROR;
+    expression_t* param;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_VARIABLE:
+            if (rewrite_rule_variable(rule, expr->variable.value) < rule->variable_count)
+                break;
+            if (rule->variable_count == REWRITE_MAX_VARIABLES)
+                return ERROR_INVALID_REWRITE_RULE;
+            rule->variables[rule->variable_count++] = expr->variable.value;
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            if (_rewrite_arity(expr) == SIZE_MAX)
+                return ERROR_INVALID_REWRITE_RULE;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                err = _rewrite_collect_variables(rule, param);
+                if (err) return err;
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            return _rewrite_collect_variables(rule, expr->prefix.right);
+        case EXPRESSION_TYPE_OPERATOR:
+            err = _rewrite_collect_variables(rule, expr->operator.left);
+            if (err) return err;
+            return _rewrite_collect_variables(rule, expr->operator.right);
+        case EXPRESSION_TYPE_NUMBER:
+            break;
+    }
+    return err;
+}
+
+/* collect the sums and products in a pattern, in prefix order
+ *
+ * @expr the part of the pattern to search
+ * @found set to the sums and products found
+ * @count the number found so far, at most REWRITE_MAX_COMMUTATIVE are collected
+ */
+void _rewrite_collect_commutative(expression_t* expr, expression_t** found, size_t* count) {
+    expression_t* param;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                _rewrite_collect_commutative(param, found, count);
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            _rewrite_collect_commutative(expr->prefix.right, found, count);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            if ((expr->operator.infix == '+' || expr->operator.infix == '*') && *count < REWRITE_MAX_COMMUTATIVE)
+                found[(*count)++] = expr;
+            _rewrite_collect_commutative(expr->operator.left, found, count);
+            _rewrite_collect_commutative(expr->operator.right, found, count);
+            break;
+        default:
+            break;
+    }
+}
+
+/* make a copy of a rule's pattern for each way the operands of it's sums and products can be ordered
+ *
+ * @rule the rule
+ */
+void _rewrite_make_variants(rewrite_rule_t* rule) {
+    expression_t* found[REWRITE_MAX_COMMUTATIVE];
+    size_t count = 0;
+    _rewrite_collect_commutative(&rule->pattern, found, &count);
+
+    rule->variants = malloc(sizeof(expression_t*) << count);
+    rule->variant_count = 0;
+
+    for (size_t mask = 0; mask < ((size_t)1 << count); ++mask) {
+        expression_t* variant = malloc(sizeof(expression_t));
+        expression_copy(&rule->pattern, variant);
+
+        size_t swapped_count = 0;
+        expression_t* swapped[REWRITE_MAX_COMMUTATIVE];
+        _rewrite_collect_commutative(variant, swapped, &swapped_count);
+
+        /* swap from the bottom up, so the nodes found stay where they were found */
+        for (size_t i = count; i-- > 0;) {
+            if (mask & ((size_t)1 << i))
+                expression_swap(swapped[i]);
+        }
+
+        bool duplicate = false;
+        for (size_t i = 0; i < rule->variant_count && !duplicate; ++i)
+            duplicate = expression_identical(rule->variants[i], variant);
+
+        if (duplicate) {
+            expression_free(variant);
+        } else {
+            rule->variants[rule->variant_count++] = variant;
+        }
+    }
+}
+
+void rewrite_rules_init(rewrite_rules_t* rules) {
+    rules->rules = NULL;
+    rules->rule_count = 0;
+    rules->nodes = NULL;
+    rules->node_count = 0;
+    rules->edges = NULL;
+    rules->edge_count = 0;
+    rules->buckets = NULL;
+    rules->bucket_count = 0;
+    rules->longest = 1;
+    rules->rewrites = 0;
+}
+
+void rewrite_rules_clean(rewrite_rules_t* rules) {
+    for (size_t i = 0; i < rules->rule_count; ++i) {
+        rewrite_rule_t* rule = rules->rules[i];
+        for (size_t j = 0; j < rule->variant_count; ++j)
+            expression_free(rule->variants[j]);
+        free(rule->variants);
+        expression_clean(&rule->pattern);
+        expression_clean(&rule->replacement);
+        free(rule);
+    }
+    for (size_t i = 0; i < rules->node_count; ++i) {
+        for (size_t j = 0; j < rules->nodes[i].leaf_count; ++j)
+            free(rules->nodes[i].leaves[j].wildcards);
+        free(rules->nodes[i].leaves);
+    }
+    free(rules->rules);
+    free(rules->nodes);
+    free(rules->edges);
+    free(rules->buckets);
+    rewrite_rules_init(rules);
+}
+
+error_t rewrite_rules_add(rewrite_rules_t* rules, expression_t* rule) {
+    if (!EXPRESSION_IS_OPERATOR(rule)
+            || rule->operator.infix != '='
+            || EXPRESSION_IS_VARIABLE(rule->operator.left))
+        return ERROR_INVALID_REWRITE_RULE;
+
+    rewrite_rule_t* added = malloc(sizeof(rewrite_rule_t));
+    added->variable_count = 0;
+    expression_copy(rule->operator.left, &added->pattern);
+    expression_copy(rule->operator.right, &added->replacement);
+
+    error_t err = _rewrite_collect_variables(added, &added->pattern);
+    if (err) {
+        expression_clean(&added->pattern);
+        expression_clean(&added->replacement);
+        free(added);
+        return err;
+    }
+
+    if (!rules->node_count)
+        _rewrite_new_node(rules);
+
+    rules->rules = realloc(rules->rules, sizeof(rewrite_rule_t*) * (rules->rule_count + 1));
+    rules->rules[rules->rule_count] = added;
+
+    _rewrite_make_variants(added);
+    for (size_t i = 0; i < added->variant_count; ++i) {
+        size_t node = 0;
+        size_t wildcard_count = 0;
+        size_t* wildcards = malloc(sizeof(size_t) * _rewrite_size(added->variants[i]));
+        _rewrite_add_path(rules, added, added->variants[i], &node, wildcards, &wildcard_count);
+
+        rewrite_node_t* leaf_node = &rules->nodes[node];
+        leaf_node->leaves = realloc(leaf_node->leaves, sizeof(rewrite_leaf_t) * (leaf_node->leaf_count + 1));
+        leaf_node->leaves[leaf_node->leaf_count++] = (rewrite_leaf_t){ rules->rule_count, wildcards };
+    }
+
+    size_t size = _rewrite_size(&added->pattern);
+    rules->longest = size > rules->longest ? size : rules->longest;
+
+    ++rules->rule_count;
+    return ERROR_NO_ERROR;
+}
+
+error_t rewrite_rules_add_string(rewrite_rules_t* rules, char* rule) {
+    expression_t expr;
+    error_t err = parse_string(rule, &expr);
+    if (err) return err;
+
+    err = rewrite_rules_add(rules, &expr);
+    expression_clean(&expr);
+    return err;
+}
+
+error_t rewrite_rules_load(rewrite_rules_t* rules, FILE* file) {
+    expression_t* rule;
+    expression_list_t* list = malloc(sizeof(expression_list_t));
+    expression_list_init(list);
+
+    error_t err = parse_file(file, list);
+    if (!err) {
+        EXPRESSION_LIST_FOREACH(rule, list) {
+            err = rewrite_rules_add(rules, rule);
+            if (err) break;
+        }
+    }
+
+    expression_list_free(list);
+    return err;
+}
+
+/* check the rules that end at a node, and remember the first one whose variables matched consistently
+ *
+ * @match the search
+ * @node the node
+ */
+void _rewrite_match_leaves(_rewrite_match_t* match, rewrite_node_t* node) {
+    for (size_t i = 0; i < node->leaf_count; ++i) {
+        rewrite_leaf_t* leaf = &node->leaves[i];
+        if (leaf->rule >= match->best)
+            continue;
+
+        expression_t* bindings[REWRITE_MAX_VARIABLES] = { NULL };
+        bool matched = true;
+        for (size_t j = 0; j < match->wildcard_count && matched; ++j) {
+            expression_t** binding = &bindings[leaf->wildcards[j]];
+            if (!*binding) {
+                *binding = match->wildcards[j];
+            } else {
+                matched = expression_identical(*binding, match->wildcards[j]);
+            }
+        }
+
+        if (matched) {
+            match->best = leaf->rule;
+            memcpy(match->bindings, bindings, sizeof(bindings));
+        }
+    }
+}
+
+/* search the discrimination tree for the rules that match the pending subexpressions
+ *
+ * @match the search
+ * @index the node reached so far
+ */
+void _rewrite_match(_rewrite_match_t* match, size_t index) {
+    rewrite_node_t* node = &match->rules->nodes[index];
+    if (!match->pending_count) {
+        _rewrite_match_leaves(match, node);
+        return;
+    }
+
+    expression_t* expr = match->pending[--match->pending_count];
+    size_t bucket;
+
+    if (!EXPRESSION_IS_VARIABLE(expr) && (!EXPRESSION_IS_FUNCTION(expr) || _rewrite_arity(expr) != SIZE_MAX)) {
+        uint64_t hash = _rewrite_mix(_rewrite_label_hash(expr), index);
+        size_t child = _rewrite_find_edge(match->rules, index, expr, hash, &bucket);
+
+        if (child) {
+            /* the children are pushed in reverse, so the first child is matched next */
+            size_t pending_count = match->pending_count;
+            switch (expr->type) {
+                case EXPRESSION_TYPE_FUNCTION:
+                {
+                    size_t arity = _rewrite_arity(expr);
+                    match->pending_count += arity;
+                    size_t i = match->pending_count;
+                    for (expression_list_t* param = expr->function.parameters; param; param = param->next)
+                        match->pending[--i] = param->value;
+                    break;
+                }
+                case EXPRESSION_TYPE_PREFIX:
+                    match->pending[match->pending_count++] = expr->prefix.right;
+                    break;
+                case EXPRESSION_TYPE_OPERATOR:
+                    match->pending[match->pending_count++] = expr->operator.right;
+                    match->pending[match->pending_count++] = expr->operator.left;
+                    break;
+                default:
+                    break;
+            }
+
+            _rewrite_match(match, child - 1);
+            match->pending_count = pending_count;
+        }
+    }
+
+    if (node->wildcard) {
+        match->wildcards[match->wildcard_count++] = expr;
+        _rewrite_match(match, node->wildcard - 1);
+        --match->wildcard_count;
+    }
+
+    match->pending[match->pending_count++] = expr;
+}
+
+/* replace each of a rule's variables in an expression with the expression it matched
+ *
+ * @rule the rule
+ * @bindings the expressions the rule's variables matched
+ * @expr the expression, a copy of the rule's replacement
+ */
+void _rewrite_substitute(rewrite_rule_t* rule, expression_t** bindings, expression_t* expr) {
+    expression_t* param;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_VARIABLE:
+        {
+            size_t index = rewrite_rule_variable(rule, expr->variable.value);
+            if (index < rule->variable_count) {
+                expression_clean(expr);
+                expression_copy(bindings[index], expr);
+            }
+            break;
+        }
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                _rewrite_substitute(rule, bindings, param);
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            _rewrite_substitute(rule, bindings, expr->prefix.right);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            _rewrite_substitute(rule, bindings, expr->operator.left);
+            _rewrite_substitute(rule, bindings, expr->operator.right);
+            break;
+        case EXPRESSION_TYPE_NUMBER:
+            break;
+    }
+}
+
+error_t _rewrite_apply_recursive(_rewrite_match_t* match, expression_t* expr, bool* changed);
+
+/* rewrite each of an expression's children
+ *
+ * @match the search, it's buffers are reused
+ * @expr the expression
+ * @changed set to true if anything was rewritten
+ * @return returns an error code
+ */
+error_t _rewrite_apply_children(_rewrite_match_t* match, expression_t* expr, bool* changed) {
+    error_t err = ERROR_NO_ERROR;
+    expression_t* param;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                err = _rewrite_apply_recursive(match, param, changed);
+                if (err) return err;
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            return _rewrite_apply_recursive(match, expr->prefix.right, changed);
+        case EXPRESSION_TYPE_OPERATOR:
+            err = _rewrite_apply_recursive(match, expr->operator.left, changed);
+            if (err) return err;
+            return _rewrite_apply_recursive(match, expr->operator.right, changed);
+        default:
+            break;
+    }
+    return err;
+}
+
+/* find the first rule that matches an expression
+ *
+ * @match the search, the rule found and it's bindings are stored in it
+ * @expr the expression
+ * @return returns true if a rule matched
+ */
+bool _rewrite_find(_rewrite_match_t* match, expression_t* expr) {
+    match->pending[0] = expr;
+    match->pending_count = 1;
+    match->wildcard_count = 0;
+    match->best = match->rules->rule_count;
+    _rewrite_match(match, 0);
+    return match->best < match->rules->rule_count;
+}
+
+/* free the operators that join a chain's operands, without freeing the operands
+ *
+ * @expr the chain's root, it isn't freed
+ */
+void _rewrite_free_joints(expression_t* expr) {
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+    expression_chain_append(&pending, expr->operator.left);
+    expression_chain_append(&pending, expr->operator.right);
+
+    while (pending.count) {
+        expression_t* next = pending.operands[--pending.count];
+        if (EXPRESSION_IS_OPERATOR(next) && next->operator.infix == expr->operator.infix) {
+            expression_chain_append(&pending, next->operator.left);
+            expression_chain_append(&pending, next->operator.right);
+            free(next);
+        }
+    }
+
+    expression_chain_clean(&pending);
+}
+
+/* rewrite two operands of a sum or product, if a rule matches them
+ *
+ * @match the search, it's buffers are reused
+ * @expr the sum or product
+ * @recursive if true the parts of the replacement that came from the rule are rewritten too
+ * @changed set to true if anything was rewritten
+ * @return returns an error code
+ */
+error_t _rewrite_apply_pairs(_rewrite_match_t* match, expression_t* expr, bool recursive, bool* changed) {
+    expression_chain_t chain;
+    expression_chain_init(&chain, expr->operator.infix);
+    expression_chain_collect(&chain, expr);
+
+    error_t err = ERROR_NO_ERROR;
+    if (chain.count < 3 || chain.count > REWRITE_MAX_CHAIN_OPERANDS) {
+        expression_chain_clean(&chain);
+        return err;
+    }
+
+    for (size_t i = 0; i < chain.count; ++i) {
+        for (size_t j = i + 1; j < chain.count; ++j) {
+            /* the pair borrows it's operands, rules with swapped operands match them in the other order */
+            expression_t pair;
+            expression_init_operator(&pair, chain.operands[i], chain.operator, chain.operands[j]);
+            if (!_rewrite_find(match, &pair))
+                continue;
+
+            rewrite_rule_t* rule = match->rules->rules[match->best];
+            expression_t* replacement = malloc(sizeof(expression_t));
+            expression_copy(&rule->replacement, replacement);
+            _rewrite_substitute(rule, match->bindings, replacement);
+            ++match->rules->rewrites;
+            *changed = true;
+
+            _rewrite_free_joints(expr);
+            expression_free(chain.operands[i]);
+            expression_free(chain.operands[j]);
+            chain.operands[i] = replacement;
+            memmove(chain.operands + j, chain.operands + j + 1, sizeof(expression_t*) * (chain.count - j - 1));
+            --chain.count;
+            expression_chain_build(&chain, expr);
+            expression_chain_clean(&chain);
+
+            /* at least two operands are left, so the replacement is still one of them */
+            if (recursive)
+                err = _rewrite_apply_recursive(match, replacement, changed);
+            return err;
+        }
+    }
+
+    expression_chain_clean(&chain);
+    return err;
+}
+
+/* rewrite an expression until no rule matches it
+ *
+ * @match the search, it's buffers are reused
+ * @expr the expression
+ * @recursive if true the parts of each replacement that came from the rule are rewritten too
+ * @changed set to true if anything was rewritten
+ * @return returns an error code
+ */
+error_t _rewrite_apply_node(_rewrite_match_t* match, expression_t* expr, bool recursive, bool* changed) {
+    for (size_t applications = 0; applications < REWRITE_MAX_APPLICATIONS; ++applications) {
+        if (!_rewrite_find(match, expr)) {
+            /* a rule may match two operands of a longer sum or product */
+            if (!EXPRESSION_IS_CHAIN(expr))
+                break;
+
+            bool rewritten = false;
+            error_t err = _rewrite_apply_pairs(match, expr, recursive, &rewritten);
+            if (err) return err;
+            if (!rewritten)
+                break;
+            *changed = true;
+            continue;
+        }
+
+        rewrite_rule_t* rule = match->rules->rules[match->best];
+        expression_t replacement;
+        expression_copy(&rule->replacement, &replacement);
+        _rewrite_substitute(rule, match->bindings, &replacement);
+
+        expression_clean(expr);
+        *expr = replacement;
+        ++match->rules->rewrites;
+        *changed = true;
+
+        /* the parts of the replacement that came from the rule may match rules of their own */
+        if (recursive) {
+            error_t err = _rewrite_apply_children(match, expr, changed);
+            if (err) return err;
+        }
+    }
+
+    return ERROR_NO_ERROR;
+}
+
+/* rewrite an expression's children, then the expression itself
+ *
+ * @match the search, it's buffers are reused
+ * @expr the expression
+ * @changed set to true if anything was rewritten
+ * @return returns an error code
+ */
+error_t _rewrite_apply_recursive(_rewrite_match_t* match, expression_t* expr, bool* changed) {
+    error_t err = budget_step();
+    if (err) return err;
+
+    err = _rewrite_apply_children(match, expr, changed);
+    if (err) return err;
+
+    return _rewrite_apply_node(match, expr, true, changed);
+}
+
+/* rewrite an expression with a rule set
+ *
+ * @rules the rule set
+ * @expr the expression
+ * @recursive if true the expression's children are rewritten first, and each replacement is visited again
+ * @changed set to true if anything was rewritten, or NULL
+ * @return returns an error code
+ */
+error_t _rewrite_apply(rewrite_rules_t* rules, expression_t* expr, bool recursive, bool* changed) {
+    if (!rules->rule_count)
+        return ERROR_NO_ERROR;
+
+    _rewrite_match_t match;
+    match.rules = rules;
+    match.pending = malloc(sizeof(expression_t*) * (rules->longest + 1));
+    match.wildcards = malloc(sizeof(expression_t*) * (rules->longest + 1));
+
+    bool ignored = false;
+    error_t err = recursive
+        ? _rewrite_apply_recursive(&match, expr, changed ? changed : &ignored)
+        : _rewrite_apply_node(&match, expr, false, changed ? changed : &ignored);
+
+    free(match.pending);
+    free(match.wildcards);
+    return err;
+}
+
+error_t rewrite_rules_apply(rewrite_rules_t* rules, expression_t* expr, bool* changed) {
+    return _rewrite_apply(rules, expr, true, changed);
+}
+
+error_t rewrite_rules_apply_node(rewrite_rules_t* rules, expression_t* expr, bool* changed) {
+    error_t err = budget_step();
+    if (err) return err;
+    return _rewrite_apply(rules, expr, false, changed);
+}
@@ -0,0 +1,187 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_REWRITE_H_
+#define SIMPLIFY_EXPRESSION_REWRITE_H_
+
+#include <stdint.h>
+
+#include "simplify/expression/expression.h"
+
+/* the most distinct variables a rule's pattern may use */
+#ifndef REWRITE_MAX_VARIABLES
+#   define REWRITE_MAX_VARIABLES 16
+#endif
+
+/* the most sums and products in a pattern whose operands are also tried in the other order */
+#ifndef REWRITE_MAX_COMMUTATIVE
+#   define REWRITE_MAX_COMMUTATIVE 4
+#endif
+
+/* the most times an expression is rewritten before moving on, so rules that undo each other can't loop forever */
+#ifndef REWRITE_MAX_APPLICATIONS
+#   define REWRITE_MAX_APPLICATIONS 64
+#endif
+
+/* the most operands a sum or product may have for every pair of them to be matched against the rules */
+#ifndef REWRITE_MAX_CHAIN_OPERANDS
+#   define REWRITE_MAX_CHAIN_OPERANDS 32
+#endif
+
+/* A rule that replaces expressions that match a pattern */
+typedef struct rewrite_rule rewrite_rule_t;
+
+/* A node in the rule set's discrimination tree */
+typedef struct rewrite_node rewrite_node_t;
+
+/* An edge between two discrimination tree nodes, labeled with the expression that leads to the child */
+typedef struct rewrite_edge rewrite_edge_t;
+
+/* A rule that ends at a discrimination tree node */
+typedef struct rewrite_leaf rewrite_leaf_t;
+
+/* A set of rewrite rules */
+typedef struct rewrite_rules rewrite_rules_t;
+
+/* A rewrite rule is an equation, `PATTERN = REPLACEMENT`, written in the same syntax as any other expression.
+ * Each variable in the pattern matches any expression, a variable used more than once must match identical
+ * expressions each time (see `expression_identical`). Everything else must match exactly: operators, function names
+ * and their number of arguments, and numbers by value. Sums and products also match with their operands swapped.
+ * A pattern that's a sum or product also matches any two operands of a longer one, `a + b + c` matches `b + a`
+ * by it's first and last operands, so a rule applies however the operands were ordered (see canonical.h).
+ * An expression that matches is replaced by the replacement, with each of the pattern's variables replaced by the
+ * expression it matched. For example `sin(a) ^ 2 + cos(a) ^ 2 = 1` or `ln(a * b) = ln(a) + ln(b)`.
+ *
+ * Patterns are compiled into a discrimination tree: each pattern is flattened into the list of it's expressions
+ * in prefix order, and every pattern is a path through the tree, sharing it's prefix with the patterns before it.
+ * Variables follow a wildcard edge that skips a whole subexpression. Edges are kept in a hash table keyed by the
+ * parent node and the edge's label, so finding the rules that match an expression takes time proportional to the
+ * expression's size and how many wildcard edges are followed, not the number of rules.
+ *
+ * When more than one rule matches, the rule that was added first is used.
+ */
+struct rewrite_rule {
+    expression_t pattern;
+    expression_t replacement;
+
+    /* the names of the pattern's variables, in the order they first appear */
+    char*  variables[REWRITE_MAX_VARIABLES];
+    size_t variable_count;
+
+    /* the pattern with some of it's operands swapped, each variant is a separate path in the tree */
+    expression_t** variants;
+    size_t         variant_count;
+};
+
+struct rewrite_leaf {
+    size_t  rule;
+
+    /* for each wildcard on the path to the leaf, the index of the pattern variable it matches */
+    size_t* wildcards;
+};
+
+struct rewrite_node {
+    /* the node's wildcard child, plus one, or zero if it has none */
+    size_t          wildcard;
+
+    rewrite_leaf_t* leaves;
+    size_t          leaf_count;
+};
+
+struct rewrite_edge {
+    size_t        parent;
+    size_t        child;
+    uint64_t      hash;
+
+    /* a borrowed expression from a pattern, only it's type, operator, name, argument count or value are used */
+    expression_t* label;
+};
+
+struct rewrite_rules {
+    rewrite_rule_t** rules;
+    size_t           rule_count;
+
+    rewrite_node_t*  nodes;
+    size_t           node_count;
+
+    /* open addressed, each bucket holds an edge's index plus one, or zero if it's empty */
+    rewrite_edge_t*  edges;
+    size_t           edge_count;
+    size_t*          buckets;
+    size_t           bucket_count;
+
+    /* the size of the longest pattern, a path through the tree is never longer than it */
+    size_t           longest;
+
+    /* the number of expressions that have been rewritten */
+    size_t           rewrites;
+};
+
+/* initialize an empty rule set
+ *
+ * @rules the rule set to initialize
+ */
+void rewrite_rules_init(rewrite_rules_t* rules);
+
+/* free all resources used by a rule set
+ *
+ * @rules the rule set to clean
+ */
+void rewrite_rules_clean(rewrite_rules_t* rules);
+
+/* add a rule to a rule set
+ *
+ * @rules the rule set
+ * @rule an equation in the form `PATTERN = REPLACEMENT`, it's copied
+ * @return returns ERROR_INVALID_REWRITE_RULE if the rule isn't an equation, it's pattern is a single variable,
+ *          or it uses more than REWRITE_MAX_VARIABLES variables
+ */
+error_t rewrite_rules_add(rewrite_rules_t* rules, expression_t* rule);
+
+/* parse a rule and add it to a rule set
+ *
+ * @rules the rule set
+ * @rule the rule's source, e.g. "x * 1 = x"
+ * @return returns an error code
+ */
+error_t rewrite_rules_add_string(rewrite_rules_t* rules, char* rule);
+
+/* read a list of rules from a file, separated by commas, and add each of them to a rule set
+ *
+ * @rules the rule set
+ * @file the file to read
+ * @return returns an error code, rules before the first rule with an error are still added
+ */
+error_t rewrite_rules_load(rewrite_rules_t* rules, FILE* file);
+
+/* find the index of one of a rule's variables
+ *
+ * @rule the rule
+ * @name the variable's name
+ * @return returns the variable's index, or variable_count if it's not one of the rule's variables
+ */
+size_t rewrite_rule_variable(rewrite_rule_t* rule, char* name);
+
+/* rewrite an expression with a rule set.
+ * The expression is visited once, from the bottom up. Each expression is rewritten until no rule matches it,
+ * what it was rewritten to is visited again before moving on to it's parent.
+ *
+ * Each expression visited counts as a step against the calling thread's budget, see budget.h.
+ *
+ * @rules the rule set
+ * @expr the expression to rewrite
+ * @changed set to true if the expression was changed, it isn't touched otherwise. May be NULL
+ * @return returns an error code
+ */
+error_t rewrite_rules_apply(rewrite_rules_t* rules, expression_t* expr, bool* changed);
+
+/* rewrite an expression with a rule set, without visiting it's children.
+ * The expression is rewritten until no rule matches it, what it was rewritten to isn't visited.
+ *
+ * @rules the rule set
+ * @expr the expression to rewrite
+ * @changed set to true if the expression was changed, it isn't touched otherwise. May be NULL
+ * @return returns an error code
+ */
+error_t rewrite_rules_apply_node(rewrite_rules_t* rules, expression_t* expr, bool* changed);
+
+#endif  // SIMPLIFY_EXPRESSION_REWRITE_H_
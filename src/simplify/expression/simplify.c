@@ -2,125 +2,464 @@
 
 #include "simplify/expression/simplify.h"
 #include "simplify/expression/isolate.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/polynomial.h"
+#include "simplify/expression/chain.h"
 
-/* get the operator that would could be used to collapse a chain of `op` operators
+/* The state shared while an expression is converted to a polynomial */
+typedef struct {
+    polynomial_atoms_t atoms;
+    mpfr_prec_t        precision;
+
+    /* if false, products and powers of sums are kept as atoms instead of being expanded */
+    bool               expand;
+
+    /* if true, the children of function calls are simplified before they're used as atoms */
+    bool               simplify_atoms;
+
+    /* if true, the children of every atom are already simplified, so they're never simplified again */
+    bool               shallow;
+} _simplify_t;
+
+/* A term of a sum, and whether it's subtracted */
+typedef struct {
+    expression_t* expr;
+    bool          negative;
+} _simplify_term_t;
+
+error_t _simplify_recursive(expression_t* expr);
+
+/* find the precision polynomials built from an expression should use
  *
- * @op the source op
- * @return returns the collapse operator, or zero if `op` is not collapseable
+ * @expr the expression
+ * @return returns the widest number's precision, or the default precision if it's wider
  */
-operator_t _operator_collapsed_equivelent(operator_t op) {
-    switch (op) {
-        case '+':
-            return '*';
-        case '*':
-            return '^';
+mpfr_prec_t _simplify_precision(expression_t* expr) {
+    mpfr_prec_t precision = mpfr_get_default_prec();
+    expression_t* param;
+
+    /* the tree is walked with a list instead of by recursion, so long sums don't overflow the stack */
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+    expression_chain_append(&pending, expr);
+
+    while (pending.count) {
+        expression_t* next = pending.operands[--pending.count];
+        switch (next->type) {
+            case EXPRESSION_TYPE_NUMBER:
+                if (mpfr_get_prec(next->number.value) > precision)
+                    precision = mpfr_get_prec(next->number.value);
+                break;
+            case EXPRESSION_TYPE_VARIABLE:
+                break;
+            case EXPRESSION_TYPE_FUNCTION:
+                EXPRESSION_LIST_FOREACH(param, next->function.parameters) {
+                    expression_chain_append(&pending, param);
+                }
+                break;
+            case EXPRESSION_TYPE_PREFIX:
+                expression_chain_append(&pending, next->prefix.right);
+                break;
+            case EXPRESSION_TYPE_OPERATOR:
+                expression_chain_append(&pending, next->operator.left);
+                expression_chain_append(&pending, next->operator.right);
+                break;
+        }
     }
 
-    return 0;
+    expression_chain_clean(&pending);
+    return precision;
 }
 
-static inline int _diff_precedence(expression_t* expr1, expression_t* expr2) {
-    return (int)operator_precedence(expr1->operator.infix) - (int)operator_precedence(expr2->operator.infix);
-}
+/* count the expressions in a tree
+ *
+ * @expr the tree's root
+ * @return returns the number of expressions
+ */
+size_t _simplify_size(expression_t* expr) {
+    size_t size = 0;
+    expression_t* param;
 
-int _expression_init_chain(expression_t* root, expression_t* var) {
-    expression_t* right = EXPRESSION_RIGHT(var);
+    expression_chain_t pending;
+    expression_chain_init(&pending, 0);
+    expression_chain_append(&pending, expr);
 
-    if (EXPRESSION_IS_VARIABLE(right)
-        && _diff_precedence(root, var) >= 0
-        && !strcmp(right->variable.value, EXPRESSION_RIGHT(root)->variable.value)) {
-            char* varname = right->variable.value;
-            expression_init_operator(right,
-                expression_new_variable(varname),
-                _operator_collapsed_equivelent(root->operator.infix),
-                expression_new_number_si(2));
-            return 0;
+    while (pending.count) {
+        expression_t* next = pending.operands[--pending.count];
+        ++size;
+        switch (next->type) {
+            case EXPRESSION_TYPE_NUMBER:
+            case EXPRESSION_TYPE_VARIABLE:
+                break;
+            case EXPRESSION_TYPE_FUNCTION:
+                EXPRESSION_LIST_FOREACH(param, next->function.parameters) {
+                    expression_chain_append(&pending, param);
+                }
+                break;
+            case EXPRESSION_TYPE_PREFIX:
+                expression_chain_append(&pending, next->prefix.right);
+                break;
+            case EXPRESSION_TYPE_OPERATOR:
+                expression_chain_append(&pending, next->operator.left);
+                expression_chain_append(&pending, next->operator.right);
+                break;
+        }
     }
 
-    return 1;
+    expression_chain_clean(&pending);
+    return size;
 }
 
-error_t _expression_collapse_variables_recursive(expression_t* expr) {
+/* simplify each of an expression's children
+ *
+ * @expr the expression
+ * @return returns an error code
+ */
+error_t _simplify_children(expression_t* expr) {
+    error_t err = ERROR_NO_ERROR;
+    expression_t* param;
+
     switch (expr->type) {
         case EXPRESSION_TYPE_NUMBER:
         case EXPRESSION_TYPE_VARIABLE:
+            break;
         case EXPRESSION_TYPE_FUNCTION:
-        case EXPRESSION_TYPE_PREFIX:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                err = _simplify_recursive(param);
+                if (err) return err;
+            }
             break;
+        case EXPRESSION_TYPE_PREFIX:
+            return _simplify_recursive(expr->prefix.right);
         case EXPRESSION_TYPE_OPERATOR:
-        {
-            error_t err = _expression_collapse_variables_recursive(EXPRESSION_LEFT(expr));
+            err = _simplify_recursive(expr->operator.left);
             if (err) return err;
+            return _simplify_recursive(expr->operator.right);
+    }
+    return err;
+}
 
-            err = _expression_collapse_variables_recursive(EXPRESSION_RIGHT(expr));
-            if (err) return err;
+/* add an expression to a polynomial as an atom
+ *
+ * @simplify
+ * @expr the expression
+ * @simplify_children if true the expression's children are simplified before it's added
+ * @poly the polynomial
+ * @return returns an error code
+ */
+error_t _simplify_add_atom(_simplify_t* simplify, expression_t* expr, bool simplify_children, polynomial_t* poly) {
+    if (simplify_children && !simplify->shallow) {
+        error_t err = _simplify_children(expr);
+        if (err) return err;
+    }
+
+    polynomial_add_atom(poly, polynomial_atoms_intern(&simplify->atoms, expr));
+    return ERROR_NO_ERROR;
+}
 
-            operator_t equiv_op = _operator_collapsed_equivelent(expr->operator.infix);
+/* get the exponent of a power that can be expanded
+ *
+ * @expr the exponent
+ * @exponent set to the exponent
+ * @return returns true if the exponent is an integer between zero and POLYNOMIAL_MAX_POWER
+ */
+bool _simplify_power_exponent(expression_t* expr, unsigned long* exponent) {
+    if (!EXPRESSION_IS_NUMBER(expr)
+            || !mpfr_integer_p(expr->number.value)
+            || mpfr_sgn(expr->number.value) < 0
+            || mpfr_cmp_ui(expr->number.value, POLYNOMIAL_MAX_POWER) > 0)
+        return false;
 
-            // Don't know how to deal with this operator yet
-            if (!equiv_op)
-                break;
+    *exponent = mpfr_get_ui(expr->number.value, MPFR_RNDN);
+    return true;
+}
 
-            // If there are two variables right next to each other try to combine them
-            if (EXPRESSION_IS_VARIABLE(EXPRESSION_LEFT(expr))
-                && EXPRESSION_IS_VARIABLE(EXPRESSION_RIGHT(expr))) {
-                    expr->operator.infix = equiv_op;
-                    expression_clean(expr->operator.right);
-                    expression_init_number_si(EXPRESSION_RIGHT(expr), 2);
+error_t _simplify_convert(_simplify_t* simplify, expression_t* expr, polynomial_t* poly);
 
-                    // the `while` loop condition will fail immediately, so just break here
-                    break;
+/* convert a sum or difference to a polynomial, one term at a time instead of recursing once per operator
+ *
+ * @simplify
+ * @expr the sum or difference
+ * @poly an empty polynomial, set to the expression's polynomial
+ * @return returns an error code
+ */
+error_t _simplify_convert_sum(_simplify_t* simplify, expression_t* expr, polynomial_t* poly) {
+    error_t err = ERROR_NO_ERROR;
+    size_t count = 0;
+    size_t capacity = 16;
+    _simplify_term_t* pending = malloc(sizeof(_simplify_term_t) * capacity);
+    pending[count++] = (_simplify_term_t){ expr, false };
+
+    mpfr_t negative_one;
+    mpfr_init2(negative_one, simplify->precision);
+    mpfr_set_si(negative_one, -1, MPFR_RNDN);
+
+    while (count && !err) {
+        _simplify_term_t next = pending[--count];
+        if (EXPRESSION_IS_OPERATOR(next.expr)
+                && (next.expr->operator.infix == '+' || next.expr->operator.infix == '-')) {
+            err = budget_step();
+            if (count + 2 > capacity) {
+                capacity *= 2;
+                pending = realloc(pending, sizeof(_simplify_term_t) * capacity);
             }
 
-            /* If possible try to add to any expressions up the tree
-             To add to an expression it must look like (<variable> eqiv_op <number>) */
-            while (EXPRESSION_IS_VARIABLE(EXPRESSION_RIGHT(expr)) && EXPRESSION_IS_OPERATOR(EXPRESSION_LEFT(expr))) {
-                /* While possible worm our way up the tree, looking for the expression */
-                expression_t* right = EXPRESSION_LEFT(expr);
-                while (EXPRESSION_IS_OPERATOR(right)
-                        && EXPRESSION_IS_OPERATOR(EXPRESSION_RIGHT(right))
-                        && _diff_precedence(right, expr) >= 0)
-                            right = EXPRESSION_RIGHT(right);
-
-                expression_t* variable = EXPRESSION_LEFT(right);
-                expression_t* count = EXPRESSION_RIGHT(right);
-
-                /* If the variable / count is an operator expression, if it includes the right
-                    variable we may be able to start a new chain */
-                if (!EXPRESSION_IS_NUMBER(count) ||!EXPRESSION_IS_VARIABLE(variable)) {
-                    if (!EXPRESSION_IS_VARIABLE(variable)) {
-                        if (!_expression_init_chain(expr, right)) {
-                            *expr = *EXPRESSION_LEFT(expr);
-                            continue;
-                        }
-                    }
-
-                    if (!EXPRESSION_IS_NUMBER(count)) {
-                        if (!_expression_init_chain(expr, right)) {
-                            *expr = *EXPRESSION_LEFT(expr);
-                            continue;
-                        }
-                    }
-                    break;
-                }
+            /* the right term is pushed first, so terms are converted from left to right */
+            pending[count++] = (_simplify_term_t){
+                next.expr->operator.right, next.negative != (next.expr->operator.infix == '-')
+            };
+            pending[count++] = (_simplify_term_t){ next.expr->operator.left, next.negative };
+            continue;
+        }
 
-                if (strcmp(variable->variable.value, EXPRESSION_RIGHT(expr)->variable.value) != 0) break;
+        polynomial_t term;
+        polynomial_init(&term, simplify->precision);
+        err = _simplify_convert(simplify, next.expr, &term);
+        if (!err) {
+            if (next.negative)
+                polynomial_scale(&term, negative_one);
 
-                if (right->operator.infix == equiv_op) {
-                    mpfr_ptr x = count->number.value;
-                    mpfr_add_si(x, x, 1, MPFR_RNDN);
-                    *expr = *EXPRESSION_LEFT(expr);
-                } else {
-                    expr->operator.infix = equiv_op;
-                    expression_clean(expr->operator.right);
-                    expression_init_number_si(EXPRESSION_RIGHT(expr), 2);
-                }
+            /* add the smaller polynomial to the larger one, so long sums are collected in linear time */
+            if (term.count > poly->count) {
+                polynomial_t swap = *poly;
+                *poly = term;
+                term = swap;
             }
+            polynomial_add(poly, &term);
         }
+        polynomial_clean(&term);
+    }
+
+    mpfr_clear(negative_one);
+    free(pending);
+    return err;
+}
+
+/* convert a product to a polynomial, one factor at a time instead of recursing once per operator
+ *
+ * @simplify
+ * @expr the product
+ * @poly an empty polynomial, set to the expression's polynomial
+ * @return returns an error code, or ERROR_POLYNOMIAL_TOO_LARGE if the product can't be expanded
+ */
+error_t _simplify_convert_product(_simplify_t* simplify, expression_t* expr, polynomial_t* poly) {
+    expression_chain_t chain;
+    expression_chain_init(&chain, '*');
+    expression_chain_collect(&chain, expr);
+
+    error_t err = _simplify_convert(simplify, chain.operands[0], poly);
+    for (size_t i = 1; i < chain.count && !err; ++i) {
+        polynomial_t factor;
+        polynomial_init(&factor, simplify->precision);
+
+        err = _simplify_convert(simplify, chain.operands[i], &factor);
+        if (!err) {
+            if (!simplify->expand && polynomial_term_count(poly) > 1 && polynomial_term_count(&factor) > 1)
+                err = ERROR_POLYNOMIAL_TOO_LARGE;
+            else
+                err = polynomial_multiply(poly, &factor);
+        }
+        polynomial_clean(&factor);
+    }
+
+    expression_chain_clean(&chain);
+    return err;
+}
+
+/* convert an operator expression to a polynomial
+ *
+ * @simplify
+ * @expr the operator expression
+ * @poly an empty polynomial, set to the expression's polynomial
+ * @return returns an error code
+ */
+error_t _simplify_convert_operator(_simplify_t* simplify, expression_t* expr, polynomial_t* poly) {
+    error_t err = ERROR_NO_ERROR;
+    size_t atoms = simplify->atoms.count;
+    unsigned long exponent;
+    polynomial_t other;
+    mpfr_t number;
+
+    polynomial_init(&other, simplify->precision);
+    mpfr_init2(number, simplify->precision);
+
+    switch (expr->operator.infix) {
+        case '+':
+        case '-':
+            err = _simplify_convert_sum(simplify, expr, poly);
+            break;
+        case '*':
+            err = _simplify_convert_product(simplify, expr, poly);
+            break;
+        case '/':
+            err = _simplify_convert(simplify, expr->operator.left, poly);
+            if (!err)
+                err = _simplify_convert(simplify, expr->operator.right, &other);
+            if (err) break;
+
+            /* only divisions by a number with an exact reciprocal are turned into products */
+            if (!polynomial_is_number(&other, number)
+                    || mpfr_zero_p(number)
+                    || mpfr_ui_div(number, 1, number, MPFR_RNDN) != 0) {
+                err = ERROR_POLYNOMIAL_TOO_LARGE;
+                break;
+            }
+            polynomial_scale(poly, number);
+            break;
+        case '^':
+            if (!_simplify_power_exponent(expr->operator.right, &exponent)) {
+                err = ERROR_POLYNOMIAL_TOO_LARGE;
+                break;
+            }
+
+            err = _simplify_convert(simplify, expr->operator.left, poly);
+            if (err) break;
+
+            if (exponent == 0) {
+                polynomial_clean(poly);
+                mpfr_set_ui(number, 1, MPFR_RNDN);
+                polynomial_add_number(poly, number);
+            } else if (!simplify->expand && polynomial_term_count(poly) > 1) {
+                err = ERROR_POLYNOMIAL_TOO_LARGE;
+            } else {
+                err = polynomial_power(poly, exponent);
+            }
+            break;
+        default:
+            err = ERROR_POLYNOMIAL_TOO_LARGE;
+            break;
+    }
+
+    polynomial_clean(&other);
+    mpfr_clear(number);
+
+    /* an expression that can't be expanded is kept whole, it's children are simplified on their own */
+    if (err == ERROR_POLYNOMIAL_TOO_LARGE) {
+        polynomial_clean(poly);
+        polynomial_atoms_truncate(&simplify->atoms, atoms);
+        return _simplify_add_atom(simplify, expr, true, poly);
+    }
+    return err;
+}
+
+/* convert an expression to a polynomial
+ *
+ * @simplify
+ * @expr the expression
+ * @poly an empty polynomial, set to the expression's polynomial
+ * @return returns an error code
+ */
+error_t _simplify_convert(_simplify_t* simplify, expression_t* expr, polynomial_t* poly) {
+    error_t err = budget_step();
+    if (err) return err;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            if (!mpfr_number_p(expr->number.value))
+                return _simplify_add_atom(simplify, expr, false, poly);
+            polynomial_add_number(poly, expr->number.value);
+            return ERROR_NO_ERROR;
+        case EXPRESSION_TYPE_VARIABLE:
+            return _simplify_add_atom(simplify, expr, false, poly);
+        case EXPRESSION_TYPE_FUNCTION:
+            return _simplify_add_atom(simplify, expr, simplify->simplify_atoms, poly);
+        case EXPRESSION_TYPE_PREFIX:
+        {
+            if (expr->prefix.prefix != '-')
+                return _simplify_add_atom(simplify, expr, true, poly);
+
+            err = _simplify_convert(simplify, expr->prefix.right, poly);
+            if (err) return err;
+
+            mpfr_t negative_one;
+            mpfr_init2(negative_one, simplify->precision);
+            mpfr_set_si(negative_one, -1, MPFR_RNDN);
+            polynomial_scale(poly, negative_one);
+            mpfr_clear(negative_one);
+            return ERROR_NO_ERROR;
+        }
+        case EXPRESSION_TYPE_OPERATOR:
+            return _simplify_convert_operator(simplify, expr, poly);
+    }
+    return ERROR_NO_ERROR;
+}
+
+/* replace an expression with it's polynomial's canonical form, if it's not longer than the expression.
+ * The polynomial is fully expanded first, if that's too long it's built again without expanding products of sums.
+ *
+ * @expr the root of a sum, product, or power
+ * @shallow if true the expression's atoms are already simplified
+ * @changed set to true if the expression was replaced by a different one, or NULL
+ * @return returns an error code
+ */
+error_t _simplify_polynomial(expression_t* expr, bool shallow, bool* changed) {
+    for (int expand = 1; expand >= 0; --expand) {
+        _simplify_t simplify;
+        polynomial_t poly;
+        expression_t* result = NULL;
+
+        polynomial_atoms_init(&simplify.atoms);
+        simplify.precision = _simplify_precision(expr);
+        simplify.expand = expand;
+        simplify.simplify_atoms = expand;
+        simplify.shallow = shallow;
+        polynomial_init(&poly, simplify.precision);
+
+        error_t err = _simplify_convert(&simplify, expr, &poly);
+        if (!err)
+            result = polynomial_to_expression(&poly, &simplify.atoms);
+
+        polynomial_clean(&poly);
+        polynomial_atoms_clean(&simplify.atoms);
+        if (err) return err;
+
+        if (_simplify_size(result) <= _simplify_size(expr)) {
+            if (changed && !expression_identical(result, expr))
+                *changed = true;
+            expression_clean(expr);
+            *expr = *result;
+            free(result);
+            return ERROR_NO_ERROR;
+        }
+        expression_free(result);
     }
     return ERROR_NO_ERROR;
 }
 
+/* simplify an expression, every sum, product and power is replaced by it's polynomial's canonical form
+ *
+ * @expr the expression
+ * @return returns an error code
+ */
+error_t _simplify_recursive(expression_t* expr) {
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+        case EXPRESSION_TYPE_VARIABLE:
+            return budget_step();
+        case EXPRESSION_TYPE_FUNCTION:
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            if (expr->prefix.prefix == '-')
+                return _simplify_polynomial(expr, false, NULL);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            switch (expr->operator.infix) {
+                case '+':
+                case '-':
+                case '*':
+                case '/':
+                case '^':
+                    return _simplify_polynomial(expr, false, NULL);
+            }
+            break;
+    }
+
+    /* the budget is checked before the expression is changed, so the expression is always left whole */
+    error_t err = budget_step();
+    if (err) return err;
+    return _simplify_children(expr);
+}
+
 error_t expression_do_logarithm(expression_t* b, expression_t* y, expression_t** out) {
     /* expression_isolate_variable can solve logarithms,
         so this function will set that up expand to b^x = y, then call
@@ -141,5 +480,37 @@ error_t expression_do_logarithm(expression_t* b, expression_t* y, expression_t**
 }
 
 error_t expression_simplify(expression_t* expr) {
-    return _expression_collapse_variables_recursive(expr);
+    return _simplify_recursive(expr);
+}
+
+error_t expression_simplify_node(expression_t* expr, bool* changed) {
+    bool polynomial = EXPRESSION_IS_PREFIX(expr)
+        ? expr->prefix.prefix == '-'
+        : EXPRESSION_IS_OPERATOR(expr) && strchr("+-*/^", expr->operator.infix);
+
+    if (!polynomial)
+        return budget_step();
+    return _simplify_polynomial(expr, true, changed);
+}
+
+bool expression_simplify_deferred(expression_t* expr, expression_t* parent) {
+    if (!parent || !EXPRESSION_IS_OPERATOR(expr) || !EXPRESSION_IS_OPERATOR(parent))
+        return false;
+
+    operator_t op = expr->operator.infix;
+    operator_t parent_op = parent->operator.infix;
+    if (op == '*')
+        return parent_op == '*';
+    return (op == '+' || op == '-') && (parent_op == '+' || parent_op == '-');
+}
+
+error_t expression_simplify_rules(expression_t* expr, rewrite_rules_t* rules) {
+    error_t err = _simplify_recursive(expr);
+    if (err || !rules) return err;
+
+    bool changed = false;
+    err = rewrite_rules_apply(rules, expr, &changed);
+    if (err || !changed) return err;
+
+    return _simplify_recursive(expr);
 }
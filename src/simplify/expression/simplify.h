@@ -4,14 +4,47 @@
 #define SIMPLIFY_EXPRESSION_SIMPLIFY_H_
 
 #include "simplify/expression/expression.h"
+#include "simplify/expression/rewrite.h"
 
 /* try to make `expr` as short as possible by combining child expressions
+ *
+ * Each expression visited counts as a step against the calling thread's budget, see budget.h.
  *
  * @expr the expression to shorten
  * @return returns an error code
  */
 error_t expression_simplify(expression_t* expr);
 
+/* simplify an expression whose children are already simplified, without visiting them again.
+ * A sum, product or power is replaced by it's polynomial's canonical form, the parts of it that aren't
+ * sums, products or powers are used as they are. Anything else is left alone.
+ *
+ * Each expression visited counts as a step against the calling thread's budget, see budget.h.
+ *
+ * @expr the expression to shorten
+ * @changed set to true if the expression was changed, it isn't touched otherwise. May be NULL
+ * @return returns an error code
+ */
+error_t expression_simplify_node(expression_t* expr, bool* changed);
+
+/* check if simplifying an expression is left to it's parent. A sum within a sum, or product within a product,
+ * is part of the polynomial expression_simplify_node builds for the outermost one.
+ *
+ * @expr the expression
+ * @parent the expression's parent, or NULL
+ * @return returns true if the expression is simplified along with it's parent
+ */
+bool expression_simplify_deferred(expression_t* expr, expression_t* parent);
+
+/* simplify an expression, then rewrite it with a set of rules (see rewrite.h).
+ * If any rule was applied the result is simplified again.
+ *
+ * @expr the expression to shorten
+ * @rules the rules to apply, or NULL to only simplify the expression
+ * @return returns an error code
+ */
+error_t expression_simplify_rules(expression_t* expr, rewrite_rules_t* rules);
+
 
 /* find the value of x in the expression `b^x = y`
  * @b
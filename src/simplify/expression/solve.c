@@ -0,0 +1,612 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <math.h>
+
+#include "simplify/expression/solve.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/isolate.h"
+#include "simplify/expression/precision.h"
+#include "simplify/expression/simplify.h"
+#include "simplify/expression/thread_pool.h"
+
+/* A range of rows of a batch, evaluated as a thread pool task */
+typedef struct {
+    expression_solution_t* solution;
+    const double*          arguments;
+    double*                results;
+    size_t                 count;
+    thread_pool_task_t     task;
+} _solve_chunk_t;
+
+/* The residual of an equation, `LEFT - RIGHT`, as a function of one variable */
+typedef struct {
+    expression_t              residual;
+    variable_t                var;
+    scope_t*                  scope;
+    const precision_policy_t* policy;
+
+    /* the residual compiled to a function of the variable, only set if `compiled` is true */
+    jit_function_t            function;
+    bool                      compiled;
+} _solve_residual_t;
+
+/* A bracket around a root, the residual has a different sign at each end */
+typedef struct {
+    double a;
+    double b;
+    double fa;
+    double fb;
+} _solve_bracket_t;
+
+error_t expression_solve(expression_solution_t* solution, expression_t* equation, variable_t var,
+                         expression_list_t* parameters, scope_t* scope) {
+    expression_t* param;
+    size_t parameter_count = 0;
+    if (parameters) {
+        EXPRESSION_LIST_FOREACH(param, parameters) {
+            if (!EXPRESSION_IS_VARIABLE(param))
+                return ERROR_INVALID_IDENTIFIER;
+            ++parameter_count;
+        }
+    }
+
+    expression_t solved;
+    expression_copy(equation, &solved);
+    error_t err = expression_isolate_variable(&solved, var);
+    if (err) {
+        expression_clean(&solved);
+        return err;
+    }
+
+    /* the variable has to end up alone on the left, for the right side to be it's value */
+    if (!EXPRESSION_IS_VARIABLE(solved.operator.left) || strcmp(solved.operator.left->variable.value, var) != 0
+        || expression_has_variable_or_function(solved.operator.right, var)) {
+        expression_clean(&solved);
+        return ERROR_VARIABLE_NOT_PRESENT;
+    }
+
+    solution->relation = solved.operator.infix;
+    solution->value    = *solved.operator.right;
+    free(solved.operator.right);
+    expression_free(solved.operator.left);
+
+    err = expression_simplify(&solution->value);
+    if (err) {
+        expression_clean(&solution->value);
+        return err;
+    }
+
+    solution->variable = malloc(strlen(var) + 1);
+    strcpy(solution->variable, var);
+    solution->parameters = malloc(sizeof(expression_list_t));
+    expression_list_init(solution->parameters);
+    if (parameters)
+        expression_list_copy(parameters, solution->parameters);
+    solution->parameter_count = parameter_count;
+
+    /* solutions that call something that can't be compiled are only evaluated as expressions */
+    solution->compiled = !jit_compile(&solution->function, &solution->value, scope, solution->parameters);
+    return ERROR_NO_ERROR;
+}
+
+void expression_solution_clean(expression_solution_t* solution) {
+    if (solution->compiled)
+        jit_clean(&solution->function);
+    expression_list_free(solution->parameters);
+    expression_clean(&solution->value);
+    free(solution->variable);
+}
+
+error_t expression_solution_evaluate(expression_solution_t* solution, scope_t* scope, expression_t** arguments,
+                                     expression_t* out) {
+    scope_t parameters;
+    scope_init_child(&parameters, scope);
+
+    size_t i = 0;
+    expression_t* param;
+    error_t err = ERROR_NO_ERROR;
+    EXPRESSION_LIST_FOREACH(param, solution->parameters) {
+        expression_t* value = malloc(sizeof(expression_t));
+        expression_copy(arguments[i++], value);
+        err = scope_define(&parameters, param->variable.value, value);
+        if (err) break;
+    }
+
+    if (!err) {
+        expression_copy(&solution->value, out);
+        err = expression_evaluate(out, &parameters);
+        if (err)
+            expression_clean(out);
+    }
+
+    scope_clean(&parameters);
+    return err;
+}
+
+/* evaluate a range of rows with a solution's compiled function
+ *
+ * @data the range's chunk
+ */
+void _solve_chunk_run(void* data) {
+    _solve_chunk_t* chunk = data;
+    for (size_t i = 0; i < chunk->count; ++i)
+        chunk->results[i] = jit_call(&chunk->solution->function,
+                                     chunk->arguments + i * chunk->solution->parameter_count);
+}
+
+/* evaluate a batch one row at a time, without the compiled function
+ *
+ * @solution the solution
+ * @scope the scope to evaluate the solution in
+ * @arguments the rows of parameter values
+ * @count the number of rows
+ * @results location to store each row's result
+ * @return returns an error code
+ */
+error_t _solve_batch_evaluate(expression_solution_t* solution, scope_t* scope, const double* arguments, size_t count,
+                              double* results) {
+    expression_t** row = malloc(sizeof(expression_t*) * (solution->parameter_count + 1));
+    error_t err = ERROR_NO_ERROR;
+
+    for (size_t i = 0; i < count && !err; ++i) {
+        for (size_t j = 0; j < solution->parameter_count; ++j)
+            row[j] = expression_new_number_d(arguments[i * solution->parameter_count + j]);
+
+        expression_t result;
+        err = expression_solution_evaluate(solution, scope, row, &result);
+        if (!err) {
+            results[i] = EXPRESSION_IS_NUMBER(&result) ? mpfr_get_d(result.number.value, MPFR_RNDN) : NAN;
+            expression_clean(&result);
+        }
+
+        for (size_t j = 0; j < solution->parameter_count; ++j)
+            expression_free(row[j]);
+    }
+
+    free(row);
+    return err;
+}
+
+error_t expression_solution_evaluate_batch(expression_solution_t* solution, scope_t* scope, const double* arguments,
+                                           size_t count, double* results) {
+    if (!solution->compiled)
+        return _solve_batch_evaluate(solution, scope, arguments, count, results);
+
+    size_t chunk_count = (count + EXPRESSION_SOLVE_BATCH_CHUNK - 1) / EXPRESSION_SOLVE_BATCH_CHUNK;
+    thread_pool_t* pool = scope_get_thread_pool(scope);
+    if (!pool || chunk_count < 2) {
+        _solve_chunk_t chunk;
+        chunk.solution  = solution;
+        chunk.arguments = arguments;
+        chunk.results   = results;
+        chunk.count     = count;
+        _solve_chunk_run(&chunk);
+        return ERROR_NO_ERROR;
+    }
+
+    /* the function only reads it's program, so any number of rows can be evaluated at once */
+    _solve_chunk_t* chunks = malloc(sizeof(_solve_chunk_t) * chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        size_t first = i * EXPRESSION_SOLVE_BATCH_CHUNK;
+        chunks[i].solution  = solution;
+        chunks[i].arguments = arguments + first * solution->parameter_count;
+        chunks[i].results   = results + first;
+        chunks[i].count     = count - first < EXPRESSION_SOLVE_BATCH_CHUNK ? count - first : EXPRESSION_SOLVE_BATCH_CHUNK;
+        thread_pool_spawn(pool, &chunks[i].task, _solve_chunk_run, &chunks[i]);
+    }
+
+    /* joined newest first, so this thread runs the chunks that haven't been stolen */
+    for (size_t i = chunk_count; i > 0; --i)
+        thread_pool_join(pool, &chunks[i - 1].task);
+    free(chunks);
+    return ERROR_NO_ERROR;
+}
+
+/* check if an expression uses a variable anywhere, including in the arguments of a call
+ *
+ * @expr the expression
+ * @var the variable
+ * @return returns true if the variable is used
+ */
+bool _solve_uses(expression_t* expr, variable_t var) {
+    expression_t* param;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_VARIABLE:
+            return strcmp(expr->variable.value, var) == 0;
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                if (_solve_uses(param, var))
+                    return true;
+            }
+            return false;
+        case EXPRESSION_TYPE_PREFIX:
+            return _solve_uses(expr->prefix.right, var);
+        case EXPRESSION_TYPE_OPERATOR:
+            return _solve_uses(expr->operator.left, var) || _solve_uses(expr->operator.right, var);
+        case EXPRESSION_TYPE_NUMBER:
+            break;
+    }
+    return false;
+}
+
+/* forget where a variable was looked up, so it's found in the scope the expression is next evaluated in.
+ * Evaluating an expression binds the names that weren't defined to the scope they were looked up in.
+ *
+ * @expr the expression
+ * @var the variable
+ */
+void _solve_unbind(expression_t* expr, variable_t var) {
+    expression_t* param;
+
+    switch (expr->type) {
+        case EXPRESSION_TYPE_VARIABLE:
+            if (strcmp(expr->variable.value, var) == 0) {
+                expr->variable.binding = NULL;
+                expr->variable.slot    = -1;
+            }
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                _solve_unbind(param, var);
+            }
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            _solve_unbind(expr->prefix.right, var);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            _solve_unbind(expr->operator.left, var);
+            _solve_unbind(expr->operator.right, var);
+            break;
+        case EXPRESSION_TYPE_NUMBER:
+            break;
+    }
+}
+
+/* evaluate a residual at the scope's precision
+ *
+ * @residual the residual
+ * @x the variable's value
+ * @out set to the residual's value, or NaN if it isn't defined at `x`
+ * @return returns ERROR_NO_ROOT_FOUND if the residual isn't a number, or ERROR_BUDGET_EXCEEDED
+ */
+error_t _solve_residual_exact(_solve_residual_t* residual, mpfr_srcptr x, mpfr_ptr out) {
+    scope_t scope;
+    scope_init_child(&scope, residual->scope);
+
+    mpfr_ptr value = precision_policy_new_number(residual->policy, 0, 0);
+    mpfr_set(value, x, MPFR_RNDN);
+    expression_t* number = malloc(sizeof(expression_t));
+    expression_init_number(number, value);
+
+    error_t err = scope_define(&scope, residual->var, number);
+    if (!err) {
+        expression_t result;
+        expression_copy(&residual->residual, &result);
+        err = expression_evaluate(&result, &scope);
+
+        /* errors like dividing by zero only mean the residual isn't defined there */
+        if (err && err != ERROR_BUDGET_EXCEEDED) {
+            mpfr_set_nan(out);
+            err = ERROR_NO_ERROR;
+        } else if (!err && EXPRESSION_IS_NUMBER(&result)) {
+            mpfr_set(out, result.number.value, MPFR_RNDN);
+        } else if (!err) {
+            err = ERROR_NO_ROOT_FOUND;
+        }
+        expression_clean(&result);
+    }
+
+    scope_clean(&scope);
+    return err;
+}
+
+/* evaluate a residual in double precision, with it's compiled function if it has one
+ *
+ * @residual the residual
+ * @x the variable's value
+ * @err set to an error code
+ * @return returns the residual's value
+ */
+double _solve_residual_fast(_solve_residual_t* residual, double x, error_t* err) {
+    if (residual->compiled)
+        return jit_call(&residual->function, &x);
+
+    mpfr_t value;
+    mpfr_t out;
+    mpfr_init2(value, 53);
+    mpfr_init2(out, 53);
+    mpfr_set_d(value, x, MPFR_RNDN);
+    *err = _solve_residual_exact(residual, value, out);
+    double result = mpfr_get_d(out, MPFR_RNDN);
+    mpfr_clear(value);
+    mpfr_clear(out);
+    return result;
+}
+
+/* check if two values of the residual have different signs, so there's a root between them
+ *
+ * @fa
+ * @fb
+ * @return returns true if the values have different signs, or one of them is zero
+ */
+static inline bool _solve_sign_change(double fa, double fb) {
+    return !isnan(fa) && !isnan(fb) && (fa == 0 || fb == 0 || (fa < 0) != (fb < 0));
+}
+
+/* search for a sign change, moving away from a guess in both directions in steps that double
+ *
+ * @residual the residual
+ * @guess where to start searching
+ * @bracket set to the first bracket found
+ * @return returns ERROR_NO_ROOT_FOUND if the residual never changed sign
+ */
+error_t _solve_bracket(_solve_residual_t* residual, double guess, _solve_bracket_t* bracket) {
+    error_t err = ERROR_NO_ERROR;
+    double fguess = _solve_residual_fast(residual, guess, &err);
+    if (err) return err;
+
+    if (fguess == 0) {
+        bracket->a = bracket->b = guess;
+        bracket->fa = bracket->fb = 0;
+        return ERROR_NO_ERROR;
+    }
+
+    /* the ends of the range searched so far, where the residual was last defined */
+    double ends[2]  = { guess, guess };
+    double values[2] = { fguess, fguess };
+    double step = fmax(fabs(guess), 1) / 64;
+
+    for (size_t i = 0; i < EXPRESSION_ROOT_BRACKET_STEPS; ++i, step *= 2) {
+        for (size_t side = 0; side < 2; ++side) {
+            double next = side ? guess - step : guess + step;
+            double fnext = _solve_residual_fast(residual, next, &err);
+            if (err) return err;
+            if (isnan(fnext))
+                continue;
+
+            if (_solve_sign_change(values[side], fnext)) {
+                bracket->a  = ends[side];
+                bracket->fa = values[side];
+                bracket->b  = next;
+                bracket->fb = fnext;
+                return ERROR_NO_ERROR;
+            }
+            ends[side] = next;
+            values[side] = fnext;
+        }
+    }
+
+    return ERROR_NO_ROOT_FOUND;
+}
+
+/* check if a bracket is narrow enough
+ *
+ * @a one end of the bracket
+ * @b the other end
+ * @tolerance the widest bracket allowed, relative to the root's magnitude
+ * @return returns true if the bracket is narrow enough
+ */
+static inline bool _solve_narrow(double a, double b, double tolerance) {
+    return tolerance > 0 && fabs(b - a) <= tolerance * fmax(1, fmin(fabs(a), fabs(b)));
+}
+
+/* narrow a bracket in double precision with the Illinois method
+ *
+ * @residual the residual
+ * @bracket the bracket to narrow
+ * @options the tolerance and iteration limit
+ * @return returns an error code
+ */
+error_t _solve_refine_fast(_solve_residual_t* residual, _solve_bracket_t* bracket,
+                           const expression_root_options_t* options) {
+    error_t err = ERROR_NO_ERROR;
+    for (size_t i = 0; i < options->max_iterations; ++i) {
+        if (bracket->fa == 0 || bracket->fb == 0 || _solve_narrow(bracket->a, bracket->b, options->tolerance))
+            break;
+
+        double mid = bracket->a + (bracket->b - bracket->a) / 2;
+        if (mid == bracket->a || mid == bracket->b)
+            break;
+
+        /* a secant step, unless it would leave the bracket */
+        double c = bracket->b - bracket->fb * (bracket->b - bracket->a) / (bracket->fb - bracket->fa);
+        if (!(c > fmin(bracket->a, bracket->b) && c < fmax(bracket->a, bracket->b)))
+            c = mid;
+
+        double fc = _solve_residual_fast(residual, c, &err);
+        if (err) return err;
+        if (isnan(fc)) {
+            c = mid;
+            fc = _solve_residual_fast(residual, c, &err);
+            if (err) return err;
+            if (isnan(fc))
+                break;
+        }
+
+        /* keep the ends on either side of the root, an end that's kept twice has it's value halved,
+            so the next secant step moves past the root instead of creeping up on it */
+        if (_solve_sign_change(bracket->fb, fc)) {
+            bracket->a  = bracket->b;
+            bracket->fa = bracket->fb;
+        } else {
+            bracket->fa /= 2;
+        }
+        bracket->b  = c;
+        bracket->fb = fc;
+    }
+    return err;
+}
+
+/* narrow a bracket at the scope's precision with the Illinois method
+ *
+ * @residual the residual
+ * @a one end of the bracket, it's replaced by the end nearest the root
+ * @b the other end
+ * @options the tolerance and iteration limit
+ * @bracketed set to false if the residual doesn't change sign between `a` and `b` at the scope's precision
+ * @return returns an error code
+ */
+error_t _solve_refine_exact(_solve_residual_t* residual, mpfr_ptr a, mpfr_ptr b,
+                            const expression_root_options_t* options, bool* bracketed) {
+    mpfr_prec_t precision = mpfr_get_prec(a);
+    mpfr_t fa, fb, c, fc, mid, step;
+    mpfr_inits2(precision, fa, fb, c, fc, mid, step, (mpfr_ptr)NULL);
+
+    error_t err = _solve_residual_exact(residual, a, fa);
+    if (!err)
+        err = _solve_residual_exact(residual, b, fb);
+    *bracketed = !err && _solve_sign_change(mpfr_get_d(fa, MPFR_RNDN), mpfr_get_d(fb, MPFR_RNDN));
+
+    for (size_t i = 0; *bracketed && i < options->max_iterations; ++i) {
+        if (mpfr_zero_p(fa) || mpfr_zero_p(fb)
+            || _solve_narrow(mpfr_get_d(a, MPFR_RNDN), mpfr_get_d(b, MPFR_RNDN), options->tolerance))
+            break;
+
+        mpfr_add(mid, a, b, MPFR_RNDN);
+        mpfr_div_2ui(mid, mid, 1, MPFR_RNDN);
+        if (mpfr_equal_p(mid, a) || mpfr_equal_p(mid, b))
+            break;
+
+        /* c = b - fb * (b - a) / (fb - fa) */
+        mpfr_sub(step, b, a, MPFR_RNDN);
+        mpfr_mul(step, step, fb, MPFR_RNDN);
+        mpfr_sub(c, fb, fa, MPFR_RNDN);
+        mpfr_div(step, step, c, MPFR_RNDN);
+        mpfr_sub(c, b, step, MPFR_RNDN);
+        bool inside = mpfr_less_p(a, b) ? mpfr_less_p(a, c) && mpfr_less_p(c, b)
+                                        : mpfr_less_p(b, c) && mpfr_less_p(c, a);
+        if (!inside)
+            mpfr_set(c, mid, MPFR_RNDN);
+
+        err = _solve_residual_exact(residual, c, fc);
+        if (!err && mpfr_nan_p(fc)) {
+            mpfr_set(c, mid, MPFR_RNDN);
+            err = _solve_residual_exact(residual, c, fc);
+            if (!err && mpfr_nan_p(fc))
+                break;
+        }
+        if (err) break;
+
+        if (mpfr_zero_p(fc) || mpfr_signbit(fc) != mpfr_signbit(fb)) {
+            mpfr_swap(a, b);
+            mpfr_swap(fa, fb);
+        } else {
+            mpfr_div_2ui(fa, fa, 1, MPFR_RNDN);
+        }
+        mpfr_swap(b, c);
+        mpfr_swap(fb, fc);
+    }
+
+    /* the end with the smallest residual is the root */
+    if (!err && *bracketed && mpfr_cmpabs(fb, fa) < 0)
+        mpfr_swap(a, b);
+
+    mpfr_clears(fa, fb, c, fc, mid, step, (mpfr_ptr)NULL);
+    return err;
+}
+
+error_t expression_find_root(expression_t* expr, variable_t var, scope_t* scope,
+                             const expression_root_options_t* options) {
+    expression_root_options_t defaults;
+    if (!options) {
+        expression_root_options_init(&defaults);
+        options = &defaults;
+    }
+
+    if (expression_is_comparison(expr) && expr->operator.infix != '=')
+        return ERROR_INVALID_OPERATOR;
+    if (!_solve_uses(expr, var))
+        return ERROR_VARIABLE_NOT_PRESENT;
+
+    _solve_residual_t residual;
+    residual.var    = var;
+    residual.scope  = scope;
+    residual.policy = scope_get_precision_policy(scope);
+    if (EXPRESSION_IS_OPERATOR(expr) && expr->operator.infix == '=') {
+        expression_t* left = malloc(sizeof(expression_t));
+        expression_t* right = malloc(sizeof(expression_t));
+        expression_copy(expr->operator.left, left);
+        expression_copy(expr->operator.right, right);
+        expression_init_operator(&residual.residual, left, '-', right);
+    } else {
+        expression_copy(expr, &residual.residual);
+    }
+    _solve_unbind(&residual.residual, var);
+
+    /* the residual is evaluated many times, so it's compiled if it can be */
+    expression_list_t* parameters = malloc(sizeof(expression_list_t));
+    expression_list_init(parameters);
+    expression_list_append(parameters, expression_new_variable(var));
+    residual.compiled = !jit_compile(&residual.function, &residual.residual, scope, parameters);
+    expression_list_free(parameters);
+
+    _solve_bracket_t bracket;
+    error_t err = _solve_bracket(&residual, options->guess, &bracket);
+    _solve_bracket_t found = bracket;
+    if (!err)
+        err = _solve_refine_fast(&residual, &bracket, options);
+
+    mpfr_ptr root = precision_policy_new_number(residual.policy, 0, 0);
+    if (!err) {
+        mpfr_t other;
+        mpfr_init2(other, mpfr_get_prec(root));
+        bool bracketed;
+
+        /* the bracket found in doubles may not hold at a higher precision, then the first bracket is used */
+        mpfr_set_d(root, bracket.a, MPFR_RNDN);
+        mpfr_set_d(other, bracket.b, MPFR_RNDN);
+        err = _solve_refine_exact(&residual, root, other, options, &bracketed);
+        if (!err && !bracketed) {
+            mpfr_set_d(root, found.a, MPFR_RNDN);
+            mpfr_set_d(other, found.b, MPFR_RNDN);
+            err = _solve_refine_exact(&residual, root, other, options, &bracketed);
+        }
+
+        /* if the residual only changes sign in double precision, the root found in doubles is the best there is */
+        if (!err && !bracketed)
+            mpfr_set_d(root, fabs(bracket.fa) < fabs(bracket.fb) ? bracket.a : bracket.b, MPFR_RNDN);
+        mpfr_clear(other);
+    }
+
+    if (residual.compiled)
+        jit_clean(&residual.function);
+    expression_clean(&residual.residual);
+
+    if (err) {
+        mpfr_clear(root);
+        free(root);
+        return err;
+    }
+
+    expression_t* value = malloc(sizeof(expression_t));
+    expression_init_number(value, root);
+    expression_clean(expr);
+    expression_init_operator(expr, expression_new_variable(var), '=', value);
+    return ERROR_NO_ERROR;
+}
+
+error_t expression_isolate_variable_numeric(expression_t* expr, variable_t var, scope_t* scope,
+                                            const expression_root_options_t* options) {
+    expression_t original;
+    expression_copy(expr, &original);
+
+    error_t err = expression_isolate_variable(expr, var);
+    if (err == ERROR_BUDGET_EXCEEDED
+        || (!err && EXPRESSION_IS_VARIABLE(expr->operator.left) && strcmp(expr->operator.left->variable.value, var) == 0
+            && !_solve_uses(expr->operator.right, var))) {
+        expression_clean(&original);
+        return err;
+    }
+
+    /* the variable couldn't be isolated, so the original equation is solved numerically */
+    err = expression_find_root(&original, var, scope, options);
+    if (err) {
+        expression_clean(&original);
+        return err;
+    }
+
+    expression_clean(expr);
+    *expr = original;
+    return ERROR_NO_ERROR;
+}
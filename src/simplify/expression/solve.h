@@ -0,0 +1,156 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_SOLVE_H_
+#define SIMPLIFY_EXPRESSION_SOLVE_H_
+
+#include "simplify/expression/expression.h"
+#include "simplify/expression/jit.h"
+
+/* the most rows each task evaluates when a batch is evaluated on a thread pool */
+#ifndef EXPRESSION_SOLVE_BATCH_CHUNK
+#   define EXPRESSION_SOLVE_BATCH_CHUNK 1024
+#endif
+
+/* the most steps taken to refine a root, at each precision, before giving up */
+#ifndef EXPRESSION_ROOT_MAX_ITERATIONS
+#   define EXPRESSION_ROOT_MAX_ITERATIONS 200
+#endif
+
+/* the most times the search for a sign change doubles it's distance from the first guess */
+#ifndef EXPRESSION_ROOT_BRACKET_STEPS
+#   define EXPRESSION_ROOT_BRACKET_STEPS 64
+#endif
+
+/* An equation solved for one of it's variables */
+typedef struct expression_solution expression_solution_t;
+
+/* How a root is found numerically */
+typedef struct expression_root_options expression_root_options_t;
+
+/* Solving the same equation for many values of it's coefficients only needs the variable to be isolated once.
+ * The equation is solved symbolically, with the coefficients left as named parameters, and the solution is simplified.
+ * Each set of parameter values then only costs evaluating the solution.
+ *
+ * The solution is also compiled to a function of it's parameters (see jit.h), if it can be.
+ * Batches are evaluated by the compiled function, in double precision, split across the scope's thread pool.
+ */
+struct expression_solution {
+    /* the variable that was solved for */
+    char*              variable;
+
+    /* the relation between the variable and it's value, '=' unless the equation was an inequality */
+    operator_t         relation;
+
+    /* the variable's value, in terms of the parameters */
+    expression_t       value;
+
+    /* the parameters' names, as variables */
+    expression_list_t* parameters;
+    size_t             parameter_count;
+
+    /* the value compiled to a function of the parameters, only set if `compiled` is true */
+    jit_function_t     function;
+    bool               compiled;
+};
+
+/* When a variable can't be isolated symbolically, like in `x + sin(x) = 2`, it's value can still be found numerically.
+ * The residual of the equation, `LEFT - RIGHT`, is searched for a sign change, moving away from a first guess in
+ * both directions. The root in that bracket is refined with safeguarded secant steps (the Illinois variant of regula
+ * falsi), falling back to bisection when a step would leave the bracket.
+ *
+ * The residual is compiled (see jit.h), if it can be, so the root is first found in double precision, cheaply.
+ * It's then refined at the scope's precision by evaluating the residual, starting from the bracket found in doubles.
+ */
+struct expression_root_options {
+    /* where the search for a sign change starts */
+    double guess;
+
+    /* the root is refined until the bracket around it is no wider than this, relative to the root's magnitude, or one
+     * if the root is smaller. If zero the root is refined until the bracket can't be narrowed at the scope's precision.
+     */
+    double tolerance;
+
+    /* the most steps taken to refine the root, at each precision */
+    size_t max_iterations;
+};
+
+/* initialize root finding options, the search starts at zero and refines the root as far as it can
+ *
+ * @options the options to initialize
+ */
+static inline void expression_root_options_init(expression_root_options_t* options) {
+    options->guess          = 0;
+    options->tolerance      = 0;
+    options->max_iterations = EXPRESSION_ROOT_MAX_ITERATIONS;
+}
+
+/* solve an equation for a variable, in terms of some parameters
+ *
+ * @solution location to store the solution, it must be cleaned with `expression_solution_clean`
+ * @equation the equation, it isn't changed
+ * @var the variable to solve for
+ * @parameters the names of the equation's coefficients, as variables. They shadow definitions in `scope`.
+ * @scope the scope the solution is compiled in, names that aren't parameters are looked up in it
+ * @return returns ERROR_VARIABLE_NOT_PRESENT if the variable couldn't be isolated,
+ *          or ERROR_INVALID_IDENTIFIER if a parameter isn't a variable
+ */
+error_t expression_solve(expression_solution_t* solution, expression_t* equation, variable_t var,
+                         expression_list_t* parameters, scope_t* scope);
+
+/* free the resources used by a solution
+ *
+ * @solution the solution to clean
+ */
+void expression_solution_clean(expression_solution_t* solution);
+
+/* evaluate a solution for one set of parameter values, at the scope's precision
+ *
+ * @solution the solution
+ * @scope the scope to evaluate the solution in
+ * @arguments the value of each parameter, in order, they're copied
+ * @out set to the variable's value
+ * @return returns an error code
+ */
+error_t expression_solution_evaluate(expression_solution_t* solution, scope_t* scope, expression_t** arguments,
+                                     expression_t* out);
+
+/* evaluate a solution for many sets of parameter values, in double precision.
+ * If the solution was compiled, and the scope has a thread pool, the rows are evaluated in parallel.
+ * Otherwise each row is evaluated by expression_solution_evaluate, and values that aren't numbers become NaN.
+ *
+ * @solution the solution
+ * @scope the scope to evaluate the solution in
+ * @arguments `count` rows of parameter values, each row has a value for every parameter, in order
+ * @count the number of rows
+ * @results location to store the variable's value for each row
+ * @return returns an error code
+ */
+error_t expression_solution_evaluate_batch(expression_solution_t* solution, scope_t* scope, const double* arguments,
+                                           size_t count, double* results);
+
+/* find a root of an equation numerically, the equation is replaced by `VAR = ROOT`.
+ * If the equation doesn't have a relation, a root of the expression is found, like expression_isolate_variable.
+ *
+ * @expr the equation
+ * @var the variable to solve for
+ * @scope the scope to evaluate the equation in, every name except `var` must have a numeric value
+ * @options how to find the root, or NULL to use the defaults
+ * @return returns ERROR_VARIABLE_NOT_PRESENT if the equation doesn't use the variable,
+ *          ERROR_INVALID_OPERATOR if it's an inequality, or ERROR_NO_ROOT_FOUND if the residual never changed sign
+ */
+error_t expression_find_root(expression_t* expr, variable_t var, scope_t* scope,
+                             const expression_root_options_t* options);
+
+/* isolate a variable, like expression_isolate_variable, finding it's value numerically if it couldn't be isolated or
+ * it's still on both sides of the equation
+ *
+ * @expr the equation
+ * @var the variable to isolate
+ * @scope the scope to evaluate the equation in if it's solved numerically
+ * @options how to find a root numerically, or NULL to use the defaults
+ * @return returns an error code
+ */
+error_t expression_isolate_variable_numeric(expression_t* expr, variable_t var, scope_t* scope,
+                                            const expression_root_options_t* options);
+
+#endif  // SIMPLIFY_EXPRESSION_SOLVE_H_
@@ -1,6 +1,7 @@
 /* Copyright Ian Shehadeh 2018 */
 
 #include "simplify/expression/stringify.h"
+#include "simplify/expression/chain.h"
 
 void _stringifier_round_number(stringifier_t* st, size_t start, size_t numstart) {
     /* round direction is `1` to round up or `-1` to round down */
@@ -119,13 +120,25 @@ size_t stringifier_write_operator(stringifier_t* st, expression_t* op) {
     if (st->current_precedence < oldprec)
         written += stringifier_write_byte(st, '(');
 
-    written += stringifier_write_expression(st, op->operator.left);
-
-    written +=stringifier_write_whitespace(st);
-    written += stringifier_write_byte(st, op->operator.infix);
-    written += stringifier_write_whitespace(st);
+    /* a sum or product is written one operand at a time, instead of recursing once per operator */
+    expression_chain_t chain;
+    expression_chain_init(&chain, op->operator.infix);
+    if (EXPRESSION_IS_CHAIN(op)) {
+        expression_chain_collect(&chain, op);
+    } else {
+        expression_chain_append(&chain, op->operator.left);
+        expression_chain_append(&chain, op->operator.right);
+    }
 
-    written += stringifier_write_expression(st, op->operator.right);
+    for (size_t i = 0; i < chain.count; ++i) {
+        if (i) {
+            written += stringifier_write_whitespace(st);
+            written += stringifier_write_byte(st, op->operator.infix);
+            written += stringifier_write_whitespace(st);
+        }
+        written += stringifier_write_expression(st, chain.operands[i]);
+    }
+    expression_chain_clean(&chain);
 
     if (st->current_precedence < oldprec)
         written += stringifier_write_byte(st, ')');
@@ -141,6 +154,45 @@ size_t stringifier_write_prefix(stringifier_t* st, expression_t* pre) {
     return written;
 }
 
+/* write a number rounded to `st->digits` significant digits, in positional notation
+ *
+ * @st the stringifier to write to
+ * @num the number to write, it must be a regular, positive number
+ * @return returns the number of bytes written
+ */
+size_t _stringifier_write_digits(stringifier_t* st, mpfr_ptr num) {
+    mpfr_exp_t exponent;
+    char* digits = mpfr_get_str(NULL, &exponent, 10, st->digits, num, MPFR_RNDN);
+    size_t length = strlen(digits);
+    size_t start = st->index;
+
+    if (exponent <= 0) {
+        stringifier_write(st, "0.");
+        for (mpfr_exp_t i = exponent; i < 0; ++i)
+            stringifier_write_byte(st, '0');
+        stringifier_write_len(st, digits, length);
+    } else if ((size_t)exponent >= length) {
+        stringifier_write_len(st, digits, length);
+        for (size_t i = length; i < (size_t)exponent; ++i)
+            stringifier_write_byte(st, '0');
+    } else {
+        stringifier_write_len(st, digits, exponent);
+        stringifier_write_byte(st, '.');
+        stringifier_write_len(st, digits + exponent, length - exponent);
+    }
+    mpfr_free_str(digits);
+
+    /* the digits are already correctly rounded, so only trailing zeros after the decimal point are trimmed */
+    if (exponent <= 0 || (size_t)exponent < length) {
+        while (st->buffer[st->index - 1] == '0')
+            --st->index;
+        if (st->buffer[st->index - 1] == '.')
+            --st->index;
+    }
+
+    return st->index - start;
+}
+
 size_t stringifier_write_number(stringifier_t* st, expression_t* number) {
     assert(EXPRESSION_IS_NUMBER(number));
 
@@ -169,6 +221,9 @@ size_t stringifier_write_number(stringifier_t* st, expression_t* number) {
         written += stringifier_write_byte(st, '-');
         mpfr_abs(num, num, MPFR_RNDN);
     }
+
+    if (st->digits)
+        return written + _stringifier_write_digits(st, num);
     size_t numlen = ceil(prec * log(2)/log(base)) + 3;
 
     _STRINGIFIER_FIT(st, numlen);
@@ -237,9 +292,24 @@ char* stringify(expression_t* expr) {
     return st.buffer;
 }
 
+char* stringify_digits(expression_t* expr, size_t digits) {
+    stringifier_t st = STRINGIFIER_DEFAULT();
+    st.digits = digits;
+    stringifier_write_expression(&st, expr);
+    stringifier_write_byte(&st, 0);
+    return st.buffer;
+}
+
 error_t expression_fprint(expression_t* expr, FILE* f) {
     char* str = stringify(expr);
     fputs(str, f);
     free(str);
     return ERROR_NO_ERROR;
 }
+
+error_t expression_fprint_digits(expression_t* expr, FILE* f, size_t digits) {
+    char* str = stringify_digits(expr, digits);
+    fputs(str, f);
+    free(str);
+    return ERROR_NO_ERROR;
+}
@@ -24,6 +24,7 @@
     .index = 0,                                        \
     .approximate_tolerance = 5,                        \
     .approximate_numbers = true,                       \
+    .digits = 0,                                       \
     .nan_string = "NaN",                               \
     .inf_string = "Inf",                               \
     .whitespace = " ",                                 \
@@ -50,6 +51,10 @@ struct stringifier {
     size_t approximate_tolerance;
     bool approximate_numbers;
 
+    /* if non-zero numbers are correctly rounded to this many significant digits,
+        instead of being written at their full precision */
+    size_t digits;
+
     char* nan_string;
     char* inf_string;
     char* whitespace;
@@ -68,6 +73,14 @@ struct stringifier {
  */
 char* stringify(expression_t* expr);
 
+/* Write the expression `expr` as a c string, rounding each number to `digits` significant digits
+ *
+ * @expr the expression to stringify
+ * @digits the number of significant digits to write
+ * @return returns a null-terminated string. This string must be freed using `free` by the user.
+ */
+char* stringify_digits(expression_t* expr, size_t digits);
+
 size_t stringifier_write_expression(stringifier_t* st, expression_t* expr);
 size_t stringifier_write_function(stringifier_t* st, expression_t* func);
 size_t stringifier_write_number(stringifier_t* st, expression_t* number);
@@ -148,4 +161,12 @@ static inline error_t expression_print(expression_t* expr) {
     return expression_fprint(expr, stdout);
 }
 
+/* print an expression to `file`, rounding each number to `digits` significant digits
+ * @file the file to write to
+ * @expr the expression to print
+ * @digits the number of significant digits to write, or zero to write numbers at their full precision
+ * @return an error code
+ */
+error_t expression_fprint_digits(expression_t* expr, FILE* file, size_t digits);
+
 #endif  // SIMPLIFY_EXPRESSION_STRINGIFY_H_
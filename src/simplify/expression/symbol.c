@@ -0,0 +1,100 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/symbol.h"
+
+/* every symbol, chained by the hash of their name */
+static symbol_t* _g_symbols[SYMBOL_TABLE_BUCKETS];
+
+/* hash a name with FNV-1a
+ *
+ * @name the name to hash
+ * @return returns the name's hash
+ */
+static inline uint64_t _symbol_hash(const char* name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (; *name; ++name) {
+        hash ^= (unsigned char)*name;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+symbol_t* symbol_intern(const char* name) {
+    symbol_t** bucket = &_g_symbols[_symbol_hash(name) & (SYMBOL_TABLE_BUCKETS - 1)];
+    for (symbol_t* symbol = *bucket; symbol; symbol = symbol->next) {
+        if (strcmp(symbol->name, name) == 0)
+            return symbol;
+    }
+
+    size_t length = strlen(name);
+    symbol_t* symbol = malloc(sizeof(symbol_t));
+    symbol->name = malloc(length + 1);
+    memcpy(symbol->name, name, length + 1);
+    symbol->definitions = 0;
+    symbol->scope = NULL;
+    symbol->index = 0;
+    symbol->dependents = NULL;
+    symbol->dependent_count = 0;
+    symbol->dependent_capacity = 0;
+    symbol->next = *bucket;
+    *bucket = symbol;
+    return symbol;
+}
+
+void symbol_define(symbol_t* symbol, scope_t* scope, size_t index) {
+    ++symbol->definitions;
+    symbol->scope = NULL;
+    if (scope)
+        symbol_learn(symbol, scope, index);
+}
+
+void symbol_undefine(symbol_t* symbol) {
+    assert(symbol->definitions > 0);
+
+    /* the remaining definition is found the next time the name is looked up */
+    --symbol->definitions;
+    symbol->scope = NULL;
+}
+
+void symbol_table_free(void) {
+    for (size_t i = 0; i < SYMBOL_TABLE_BUCKETS; ++i) {
+        symbol_t* symbol = _g_symbols[i];
+        while (symbol) {
+            symbol_t* next = symbol->next;
+            free(symbol->dependents);
+            free(symbol->name);
+            free(symbol);
+            symbol = next;
+        }
+        _g_symbols[i] = NULL;
+    }
+}
+
+void symbol_resolve(expression_t* expr) {
+    switch (expr->type) {
+        case EXPRESSION_TYPE_NUMBER:
+            break;
+        case EXPRESSION_TYPE_VARIABLE:
+            if (!expr->variable.symbol)
+                expr->variable.symbol = symbol_intern(expr->variable.value);
+            break;
+        case EXPRESSION_TYPE_PREFIX:
+            symbol_resolve(expr->prefix.right);
+            break;
+        case EXPRESSION_TYPE_OPERATOR:
+            symbol_resolve(expr->operator.left);
+            symbol_resolve(expr->operator.right);
+            break;
+        case EXPRESSION_TYPE_FUNCTION:
+        {
+            if (!expr->function.symbol)
+                expr->function.symbol = symbol_intern(expr->function.name);
+
+            expression_t* param;
+            EXPRESSION_LIST_FOREACH(param, expr->function.parameters) {
+                symbol_resolve(param);
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_SYMBOL_H_
+#define SIMPLIFY_EXPRESSION_SYMBOL_H_
+
+#include "simplify/expression/expr_types.h"
+
+/* the number of buckets in the symbol table, must be a power of two */
+#ifndef SYMBOL_TABLE_BUCKETS
+#   define SYMBOL_TABLE_BUCKETS 1024
+#endif
+
+/* A symbol is an interned variable or function name.
+ *
+ * There's one symbol for each name, so references to the same name share a symbol, and they can be compared by address.
+ * Every symbol counts the live definitions of it's name, in every scope and call frame.
+ * While a name is defined exactly once, in a scope's slots, the symbol remembers that slot, so references
+ * resolved to the symbol can load their definition without searching any scope.
+ * A new definition of the name, including an argument named after it, makes the definition ambiguous,
+ * and lookups search the scope chain until only one definition is left.
+ * Redefining a name in the same scope replaces the definition in the same slot, so the symbol doesn't change.
+ */
+struct symbol {
+    char*  name;
+
+    /* the number of scopes and call frames the name is defined in */
+    size_t definitions;
+
+    /* the scope holding the name's only definition, and the index of it's slot. NULL if it isn't known */
+    scope_t* scope;
+    size_t   index;
+
+    /* the values in value caches that were evaluated using the name, see value_cache.h */
+    value_cache_entry_t** dependents;
+    size_t                dependent_count;
+    size_t                dependent_capacity;
+
+    symbol_t* next;
+};
+
+/* get the symbol for a name, it's created the first time the name is used
+ *
+ * @name the name, it's copied
+ * @return returns the name's symbol, symbols are freed by `symbol_table_free`
+ */
+symbol_t* symbol_intern(const char* name);
+
+/* record a new definition of a symbol
+ *
+ * @symbol the symbol that was defined
+ * @scope the scope the definition is in, or NULL if it's a call frame's argument
+ * @index the index of the definition's slot in `scope`
+ */
+void symbol_define(symbol_t* symbol, scope_t* scope, size_t index);
+
+/* record that a definition of a symbol was removed
+ *
+ * @symbol the symbol
+ */
+void symbol_undefine(symbol_t* symbol);
+
+/* remember which slot holds a symbol's definition, if it's the only one
+ *
+ * @symbol the symbol
+ * @scope the scope it's definition was found in
+ * @index the index of the definition's slot in `scope`
+ */
+static inline void symbol_learn(symbol_t* symbol, scope_t* scope, size_t index) {
+    if (symbol->definitions == 1) {
+        symbol->scope = scope;
+        symbol->index = index;
+    }
+}
+
+/* free every symbol, no expression may reference a symbol after they're freed,
+ * and every value cache must be cleaned first
+ */
+void symbol_table_free(void);
+
+/* intern the name of every variable and function referenced by an expression that doesn't have a symbol yet
+ *
+ * @expr the expression to resolve
+ */
+void symbol_resolve(expression_t* expr);
+
+#endif  // SIMPLIFY_EXPRESSION_SYMBOL_H_
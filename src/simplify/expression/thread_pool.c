@@ -0,0 +1,210 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <sched.h>
+
+#include "simplify/expression/thread_pool.h"
+#include "simplify/expression/call_stack.h"
+
+/* the index of the deque this thread pushes it's tasks onto */
+static CALL_STACK_THREAD_LOCAL size_t _g_thread_pool_worker;
+
+/* A worker thread's arguments */
+typedef struct {
+    thread_pool_t* pool;
+    size_t         index;
+} _thread_pool_worker_t;
+
+/* push a task onto the bottom of a deque
+ *
+ * @deque the deque
+ * @task the task
+ */
+void _thread_pool_deque_push(thread_pool_deque_t* deque, thread_pool_task_t* task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom >= deque->capacity) {
+        if (deque->top > 0) {
+            /* tasks were stolen from the top, reuse their space */
+            memmove(deque->tasks, &deque->tasks[deque->top], (deque->bottom - deque->top) * sizeof(thread_pool_task_t*));
+            deque->bottom -= deque->top;
+            deque->top = 0;
+        } else {
+            deque->capacity = deque->capacity ? deque->capacity * 2 : THREAD_POOL_DEQUE_INITIAL_SIZE;
+            deque->tasks = realloc(deque->tasks, deque->capacity * sizeof(thread_pool_task_t*));
+        }
+    }
+    deque->tasks[deque->bottom++] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/* take a task from a deque
+ *
+ * @deque the deque
+ * @steal if true the oldest task is taken from the top, otherwise the newest is taken from the bottom
+ * @return returns the task, or NULL if the deque is empty
+ */
+thread_pool_task_t* _thread_pool_deque_take(thread_pool_deque_t* deque, bool steal) {
+    thread_pool_task_t* task = NULL;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        task = steal ? deque->tasks[deque->top++] : deque->tasks[--deque->bottom];
+        if (deque->top == deque->bottom)
+            deque->top = deque->bottom = 0;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return task;
+}
+
+/* find a task for a worker to run, from it's own deque first, then from the other workers'
+ *
+ * @pool the pool
+ * @index the worker's index
+ * @return returns a task, or NULL if there weren't any queued
+ */
+thread_pool_task_t* _thread_pool_take(thread_pool_t* pool, size_t index) {
+    thread_pool_task_t* task = _thread_pool_deque_take(&pool->deques[index], false);
+    bool stolen = false;
+
+    for (size_t i = 1; !task && i < pool->workers; ++i) {
+        task = _thread_pool_deque_take(&pool->deques[(index + i) % pool->workers], true);
+        stolen = true;
+    }
+
+    if (task) {
+        pthread_mutex_lock(&pool->lock);
+        --pool->queued;
+        if (stolen)
+            ++pool->stolen;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return task;
+}
+
+/* run a task, and mark it as done
+ *
+ * @task the task
+ */
+void _thread_pool_run(thread_pool_task_t* task) {
+    task->function(task->data);
+    __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+}
+
+/* a worker thread's main loop, it runs tasks until the pool is stopped
+ *
+ * @arg the worker's arguments
+ * @return returns NULL
+ */
+void* _thread_pool_worker_main(void* arg) {
+    _thread_pool_worker_t* worker = arg;
+    thread_pool_t* pool = worker->pool;
+    _g_thread_pool_worker = worker->index;
+    free(worker);
+
+    for (;;) {
+        thread_pool_task_t* task = _thread_pool_take(pool, _g_thread_pool_worker);
+        if (task) {
+            _thread_pool_run(task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->stop && pool->queued == 0)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        bool stop = pool->stop;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (stop)
+            break;
+    }
+
+    /* tasks may have left values and cached constants in this thread's storage */
+    call_stack_free();
+    mpfr_free_cache();
+    return NULL;
+}
+
+error_t thread_pool_init(thread_pool_t* pool, size_t workers) {
+    if (workers == 0)
+        workers = 1;
+
+    pool->workers = workers;
+    pool->threads = calloc(workers, sizeof(pthread_t));
+    pool->deques  = calloc(workers, sizeof(thread_pool_deque_t));
+    pool->queued  = 0;
+    pool->stop    = false;
+    pool->spawned = 0;
+    pool->stolen  = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (size_t i = 0; i < workers; ++i)
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+
+    /* the calling thread is the first worker */
+    _g_thread_pool_worker = 0;
+    for (size_t i = 1; i < workers; ++i) {
+        _thread_pool_worker_t* worker = malloc(sizeof(_thread_pool_worker_t));
+        worker->pool  = pool;
+        worker->index = i;
+
+        if (pthread_create(&pool->threads[i], NULL, _thread_pool_worker_main, worker)) {
+            free(worker);
+            pool->workers = i;
+            thread_pool_clean(pool);
+            return ERROR_THREAD_START;
+        }
+    }
+
+    return ERROR_NO_ERROR;
+}
+
+void thread_pool_clean(thread_pool_t* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 1; i < pool->workers; ++i)
+        pthread_join(pool->threads[i], NULL);
+
+    for (size_t i = 0; i < pool->workers; ++i) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->deques);
+    free(pool->threads);
+    pool->deques  = NULL;
+    pool->threads = NULL;
+    pool->workers = 0;
+}
+
+void thread_pool_spawn(thread_pool_t* pool, thread_pool_task_t* task, thread_pool_function_t function, void* data) {
+    task->function = function;
+    task->data     = data;
+    task->done     = 0;
+
+    /* threads that aren't workers share the first deque */
+    size_t index = _g_thread_pool_worker < pool->workers ? _g_thread_pool_worker : 0;
+    _thread_pool_deque_push(&pool->deques[index], task);
+
+    pthread_mutex_lock(&pool->lock);
+    ++pool->queued;
+    ++pool->spawned;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_join(thread_pool_t* pool, thread_pool_task_t* task) {
+    size_t index = _g_thread_pool_worker < pool->workers ? _g_thread_pool_worker : 0;
+
+    while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+        thread_pool_task_t* next = _thread_pool_take(pool, index);
+        if (next)
+            _thread_pool_run(next);
+        else
+            sched_yield();
+    }
+}
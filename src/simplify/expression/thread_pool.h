@@ -0,0 +1,96 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_THREAD_POOL_H_
+#define SIMPLIFY_EXPRESSION_THREAD_POOL_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "simplify/expression/expr_types.h"
+
+/* the number of tasks a worker's deque has room for before it grows */
+#ifndef THREAD_POOL_DEQUE_INITIAL_SIZE
+#   define THREAD_POOL_DEQUE_INITIAL_SIZE 64
+#endif
+
+typedef struct thread_pool_task thread_pool_task_t;
+typedef struct thread_pool_deque thread_pool_deque_t;
+
+/* a task's work, it's given the task's data */
+typedef void (*thread_pool_function_t)(void* data);
+
+/* A task that may run on any of the pool's threads.
+ * The task is owned by the thread that spawned it, which must join it before it's freed.
+ */
+struct thread_pool_task {
+    thread_pool_function_t function;
+    void*                  data;
+    int                    done;
+};
+
+/* The tasks spawned by one worker.
+ * The worker pushes and pops tasks at the bottom, so it runs the work it spawned most recently first,
+ * and idle workers steal the oldest tasks from the top, which are usually the largest.
+ */
+struct thread_pool_deque {
+    pthread_mutex_t      lock;
+    thread_pool_task_t** tasks;
+    size_t               top;
+    size_t               bottom;
+    size_t               capacity;
+};
+
+/* A work stealing thread pool for fork-join parallelism.
+ *
+ * Each worker has a deque of the tasks it spawned. A thread waiting to join a task runs other tasks in the meantime,
+ * first from it's own deque, then stolen from the other workers, so waiting never blocks a worker.
+ * The thread that initialized the pool is the first worker, it runs tasks while it waits for them.
+ */
+struct thread_pool {
+    size_t               workers;
+    pthread_t*           threads;
+    thread_pool_deque_t* deques;
+
+    /* idle workers sleep until a task is queued, or the pool is stopped */
+    pthread_mutex_t      lock;
+    pthread_cond_t       wake;
+    size_t               queued;
+    bool                 stop;
+
+    /* statistics */
+    size_t               spawned;
+    size_t               stolen;
+};
+
+/* initialize a thread pool, and start it's threads
+ *
+ * @pool the pool to initialize
+ * @workers the number of threads that run tasks, including the calling thread. There is always at least one worker.
+ * @return returns ERROR_THREAD_START if a thread couldn't be started
+ */
+error_t thread_pool_init(thread_pool_t* pool, size_t workers);
+
+/* stop a thread pool's threads and free it's resources, no tasks may be running
+ *
+ * @pool the pool to clean
+ */
+void thread_pool_clean(thread_pool_t* pool);
+
+/* queue a task on the calling worker's deque, it may run on any thread
+ *
+ * @pool the pool
+ * @task the task, it must stay valid until it's joined
+ * @function the task's work
+ * @data the data given to `function`
+ */
+void thread_pool_spawn(thread_pool_t* pool, thread_pool_task_t* task, thread_pool_function_t function, void* data);
+
+/* wait for a task to finish, running other tasks until it does
+ *
+ * @pool the pool
+ * @task a task spawned by the calling thread
+ */
+void thread_pool_join(thread_pool_t* pool, thread_pool_task_t* task);
+
+#endif  // SIMPLIFY_EXPRESSION_THREAD_POOL_H_
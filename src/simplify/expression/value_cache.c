@@ -0,0 +1,187 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "simplify/expression/value_cache.h"
+#include "simplify/expression/call_stack.h"
+#include "simplify/expression/symbol.h"
+
+/* the innermost value being recorded on this thread */
+static CALL_STACK_THREAD_LOCAL value_cache_recording_t* _g_value_cache_recording;
+
+/* add a symbol to a list, unless it's already in the list
+ *
+ * @symbols the list
+ * @count the number of symbols in the list
+ * @capacity the number of symbols the list has room for
+ * @symbol the symbol to add
+ */
+void _value_cache_add_symbol(symbol_t*** symbols, size_t* count, size_t* capacity, symbol_t* symbol) {
+    for (size_t i = 0; i < *count; ++i) {
+        if ((*symbols)[i] == symbol)
+            return;
+    }
+
+    if (*count >= *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 8;
+        *symbols = realloc(*symbols, *capacity * sizeof(symbol_t*));
+    }
+    (*symbols)[(*count)++] = symbol;
+}
+
+/* remove an entry from the values that depend on a symbol
+ *
+ * @symbol the symbol
+ * @entry the entry
+ */
+void _value_cache_remove_dependent(symbol_t* symbol, value_cache_entry_t* entry) {
+    for (size_t i = symbol->dependent_count; i > 0; --i) {
+        if (symbol->dependents[i - 1] == entry) {
+            symbol->dependents[i - 1] = symbol->dependents[--symbol->dependent_count];
+            return;
+        }
+    }
+}
+
+/* free an entry, and remove it from it's cache, it's definition, and the symbols it depends on
+ *
+ * @entry the entry to free
+ */
+void _value_cache_entry_free(value_cache_entry_t* entry) {
+    for (size_t i = 0; i < entry->dependency_count; ++i)
+        _value_cache_remove_dependent(entry->dependencies[i], entry);
+
+    if (entry->previous)
+        entry->previous->next = entry->next;
+    else
+        entry->cache->entries = entry->next;
+    if (entry->next)
+        entry->next->previous = entry->previous;
+
+    entry->definition->cached = NULL;
+    expression_clean(&entry->value);
+    free(entry->dependencies);
+    free(entry);
+}
+
+void value_cache_init(value_cache_t* cache) {
+    cache->entries       = NULL;
+    cache->hits          = 0;
+    cache->misses        = 0;
+    cache->invalidations = 0;
+}
+
+void value_cache_clean(value_cache_t* cache) {
+    while (cache->entries)
+        _value_cache_entry_free(cache->entries);
+}
+
+bool value_cache_lookup(value_cache_t* cache, variable_info_t* definition, const precision_policy_t* policy, expression_t* value) {
+    value_cache_entry_t* entry = definition->cached;
+    if (!entry || entry->cache != cache || entry->default_precision != mpfr_get_default_prec() ||
+            !precision_policy_equal(&entry->policy, policy)) {
+        ++cache->misses;
+        return false;
+    }
+
+    ++cache->hits;
+    expression_copy(&entry->value, value);
+    return true;
+}
+
+value_cache_recording_t* value_cache_begin(value_cache_t* cache, variable_info_t* definition, symbol_t* symbol) {
+    value_cache_recording_t* recording = malloc(sizeof(value_cache_recording_t));
+    recording->cache      = cache;
+    recording->definition = definition;
+    recording->symbol     = symbol;
+    recording->symbols    = NULL;
+    recording->count      = 0;
+    recording->capacity   = 0;
+    recording->cacheable  = true;
+    recording->outer      = _g_value_cache_recording;
+
+    _g_value_cache_recording = recording;
+    return recording;
+}
+
+void value_cache_end(value_cache_recording_t* recording, expression_t* value, const precision_policy_t* policy) {
+    assert(_g_value_cache_recording == recording);
+    _g_value_cache_recording = recording->outer;
+
+    if (!value || !recording->cacheable) {
+        /* the value that used this one depends on everything this one looked up, since there's no entry to invalidate */
+        if (recording->outer) {
+            recording->outer->cacheable = recording->outer->cacheable && recording->cacheable;
+            for (size_t i = 0; i < recording->count; ++i) {
+                _value_cache_add_symbol(&recording->outer->symbols, &recording->outer->count, &recording->outer->capacity,
+                                        recording->symbols[i]);
+            }
+        }
+
+        free(recording->symbols);
+        free(recording);
+        return;
+    }
+
+    if (recording->definition->cached)
+        _value_cache_entry_free(recording->definition->cached);
+
+    value_cache_entry_t* entry = malloc(sizeof(value_cache_entry_t));
+    entry->cache             = recording->cache;
+    entry->definition        = recording->definition;
+    entry->symbol            = recording->symbol;
+    entry->policy            = *policy;
+    entry->default_precision = mpfr_get_default_prec();
+    entry->dependencies      = recording->symbols;
+    entry->dependency_count  = recording->count;
+    expression_copy(value, &entry->value);
+
+    entry->previous = NULL;
+    entry->next     = recording->cache->entries;
+    if (entry->next)
+        entry->next->previous = entry;
+    recording->cache->entries = entry;
+    recording->definition->cached = entry;
+
+    for (size_t i = 0; i < entry->dependency_count; ++i) {
+        symbol_t* symbol = entry->dependencies[i];
+        if (symbol->dependent_count >= symbol->dependent_capacity) {
+            symbol->dependent_capacity = symbol->dependent_capacity ? symbol->dependent_capacity * 2 : 4;
+            symbol->dependents = realloc(symbol->dependents, symbol->dependent_capacity * sizeof(value_cache_entry_t*));
+        }
+        symbol->dependents[symbol->dependent_count++] = entry;
+    }
+
+    free(recording);
+}
+
+bool value_cache_is_recording(void) {
+    return _g_value_cache_recording != NULL;
+}
+
+void value_cache_record(symbol_t* symbol, variable_info_t* definition) {
+    value_cache_recording_t* recording = _g_value_cache_recording;
+    _value_cache_add_symbol(&recording->symbols, &recording->count, &recording->capacity, symbol);
+    if (definition && definition->impure)
+        recording->cacheable = false;
+}
+
+void value_cache_defined(symbol_t* symbol) {
+    /* values being evaluated may have already used the old definition */
+    for (value_cache_recording_t* recording = _g_value_cache_recording; recording; recording = recording->outer)
+        recording->cacheable = false;
+
+    while (symbol->dependent_count > 0) {
+        value_cache_entry_t* entry = symbol->dependents[symbol->dependent_count - 1];
+        symbol_t* changed = entry->symbol;
+
+        ++entry->cache->invalidations;
+        _value_cache_entry_free(entry);
+
+        /* values that use the discarded value are out of date too */
+        value_cache_defined(changed);
+    }
+}
+
+void value_cache_forget(variable_info_t* definition) {
+    if (definition->cached)
+        _value_cache_entry_free(definition->cached);
+}
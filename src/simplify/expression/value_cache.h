@@ -0,0 +1,134 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#ifndef SIMPLIFY_EXPRESSION_VALUE_CACHE_H_
+#define SIMPLIFY_EXPRESSION_VALUE_CACHE_H_
+
+#include "simplify/expression/expression.h"
+
+/* The names looked up while a variable's value is evaluated */
+typedef struct value_cache_recording value_cache_recording_t;
+
+/* A value cache keeps the evaluated values of variables, like the cells of a spreadsheet.
+ *
+ * When a variable defined in a scope without a parent is used in that scope, it's evaluated value is stored
+ * with it's definition, along with every name that was looked up while it was evaluated.
+ * Each of those names remembers the values that depend on it. Defining a name in a scope without a parent
+ * discards the values that depend on it, and the values that depend on those, and so on.
+ * Nothing is evaluated when a value is discarded, it's evaluated again the next time the variable is used.
+ *
+ * Values that use an impure definition (see `scope_mark_impure`), or that define anything in a scope without a parent
+ * while they're evaluated, are never stored. Variables used from inside a function call are evaluated every time,
+ * since a parameter may have the same name as a variable the value uses.
+ *
+ * Value caches are attached to a scope with `scope_set_value_cache`.
+ */
+struct value_cache_entry {
+    value_cache_t*       cache;
+
+    /* the definition whose value is stored, and the name it's defined as */
+    variable_info_t*     definition;
+    symbol_t*            symbol;
+
+    expression_t         value;
+    precision_policy_t   policy;
+    mpfr_prec_t          default_precision;
+
+    /* the names looked up while evaluating the value */
+    symbol_t**           dependencies;
+    size_t               dependency_count;
+
+    value_cache_entry_t* previous;
+    value_cache_entry_t* next;
+};
+
+struct value_cache_recording {
+    value_cache_t*           cache;
+    variable_info_t*         definition;
+    symbol_t*                symbol;
+
+    symbol_t**               symbols;
+    size_t                   count;
+    size_t                   capacity;
+
+    /* false once the value used an impure definition, or defined something */
+    bool                     cacheable;
+
+    value_cache_recording_t* outer;
+};
+
+struct value_cache {
+    value_cache_entry_t* entries;
+
+    size_t hits;
+    size_t misses;
+
+    /* values discarded because a name they depend on was defined */
+    size_t invalidations;
+};
+
+/* initialize a value cache
+ *
+ * @cache the cache to initialize
+ */
+void value_cache_init(value_cache_t* cache);
+
+/* discard every value in the cache
+ *
+ * @cache the cache to clean
+ */
+void value_cache_clean(value_cache_t* cache);
+
+/* find a definition's stored value
+ *
+ * @cache the cache
+ * @definition the variable's definition
+ * @policy the precision policy the value would be evaluated with
+ * @value location to store a copy of the value
+ * @return returns true if the value was found
+ */
+bool value_cache_lookup(value_cache_t* cache, variable_info_t* definition, const precision_policy_t* policy, expression_t* value);
+
+/* start recording the names a definition's value looks up, while it's evaluated
+ *
+ * @cache the cache the value will be stored in
+ * @definition the variable's definition
+ * @symbol the variable's name
+ * @return returns the recording, it's freed by value_cache_end
+ */
+value_cache_recording_t* value_cache_begin(value_cache_t* cache, variable_info_t* definition, symbol_t* symbol);
+
+/* stop recording, and store the value if it can be cached.
+ * Recordings must be ended in the reverse order they were started.
+ *
+ * @recording the recording started by value_cache_begin
+ * @value the evaluated value, or NULL if it couldn't be evaluated
+ * @policy the precision policy the value was evaluated with
+ */
+void value_cache_end(value_cache_recording_t* recording, expression_t* value, const precision_policy_t* policy);
+
+/* check if a value is being recorded on this thread
+ *
+ * @return returns true if names that are looked up should be passed to value_cache_record
+ */
+bool value_cache_is_recording(void);
+
+/* record that the innermost value being evaluated looked up a name
+ *
+ * @symbol the name
+ * @definition the definition that was found, or NULL
+ */
+void value_cache_record(symbol_t* symbol, variable_info_t* definition);
+
+/* discard every value that depends on a name, because it was defined in a scope without a parent
+ *
+ * @symbol the name
+ */
+void value_cache_defined(symbol_t* symbol);
+
+/* discard a definition's value, because it's being freed or replaced
+ *
+ * @definition the definition
+ */
+void value_cache_forget(variable_info_t* definition);
+
+#endif  // SIMPLIFY_EXPRESSION_VALUE_CACHE_H_
@@ -1,5 +1,6 @@
 /* Copyright Ian Shehadeh 2018 */
 
+#include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
@@ -73,10 +74,20 @@ error_t _parser_parse_number(expression_parser_t* parser, expression_t* expr) {
     number_buffer[token.length] = 0;
 
     strncpy(&number_buffer[0], token.start, token.length);
-    expr->number.value = malloc(sizeof(mpfr_t));
-    mpfr_init2(expr->number.value, ((mpfr_prec_t)token.length * 2) > mpfr_get_default_prec() ?
-                        (mpfr_prec_t)token.length * 2 : mpfr_get_default_prec());
-    mpfr_set_str(expr->number.value, &number_buffer[0], 10, MPFR_RNDF);
+
+    /* give the literal enough bits to hold every digit that was written, the policy trims it when it's evaluated */
+    size_t digits = 0;
+    for (size_t i = 0; i < token.length; ++i) {
+        if (isdigit(token.start[i]))
+            ++digits;
+    }
+
+    mpfr_prec_t precision = precision_for_digits(digits);
+    mpfr_ptr value = malloc(sizeof(mpfr_t));
+    mpfr_init2(value, precision > mpfr_get_default_prec() ? precision : mpfr_get_default_prec());
+    int rounded = mpfr_strtofr(value, &number_buffer[0], NULL, 10, MPFR_RNDN);
+    expression_init_number(expr, value);
+    expr->number.inexact = rounded != 0;
 
     return ERROR_NO_ERROR;
 }
@@ -166,6 +177,7 @@ error_t _parser_parse_identifier(expression_parser_t* parser, expression_t* expr
         expr->function.name = malloc(identifier.length + 1);
         expr->function.name[identifier.length] = 0;
         strncpy(expr->function.name, identifier.start, identifier.length);
+        expr->function.symbol = NULL;
     } else {
         expr->type = EXPRESSION_TYPE_VARIABLE;
 
@@ -173,6 +185,8 @@ error_t _parser_parse_identifier(expression_parser_t* parser, expression_t* expr
         expr->variable.value = malloc(identifier.length + 1);
         expr->variable.value[identifier.length] = 0;
         expr->variable.binding = NULL;
+        expr->variable.slot = -1;
+        expr->variable.symbol = NULL;
         strncpy(expr->variable.value, identifier.start, identifier.length);
     }
 
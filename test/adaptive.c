@@ -0,0 +1,82 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/builtins.h"
+#include "simplify/expression/evaluate.h"
+
+DEFINE_MPFR_FUNCTION(sin)
+DEFINE_MPFR_FUNCTION(acos)
+
+int main() {
+    struct {
+        char*  string;
+        size_t digits;
+        char*  result;
+    } __string_result_pairs[] = {
+        { "1 / 3", 30, "0.333333333333333333333333333333" },
+        { "2 \\ 2", 40, "1.41421356237309504880168872420969807857" },
+        { "100 / 7", 25, "14.28571428571428571428571" },
+        { "3 - 2.5", 20, "0.5" },
+        { "2 ^ 70", 5, "1180600000000000000000" },
+        { "x + 1 / 4", 10, "x + 0.25" },
+        { "1 - 1 / 3", 30, "0.666666666666666666666666666667" },
+        { "(0 - 1 / 3) * (0 - 1 / 3)", 30, "0.111111111111111111111111111111" },
+        { "1 / (1 - 1 / 3)", 20, "1.5" },
+        { "(1 + 10 ^ (0 - 30)) - 1", 5, "0.000000000000000000000000000001" },
+        { "if(1 / 3 < 0.3334, 1, 2)", 10, "1" },
+        { "a + (a: 1 / 3)", 20, "0.66666666666666666667" },
+        { "sin(2 ^ 0.5)", 30, "0.987765945992735527069134072079" },
+        { "acos(1 / 3)", 30, "1.23095941734077468213492917825" },
+    };
+
+    error_t err;
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t expr;
+        scope_t      scope;
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i].string);
+        err = parse_string(__string_result_pairs[i].string, &expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        scope_init(&scope);
+        EXPORT_MPFR_FUNCTION(&scope, sin);
+        EXPORT_MPFR_FUNCTION(&scope, acos);
+        scope_mark_shape(&scope, "sin", FUNCTION_SHAPE_SLOPE_ONE);
+        scope_mark_shape(&scope, "acos", FUNCTION_SHAPE_DECREASING);
+        err = expression_evaluate_adaptive(&expr, &scope, __string_result_pairs[i].digits);
+        if (err)
+            FATAL("failed to evaluate \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        char* str = stringify_digits(&expr, __string_result_pairs[i].digits);
+        if (strcmp(str, __string_result_pairs[i].result) != 0)
+            FATAL("strings do not match! expecting string '%s' got '%s'", __string_result_pairs[i].result, str);
+
+        free(str);
+        scope_clean(&scope);
+        expression_clean(&expr);
+        printf("done\n");
+    }
+
+    /* assignments are only applied once */
+    printf("starting test (n: n + 1)...");
+    expression_t expr;
+    scope_t      scope;
+    scope_init(&scope);
+    scope_define(&scope, "n", expression_new_number_si(0));
+    if (parse_string("n: n + 1", &expr))
+        FATAL("failed to parse string \"n: n + 1\"");
+    err = expression_evaluate_adaptive(&expr, &scope, 10);
+    if (err)
+        FATAL("failed to evaluate \"n: n + 1\": %s", error_string(err));
+    expression_clean(&expr);
+
+    expression_init_variable(&expr, "n", 1);
+    err = expression_evaluate(&expr, &scope);
+    if (err || !EXPRESSION_IS_NUMBER(&expr) || mpfr_cmp_ui(expr.number.value, 1) != 0)
+        FATAL("expected n to be incremented once");
+
+    scope_clean(&scope);
+    expression_clean(&expr);
+    printf("done\n");
+}
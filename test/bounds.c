@@ -0,0 +1,87 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <math.h>
+
+#include "test/test.h"
+#include "simplify/expression/bounds.h"
+
+typedef void (*bounds_operation_t)(mpfr_ptr, mpfr_ptr, mpfr_srcptr, mpfr_srcptr, mpfr_srcptr, mpfr_srcptr);
+
+bool same(mpfr_ptr x, double y) {
+    return isnan(y) ? mpfr_nan_p(x) : mpfr_cmp_d(x, y) == 0;
+}
+
+int main() {
+    struct {
+        char*              name;
+        bounds_operation_t operation;
+        double             lower1;
+        double             upper1;
+        double             lower2;
+        double             upper2;
+        double             lower;
+        double             upper;
+    } __bounds_pairs[] = {
+        { "[1, 2] + [3, 4]",      bounds_add,   1, 2, 3, 4, 4, 6 },
+        { "[1, 2] - [3, 4]",      bounds_sub,   1, 2, 3, 4, -3, -1 },
+        { "[-1, 2] * [3, 4]",     bounds_mul,   -1, 2, 3, 4, -4, 8 },
+        { "[-1, 2] * [-3, 4]",    bounds_mul,   -1, 2, -3, 4, -6, 8 },
+        { "[1, 2] / [4, 8]",      bounds_div,   1, 2, 4, 8, 0.125, 0.5 },
+        { "[1, 2] / [-1, 1]",     bounds_div,   1, 2, -1, 1, -INFINITY, INFINITY },
+        { "[-2, 1] ^ [2, 2]",     bounds_pow,   -2, 1, 2, 2, 0, 4 },
+        { "[-2, 1] ^ [3, 3]",     bounds_pow,   -2, 1, 3, 3, -8, 1 },
+        { "[-2, 1] ^ [-1, -1]",   bounds_pow,   -2, 1, -1, -1, -INFINITY, INFINITY },
+        { "[-2, -1] ^ [0.5, 0.5]", bounds_pow,  -2, -1, 0.5, 0.5, NAN, NAN },
+        { "[4, 9] \\ [2, 2]",     bounds_rootn, 4, 9, 2, 2, 2, 3 },
+        { "[4, 9] \\ [2, 3]",     bounds_rootn, 4, 9, 2, 3, -INFINITY, INFINITY },
+        { "[-4, 9] \\ [2, 2]",    bounds_rootn, -4, 9, 2, 2, -INFINITY, INFINITY },
+        { "hull [1, 2] [3, 4]",   bounds_hull,  1, 2, 3, 4, 1, 4 },
+    };
+
+    mpfr_t lower1, upper1, lower2, upper2, lower, upper;
+    mpfr_inits2(53, lower1, upper1, lower2, upper2, lower, upper, (mpfr_ptr)NULL);
+
+    for (int i = 0; i < (int) (sizeof(__bounds_pairs) / sizeof(__bounds_pairs[0])); ++i) {
+        printf("starting test #%d (%s)...", i + 1, __bounds_pairs[i].name);
+        mpfr_set_d(lower1, __bounds_pairs[i].lower1, MPFR_RNDN);
+        mpfr_set_d(upper1, __bounds_pairs[i].upper1, MPFR_RNDN);
+        mpfr_set_d(lower2, __bounds_pairs[i].lower2, MPFR_RNDN);
+        mpfr_set_d(upper2, __bounds_pairs[i].upper2, MPFR_RNDN);
+
+        __bounds_pairs[i].operation(lower, upper, lower1, upper1, lower2, upper2);
+        if (!same(lower, __bounds_pairs[i].lower) || !same(upper, __bounds_pairs[i].upper))
+            FATAL("bounds do not match! expecting [%g, %g] got [%g, %g]",
+                  __bounds_pairs[i].lower, __bounds_pairs[i].upper,
+                  mpfr_get_d(lower, MPFR_RNDN), mpfr_get_d(upper, MPFR_RNDN));
+        printf("done\n");
+    }
+
+    /* results are rounded outwards, so they still enclose the exact result */
+    printf("starting test (1 / 3)...");
+    mpfr_set_ui(lower1, 1, MPFR_RNDN);
+    mpfr_set_ui(upper1, 1, MPFR_RNDN);
+    mpfr_set_ui(lower2, 3, MPFR_RNDN);
+    mpfr_set_ui(upper2, 3, MPFR_RNDN);
+    bounds_div(lower, upper, lower1, upper1, lower2, upper2);
+    if (bounds_are_exact(lower, upper) || mpfr_sgn(lower) <= 0)
+        FATAL("expected the bounds of 1 / 3 to be apart");
+
+    mpfr_mul_ui(lower, lower, 3, MPFR_RNDD);
+    mpfr_mul_ui(upper, upper, 3, MPFR_RNDU);
+    if (mpfr_cmp_ui(lower, 1) >= 0 || mpfr_cmp_ui(upper, 1) <= 0)
+        FATAL("expected the bounds of 1 / 3 to enclose it");
+    printf("done\n");
+
+    /* widening bounds of sin(1) by the width of [1, 1.5] */
+    printf("starting test (widen)...");
+    mpfr_set_d(lower, 0.75, MPFR_RNDN);
+    mpfr_set_d(upper, 1, MPFR_RNDN);
+    mpfr_set_d(lower1, 1, MPFR_RNDN);
+    mpfr_set_d(upper1, 1.5, MPFR_RNDN);
+    bounds_widen(lower, upper, lower1, upper1);
+    if (!same(lower, 0.25) || !same(upper, 1.5))
+        FATAL("expected [0.25, 1.5] got [%g, %g]", mpfr_get_d(lower, MPFR_RNDN), mpfr_get_d(upper, MPFR_RNDN));
+    printf("done\n");
+
+    mpfr_clears(lower1, upper1, lower2, upper2, lower, upper, (mpfr_ptr)NULL);
+}
@@ -0,0 +1,137 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <stdint.h>
+
+#include "test/test.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/call_stack.h"
+#include "simplify/expression/isolate.h"
+#include "simplify/expression/simplify.h"
+
+/* evaluate a string in a scope, and check the error and the budget's exceeded limit
+ *
+ * @scope the scope to evaluate the string in, it's budget is used
+ * @string the string to evaluate
+ * @error the expected error
+ * @limit the limit the budget should have exceeded
+ */
+void check(scope_t* scope, char* string, error_t error, budget_limit_t limit) {
+    expression_t expr;
+
+    printf("starting test (%s)...", string);
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    /* frames are released when evaluation fails, so the value stack should be empty afterwards */
+    variable_info_t* bottom = call_stack_push(1);
+    call_stack_pop(1);
+
+    err = expression_evaluate(&expr, scope);
+    if (err != error)
+        FATAL("expected \"%s\" evaluating \"%s\", got \"%s\"", error_string(error), string, error_string(err));
+    if (scope_get_budget(scope) && scope_get_budget(scope)->exceeded != limit)
+        FATAL("expected limit %d to be exceeded evaluating \"%s\", got %d", limit, string,
+              scope_get_budget(scope)->exceeded);
+    if (budget_current())
+        FATAL("the budget wasn't left evaluating \"%s\"", string);
+
+    if (call_stack_push(1) != bottom)
+        FATAL("the value stack wasn't emptied");
+    call_stack_pop(1);
+
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+/* check that simplifying or isolating a variable in a string runs out of budget, without changing the expression
+ *
+ * @string the string
+ * @isolate the variable to isolate, or NULL to simplify the expression
+ */
+void check_rewrite(char* string, variable_t isolate) {
+    expression_t expr;
+    budget_t budget;
+
+    printf("starting test (%s, %s)...", string, isolate ? "isolate" : "simplify");
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    budget_init(&budget);
+    budget.max_steps = 2;
+    budget_enter(&budget);
+    err = isolate ? expression_isolate_variable(&expr, isolate) : expression_simplify(&expr);
+    budget_leave(&budget);
+
+    if (err != ERROR_BUDGET_EXCEEDED || budget.exceeded != BUDGET_LIMIT_STEPS)
+        FATAL("expected the budget to be exceeded rewriting \"%s\", got \"%s\"", string, error_string(err));
+
+    char* str = stringify(&expr);
+    if (isolate && strcmp(str, string) != 0)
+        FATAL("expected \"%s\" to be unchanged, got \"%s\"", string, str);
+    free(str);
+
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+int main() {
+    scope_t scope;
+    budget_t budget;
+    precision_policy_t policy;
+
+    scope_init(&scope);
+    budget_init(&budget);
+    precision_policy_init(&policy);
+    scope_set_budget(&scope, &budget);
+    scope_set_precision_policy(&scope, &policy);
+
+    check(&scope, "g(n): 1 + g(n + 1)", ERROR_NO_ERROR, BUDGET_LIMIT_NONE);
+    check(&scope, "h(n): h(n + 1)", ERROR_NO_ERROR, BUDGET_LIMIT_NONE);
+    check(&scope, "k(a, b): a * b", ERROR_NO_ERROR, BUDGET_LIMIT_NONE);
+    check(&scope, "m(a, b, c, d, e, f, g, h, i, j, k, l): a + b + c + d + e + f + g + h + i + j + k + l", ERROR_NO_ERROR,
+          BUDGET_LIMIT_NONE);
+
+    /* limits that aren't reached don't change anything */
+    budget.max_steps = 100000;
+    budget.max_seconds = 60;
+    budget.max_bytes = 1 << 20;
+    budget.max_precision = 1024;
+    check(&scope, "k(3, 4) + 1 / 3", ERROR_NO_ERROR, BUDGET_LIMIT_NONE);
+
+    budget.max_steps = 1000;
+    check(&scope, "g(1)", ERROR_BUDGET_EXCEEDED, BUDGET_LIMIT_STEPS);
+    budget.max_steps = 0;
+
+    /* only live numbers are counted, a long sum frees each partial sum, but a call holds all of it's arguments */
+    budget.max_bytes = 64;
+    check(&scope, "1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1 + 1", ERROR_NO_ERROR,
+          BUDGET_LIMIT_NONE);
+    check(&scope, "m(1 / 3, 1 / 3, 1 / 3, 1 / 3, 1 / 3, 1 / 3, 1 / 3, 1 / 3, 1 / 3, 1 / 3, 1 / 3, 1 / 3)",
+          ERROR_BUDGET_EXCEEDED, BUDGET_LIMIT_MEMORY);
+    budget.max_bytes = 0;
+
+    precision_policy_set_fixed(&policy, 100000);
+    check(&scope, "1 / 3", ERROR_BUDGET_EXCEEDED, BUDGET_LIMIT_PRECISION);
+    check(&scope, "k(1, 3)", ERROR_BUDGET_EXCEEDED, BUDGET_LIMIT_PRECISION);
+    precision_policy_init(&policy);
+    budget.max_precision = 0;
+
+    /* h never returns, only the clock stops it */
+    budget.max_seconds = 0.05;
+    expression_set_recursion_limit(SIZE_MAX);
+    check(&scope, "h(1)", ERROR_BUDGET_EXCEEDED, BUDGET_LIMIT_TIME);
+    expression_set_recursion_limit(EVALUATE_DEFAULT_RECURSION_LIMIT);
+    budget.max_seconds = 0;
+
+    /* the budget is reset each time it's used */
+    check(&scope, "k(3, 4)", ERROR_NO_ERROR, BUDGET_LIMIT_NONE);
+
+    check_rewrite("x * 2 + 3 = 7", "x");
+    check_rewrite("a + b + c + d", NULL);
+
+    scope_clean(&scope);
+    call_stack_free();
+}
@@ -0,0 +1,113 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/call_cache.h"
+
+/* the builtin used to check that calls are only made once, it counts how many times it's called */
+static int _g_calls;
+
+error_t builtin_func_count(scope_t* scope, expression_t** out) {
+    ++_g_calls;
+    *out = malloc(sizeof(expression_t));
+    return scope_get_value(scope, "__arg0", *out);
+}
+
+/* the number of times `tick` has been called, it's impure so it's calls are never cached.
+    It only has a result if it's argument is a number, otherwise the call is left as it is */
+static int _g_ticks;
+
+error_t builtin_func_tick(scope_t* scope, expression_t** out) {
+    ++_g_ticks;
+    expression_t value;
+    error_t err = scope_get_value(scope, "__arg0", &value);
+    if (!err && EXPRESSION_IS_NUMBER(&value)) {
+        *out = malloc(sizeof(expression_t));
+        **out = value;
+    } else if (!err) {
+        expression_clean(&value);
+    }
+    return err;
+}
+
+int main() {
+    struct {
+        char*  string;
+        char*  result;
+        int    calls;
+    } __string_result_pairs[] = {
+        { "count(2) + count(2)", "4", 1 },
+        { "count(1 + 1)", "2", 0 },
+        { "f(a): count(a) * k", "count(a) * k", 0 },
+        { "k: 3", "3", 0 },
+        { "f(3) + f(3)", "18", 1 },
+        { "k: 4", "4", 0 },
+        { "f(3)", "12", 0 },
+        { "f(a): count(a) * k + 1", "count(a) * k + 1", 0 },
+        { "f(3)", "13", 0 },
+        { "f(5)", "21", 1 },
+        { "count(a * b) - count(b * a)", "b * a - b * a", 1 },
+    };
+
+    error_t err;
+    scope_t scope;
+    call_cache_t cache;
+
+    scope_init(&scope);
+    call_cache_init(&cache, 64);
+    scope_set_call_cache(&scope, &cache);
+    scope_define_internal_function(&scope, "count", builtin_func_count, 1, "__arg0");
+    scope_define_internal_function(&scope, "tick", builtin_func_tick, 1, "__arg0");
+    scope_mark_impure(&scope, "tick");
+
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t expr;
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i].string);
+        err = parse_string(__string_result_pairs[i].string, &expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        _g_calls = 0;
+        err = expression_evaluate(&expr, &scope);
+        if (err)
+            FATAL("failed to evaluate \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        if (_g_calls != __string_result_pairs[i].calls)
+            FATAL("expected %d calls, got %d", __string_result_pairs[i].calls, _g_calls);
+
+        char* str = stringify(&expr);
+        if (strcmp(str, __string_result_pairs[i].result) != 0)
+            FATAL("strings do not match! expecting string '%s' got '%s'", __string_result_pairs[i].result, str);
+
+        free(str);
+        expression_clean(&expr);
+        printf("done\n");
+    }
+
+    if (cache.hits == 0)
+        FATAL("expected the cache to be hit");
+
+    /* calls made through scope_call evaluate their arguments once, whether the result is cached or not */
+    printf("starting test (scope_call)...");
+    expression_list_t* args = malloc(sizeof(expression_list_t));
+    expression_list_init(args);
+    expression_list_append(args, expression_new_function("tick", 1, expression_new_variable("y")));
+    for (int i = 0; i < 2; ++i) {
+        expression_t result;
+        _g_calls = 0;
+        _g_ticks = 0;
+        err = scope_call(&scope, "count", args, &result);
+        if (err)
+            FATAL("failed to call count: %s", error_string(err));
+        if (_g_ticks != 1 || _g_calls != (i == 0))
+            FATAL("expected the argument to be evaluated once, and count to be called %d times, got %d and %d",
+                  i == 0, _g_ticks, _g_calls);
+        expression_clean(&result);
+    }
+    expression_list_free(args);
+    printf("done\n");
+
+    call_cache_clean(&cache);
+    scope_clean(&scope);
+}
@@ -0,0 +1,65 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/call_stack.h"
+
+int main() {
+    char* __string_result_pairs[][2] = {
+        { "f(a, b): a * 10 + b", "a * 10 + b" },
+        { "f(1, 2)", "12" },
+        { "g(a): f(a, a + 1) + a", "f(a, a + 1) + a" },
+        { "g(3)", "37" },
+        { "h(x): (x: x * 2) + x", "(x : x * 2) + x" },
+        { "h(4)", "12" },
+        { "k(q): q + a", "q + a" },
+        { "m(a): k(1)", "k(1)" },
+        { "m(5)", "6" },
+        { "f(z, 2)", "z * 10 + 2" },
+    };
+
+    error_t err;
+    scope_t scope;
+    scope_init(&scope);
+
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t expr;
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i][0]);
+        err = parse_string(__string_result_pairs[i][0], &expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i][0], error_string(err));
+
+        err = expression_evaluate(&expr, &scope);
+        if (err)
+            FATAL("failed to evaluate \"%s\": %s", __string_result_pairs[i][0], error_string(err));
+
+        char* str = stringify(&expr);
+        if (strcmp(str, __string_result_pairs[i][1]) != 0)
+            FATAL("strings do not match! expecting string '%s' got '%s'", __string_result_pairs[i][1], str);
+
+        free(str);
+        expression_clean(&expr);
+        printf("done\n");
+    }
+    scope_clean(&scope);
+
+    printf("starting test #%d (value stack segments)...", (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])) + 1);
+    variable_info_t* frames[8];
+    for (int i = 0; i < 8; ++i) {
+        frames[i] = call_stack_push(CALL_STACK_SEGMENT_SIZE / 3);
+        frames[i]->generation = i;
+    }
+
+    for (int i = 7; i >= 0; --i) {
+        if (frames[i]->generation != (unsigned long)i)
+            FATAL("frame %d was overwritten", i);
+        call_stack_pop(CALL_STACK_SEGMENT_SIZE / 3);
+    }
+
+    if (call_stack_push(CALL_STACK_SEGMENT_SIZE / 3) != frames[0])
+        FATAL("the stack wasn't emptied");
+    call_stack_pop(CALL_STACK_SEGMENT_SIZE / 3);
+    call_stack_free();
+    printf("done\n");
+}
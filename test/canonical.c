@@ -0,0 +1,147 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/canonical.h"
+
+/* the number of terms in the generated sum, enough to overflow the stack if it were walked by recursion */
+#define LONG_SUM_TERMS     300000
+#define LONG_SUM_VARIABLES 50
+
+/* check the order of two strings
+ *
+ * @string1
+ * @string2
+ * @order the expected sign of expression_order
+ */
+void check_order(char* string1, char* string2, int order) {
+    expression_t expr1;
+    expression_t expr2;
+
+    printf("starting test (%s, %s)...", string1, string2);
+    if (parse_string(string1, &expr1) || parse_string(string2, &expr2))
+        FATAL("failed to parse \"%s\" or \"%s\"", string1, string2);
+
+    int result = expression_order(&expr1, &expr2);
+    int reverse = expression_order(&expr2, &expr1);
+    if ((result > 0) - (result < 0) != order || (reverse > 0) - (reverse < 0) != -order)
+        FATAL("expected \"%s\" ordered against \"%s\" to be %d, got %d and %d", string1, string2, order, result, reverse);
+
+    expression_clean(&expr1);
+    expression_clean(&expr2);
+    printf("done\n");
+}
+
+/* canonicalize a string, and check the result
+ *
+ * @string the string
+ * @expected the expected result
+ * @changed true if the expression should be changed
+ */
+void check_canonical(char* string, char* expected, bool changed) {
+    expression_t expr;
+
+    printf("starting test (%s)...", string);
+    if (parse_string(string, &expr))
+        FATAL("failed to parse \"%s\"", string);
+
+    if (expression_canonicalize(&expr) != changed)
+        FATAL("expected \"%s\" to be %s", string, changed ? "changed" : "left alone");
+
+    char* str = stringify(&expr);
+    if (strcmp(str, expected) != 0)
+        FATAL("strings do not match! expecting string '%s' got '%s'", expected, str);
+
+    free(str);
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+/* check that commuted strings have identical canonical forms
+ *
+ * @string1
+ * @string2
+ */
+void check_commuted(char* string1, char* string2) {
+    expression_t expr1;
+    expression_t expr2;
+
+    printf("starting test (%s, %s)...", string1, string2);
+    if (parse_string(string1, &expr1) || parse_string(string2, &expr2))
+        FATAL("failed to parse \"%s\" or \"%s\"", string1, string2);
+
+    expression_canonicalize(&expr1);
+    expression_canonicalize(&expr2);
+    if (!expression_identical(&expr1, &expr2))
+        FATAL("expected the canonical forms of \"%s\" and \"%s\" to be identical", string1, string2);
+    if (expression_hash(&expr1) != expression_hash(&expr2))
+        FATAL("expected the canonical forms of \"%s\" and \"%s\" to have the same hash", string1, string2);
+
+    expression_clean(&expr1);
+    expression_clean(&expr2);
+    printf("done\n");
+}
+
+int main() {
+    /* variables come first, then functions, prefixes, operators and numbers */
+    check_order("x", "f(x)", -1);
+    check_order("f(x)", "-x", -1);
+    check_order("-x", "x ^ 2", -1);
+    check_order("x ^ 2", "2", -1);
+    check_order("1", "2", -1);
+    check_order("a", "b", -1);
+    check_order("x", "x", 0);
+
+    /* names with numbers in them are ordered by the numbers' values */
+    check_order("x_2", "x_10", -1);
+
+    /* expressions of the same kind are ordered by their children, from left to right */
+    check_order("f(a)", "f(a, b)", -1);
+    check_order("f(b)", "f(a, c)", 1);
+    check_order("x ^ 2", "x ^ 3", -1);
+    check_order("a * z", "b * a", -1);
+
+    /* operands are sorted, and nested to the left */
+    check_canonical("b + a", "a + b", true);
+    check_canonical("c * (b * a)", "a * b * c", true);
+    check_canonical("2 + x ^ 2 + sin(x) + x", "x + sin(x) + x ^ 2 + 2", true);
+    check_canonical("(b + a) * (d + c)", "(a + b) * (c + d)", true);
+    check_canonical("f(b * a, d + c)", "f(a * b, c + d)", true);
+
+    /* constants are folded when it's exact */
+    check_canonical("2 + x + 3", "x + 5", true);
+    check_canonical("2 * x * 3 * y", "x * y * 6", true);
+
+    /* expressions that are already canonical are left alone */
+    check_canonical("a + b + 2", "a + b + 2", false);
+    check_canonical("x - y", "x - y", false);
+
+    check_commuted("x * y + sin(z) + 3", "3 + sin(z) + y * x");
+    check_commuted("(a + b) * c", "c * (b + a)");
+
+    /* long sums are canonicalized without overflowing the stack */
+    printf("starting test (long sum)...");
+    char name[32];
+    expression_t* sum = NULL;
+    expression_t* reversed = NULL;
+    for (int i = 0; i < LONG_SUM_TERMS; ++i) {
+        sprintf(name, "x_%d", i % LONG_SUM_VARIABLES);
+        expression_t* term = expression_new_variable(name);
+        sum = sum ? expression_new_operator(term, '+', sum) : term;
+
+        sprintf(name, "x_%d", (LONG_SUM_TERMS - i - 1) % LONG_SUM_VARIABLES);
+        term = expression_new_variable(name);
+        reversed = reversed ? expression_new_operator(reversed, '+', term) : term;
+    }
+
+    if (!expression_canonicalize(sum) || !expression_canonicalize(reversed))
+        FATAL("expected long sums to be changed");
+    if (!expression_identical(sum, reversed))
+        FATAL("expected long sums to be identical");
+    if (expression_canonicalize(sum))
+        FATAL("expected a canonical long sum to be left alone");
+    expression_free(sum);
+    expression_free(reversed);
+    printf("done\n");
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/chain.h"
+#include "simplify/expression/simplify.h"
+
+/* the number of terms in the generated sums, enough to overflow the stack if they were walked by recursion */
+#define LONG_SUM_TERMS     300000
+#define LONG_SUM_VARIABLES 50
+
+/* compare two strings, and check the result
+ *
+ * @string1
+ * @string2
+ * @result the expected result
+ */
+void check_compare(char* string1, char* string2, compare_result_t result) {
+    expression_t expr1;
+    expression_t expr2;
+
+    printf("starting test (%s, %s)...", string1, string2);
+    if (parse_string(string1, &expr1) || parse_string(string2, &expr2))
+        FATAL("failed to parse \"%s\" or \"%s\"", string1, string2);
+
+    compare_result_t cmp = expression_compare(&expr1, &expr2);
+    if (cmp != result)
+        FATAL("expected \"%s\" compared to \"%s\" to be %d, got %d", string1, string2, result, cmp);
+
+    expression_clean(&expr1);
+    expression_clean(&expr2);
+    printf("done\n");
+}
+
+/* build a sum of variables
+ *
+ * @count the number of terms
+ * @right if true the sum leans right, otherwise it leans left
+ * @reverse if true the variables are added in reverse order
+ * @return returns the sum
+ */
+expression_t* long_sum(int count, bool right, bool reverse) {
+    char name[32];
+    expression_t* sum = NULL;
+    for (int i = 0; i < count; ++i) {
+        sprintf(name, "v%d", (reverse ? count - i - 1 : i) % LONG_SUM_VARIABLES);
+        expression_t* term = expression_new_variable(name);
+        if (!sum)
+            sum = term;
+        else
+            sum = right ? expression_new_operator(term, '+', sum) : expression_new_operator(sum, '+', term);
+    }
+    return sum;
+}
+
+int main() {
+    /* a chain's operands are collected from left to right, however it's parenthesized */
+    printf("starting test (collect)...");
+    expression_t expr;
+    parse_string("a * (b * c) * (d + e) * f", &expr);
+    expression_chain_t chain;
+    expression_chain_init(&chain, '*');
+    expression_chain_collect(&chain, &expr);
+    char* expected[] = { "a", "b", "c", "d + e", "f" };
+    if (chain.count != 5)
+        FATAL("expected 5 operands, got %zu", chain.count);
+    for (size_t i = 0; i < chain.count; ++i) {
+        char* str = stringify(chain.operands[i]);
+        if (strcmp(str, expected[i]) != 0)
+            FATAL("expected operand %zu to be '%s' got '%s'", i, expected[i], str);
+        free(str);
+    }
+    expression_chain_clean(&chain);
+    expression_clean(&expr);
+    printf("done\n");
+
+    /* sums and products are equal if their operands are, in any order */
+    check_compare("a + b + c", "c + (b + a)", COMPARE_RESULT_EQUAL);
+    check_compare("x * y * sin(z) * 2", "2 * sin(z) * x * y", COMPARE_RESULT_EQUAL);
+    check_compare("a + a + b", "a + b + b", COMPARE_RESULT_INCOMPARABLE);
+    check_compare("a * b * c", "a * b * d", COMPARE_RESULT_INCOMPARABLE);
+    check_compare("a + b + c", "a + b", COMPARE_RESULT_INCOMPARABLE);
+    check_compare("1 + x + 2", "x + 2 + 1.0000000000000000001", COMPARE_RESULT_EQUAL);
+
+    /* two operand sums still compare by value */
+    check_compare("1 + 2", "3 + 4", COMPARE_RESULT_LESS);
+
+    printf("starting test (%d terms)...", LONG_SUM_TERMS);
+    expression_t* left = long_sum(LONG_SUM_TERMS, false, false);
+    expression_t* right = long_sum(LONG_SUM_TERMS, true, true);
+    expression_t* reversed = long_sum(LONG_SUM_TERMS, false, true);
+
+    expression_t copy;
+    expression_copy(left, &copy);
+    if (!expression_identical(left, &copy) || expression_hash(left) != expression_hash(&copy))
+        FATAL("expected a copy to be identical");
+    if (expression_identical(left, right))
+        FATAL("expected sums nested differently not to be identical");
+    if (expression_compare(left, right) != COMPARE_RESULT_EQUAL)
+        FATAL("expected sums nested differently to be equal");
+    if (expression_compare(left, reversed) != COMPARE_RESULT_EQUAL)
+        FATAL("expected sums in different orders to be equal");
+
+    char* str = stringify(right);
+    char* str_left = stringify(left);
+    if (strcmp(str, str_left) != 0)
+        FATAL("expected sums nested differently to be written the same");
+    free(str);
+    free(str_left);
+
+    error_t err = expression_simplify(right);
+    if (err)
+        FATAL("failed to simplify: %s", error_string(err));
+    if (strncmp((str = stringify(right)), "v0 * 6000 + v1 * 6000", 21) != 0)
+        FATAL("expected like terms to be collected, got '%.64s'", str);
+    free(str);
+
+    expression_clean(&copy);
+    expression_free(left);
+    expression_free(right);
+    expression_free(reversed);
+    printf("done\n");
+}
@@ -0,0 +1,241 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <math.h>
+
+#include "test/test.h"
+#include "simplify/builtins.h"
+#include "simplify/expression/codegen.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/symbol.h"
+
+/* the command used to compile generated code, and the libraries it's linked with. They're set by CMake */
+#ifndef CODEGEN_TEST_COMPILER
+#   define CODEGEN_TEST_COMPILER "cc -std=c99"
+#endif
+
+#ifndef CODEGEN_TEST_LIBRARIES
+#   define CODEGEN_TEST_LIBRARIES "-lmpfr -lgmp -lm"
+#endif
+
+DEFINE_MPFR_FUNCTION(sin)
+DEFINE_MPFR_FUNCTION(cos)
+DEFINE_MPFR_FUNCTION(sec)
+DEFINE_MPFR_FUNCTION_NRND(floor)
+DEFINE_MPFR_FUNCTION2(max)
+DEFINE_MPFR_CONST(pi)
+
+static const double _g_samples[][2] = { { 0.5, 1.25 }, { 2, 3 }, { -1.5, 0.75 }, { 10, -4 } };
+
+#define SAMPLE_COUNT (sizeof(_g_samples) / sizeof(_g_samples[0]))
+
+/* returns it's argument, it's marked impure so code can't be generated for it */
+error_t builtin_func_tick(scope_t* scope, expression_t** out) {
+    *out = malloc(sizeof(expression_t));
+    return scope_get_argument(scope, 0, *out);
+}
+
+/* evaluate a string in a scope, and discard the result
+ *
+ * @scope the scope to evaluate the string in
+ * @string the string to evaluate
+ */
+void run(scope_t* scope, char* string) {
+    expression_t expr;
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    err = expression_evaluate(&expr, scope);
+    if (err)
+        FATAL("failed to evaluate \"%s\": %s", string, error_string(err));
+    expression_clean(&expr);
+}
+
+/* check if two doubles are equal, allowing for the rounding error of the math library
+ *
+ * @x the first double
+ * @y the second double
+ * @return returns true if they're close enough
+ */
+bool close_enough(double x, double y) {
+    if (isnan(x) || isnan(y))
+        return isnan(x) && isnan(y);
+    return fabs(x - y) <= 1e-12 * fmax(1, fmax(fabs(x), fabs(y)));
+}
+
+/* write a program that prints a generated function's result for each sample, compile it, and run it
+ *
+ * @code the generated function
+ * @type the kind of numbers the function uses
+ * @results location to store the function's results
+ */
+void compile_and_run(stringifier_t* code, codegen_type_t type, double* results) {
+    FILE* source = fopen("codegen_test.c", "w");
+    if (!source)
+        FATAL("failed to open codegen_test.c");
+
+    fwrite(code->buffer, 1, code->index, source);
+    fputs("\n#include <stdio.h>\n\nint main() {\n", source);
+    for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+        if (type == CODEGEN_DOUBLE) {
+            fprintf(source, "    printf(\"%%.17g\\n\", generated(%.17g, %.17g));\n", _g_samples[i][0], _g_samples[i][1]);
+            continue;
+        }
+        fprintf(source, "    {\n"
+                        "        mpfr_t result, x, y;\n"
+                        "        mpfr_inits2(53, result, x, y, (mpfr_ptr)0);\n"
+                        "        mpfr_set_d(x, %.17g, MPFR_RNDN);\n"
+                        "        mpfr_set_d(y, %.17g, MPFR_RNDN);\n"
+                        "        generated(result, x, y, MPFR_RNDN);\n"
+                        "        printf(\"%%.17g\\n\", mpfr_get_d(result, MPFR_RNDN));\n"
+                        "        mpfr_clears(result, x, y, (mpfr_ptr)0);\n"
+                        "    }\n", _g_samples[i][0], _g_samples[i][1]);
+    }
+    fputs("    return 0;\n}\n", source);
+    fclose(source);
+
+    if (system(CODEGEN_TEST_COMPILER " codegen_test.c -o codegen_test " CODEGEN_TEST_LIBRARIES) != 0)
+        FATAL("failed to compile the generated code:\n%.*s", (int)code->index, code->buffer);
+    if (system("./codegen_test > codegen_test.out") != 0)
+        FATAL("failed to run the generated code");
+
+    FILE* output = fopen("codegen_test.out", "r");
+    if (!output)
+        FATAL("failed to open codegen_test.out");
+    for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+        char line[64];
+        if (!fgets(line, sizeof(line), output))
+            FATAL("expected %zu results from the generated code", SAMPLE_COUNT);
+        results[i] = strtod(line, NULL);
+    }
+    fclose(output);
+}
+
+/* generate code for a string with the parameters x and y, and compare it's results with expression_evaluate
+ *
+ * @scope the scope to generate and evaluate the string in
+ * @string the string to generate code for
+ * @type the kind of numbers the code uses
+ */
+void check(scope_t* scope, char* string, codegen_type_t type) {
+    expression_t expr;
+    stringifier_t code = STRINGIFIER_DEFAULT();
+    double results[SAMPLE_COUNT];
+
+    printf("starting test (%s, %s)...", string, type == CODEGEN_DOUBLE ? "double" : "mpfr");
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    expression_list_t* parameters = malloc(sizeof(expression_list_t));
+    expression_list_init(parameters);
+    expression_list_append(parameters, expression_new_variable("x"));
+    expression_list_append(parameters, expression_new_variable("y"));
+
+    err = codegen_write_expression(&code, &expr, scope, "generated", parameters, type);
+    if (err)
+        FATAL("failed to generate code for \"%s\": %s", string, error_string(err));
+    compile_and_run(&code, type, results);
+
+    for (size_t i = 0; i < SAMPLE_COUNT; ++i) {
+        scope_define(scope, "x", expression_new_number_d(_g_samples[i][0]));
+        scope_define(scope, "y", expression_new_number_d(_g_samples[i][1]));
+
+        expression_t result;
+        expression_copy(&expr, &result);
+        err = expression_evaluate(&result, scope);
+        if (err || !EXPRESSION_IS_NUMBER(&result))
+            FATAL("failed to evaluate \"%s\"", string);
+
+        double expected = mpfr_get_d(result.number.value, MPFR_RNDN);
+        if (!close_enough(results[i], expected))
+            FATAL("\"%s\" with x = %g, y = %g: expected %.17g, got %.17g", string, _g_samples[i][0], _g_samples[i][1],
+                  expected, results[i]);
+        expression_clean(&result);
+    }
+
+    free(code.buffer);
+    expression_list_free(parameters);
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+/* check that code can't be generated for a string
+ *
+ * @scope the scope to generate code in
+ * @string the string
+ */
+void check_fails(scope_t* scope, char* string) {
+    expression_t expr;
+    stringifier_t code = STRINGIFIER_DEFAULT();
+
+    printf("starting test (%s)...", string);
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    expression_list_t* parameters = malloc(sizeof(expression_list_t));
+    expression_list_init(parameters);
+    expression_list_append(parameters, expression_new_variable("x"));
+
+    if (!codegen_write_expression(&code, &expr, scope, "generated", parameters, CODEGEN_DOUBLE))
+        FATAL("expected code generation to fail for \"%s\"", string);
+    if (code.index != 0)
+        FATAL("expected nothing to be written for \"%s\"", string);
+
+    free(code.buffer);
+    expression_list_free(parameters);
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+int main() {
+    static const codegen_type_t types[] = { CODEGEN_DOUBLE, CODEGEN_MPFR };
+    static char* strings[] = {
+        "x + y * 2",
+        "(x - y) / (x + y + 20)",
+        "-x ^ 2 + 3 * x - -y",
+        "x ^ 3 + y \\ 3",
+        "sin(x) * cos(y) + max(x, y) + sec(y)",
+        "floor(x * 3) + pi * x + k",
+        "1e30 * x + 7",
+
+        /* user functions are written as functions, and call each other */
+        "f(x, y) + square(f(y, x))",
+        "square(square(x + y))",
+    };
+
+    scope_t scope;
+    scope_init(&scope);
+    EXPORT_BUILTIN_FUNCTION(&scope, sin);
+    EXPORT_BUILTIN_FUNCTION(&scope, cos);
+    EXPORT_BUILTIN_FUNCTION(&scope, sec);
+    EXPORT_BUILTIN_FUNCTION(&scope, floor);
+    EXPORT_BUILTIN_FUNCTION(&scope, tick);
+    EXPORT_BUILTIN_FUNCTION2(&scope, max);
+    EXPORT_BUILTIN_CONST(&scope, pi);
+    scope_mark_impure(&scope, "tick");
+
+    run(&scope, "k: 2.5");
+    run(&scope, "square(t): t * t");
+    run(&scope, "f(a, b): square(a) - b / k");
+    run(&scope, "shift(t): t + x");
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        for (size_t j = 0; j < sizeof(strings) / sizeof(strings[0]); ++j)
+            check(&scope, strings[j], types[i]);
+    }
+
+    check_fails(&scope, "x: 1");
+    check_fails(&scope, "undefined + 1");
+    check_fails(&scope, "tick(1)");
+
+    /* shift uses x, which the generated function can't see */
+    check_fails(&scope, "shift(x)");
+
+    remove("codegen_test.c");
+    remove("codegen_test.out");
+    remove("codegen_test");
+    scope_clean(&scope);
+    symbol_table_free();
+}
@@ -4,6 +4,10 @@
 #include "simplify/expression/isolate.h"
 #include "simplify/expression/simplify.h"
 #include "simplify/expression/evaluate.h"
+#include "simplify/builtins.h"
+
+DEFINE_MPFR_FUNCTION(sin)
+DEFINE_MPFR_CONST(pi)
 
 static struct {
     char* expr1;
@@ -28,6 +32,51 @@ static struct {
     {"y * (x2) + x^4", "x^4 + y * (2 * x)", COMPARE_RESULT_EQUAL},
     {"(y)f(x + 5)", "f(x + 5) * y", COMPARE_RESULT_EQUAL},
     {"x * x * x", "x ^ 2 * x", COMPARE_RESULT_EQUAL},
+    {"123456789012", "123456789013", COMPARE_RESULT_LESS},
+    {"0.1 + 0.2", "0.3", COMPARE_RESULT_EQUAL},
+    {"sin(pi)", "0", COMPARE_RESULT_EQUAL},
+    {"1e300 * 10", "1e300", COMPARE_RESULT_GREATER},
+    {"1 / 0", "5", COMPARE_RESULT_GREATER},
+    {"-1 / 0", "-1e300", COMPARE_RESULT_LESS},
+    {"1e-20", "2e-20", COMPARE_RESULT_LESS},
+    {"-3e-20", "-2e-20", COMPARE_RESULT_LESS},
+    {"1e-20", "1e-20 * (1 + 2 ^ -60)", COMPARE_RESULT_EQUAL},
+    {"1e-20", "0", COMPARE_RESULT_EQUAL},
+};
+
+/* numbers compared with an explicit tolerance */
+static struct {
+    char*               expr1;
+    char*               expr2;
+    compare_tolerance_t tolerance;
+    compare_result_t    result;
+} __tolerance_result_pairs[] = {
+    {"1.001", "1", { 0, 0, 0 }, COMPARE_RESULT_GREATER},
+    {"1.001", "1", { 0.01, 0, 0 }, COMPARE_RESULT_EQUAL},
+    {"1001", "1000", { 0.01, 0, 0 }, COMPARE_RESULT_EQUAL},
+    {"1001", "1000", { 0, 0.5, 0 }, COMPARE_RESULT_GREATER},
+    {"1000.25", "1000", { 0, 0.5, 0 }, COMPARE_RESULT_EQUAL},
+    {"1e-300", "2e-300", { 0, 1e-200, 0 }, COMPARE_RESULT_EQUAL},
+    {"1e-300", "2e-300", { 0.1, 0, 0 }, COMPARE_RESULT_LESS},
+    {"1 + 2 ^ -52", "1", { 0, 0, 0 }, COMPARE_RESULT_GREATER},
+    {"1 + 2 ^ -52", "1", { 0, 0, 1 }, COMPARE_RESULT_EQUAL},
+    {"1e300 * 10", "1e301", { 0, 0, 4 }, COMPARE_RESULT_EQUAL},
+    {"1 / 0", "1e300", { 1, 1, 1000 }, COMPARE_RESULT_GREATER},
+};
+
+/* comparisons evaluated as true or false, only equality is decided within the tolerance */
+static struct {
+    char*               expr;
+    expression_result_t result;
+} __comparison_results[] = {
+    {"1e-20 < 2e-20", EXPRESSION_RESULT_TRUE},
+    {"1e-20 > 2e-20", EXPRESSION_RESULT_FALSE},
+    {"1e-20 = 2e-20", EXPRESSION_RESULT_FALSE},
+    {"sin(pi) = 0", EXPRESSION_RESULT_TRUE},
+    {"1 + 2 ^ -52 = 1", EXPRESSION_RESULT_TRUE},
+    {"1 + 2 ^ -52 > 1", EXPRESSION_RESULT_TRUE},
+    {"1 < 1 + 2 ^ -52", EXPRESSION_RESULT_TRUE},
+    {"1 + 2 ^ -52 < 1", EXPRESSION_RESULT_FALSE},
 };
 
 int main() {
@@ -47,7 +96,8 @@ int main() {
             FATAL("failed to parse expression 2/2 \"%s\": %s", __expr_result_pairs[i].expr2, error_string(err));
 
         scope_init(&scope);
-
+        EXPORT_BUILTIN_FUNCTION(&scope, sin);
+        EXPORT_BUILTIN_CONST(&scope, pi);
 
         err = expression_evaluate(&expr1, &scope);
         if (err)
@@ -76,4 +126,57 @@ int main() {
         expression_clean(&expr2);
         printf("done\n");
     }
+
+    for (int i = 0; i < (int) (sizeof(__tolerance_result_pairs) / sizeof(__tolerance_result_pairs[0])); ++i) {
+        expression_t expr1;
+        expression_t expr2;
+        scope_t      scope;
+
+        printf("starting tolerance test #%d...", i + 1);
+        if (parse_string(__tolerance_result_pairs[i].expr1, &expr1) ||
+                parse_string(__tolerance_result_pairs[i].expr2, &expr2))
+            FATAL("failed to parse \"%s\" or \"%s\"", __tolerance_result_pairs[i].expr1,
+                  __tolerance_result_pairs[i].expr2);
+
+        scope_init(&scope);
+        if (expression_evaluate(&expr1, &scope) || expression_evaluate(&expr2, &scope))
+            FATAL("failed to evaluate \"%s\" or \"%s\"", __tolerance_result_pairs[i].expr1,
+                  __tolerance_result_pairs[i].expr2);
+
+        expression_set_compare_tolerance(__tolerance_result_pairs[i].tolerance);
+        compare_result_t cmp = expression_compare(&expr1, &expr2);
+        expression_set_compare_tolerance(COMPARE_TOLERANCE_DEFAULT());
+        if (cmp != __tolerance_result_pairs[i].result) {
+            FATAL("Test failed, expected the relationship of '%s' and '%s' to be %s, got %s",
+                __tolerance_result_pairs[i].expr1, __tolerance_result_pairs[i].expr2,
+                print_compare_result(__tolerance_result_pairs[i].result), print_compare_result(cmp));
+        }
+        scope_clean(&scope);
+        expression_clean(&expr1);
+        expression_clean(&expr2);
+        printf("done\n");
+    }
+
+    for (int i = 0; i < (int) (sizeof(__comparison_results) / sizeof(__comparison_results[0])); ++i) {
+        expression_t expr;
+        scope_t      scope;
+
+        printf("starting comparison test #%d...", i + 1);
+        if (parse_string(__comparison_results[i].expr, &expr))
+            FATAL("failed to parse \"%s\"", __comparison_results[i].expr);
+
+        scope_init(&scope);
+        EXPORT_BUILTIN_FUNCTION(&scope, sin);
+        EXPORT_BUILTIN_CONST(&scope, pi);
+        err = expression_evaluate(&expr, &scope);
+        if (err)
+            FATAL("failed to evaluate \"%s\": %s", __comparison_results[i].expr, error_string(err));
+
+        if (expression_evaluate_comparisons(&expr) != __comparison_results[i].result)
+            FATAL("expected \"%s\" to be %s", __comparison_results[i].expr,
+                  __comparison_results[i].result == EXPRESSION_RESULT_TRUE ? "true" : "false");
+        scope_clean(&scope);
+        expression_clean(&expr);
+        printf("done\n");
+    }
 }
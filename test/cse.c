@@ -0,0 +1,147 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/cse.h"
+
+/* the builtin used to check how many times a subexpression is evaluated, it counts how many times it's called */
+static int _g_calls;
+
+error_t builtin_func_count(scope_t* scope, expression_t** out) {
+    ++_g_calls;
+    *out = malloc(sizeof(expression_t));
+    return scope_get_value(scope, "__arg0", *out);
+}
+
+/* the results of a list of statements */
+typedef struct {
+    char*  strings[16];
+    size_t count;
+} results_t;
+
+/* store a statement's result */
+error_t collect(expression_t* expr, void* data) {
+    results_t* results = data;
+    results->strings[results->count++] = stringify(expr);
+    return ERROR_NO_ERROR;
+}
+
+/* evaluate a string with and without eliminating common subexpressions, and check the results are the same
+ *
+ * @scope the scope to evaluate the string in
+ * @string the string
+ * @calls the number of calls to `count` expected when common subexpressions are eliminated
+ * @temporaries the number of subexpressions expected to be reused
+ */
+void check(scope_t* scope, char* string, int calls, size_t temporaries) {
+    expression_t expr;
+    expression_t plain;
+    expression_cse_stats_t stats = { 0, 0 };
+
+    printf("starting test (%s)...", string);
+    if (parse_string(string, &expr) || parse_string(string, &plain))
+        FATAL("failed to parse string \"%s\"", string);
+
+    error_t err = expression_evaluate(&plain, scope);
+    if (err)
+        FATAL("failed to evaluate \"%s\": %s", string, error_string(err));
+
+    _g_calls = 0;
+    err = expression_cse_evaluate(&expr, scope, &stats);
+    if (err)
+        FATAL("failed to evaluate \"%s\" without common subexpressions: %s", string, error_string(err));
+    if (_g_calls != calls)
+        FATAL("expected %d calls, got %d", calls, _g_calls);
+    if (stats.temporaries != temporaries)
+        FATAL("expected %zu temporaries, got %zu", temporaries, stats.temporaries);
+
+    char* str = stringify(&expr);
+    char* result = stringify(&plain);
+    if (strcmp(str, result) != 0)
+        FATAL("strings do not match! expecting string '%s' got '%s'", result, str);
+
+    free(str);
+    free(result);
+    expression_clean(&expr);
+    expression_clean(&plain);
+    printf("done\n");
+}
+
+int main() {
+    scope_t scope;
+    scope_init(&scope);
+    scope_define_internal_function(&scope, "count", builtin_func_count, 1, "__arg0");
+    scope_define_internal_function(&scope, "noisy", builtin_func_count, 1, "__arg0");
+    scope_mark_impure(&scope, "noisy");
+    scope_define(&scope, "y", expression_new_number_si(2));
+
+    char* definitions[] = { "g(a, b): if(a, b, 0)", "h(a): a * 2" };
+    for (size_t i = 0; i < sizeof(definitions) / sizeof(definitions[0]); ++i) {
+        expression_t expr;
+        parse_string(definitions[i], &expr);
+        if (expression_evaluate(&expr, &scope))
+            FATAL("failed to define \"%s\"", definitions[i]);
+        expression_clean(&expr);
+    }
+
+    /* repeated subexpressions are evaluated once */
+    check(&scope, "count(y + 1) * 2 + count(y + 1)", 1, 1);
+    check(&scope, "count(y + 1) + count(y + 2) + count(y + 1) * count(y + 2)", 2, 2);
+    check(&scope, "h(count(y * 3)) - count(y * 3) * count(y * 3)", 1, 1);
+
+    /* a sum or product's operands may be in either order */
+    check(&scope, "count(y + 1) * 2 + count(1 + y)", 1, 1);
+    check(&scope, "count(y * 3) - count(3 * y)", 1, 1);
+
+    /* copies inside a reused subexpression aren't reused separately */
+    check(&scope, "(count(y + 1) + 1) * 2 + (count(y + 1) + 1) * 2", 1, 1);
+
+    /* small subexpressions, and symbolic ones, are left alone or give the same result */
+    check(&scope, "count(y) + count(y)", 2, 0);
+    check(&scope, "count(x + 1) * count(x + 1) + z", 1, 1);
+
+    /* impure functions are evaluated every time, but their arguments may still be reused */
+    check(&scope, "noisy(y + 1) + noisy(y + 1)", 2, 1);
+
+    /* copies that may not be evaluated aren't counted */
+    check(&scope, "if(y, count(y + 1), 0) + count(y + 1)", 2, 0);
+    check(&scope, "g(1, count(y + 1)) + count(y + 1)", 2, 0);
+
+    /* a user function's arguments that are always used are */
+    check(&scope, "h(count(y + 1)) + count(y + 1)", 1, 1);
+
+    /* an expression that assigns anything is evaluated as it is */
+    check(&scope, "(q: count(y + 1)) + count(y + 1)", 2, 0);
+
+    /* statements share temporaries, until one assigns something */
+    printf("starting test (statements)...");
+    char* strings[] = { "count(y + 1)", "count(y + 1) * 2", "y: 5", "count(y + 1)", "count(y + 1) - 1" };
+    char* expected[] = { "3", "6", "5", "6", "5" };
+    expression_list_t* statements = malloc(sizeof(expression_list_t));
+    expression_list_init(statements);
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); ++i) {
+        expression_t* expr = malloc(sizeof(expression_t));
+        parse_string(strings[i], expr);
+        expression_list_append(statements, expr);
+    }
+
+    results_t results;
+    results.count = 0;
+    expression_cse_stats_t stats = { 0, 0 };
+    _g_calls = 0;
+    error_t err = expression_cse_evaluate_statements(statements, &scope, collect, &results, &stats);
+    if (err)
+        FATAL("failed to evaluate statements: %s", error_string(err));
+    if (_g_calls != 2 || stats.temporaries != 2 || stats.reused != 2)
+        FATAL("expected 2 calls and 2 temporaries, got %d calls and %zu temporaries", _g_calls, stats.temporaries);
+    if (results.count != sizeof(expected) / sizeof(expected[0]))
+        FATAL("expected %zu results, got %zu", sizeof(expected) / sizeof(expected[0]), results.count);
+    for (size_t i = 0; i < results.count; ++i) {
+        if (strcmp(results.strings[i], expected[i]) != 0)
+            FATAL("expected statement %zu to be '%s' got '%s'", i, expected[i], results.strings[i]);
+        free(results.strings[i]);
+    }
+    expression_list_free(statements);
+    printf("done\n");
+
+    scope_clean(&scope);
+}
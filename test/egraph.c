@@ -0,0 +1,144 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/egraph.h"
+
+/* simplify a string with an e-graph, and check the result
+ *
+ * @string the string to simplify
+ * @rules rules to use as well as the defaults, or NULL
+ * @cost the cost model
+ * @result the expected result, or NULL if more than one result is as cheap
+ * @result_cost the expected result's cost
+ */
+void check(char* string, rewrite_rules_t* rules, egraph_cost_t cost, char* result, double result_cost) {
+    expression_t expr;
+
+    printf("starting test (%s)...", string);
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    err = egraph_simplify(&expr, rules, NULL, cost);
+    if (err)
+        FATAL("failed to simplify \"%s\": %s", string, error_string(err));
+
+    char* str = stringify(&expr);
+    if (result && strcmp(str, result) != 0)
+        FATAL("strings do not match! expecting string '%s' got '%s'", result, str);
+    if (egraph_expression_cost(&expr, cost) != result_cost)
+        FATAL("expected '%s' to cost %g, it costs %g", str, result_cost, egraph_expression_cost(&expr, cost));
+    free(str);
+
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+/* add a string to an e-graph
+ *
+ * @graph the graph
+ * @string the string
+ * @return returns the string's e-class
+ */
+size_t add(egraph_t* graph, char* string) {
+    expression_t expr;
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    size_t class = egraph_add(graph, &expr);
+    expression_clean(&expr);
+    return class;
+}
+
+int main() {
+    egraph_t graph;
+
+    /* each e-node is only stored once */
+    printf("starting test (hash-consing)...");
+    egraph_init(&graph);
+    size_t class = add(&graph, "x * y + x * y");
+    if (graph.live_count != 4)
+        FATAL("expected 4 e-nodes, got %zu", graph.live_count);
+    if (add(&graph, "x * y + x * y") != class)
+        FATAL("expected the same expression to be in the same e-class");
+    egraph_clean(&graph);
+    printf("done\n");
+
+    /* merging two e-classes merges the e-classes that use them */
+    printf("starting test (congruence)...");
+    egraph_init(&graph);
+    size_t a = add(&graph, "a");
+    size_t b = add(&graph, "b");
+    size_t fa = add(&graph, "f(a + 1)");
+    size_t fb = add(&graph, "f(b + 1)");
+    if (egraph_find(&graph, fa) == egraph_find(&graph, fb))
+        FATAL("expected f(a + 1) and f(b + 1) to be in different e-classes");
+    if (!egraph_merge(&graph, a, b) || egraph_merge(&graph, b, a))
+        FATAL("expected only the first merge to change the graph");
+    egraph_rebuild(&graph);
+    if (egraph_find(&graph, fa) != egraph_find(&graph, fb))
+        FATAL("expected f(a + 1) and f(b + 1) to be in the same e-class");
+    egraph_clean(&graph);
+    printf("done\n");
+
+    /* exact arithmetic on numbers is folded, anything that would round isn't */
+    printf("starting test (folding)...");
+    egraph_init(&graph);
+    if (add(&graph, "2 * 3 - 1") != add(&graph, "5"))
+        FATAL("expected 2 * 3 - 1 to be folded");
+    if (add(&graph, "1 / 3") == add(&graph, "0.3333333333333333"))
+        FATAL("expected 1 / 3 not to be folded");
+    egraph_clean(&graph);
+    printf("done\n");
+
+    check("2 * 3 + 4", NULL, egraph_cost_size, "10", 1);
+    check("x - x + y", NULL, egraph_cost_size, "y", 1);
+    check("(a + 0) * 1", NULL, egraph_cost_size, "a", 1);
+    check("a * b + a * c", NULL, egraph_cost_size, NULL, 5);
+    check("(x + 1) * y - y", NULL, egraph_cost_size, NULL, 3);
+    check("x * x * x", NULL, egraph_cost_size, "x ^ 3", 3);
+
+    /* the cheapest form depends on the cost model */
+    check("x ^ 2", NULL, egraph_cost_size, "x ^ 2", 3);
+    check("x ^ 2", NULL, egraph_cost_speed, "x * x", 6);
+
+    /* other rules are used too, whatever order the sum is written in */
+    rewrite_rules_t rules;
+    rewrite_rules_init(&rules);
+    rewrite_rules_add_string(&rules, "sin(a) ^ 2 + cos(a) ^ 2 = 1");
+    check("sin(x) ^ 2 + x + cos(x) ^ 2", &rules, egraph_cost_size, NULL, 3);
+    rewrite_rules_clean(&rules);
+
+    /* saturation stops at the node limit, and the graph can still be extracted from */
+    printf("starting test (node limit)...");
+    egraph_limits_t limits = { 500, 0, 0 };
+    rewrite_rules_init(&rules);
+    egraph_default_rules(&rules);
+    egraph_init(&graph);
+    class = add(&graph, "a + b + c + d + e + f + g + h + i + j");
+    error_t err = egraph_saturate(&graph, &rules, &limits);
+    if (err)
+        FATAL("failed to saturate: %s", error_string(err));
+    if (graph.stopped != EGRAPH_STOP_NODE_LIMIT)
+        FATAL("expected saturation to stop at the node limit, it stopped with %d", graph.stopped);
+
+    double cost;
+    expression_t* expr = egraph_extract(&graph, class, egraph_cost_size, &cost);
+    if (cost != 19)
+        FATAL("expected the extracted sum to cost 19, it costs %g", cost);
+    expression_free(expr);
+    egraph_clean(&graph);
+    printf("done\n");
+
+    /* a graph the rules can't add to is saturated */
+    printf("starting test (saturated)...");
+    egraph_init(&graph);
+    add(&graph, "sin(x)");
+    err = egraph_saturate(&graph, &rules, NULL);
+    if (err || graph.stopped != EGRAPH_STOP_SATURATED || graph.applied != 0)
+        FATAL("expected sin(x) to be saturated without applying any rules");
+    egraph_clean(&graph);
+    rewrite_rules_clean(&rules);
+    printf("done\n");
+}
@@ -14,6 +14,9 @@
 #define OP_BOOLEAN_TRUE     8
 #define OP_BOOLEAN_FALSE    16
 
+/* the number of terms added to x in the long equation, enough to be slow if each side was searched at every level */
+#define LONG_EQUATION_TERMS 20000
+
 DEFINE_MPFR_FUNCTION(cos)
 DEFINE_MPFR_CONST(pi)
 
@@ -197,40 +200,37 @@ int main() {
         },
         {"3 + x * x * x * 3", OP_EVALUATE | OP_COMPLEX_SIMPLIFY,
             expression_new_operator(
-                expression_new_number_d(3),
-                '+',
                 expression_new_operator(
                     expression_new_operator(
                         expression_new_variable("x"),
                         '^',
                         expression_new_number_d(3)),
                     '*',
-                    expression_new_number_d(3)))
+                    expression_new_number_d(3)),
+                '+',
+                expression_new_number_d(3))
         },
         {"3 * x * x * x * 3", OP_EVALUATE | OP_COMPLEX_SIMPLIFY,
             expression_new_operator(
                 expression_new_operator(
-                    expression_new_number_d(3),
-                    '*',
-                    expression_new_operator(
-                        expression_new_variable("x"),
-                        '^',
-                        expression_new_number_d(3))),
+                    expression_new_variable("x"),
+                    '^',
+                    expression_new_number_d(3)),
                 '*',
-                expression_new_number_d(3))
+                expression_new_number_d(9))
         },
         {"100 ^ x * x * x * 3", OP_EVALUATE | OP_COMPLEX_SIMPLIFY,
             expression_new_operator(
                 expression_new_operator(
                     expression_new_operator(
-                        expression_new_number_d(100),
+                        expression_new_variable("x"),
                         '^',
-                        expression_new_variable("x")),
+                        expression_new_number_d(2)),
                     '*',
                     expression_new_operator(
-                        expression_new_variable("x"),
+                        expression_new_number_d(100),
                         '^',
-                        expression_new_number_d(2))),
+                        expression_new_variable("x"))),
                 '*',
                 expression_new_number_d(3))
         },
@@ -318,4 +318,28 @@ int main() {
         expression_clean(&expr);
         printf("done\n");
     }
+
+    /* a variable deep in a long equation is isolated by looking at each expression once */
+    printf("starting test (long equation)...");
+    expression_t* sum = expression_new_variable("x");
+    for (int i = 0; i < LONG_EQUATION_TERMS; ++i)
+        sum = expression_new_operator(sum, '+', i % 2 ? expression_new_variable("y") : expression_new_number_si(1));
+
+    err = expression_isolate_variable(sum, "x");
+    if (err)
+        FATAL("failed to isolate 'x' in a long equation: %s", error_string(err));
+    if (!EXPRESSION_IS_VARIABLE(sum->operator.left) || strcmp(sum->operator.left->variable.value, "x") != 0)
+        FATAL("expected 'x' to be isolated on the left of a long equation");
+
+    /* x = 0 - 1 - y - 1 - y ... */
+    size_t terms = 0;
+    expression_t* side = sum->operator.right;
+    while (EXPRESSION_IS_OPERATOR(side) && side->operator.infix == '-') {
+        ++terms;
+        side = side->operator.left;
+    }
+    if (terms != LONG_EQUATION_TERMS || !EXPRESSION_IS_NUMBER(side))
+        FATAL("expected %d terms to be subtracted from 0, got %zu", LONG_EQUATION_TERMS, terms);
+    expression_free(sum);
+    printf("done\n");
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/fixpoint.h"
+#include "simplify/expression/simplify.h"
+
+/* the number of unrelated terms added to an expression, that only have to be simplified once */
+#define BULK_TERMS 200
+
+/* simplify a string until it stops changing, and check the result
+ *
+ * @string the string
+ * @rules the rules to rewrite it with, or NULL
+ * @result the expected result
+ * @stats set to the work done
+ */
+void check(char* string, rewrite_rules_t* rules, char* result, expression_fixpoint_stats_t* stats) {
+    expression_t expr;
+
+    printf("starting test (%.64s)...", string);
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    err = expression_simplify_fixpoint(&expr, rules, stats);
+    if (err)
+        FATAL("failed to simplify \"%s\": %s", string, error_string(err));
+    if (!stats->converged)
+        FATAL("expected \"%s\" to converge in %d iterations", string, EXPRESSION_FIXPOINT_MAX_ITERATIONS);
+
+    char* str = stringify(&expr);
+    if (strcmp(str, result) != 0)
+        FATAL("strings do not match! expecting string '%s' got '%s'", result, str);
+
+    /* the result is stable, simplifying it again doesn't change it */
+    expression_fixpoint_stats_t again;
+    err = expression_simplify_fixpoint(&expr, rules, &again);
+    if (err || again.iterations != 1 || !again.converged)
+        FATAL("expected '%s' not to change when it's simplified again", str);
+    free(str);
+
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+int main() {
+    expression_fixpoint_stats_t stats;
+    rewrite_rules_t rules;
+
+    /* without rules the results are the same as expression_simplify's */
+    check("x + x", NULL, "x * 2", &stats);
+    check("2 * y - y * 3", NULL, "-y", &stats);
+    check("(x + 1) * (x - 1)", NULL, "x ^ 2 - 1", &stats);
+    check("sin(x + x) + sin(2 * x)", NULL, "sin(x * 2) * 2", &stats);
+    check("f(x) = x * x - 1 + 1", NULL, "f(x) = x ^ 2", &stats);
+    check("x - (y - x) + y", NULL, "x * 2", &stats);
+
+    /* a rule's replacement is simplified, and the result is rewritten again */
+    rewrite_rules_init(&rules);
+    rewrite_rules_add_string(&rules, "sin(a) ^ 2 + cos(a) ^ 2 = 1");
+    rewrite_rules_add_string(&rules, "double(a) = a + a");
+    check("sin(x) ^ 2 + cos(x) ^ 2", &rules, "1", &stats);
+    check("sin(double(x) / 2) ^ 2 + cos(x) ^ 2", &rules, "1", &stats);
+    rewrite_rules_clean(&rules);
+
+    /* each walk only applies the passes to the parts of the expression that changed */
+    rewrite_rules_init(&rules);
+    rewrite_rules_add_string(&rules, "p(a) = q(r(a))");
+    rewrite_rules_add_string(&rules, "r(a) = a + a");
+
+    /* the result is what expression_simplify makes of the rewritten expression */
+    char* string = calloc(BULK_TERMS * 32, 1);
+    char* rewritten = calloc(BULK_TERMS * 32, 1);
+    strcpy(string, "p(v)");
+    strcpy(rewritten, "q(v + v)");
+    for (int i = 0; i < BULK_TERMS; ++i) {
+        sprintf(string + strlen(string), " + g%c%c(w) * w", 'a' + i / 26, 'a' + i % 26);
+        sprintf(rewritten + strlen(rewritten), " + g%c%c(w) * w", 'a' + i / 26, 'a' + i % 26);
+    }
+
+    expression_t expr;
+    parse_string(rewritten, &expr);
+    expression_simplify(&expr);
+    char* result = stringify(&expr);
+    expression_clean(&expr);
+    free(rewritten);
+
+    check(string, &rules, result, &stats);
+    if (stats.iterations < 3)
+        FATAL("expected more than one walk to be needed, only %zu were", stats.iterations);
+    if (stats.skipped < stats.visited)
+        FATAL("expected most expressions to be skipped, %zu were visited and %zu skipped", stats.visited, stats.skipped);
+    free(string);
+    free(result);
+    rewrite_rules_clean(&rules);
+
+    /* rules that undo each other stop at the iteration limit */
+    printf("starting test (loop)...");
+    rewrite_rules_init(&rules);
+    rewrite_rules_add_string(&rules, "f(a) = g(a)");
+    rewrite_rules_add_string(&rules, "g(a) = h(a + 0)");
+    rewrite_rules_add_string(&rules, "h(a) = f(a)");
+    parse_string("f(x)", &expr);
+    error_t err = expression_simplify_fixpoint(&expr, &rules, &stats);
+    if (err || stats.converged || stats.iterations != EXPRESSION_FIXPOINT_MAX_ITERATIONS)
+        FATAL("expected rules that loop to stop after %d iterations", EXPRESSION_FIXPOINT_MAX_ITERATIONS);
+    expression_clean(&expr);
+    rewrite_rules_clean(&rules);
+    printf("done\n");
+}
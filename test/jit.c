@@ -0,0 +1,195 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <math.h>
+
+#include "test/test.h"
+#include "simplify/builtins.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/jit.h"
+#include "simplify/expression/symbol.h"
+
+DEFINE_MPFR_FUNCTION(sin)
+DEFINE_MPFR_FUNCTION(cos)
+DEFINE_MPFR_FUNCTION2(max)
+DEFINE_MPFR_CONST(pi)
+
+/* returns it's argument, it's marked impure so it can't be compiled */
+error_t builtin_func_tick(scope_t* scope, expression_t** out) {
+    *out = malloc(sizeof(expression_t));
+    return scope_get_argument(scope, 0, *out);
+}
+
+/* evaluate a string in a scope, and discard the result
+ *
+ * @scope the scope to evaluate the string in
+ * @string the string to evaluate
+ */
+void run(scope_t* scope, char* string) {
+    expression_t expr;
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    err = expression_evaluate(&expr, scope);
+    if (err)
+        FATAL("failed to evaluate \"%s\": %s", string, error_string(err));
+    expression_clean(&expr);
+}
+
+/* check if two doubles are equal, allowing for the rounding error of the math library
+ *
+ * @x the first double
+ * @y the second double
+ * @return returns true if they're close enough
+ */
+bool close_enough(double x, double y) {
+    if (isnan(x) || isnan(y))
+        return isnan(x) && isnan(y);
+    return fabs(x - y) <= 1e-12 * fmax(1, fmax(fabs(x), fabs(y)));
+}
+
+/* compile a string with the parameters x and y, and compare it's results with expression_evaluate
+ *
+ * @scope the scope to compile and evaluate the string in
+ * @string the string to compile
+ */
+void check(scope_t* scope, char* string) {
+    static const double samples[][2] = { { 0.5, 1.25 }, { 2, 3 }, { -1.5, 0.75 }, { 10, -4 } };
+
+    expression_t expr;
+    jit_function_t function;
+
+    printf("starting test (%s)...", string);
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    expression_list_t* parameters = malloc(sizeof(expression_list_t));
+    expression_list_init(parameters);
+    expression_list_append(parameters, expression_new_variable("x"));
+    expression_list_append(parameters, expression_new_variable("y"));
+
+    err = jit_compile(&function, &expr, scope, parameters);
+    if (err)
+        FATAL("failed to compile \"%s\": %s", string, error_string(err));
+#if JIT_NATIVE
+    if (!function.native)
+        FATAL("expected \"%s\" to be compiled to machine code", string);
+#endif
+
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+        scope_define(scope, "x", expression_new_number_d(samples[i][0]));
+        scope_define(scope, "y", expression_new_number_d(samples[i][1]));
+
+        expression_t result;
+        expression_copy(&expr, &result);
+        err = expression_evaluate(&result, scope);
+        if (err || !EXPRESSION_IS_NUMBER(&result))
+            FATAL("failed to evaluate \"%s\"", string);
+
+        double expected = mpfr_get_d(result.number.value, MPFR_RNDN);
+        double native = jit_call(&function, samples[i]);
+        double interpreted = jit_interpret(&function, samples[i]);
+        if (!close_enough(native, expected) || !close_enough(interpreted, expected))
+            FATAL("\"%s\" with x = %g, y = %g: expected %.17g, got %.17g compiled and %.17g interpreted",
+                  string, samples[i][0], samples[i][1], expected, native, interpreted);
+        expression_clean(&result);
+    }
+
+    jit_clean(&function);
+    expression_list_free(parameters);
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+/* check that a string can't be compiled
+ *
+ * @scope the scope to compile the string in
+ * @string the string to compile
+ */
+void check_fails(scope_t* scope, char* string) {
+    expression_t expr;
+    jit_function_t function;
+
+    printf("starting test (%s)...", string);
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    if (!jit_compile(&function, &expr, scope, NULL))
+        FATAL("expected \"%s\" to fail to compile", string);
+
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+/* build a balanced tree of sums and products, compiling it needs one register per level
+ *
+ * @level the depth of the tree
+ * @leaf the variable used if the tree is a leaf
+ * @return returns the tree as a string, it must be freed
+ */
+char* balanced(int level, char* leaf) {
+    if (level == 0) {
+        char* copy = malloc(strlen(leaf) + 1);
+        strcpy(copy, leaf);
+        return copy;
+    }
+
+    char* left = balanced(level - 1, "x");
+    char* right = balanced(level - 1, "y");
+    char* tree = malloc(strlen(left) + strlen(right) + 8);
+    sprintf(tree, "(%s %c %s)", left, level % 2 ? '+' : '*', right);
+    free(left);
+    free(right);
+    return tree;
+}
+
+int main() {
+    scope_t scope;
+    scope_init(&scope);
+    EXPORT_BUILTIN_FUNCTION(&scope, sin);
+    EXPORT_BUILTIN_FUNCTION(&scope, cos);
+    EXPORT_BUILTIN_FUNCTION(&scope, tick);
+    EXPORT_BUILTIN_FUNCTION2(&scope, max);
+    EXPORT_BUILTIN_CONST(&scope, pi);
+    scope_mark_impure(&scope, "tick");
+
+    run(&scope, "k: 2.5");
+    run(&scope, "square(t): t * t");
+    run(&scope, "f(a, b): square(a) - b / k");
+    run(&scope, "shift(t): t + x");
+
+    check(&scope, "x + y * 2");
+    check(&scope, "(x - y) / (x + y + 20)");
+    check(&scope, "-x ^ 2 + 3 * x - -y");
+    check(&scope, "x ^ 3 + y \\ 3");
+    check(&scope, "sin(x) * cos(y) + max(x, y)");
+    check(&scope, "pi * x + k");
+
+    /* right leaning expressions are compiled right to left, so they use fewer registers */
+    check(&scope, "(x + 1) * ((y + 2) * ((x + 3) * ((y + 4) * (x - 5))))");
+    check(&scope, "x - (y - (x - (y - (x / (y + 9)))))");
+
+    /* calls made while other values are in registers */
+    check(&scope, "x + sin(y + cos(x * max(y, x - 1)))");
+    check(&scope, "(x * 2) - max(y / 3, max(x, sin(y) + 1))");
+
+    /* user functions are inlined, and see their caller's names */
+    check(&scope, "f(x, y) + square(f(y, x))");
+    check(&scope, "shift(y) * square(x + 1)");
+
+    /* enough registers that the upper eight are used */
+    char* tree = balanced(10, "x");
+    check(&scope, tree);
+    free(tree);
+
+    check_fails(&scope, "x: 1");
+    check_fails(&scope, "undefined + 1");
+    check_fails(&scope, "tick(1)");
+    run(&scope, "forever(n): forever(n + 1)");
+    check_fails(&scope, "forever(1)");
+
+    scope_clean(&scope);
+    symbol_table_free();
+}
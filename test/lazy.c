@@ -0,0 +1,102 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/builtins.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/call_cache.h"
+#include "simplify/expression/call_stack.h"
+
+/* the number of times `count` has been called */
+static size_t _g_count;
+
+/* returns it's argument, and counts how many times it's called */
+error_t builtin_func_count(scope_t* scope, expression_t** out) {
+    ++_g_count;
+    *out = malloc(sizeof(expression_t));
+    return scope_get_argument(scope, 0, *out);
+}
+
+int main() {
+    struct {
+        char*   string;
+        char*   result;
+        size_t  count;
+    } __string_result_pairs[] = {
+        /* arguments the body doesn't use aren't evaluated, and arguments it uses twice are evaluated once */
+        { "first(a, b): a", "a", 0 },
+        { "first(count(1), count(2))", "1", 1 },
+        { "twice(a): a + a", "a + a", 0 },
+        { "twice(count(3))", "6", 1 },
+        { "maybe(c, a): if(c > 0, a * a + a, 0)", "if(c > 0, a * a + a, 0)", 0 },
+        { "maybe(1, count(3))", "12", 1 },
+        { "maybe(-1, count(3))", "0", 0 },
+        { "first(1, (z: 4))", "1", 0 },
+        { "z", "4", 0 },
+
+        /* only the selected value is evaluated */
+        { "if(1 < 2, count(10), count(20))", "10", 1 },
+        { "if(2 < 1, count(10), count(20))", "20", 1 },
+        { "if(0, 1, 2)", "2", 0 },
+        { "x: 0", "0", 0 },
+        { "if(x < 0, count(-1), x = 0, count(0), count(1))", "0", 1 },
+        { "if(x > 0, count(-1), x < 0, count(0), count(1))", "1", 1 },
+        { "if(y < 1, 2, 3)", "if(y < 1, 2, 3)", 0 },
+        { "if(1, 2)", "if(1, 2)", 0 },
+
+        /* arguments used in only one branch are passed unevaluated */
+        { "pick(c, a, b): if(c > 0, a, b)", "if(c > 0, a, b)", 0 },
+        { "pick(1, count(5), count(6))", "5", 1 },
+        { "pick(count(-1), count(5), count(6))", "6", 2 },
+        { "pick(1, count(5), count(6)) + pick(1, count(5), count(6))", "10", 2 },
+
+        /* unevaluated arguments can be read by name from a function that's called */
+        { "shift(t): t + w", "t + w", 0 },
+        { "g(w): shift(1)", "shift(1)", 0 },
+        { "g(count(5))", "6", 1 },
+
+        /* a call selected by a conditional reuses the caller's frame */
+        { "down(n): if(n < 1, 0, down(n - 1))", "if(n < 1, 0, down(n - 1))", 0 },
+        { "down(100000)", "0", 0 },
+        { "fib(n): if(n < 2, n, fib(n - 1) + fib(n - 2))", "if(n < 2, n, fib(n - 1) + fib(n - 2))", 0 },
+        { "fib(20)", "6765", 0 },
+    };
+
+    error_t err;
+    scope_t scope;
+    call_cache_t calls;
+    scope_init(&scope);
+    call_cache_init(&calls, CALL_CACHE_DEFAULT_SIZE);
+    scope_set_call_cache(&scope, &calls);
+    EXPORT_BUILTIN_FUNCTION(&scope, count);
+    scope_mark_impure(&scope, "count");
+    expression_set_recursion_limit(200000);
+
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t expr;
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i].string);
+        err = parse_string(__string_result_pairs[i].string, &expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        _g_count = 0;
+        err = expression_evaluate(&expr, &scope);
+        if (err)
+            FATAL("failed to evaluate \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+        if (_g_count != __string_result_pairs[i].count)
+            FATAL("expected %zu calls evaluating \"%s\", got %zu", __string_result_pairs[i].count,
+                  __string_result_pairs[i].string, _g_count);
+
+        char* str = stringify(&expr);
+        if (strcmp(str, __string_result_pairs[i].result) != 0)
+            FATAL("strings do not match! expecting string '%s' got '%s'", __string_result_pairs[i].result, str);
+        free(str);
+
+        expression_clean(&expr);
+        printf("done\n");
+    }
+
+    scope_clean(&scope);
+    call_cache_clean(&calls);
+    call_stack_free();
+}
@@ -0,0 +1,69 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/memo.h"
+
+/* the builtin used to check that calls are only made once, it counts how many times it's called */
+static int _g_calls;
+
+error_t builtin_func_count(scope_t* scope, expression_t** out) {
+    ++_g_calls;
+    *out = malloc(sizeof(expression_t));
+    return scope_get_value(scope, "__arg0", *out);
+}
+
+int main() {
+    struct {
+        char*  string;
+        char*  result;
+        int    calls;
+    } __string_result_pairs[] = {
+        { "count(y) + count(y)", "4", 1 },
+        { "(count(y) + 1) ^ 2 / (count(y) + 1)", "3", 0 },
+        { "count(y) * count(z)", "2 * z", 1 },
+        { "y: 3", "3", 0 },
+        { "count(y) + count(y)", "6", 1 },
+        { "z: 1", "1", 0 },
+        { "count(y) * count(z)", "3", 1 },
+        { "count(a * b) + count(b * a)", "b * a + b * a", 1 },
+    };
+
+    error_t err;
+    scope_t scope;
+    expression_memo_t memo;
+
+    scope_init(&scope);
+    expression_memo_init(&memo, true);
+    scope_set_memo(&scope, &memo);
+    scope_define_internal_function(&scope, "count", builtin_func_count, 1, "__arg0");
+    scope_define(&scope, "y", expression_new_number_si(2));
+
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t expr;
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i].string);
+        err = parse_string(__string_result_pairs[i].string, &expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        _g_calls = 0;
+        err = expression_evaluate(&expr, &scope);
+        if (err)
+            FATAL("failed to evaluate \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        if (_g_calls != __string_result_pairs[i].calls)
+            FATAL("expected %d calls, got %d", __string_result_pairs[i].calls, _g_calls);
+
+        char* str = stringify(&expr);
+        if (strcmp(str, __string_result_pairs[i].result) != 0)
+            FATAL("strings do not match! expecting string '%s' got '%s'", __string_result_pairs[i].result, str);
+
+        free(str);
+        expression_clean(&expr);
+        printf("done\n");
+    }
+
+    expression_memo_clean(&memo);
+    scope_clean(&scope);
+}
@@ -0,0 +1,218 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/builtins.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/simplify.h"
+#include "simplify/expression/thread_pool.h"
+#include "simplify/expression/symbol.h"
+
+DEFINE_MPFR_FUNCTION(sin)
+DEFINE_MPFR_FUNCTION(cos)
+DEFINE_MPFR_FUNCTION2(max)
+
+/* the thread the tests run on, impure functions must only be called from it */
+static pthread_t _g_main_thread;
+
+/* returns it's argument, it's marked impure so it should never run on a worker */
+error_t builtin_func_tick(scope_t* scope, expression_t** out) {
+    if (!pthread_equal(pthread_self(), _g_main_thread))
+        FATAL("an impure function was called from a worker thread");
+
+    *out = malloc(sizeof(expression_t));
+    return scope_get_argument(scope, 0, *out);
+}
+
+/* returns it's argument, it's pure but it isn't marked thread safe, so it should never run on a worker either */
+error_t builtin_func_same(scope_t* scope, expression_t** out) {
+    if (!pthread_equal(pthread_self(), _g_main_thread))
+        FATAL("a function that isn't marked thread safe was called from a worker thread");
+
+    *out = malloc(sizeof(expression_t));
+    return scope_get_argument(scope, 0, *out);
+}
+
+/* log(b, y), it evaluates the logarithm it builds so it isn't thread safe, it should never run on a worker */
+error_t builtin_func_log(scope_t* scope, expression_t** out) {
+    if (!pthread_equal(pthread_self(), _g_main_thread))
+        FATAL("a function that isn't thread safe was called from a worker thread");
+
+    expression_t* b = malloc(sizeof(expression_t));
+    expression_t* y = malloc(sizeof(expression_t));
+    scope_get_argument(scope, 0, b);
+    scope_get_argument(scope, 1, y);
+
+    error_t err = expression_do_logarithm(b, y, out);
+    if (err) return err;
+    return expression_evaluate(*out, scope);
+}
+
+/* define the functions used by the tests in a scope */
+void init_scope(scope_t* scope, precision_policy_t* policy) {
+    scope_init(scope);
+    scope_set_precision_policy(scope, policy);
+    EXPORT_MPFR_FUNCTION(scope, sin);
+    EXPORT_MPFR_FUNCTION(scope, cos);
+    EXPORT_BUILTIN_FUNCTION(scope, tick);
+    EXPORT_BUILTIN_FUNCTION(scope, same);
+    EXPORT_MPFR_FUNCTION2(scope, max);
+    EXPORT_BUILTIN_FUNCTION2(scope, log);
+    scope_mark_impure(scope, "tick");
+}
+
+/* evaluate a string in a scope
+ *
+ * @scope the scope to evaluate the string in
+ * @string the string to evaluate
+ * @expr location to store the result
+ */
+void evaluate(scope_t* scope, char* string, expression_t* expr) {
+    error_t err = parse_string(string, expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    err = expression_evaluate(expr, scope);
+    if (err)
+        FATAL("failed to evaluate \"%s\": %s", string, error_string(err));
+}
+
+/* the results of a list of statements, in the order they were printed */
+typedef struct {
+    char* strings[16];
+    int   count;
+} results_t;
+
+error_t collect(expression_t* expr, void* data) {
+    results_t* results = data;
+    results->strings[results->count++] = stringify(expr);
+    return ERROR_NO_ERROR;
+}
+
+/* evaluate a list of statements in a scope, collecting their results
+ *
+ * @scope the scope to evaluate the statements in
+ * @strings the statements, the list ends with NULL
+ * @results location to store the results
+ */
+void evaluate_statements(scope_t* scope, char** strings, results_t* results) {
+    expression_list_t* statements = malloc(sizeof(expression_list_t));
+    expression_list_init(statements);
+    results->count = 0;
+
+    for (int i = 0; strings[i]; ++i) {
+        expression_t* expr = malloc(sizeof(expression_t));
+        error_t err = parse_string(strings[i], expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", strings[i], error_string(err));
+        expression_list_append(statements, expr);
+    }
+
+    error_t err = expression_evaluate_statements(statements, scope, collect, results);
+    if (err)
+        FATAL("failed to evaluate statements: %s", error_string(err));
+    expression_list_free(statements);
+}
+
+int main() {
+    char* strings[] = {
+        "sin(2 ^ 0.5) + cos(3 \\ 5) * sin(7) - cos(11)",
+        "2 ^ 0.5 + 3 ^ 0.5 + 5 ^ 0.5 + 7 ^ 0.5 + 11 ^ 0.5",
+        "sin(cos(sin(2)) + cos(sin(3))) / max(sin(5), cos(5))",
+        "-sin(2) * -(3 ^ 0.5)",
+        "x + sin(2) * (y - cos(3 ^ 0.25))",
+        "g(x): cos(x) ^ 0.5 + a",
+        "g(2) + sin(3) * g(sin(4))",
+        "tick(1) + sin(5) + tick(2) * cos(5)",
+        "(k(x): sin(x)) + sin(2) + cos(2)",
+        "k(3) + cos(3)",
+        "sin(1, 2) + cos(2 ^ 0.5)",
+        "sin(1) < cos(2 ^ 0.5)",
+        "log(2, 3 ^ 0.5) + sin(5) * log(3, 7 ^ 0.5) + cos(5)",
+        "same(2 ^ 0.5) + sin(3) * same(5 ^ 0.5) + cos(7)",
+        NULL,
+    };
+
+    precision_policy_t policy;
+    precision_policy_init(&policy);
+    precision_policy_set_fixed(&policy, 8192);
+    mpfr_set_default_prec(8192);
+    _g_main_thread = pthread_self();
+
+    scope_t serial;
+    scope_t parallel;
+    thread_pool_t pool;
+    init_scope(&serial, &policy);
+    init_scope(&parallel, &policy);
+
+    error_t err = thread_pool_init(&pool, 4);
+    if (err)
+        FATAL("failed to start the pool: %s", error_string(err));
+    scope_set_thread_pool(&parallel, &pool);
+
+    /* a long sum of expensive terms, so there's plenty to steal */
+    char sum[4096] = "sin(1 ^ 0.5)";
+    for (int i = 2; i <= 64; ++i)
+        snprintf(sum + strlen(sum), sizeof(sum) - strlen(sum), " + sin(%d ^ 0.5)", i);
+    strings[sizeof(strings) / sizeof(strings[0]) - 1] = sum;
+
+    for (int i = 0; i < (int) (sizeof(strings) / sizeof(strings[0])); ++i) {
+        expression_t expected;
+        expression_t result;
+
+        printf("starting test #%d (%.64s)...", i + 1, strings[i]);
+        evaluate(&serial, strings[i], &expected);
+        evaluate(&parallel, strings[i], &result);
+
+        char* expected_str = stringify(&expected);
+        char* result_str = stringify(&result);
+        if (strcmp(expected_str, result_str) != 0)
+            FATAL("strings do not match! expecting string '%s' got '%s'", expected_str, result_str);
+        if (EXPRESSION_IS_NUMBER(&expected) && !mpfr_equal_p(expected.number.value, result.number.value))
+            FATAL("the parallel result isn't the same as the serial result");
+
+        free(expected_str);
+        free(result_str);
+        expression_clean(&expected);
+        expression_clean(&result);
+        printf("done\n");
+    }
+
+    if (pool.spawned == 0)
+        FATAL("no subexpressions were evaluated in parallel");
+
+    /* the closed subexpressions of later statements start before earlier statements finish,
+        but not before an earlier statement that assigns anything, like the one redefining sin */
+    char* statements[] = {
+        "a: 2 ^ 0.5",
+        "sin(a) + cos(3 ^ 0.5)",
+        "sin(5 ^ 0.5) * cos(7 ^ 0.5)",
+        "n(x): sin(x) ^ 2",
+        "n(3 ^ 0.5) + cos(11 ^ 0.5)",
+        "sin(x): x + 1",
+        "sin(2 ^ 0.5) + cos(13 ^ 0.5)",
+        "cos(17 ^ 0.5) * a",
+        NULL,
+    };
+
+    results_t expected;
+    results_t results;
+    printf("starting test #%d (statements)...", (int) (sizeof(strings) / sizeof(strings[0])) + 1);
+    evaluate_statements(&serial, statements, &expected);
+    evaluate_statements(&parallel, statements, &results);
+
+    if (results.count != expected.count)
+        FATAL("expected %d results, got %d", expected.count, results.count);
+    for (int i = 0; i < expected.count; ++i) {
+        if (strcmp(expected.strings[i], results.strings[i]) != 0)
+            FATAL("statement %d doesn't match! expecting string '%s' got '%s'", i + 1, expected.strings[i], results.strings[i]);
+        free(expected.strings[i]);
+        free(results.strings[i]);
+    }
+    printf("done\n");
+
+    thread_pool_clean(&pool);
+    scope_clean(&parallel);
+    scope_clean(&serial);
+    symbol_table_free();
+    mpfr_free_cache();
+}
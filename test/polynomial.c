@@ -0,0 +1,127 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/budget.h"
+#include "simplify/expression/simplify.h"
+#include "simplify/expression/polynomial.h"
+
+/* the number of terms in the generated sums, and the number of variables they use */
+#define LARGE_SUM_TERMS     5000
+#define LARGE_SUM_VARIABLES 50
+
+/* simplify an expression, and check the result
+ *
+ * @expr the expression, it's freed
+ * @result the expected result
+ */
+void check(expression_t* expr, char* result) {
+    budget_t budget;
+
+    /* collecting like terms is linear, so even the generated sums should be done well within a second */
+    budget_init(&budget);
+    budget.max_seconds = 1;
+    budget_enter(&budget);
+    error_t err = expression_simplify(expr);
+    budget_leave(&budget);
+    if (err)
+        FATAL("failed to simplify expression: %s", error_string(err));
+
+    char* str = stringify(expr);
+    if (strcmp(str, result) != 0)
+        FATAL("strings do not match! expecting string '%s' got '%s'", result, str);
+    free(str);
+
+    expression_free(expr);
+}
+
+/* build the result of simplifying a generated sum, each variable is added `count` times
+ *
+ * @count the number of times each variable appears
+ * @return returns a new string
+ */
+char* large_sum_result(int count) {
+    char* result = calloc(LARGE_SUM_VARIABLES * 32, 1);
+    for (int i = 0; i < LARGE_SUM_VARIABLES; ++i)
+        sprintf(result + strlen(result), "%sv%d * %d", i ? " + " : "", i, count);
+    return result;
+}
+
+int main() {
+    struct {
+        char* string;
+        char* result;
+    } __string_result_pairs[] = {
+        /* like terms are collected */
+        { "x + x", "x * 2" },
+        { "x * x", "x ^ 2" },
+        { "x - x", "0" },
+        { "a * b + b * a", "a * b * 2" },
+        { "2 * y - y * 3", "-y" },
+        { "1 - x * 2 + x", "-x + 1" },
+        { "x * x * 3 + 2 * x ^ 2", "x ^ 2 * 5" },
+        { "x / 2 + x / 2", "x" },
+        { "x / 3 + x / 3", "x / 3 * 2" },
+
+        /* powers of a single term are collected too */
+        { "x ^ 2 - x ^ 2", "0" },
+        { "x ^ 2 + x ^ 2", "x ^ 2 * 2" },
+        { "x * x + x * x", "x ^ 2 * 2" },
+        { "(a * b) ^ 2 - b ^ 2 * a ^ 2", "0" },
+
+        /* products are expanded when the result isn't longer */
+        { "(x + 1) * (x - 1)", "x ^ 2 - 1" },
+        { "(x + 1) ^ 2 - x ^ 2", "x * 2 + 1" },
+        { "(x + 1) ^ 2", "(x + 1) ^ 2" },
+        { "(x + y) * (x + y) + (x + y) * (x + y)", "(x + y) * (x + y) * 2" },
+
+        /* anything else is kept whole, but it's children are simplified */
+        { "sin(x + x) + sin(2 * x)", "sin(x * 2) * 2" },
+        { "x ^ y * x ^ y", "x ^ y ^ 2" },
+        { "f(x) = x * x - 1 + 1", "f(x) = x ^ 2" },
+    };
+
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t* expr = malloc(sizeof(expression_t));
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i].string);
+        error_t err = parse_string(__string_result_pairs[i].string, expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        check(expr, __string_result_pairs[i].result);
+        printf("done\n");
+    }
+
+    char name[32];
+    char* result = large_sum_result(LARGE_SUM_TERMS / LARGE_SUM_VARIABLES);
+
+    /* a sum parsed from a string leans left */
+    printf("starting test (%d terms, left)...", LARGE_SUM_TERMS);
+    expression_t* sum = NULL;
+    for (int i = 0; i < LARGE_SUM_TERMS; ++i) {
+        sprintf(name, "v%d", i % LARGE_SUM_VARIABLES);
+        expression_t* term = expression_new_variable(name);
+        sum = sum ? expression_new_operator(sum, '+', term) : term;
+    }
+    check(sum, result);
+    printf("done\n");
+
+    /* a sum built by recursion may lean right */
+    printf("starting test (%d terms, right)...", LARGE_SUM_TERMS);
+    sum = NULL;
+    for (int i = LARGE_SUM_TERMS - 1; i >= 0; --i) {
+        sprintf(name, "v%d", i % LARGE_SUM_VARIABLES);
+        expression_t* term = expression_new_variable(name);
+        sum = sum ? expression_new_operator(term, '+', sum) : term;
+    }
+    check(sum, result);
+    printf("done\n");
+    free(result);
+
+    /* products that would have too many terms aren't expanded */
+    printf("starting test (large product)...");
+    expression_t* expr = malloc(sizeof(expression_t));
+    parse_string("(a + b + c + d + e + f + g + h) ^ 60 - 1", expr);
+    check(expr, "(a + b + c + d + e + f + g + h) ^ 60 - 1");
+    printf("done\n");
+}
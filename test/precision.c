@@ -0,0 +1,52 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/evaluate.h"
+
+int main() {
+    struct {
+        char*       string;
+        mpfr_prec_t precision;
+        size_t      digits;
+        char*       result;
+    } __string_result_pairs[] = {
+        { "1 / 3", 200, 50, "0.33333333333333333333333333333333333333333333333333" },
+        { "1 / 3", 20, 20, "0.33333301544189453125" },
+        { "0.1234567890123456789012345", 24, 25, "0.1234567910432815551757812" },
+        { "2 \\ 2", 128, 30, "1.41421356237309504880168872421" },
+    };
+
+    error_t err;
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t       expr;
+        scope_t            scope;
+        precision_policy_t policy;
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i].string);
+        err = parse_string(__string_result_pairs[i].string, &expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        scope_init(&scope);
+        precision_policy_init(&policy);
+        precision_policy_set_fixed(&policy, __string_result_pairs[i].precision);
+        scope_set_precision_policy(&scope, &policy);
+
+        err = expression_evaluate(&expr, &scope);
+        if (err)
+            FATAL("failed to evaluate \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        if (mpfr_get_prec(expr.number.value) != __string_result_pairs[i].precision)
+            FATAL("precision does not match! expecting %ld bits got %ld bits",
+                    (long)__string_result_pairs[i].precision, (long)mpfr_get_prec(expr.number.value));
+
+        char* str = stringify_digits(&expr, __string_result_pairs[i].digits);
+        if (strcmp(str, __string_result_pairs[i].result) != 0)
+            FATAL("strings do not match! expecting string '%s' got '%s'", __string_result_pairs[i].result, str);
+
+        free(str);
+        scope_clean(&scope);
+        expression_clean(&expr);
+        printf("done\n");
+    }
+}
@@ -0,0 +1,95 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/call_stack.h"
+#include "simplify/expression/budget.h"
+
+int main() {
+    struct {
+        char*   string;
+        char*   result;
+        size_t  limit;
+        error_t error;
+    } __string_result_pairs[] = {
+        { "f(n): if(n < 1, 0, f(n - 1))", "if(n < 1, 0, f(n - 1))", 0, ERROR_NO_ERROR },
+        { "f(100000)", "0", 0, ERROR_NO_ERROR },
+        { "g(n): if(n < 1, 0, 1 + g(n - 1))", "if(n < 1, 0, 1 + g(n - 1))", 0, ERROR_NO_ERROR },
+        { "g(100000)", NULL, 0, ERROR_RECURSION_LIMIT },
+        { "g(1000)", "1000", 0, ERROR_NO_ERROR },
+        { "h(n): 1 + h(n + 1)", "1 + h(n + 1)", 0, ERROR_NO_ERROR },
+        { "h(1)", NULL, 2000, ERROR_RECURSION_LIMIT },
+        { "x: y", "y", 0, ERROR_NO_ERROR },
+        { "y: x", "y", 0, ERROR_NO_ERROR },
+        { "x", NULL, 0, ERROR_RECURSION_LIMIT },
+        { "k(a, b): a * b", "a * b", 0, ERROR_NO_ERROR },
+        { "m(a): k(a, a + 1)", "k(a, a + 1)", 0, ERROR_NO_ERROR },
+        { "m(3) + m(4)", "32", 0, ERROR_NO_ERROR },
+        { "p(a): q + k(a, 2)", "q + k(a, 2)", 0, ERROR_NO_ERROR },
+        { "r(q): p(q)", "p(q)", 0, ERROR_NO_ERROR },
+        { "r(3)", "9", 0, ERROR_NO_ERROR },
+        { "m(m(m(2)))", "1806", 2, ERROR_NO_ERROR },
+        { "m(m(m(2)))", NULL, 1, ERROR_RECURSION_LIMIT },
+    };
+
+    error_t err;
+    scope_t scope;
+    scope_init(&scope);
+
+    /* frames are released when evaluation fails, so the value stack should be empty between expressions */
+    variable_info_t* bottom = call_stack_push(1);
+    call_stack_pop(1);
+
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t expr;
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i].string);
+        err = parse_string(__string_result_pairs[i].string, &expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        expression_set_recursion_limit(__string_result_pairs[i].limit ? __string_result_pairs[i].limit
+                                                                       : EVALUATE_DEFAULT_RECURSION_LIMIT);
+        err = expression_evaluate(&expr, &scope);
+        if (err != __string_result_pairs[i].error)
+            FATAL("expected \"%s\" evaluating \"%s\", got \"%s\"", error_string(__string_result_pairs[i].error),
+                    __string_result_pairs[i].string, error_string(err));
+
+        if (__string_result_pairs[i].result) {
+            char* str = stringify(&expr);
+            if (strcmp(str, __string_result_pairs[i].result) != 0)
+                FATAL("strings do not match! expecting string '%s' got '%s'", __string_result_pairs[i].result, str);
+            free(str);
+        }
+
+        if (call_stack_push(1) != bottom)
+            FATAL("the value stack wasn't emptied");
+        call_stack_pop(1);
+
+        expression_clean(&expr);
+        printf("done\n");
+    }
+
+    /* tail calls don't count towards the limit, so a function that never returns is stopped by a budget */
+    printf("starting test (e(1), with a budget)...");
+    expression_t expr;
+    budget_t budget;
+    budget_init(&budget);
+    budget.max_steps = 100000;
+    scope_set_budget(&scope, &budget);
+    expression_set_recursion_limit(EVALUATE_DEFAULT_RECURSION_LIMIT);
+    if (parse_string("e(n): if(n < 0, 0, e(n + 1))", &expr) || expression_evaluate(&expr, &scope))
+        FATAL("failed to define e");
+    expression_clean(&expr);
+    if (parse_string("e(1)", &expr))
+        FATAL("failed to parse string \"e(1)\"");
+    err = expression_evaluate(&expr, &scope);
+    if (err != ERROR_BUDGET_EXCEEDED)
+        FATAL("expected \"%s\", got \"%s\"", error_string(ERROR_BUDGET_EXCEEDED), error_string(err));
+    expression_clean(&expr);
+    scope_set_budget(&scope, NULL);
+    printf("done\n");
+
+    scope_clean(&scope);
+    call_stack_free();
+}
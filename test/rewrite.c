@@ -0,0 +1,131 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/rewrite.h"
+#include "simplify/expression/simplify.h"
+
+/* the number of generated rules, used to check that matching doesn't slow down as rules are added */
+#define GENERATED_RULES 1000
+
+/* rewrite a string with a rule set, and check the result
+ *
+ * @rules the rules
+ * @string the string to rewrite
+ * @result the expected result
+ * @changed if the expression should have been changed
+ */
+void check(rewrite_rules_t* rules, char* string, char* result, bool changed) {
+    expression_t expr;
+    bool was_changed = false;
+
+    printf("starting test (%s)...", string);
+    error_t err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    err = rewrite_rules_apply(rules, &expr, &was_changed);
+    if (err)
+        FATAL("failed to rewrite \"%s\": %s", string, error_string(err));
+    if (was_changed != changed)
+        FATAL("expected \"%s\" to be %s", string, changed ? "changed" : "unchanged");
+
+    char* str = stringify(&expr);
+    if (strcmp(str, result) != 0)
+        FATAL("strings do not match! expecting string '%s' got '%s'", result, str);
+    free(str);
+
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+int main() {
+    char* rule_strings[] = {
+        "sin(a) ^ 2 + cos(a) ^ 2 = 1",
+        "ln(a * b) = ln(a) + ln(b)",
+        "ln(exp(a)) = a",
+        "f(a, a) = a",
+        "a * 0 = 0",
+        "g(a) = h(a)",
+        "h(a) = g(a)",
+    };
+
+    rewrite_rules_t rules;
+    rewrite_rules_init(&rules);
+    for (int i = 0; i < (int) (sizeof(rule_strings) / sizeof(rule_strings[0])); ++i) {
+        error_t err = rewrite_rules_add_string(&rules, rule_strings[i]);
+        if (err)
+            FATAL("failed to add rule \"%s\": %s", rule_strings[i], error_string(err));
+    }
+
+    /* anything but an equation with a pattern more specific than a variable is rejected */
+    char* bad_rules[] = { "sin(a)", "a = 1", "f(a): a" };
+    for (int i = 0; i < (int) (sizeof(bad_rules) / sizeof(bad_rules[0])); ++i) {
+        if (rewrite_rules_add_string(&rules, bad_rules[i]) != ERROR_INVALID_REWRITE_RULE)
+            FATAL("expected \"%s\" to be an invalid rule", bad_rules[i]);
+    }
+    if (rules.rule_count != sizeof(rule_strings) / sizeof(rule_strings[0]))
+        FATAL("expected %zu rules, got %zu", sizeof(rule_strings) / sizeof(rule_strings[0]), rules.rule_count);
+
+    check(&rules, "sin(x + 1) ^ 2 + cos(x + 1) ^ 2", "1", true);
+    check(&rules, "sin(x) ^ 2 + cos(y) ^ 2", "sin(x) ^ 2 + cos(y) ^ 2", false);
+
+    /* sums and products match with their operands in either order */
+    check(&rules, "cos(y) ^ 2 + sin(y) ^ 2", "1", true);
+    check(&rules, "0 * q + q * 0", "0 + 0", true);
+
+    /* the parts of a replacement are rewritten too */
+    check(&rules, "ln(p * q * r)", "ln(p) + ln(q) + ln(r)", true);
+    check(&rules, "ln(exp(z + 1))", "z + 1", true);
+    check(&rules, "ln(exp(sin(2 * 0) ^ 2 + cos(0) ^ 2))", "1", true);
+
+    /* a variable used twice must match the same expression each time */
+    check(&rules, "f(x + 2, x + 2)", "x + 2", true);
+    check(&rules, "f(x + 2, x + 3)", "f(x + 2, x + 3)", false);
+
+    /* rules that undo each other stop after a fixed number of rewrites */
+    check(&rules, "g(1)", "g(1)", true);
+
+    /* the result is simplified again after it's rewritten */
+    printf("starting test (simplify with rules)...");
+    expression_t expr;
+    parse_string("sin(x) ^ 2 + cos(x) ^ 2 + x + x", &expr);
+    error_t err = expression_simplify_rules(&expr, &rules);
+    if (err)
+        FATAL("failed to simplify: %s", error_string(err));
+    char* str = stringify(&expr);
+    if (strcmp(str, "x * 2 + 1") != 0)
+        FATAL("strings do not match! expecting string 'x * 2 + 1' got '%s'", str);
+    free(str);
+    expression_clean(&expr);
+    printf("done\n");
+    rewrite_rules_clean(&rules);
+
+    /* rules are read from a file in the same format as any other list of expressions */
+    printf("starting test (load)...");
+    FILE* file = tmpfile();
+    fputs("d(a + b) = d(a) + d(b),\nd(a * b) = d(a) * b + a * d(b)", file);
+    rewind(file);
+    rewrite_rules_init(&rules);
+    err = rewrite_rules_load(&rules, file);
+    fclose(file);
+    if (err || rules.rule_count != 2)
+        FATAL("failed to load rules: %s", error_string(err));
+    printf("done\n");
+    check(&rules, "d(x * y + z)", "d(x) * y + x * d(y) + d(z)", true);
+    rewrite_rules_clean(&rules);
+
+    /* finding a rule doesn't depend on how many rules there are */
+    rewrite_rules_init(&rules);
+    for (int i = 0; i < GENERATED_RULES; ++i) {
+        char rule[64];
+        sprintf(rule, "r(a, %d) = a + %d", i, i);
+        err = rewrite_rules_add_string(&rules, rule);
+        if (err)
+            FATAL("failed to add rule \"%s\": %s", rule, error_string(err));
+    }
+    if (rules.node_count > GENERATED_RULES * 2 + 3)
+        FATAL("expected the rules to share their prefix, got %zu nodes", rules.node_count);
+    check(&rules, "r(x, 500)", "x + 500", true);
+    check(&rules, "r(x, 1000)", "r(x, 1000)", false);
+    rewrite_rules_clean(&rules);
+}
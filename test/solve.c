@@ -0,0 +1,317 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include <math.h>
+
+#include "test/test.h"
+#include "simplify/builtins.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/precision.h"
+#include "simplify/expression/solve.h"
+#include "simplify/expression/thread_pool.h"
+
+/* the number of rows in the generated batches, enough to be split across several tasks */
+#define BATCH_ROWS 10000
+
+DEFINE_MPFR_FUNCTION(sin)
+
+/* returns it's argument, it's marked impure so it can't be compiled */
+error_t builtin_func_tick(scope_t* scope, expression_t** out) {
+    *out = malloc(sizeof(expression_t));
+    return scope_get_argument(scope, 0, *out);
+}
+
+/* make a list of parameters from their names
+ *
+ * @names the names, separated by spaces
+ * @return returns the list
+ */
+expression_list_t* parameters(char* names) {
+    char buffer[64];
+    strcpy(buffer, names);
+
+    expression_list_t* list = malloc(sizeof(expression_list_t));
+    expression_list_init(list);
+    for (char* name = strtok(buffer, " "); name; name = strtok(NULL, " "))
+        expression_list_append(list, expression_new_variable(name));
+    return list;
+}
+
+/* solve a string for x
+ *
+ * @solution location to store the solution
+ * @scope the scope to compile the solution in
+ * @string the equation
+ * @names the equation's parameters, separated by spaces
+ * @compiled true if the solution is expected to be compiled
+ */
+void solve(expression_solution_t* solution, scope_t* scope, char* string, char* names, bool compiled) {
+    expression_t expr;
+    if (parse_string(string, &expr))
+        FATAL("failed to parse string \"%s\"", string);
+
+    expression_list_t* params = parameters(names);
+    error_t err = expression_solve(solution, &expr, "x", params, scope);
+    if (err)
+        FATAL("failed to solve \"%s\" for x: %s", string, error_string(err));
+    if (solution->compiled != compiled)
+        FATAL("expected the solution of \"%s\" %sto be compiled", string, compiled ? "" : "not ");
+
+    expression_list_free(params);
+    expression_clean(&expr);
+}
+
+/* evaluate a solution for one row, and check the result
+ *
+ * @solution the solution
+ * @scope the scope to evaluate the solution in
+ * @row the parameters' values
+ * @expected the expected value of x
+ */
+void check_row(expression_solution_t* solution, scope_t* scope, double* row, double expected) {
+    expression_t* arguments[8];
+    for (size_t i = 0; i < solution->parameter_count; ++i)
+        arguments[i] = expression_new_number_d(row[i]);
+
+    expression_t result;
+    error_t err = expression_solution_evaluate(solution, scope, arguments, &result);
+    if (err)
+        FATAL("failed to evaluate the solution: %s", error_string(err));
+    if (!EXPRESSION_IS_NUMBER(&result) || fabs(mpfr_get_d(result.number.value, MPFR_RNDN) - expected) > 1e-9)
+        FATAL("expected x to be %g", expected);
+
+    expression_clean(&result);
+    for (size_t i = 0; i < solution->parameter_count; ++i)
+        expression_free(arguments[i]);
+}
+
+/* evaluate a solution for a batch of rows, and check each result
+ *
+ * @solution the solution
+ * @scope the scope to evaluate the solution in
+ * @rows the number of rows
+ * @x the function the solution is expected to match
+ */
+void check_batch(expression_solution_t* solution, scope_t* scope, size_t rows, double (*x)(const double*)) {
+    double* arguments = malloc(sizeof(double) * rows * solution->parameter_count);
+    double* results = malloc(sizeof(double) * rows);
+    /* roots are only taken to whole powers, so every value is a whole number */
+    for (size_t i = 0; i < rows * solution->parameter_count; ++i)
+        arguments[i] = 1 + (double)(i % 97 % 7);
+
+    error_t err = expression_solution_evaluate_batch(solution, scope, arguments, rows, results);
+    if (err)
+        FATAL("failed to evaluate a batch: %s", error_string(err));
+    for (size_t i = 0; i < rows; ++i) {
+        double expected = x(arguments + i * solution->parameter_count);
+        if (fabs(results[i] - expected) > 1e-9 * fmax(1, fabs(expected)))
+            FATAL("expected row %zu to be %g, got %g", i, expected, results[i]);
+    }
+
+    free(arguments);
+    free(results);
+}
+
+/* find a root of a string numerically, and check it
+ *
+ * @scope the scope to evaluate the equation in
+ * @string the equation
+ * @options how to find the root, or NULL to use the defaults
+ * @expected the expected value of x
+ * @tolerance how far the root found may be from the expected one
+ */
+void check_root(scope_t* scope, char* string, expression_root_options_t* options, double expected, double tolerance) {
+    expression_t expr;
+    printf("starting test (%s)...", string);
+    if (parse_string(string, &expr))
+        FATAL("failed to parse string \"%s\"", string);
+
+    error_t err = expression_find_root(&expr, "x", scope, options);
+    if (err)
+        FATAL("failed to find a root of \"%s\": %s", string, error_string(err));
+    if (!EXPRESSION_IS_VARIABLE(expr.operator.left) || !EXPRESSION_IS_NUMBER(expr.operator.right))
+        FATAL("expected `x = NUMBER`");
+
+    double x = mpfr_get_d(expr.operator.right->number.value, MPFR_RNDN);
+    if (fabs(x - expected) > tolerance)
+        FATAL("expected x to be %.17g, got %.17g", expected, x);
+
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+/* try to find a root of a string numerically, and check the error
+ *
+ * @scope the scope to evaluate the equation in
+ * @string the equation
+ * @expected the expected error
+ */
+void check_root_error(scope_t* scope, char* string, error_t expected) {
+    expression_t expr;
+    printf("starting test (%s)...", string);
+    if (parse_string(string, &expr))
+        FATAL("failed to parse string \"%s\"", string);
+
+    error_t err = expression_find_root(&expr, "x", scope, NULL);
+    if (err != expected)
+        FATAL("expected \"%s\" to fail with \"%s\", got \"%s\"", string, error_string(expected), error_string(err));
+
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+double linear(const double* row) {
+    return (row[2] - row[1]) / row[0];
+}
+
+double root(const double* row) {
+    return pow(row[1], 1 / row[0]);
+}
+
+double scaled(const double* row) {
+    return 6 / row[0];
+}
+
+int main() {
+    scope_t scope;
+    scope_init(&scope);
+    scope_define_internal_function(&scope, "tick", builtin_func_tick, 1, "__arg0");
+    scope_mark_impure(&scope, "tick");
+    EXPORT_BUILTIN_FUNCTION(&scope, sin);
+
+    thread_pool_t pool;
+    if (thread_pool_init(&pool, 4))
+        FATAL("failed to start a thread pool");
+
+    expression_solution_t solution;
+
+    /* an equation is solved once, and it's solution is evaluated for each set of coefficients */
+    printf("starting test (a * x + b = c)...");
+    solve(&solution, &scope, "a * x + b = c", "a b c", true);
+    if (solution.relation != '=' || solution.parameter_count != 3)
+        FATAL("expected `x = VALUE` with 3 parameters");
+    check_row(&solution, &scope, (double[]){ 2, 3, 11 }, 4);
+    check_row(&solution, &scope, (double[]){ -4, 1, 1 }, 0);
+    check_batch(&solution, &scope, BATCH_ROWS, linear);
+
+    /* batches are split across the scope's threads */
+    scope_set_thread_pool(&scope, &pool);
+    size_t spawned = pool.spawned;
+    check_batch(&solution, &scope, BATCH_ROWS, linear);
+    if (pool.spawned == spawned)
+        FATAL("expected the batch to be evaluated in parallel");
+    scope_set_thread_pool(&scope, NULL);
+    expression_solution_clean(&solution);
+    printf("done\n");
+
+    printf("starting test (x ^ a = b)...");
+    solve(&solution, &scope, "x ^ a = b", "a b", true);
+    check_row(&solution, &scope, (double[]){ 3, 8 }, 2);
+    check_batch(&solution, &scope, BATCH_ROWS, root);
+    expression_solution_clean(&solution);
+    printf("done\n");
+
+    /* solutions that can't be compiled are evaluated one row at a time */
+    printf("starting test (tick(a) * x = 6)...");
+    solve(&solution, &scope, "tick(a) * x = 6", "a", false);
+    check_row(&solution, &scope, (double[]){ 2 }, 3);
+    scope_set_thread_pool(&scope, &pool);
+    check_batch(&solution, &scope, 100, scaled);
+    scope_set_thread_pool(&scope, NULL);
+    expression_solution_clean(&solution);
+    printf("done\n");
+
+    /* equations that don't have the variable can't be solved */
+    printf("starting test (errors)...");
+    expression_t expr;
+    parse_string("a + b = 1", &expr);
+    expression_list_t* params = parameters("a b");
+    if (expression_solve(&solution, &expr, "x", params, &scope) != ERROR_VARIABLE_NOT_PRESENT)
+        FATAL("expected \"a + b = 1\" not to be solved for x");
+    expression_list_free(params);
+    expression_clean(&expr);
+
+    parse_string("a * x = 1", &expr);
+    params = malloc(sizeof(expression_list_t));
+    expression_list_init(params);
+    expression_list_append(params, expression_new_number_si(1));
+    if (expression_solve(&solution, &expr, "x", params, &scope) != ERROR_INVALID_IDENTIFIER)
+        FATAL("expected a parameter that isn't a name to be rejected");
+    expression_list_free(params);
+    expression_clean(&expr);
+    printf("done\n");
+
+    /* equations that can't be solved symbolically are solved numerically */
+    check_root(&scope, "x + sin(x) = 2", NULL, 1.1060601577062719, 1e-15);
+    check_root(&scope, "x ^ 3 - 2", NULL, cbrt(2), 1e-15);
+    check_root(&scope, "3 = x * x * x + 2 * x", NULL, 1, 1e-15);
+
+    /* residuals that can't be compiled are evaluated as expressions */
+    expression_root_options_t options;
+    expression_root_options_init(&options);
+    options.guess = 1;
+    check_root(&scope, "tick(x) * x = 9", &options, 3, 1e-15);
+
+    /* the search starts at the guess, so the nearest root is found */
+    options.guess = -10;
+    check_root(&scope, "x * x = 4", &options, -2, 1e-15);
+
+    /* the root is only refined as far as it has to be */
+    options.guess = 0;
+    options.tolerance = 1e-3;
+    check_root(&scope, "x + sin(x) = 2", &options, 1.1060601577062719, 2e-3);
+
+    /* roots are refined past double precision, even if the equation was evaluated before x was solved for.
+        Copies are made at the default precision, so it's raised like `-p` does */
+    printf("starting test (x * x * x + x = 3, 200 bits)...");
+    precision_policy_t policy;
+    precision_policy_init(&policy);
+    precision_policy_set_fixed(&policy, 200);
+    scope_set_precision_policy(&scope, &policy);
+    mpfr_prec_t default_precision = mpfr_get_default_prec();
+    mpfr_set_default_prec(200);
+
+    parse_string("x * x * x + x = 3", &expr);
+    if (expression_evaluate(&expr, &scope) || expression_find_root(&expr, "x", &scope, NULL))
+        FATAL("failed to find a root of \"x * x * x + x = 3\"");
+    if (!EXPRESSION_IS_NUMBER(expr.operator.right))
+        FATAL("expected `x = NUMBER`");
+
+    mpfr_t residual;
+    mpfr_init2(residual, 400);
+    mpfr_pow_ui(residual, expr.operator.right->number.value, 3, MPFR_RNDN);
+    mpfr_add(residual, residual, expr.operator.right->number.value, MPFR_RNDN);
+    mpfr_sub_ui(residual, residual, 3, MPFR_RNDN);
+    mpfr_abs(residual, residual, MPFR_RNDN);
+    if (mpfr_get_prec(expr.operator.right->number.value) != 200 || mpfr_cmp_ui_2exp(residual, 1, -190) > 0)
+        FATAL("expected the root to be accurate to 200 bits, the residual is %g", mpfr_get_d(residual, MPFR_RNDN));
+    mpfr_clear(residual);
+    expression_clean(&expr);
+    mpfr_set_default_prec(default_precision);
+    scope_set_precision_policy(&scope, NULL);
+    printf("done\n");
+
+    check_root_error(&scope, "x ^ 2 + 1", ERROR_NO_ROOT_FOUND);
+    check_root_error(&scope, "x < 1", ERROR_INVALID_OPERATOR);
+    check_root_error(&scope, "y = 1", ERROR_VARIABLE_NOT_PRESENT);
+
+    /* variables are isolated symbolically when they can be */
+    printf("starting test (isolate numeric)...");
+    parse_string("x * 2 = a", &expr);
+    if (expression_isolate_variable_numeric(&expr, "x", &scope, NULL))
+        FATAL("failed to isolate x in \"x * 2 = a\"");
+    if (!EXPRESSION_IS_OPERATOR(expr.operator.right))
+        FATAL("expected x to be isolated symbolically");
+    expression_clean(&expr);
+
+    parse_string("x + sin(x) = 2", &expr);
+    if (expression_isolate_variable_numeric(&expr, "x", &scope, NULL))
+        FATAL("failed to isolate x in \"x + sin(x) = 2\"");
+    if (!EXPRESSION_IS_NUMBER(expr.operator.right))
+        FATAL("expected x to be found numerically");
+    expression_clean(&expr);
+    printf("done\n");
+
+    thread_pool_clean(&pool);
+    scope_clean(&scope);
+    return 0;
+}
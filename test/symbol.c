@@ -0,0 +1,80 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/symbol.h"
+
+/* evaluate a string in a scope, and check the result
+ *
+ * @scope the scope to evaluate the string in
+ * @string the string to evaluate
+ * @result the expected result
+ */
+void check(scope_t* scope, char* string, char* result) {
+    expression_t expr;
+    error_t err;
+
+    printf("starting test (%s)...", string);
+    err = parse_string(string, &expr);
+    if (err)
+        FATAL("failed to parse string \"%s\": %s", string, error_string(err));
+
+    err = expression_evaluate(&expr, scope);
+    if (err)
+        FATAL("failed to evaluate \"%s\": %s", string, error_string(err));
+
+    char* str = stringify(&expr);
+    if (strcmp(str, result) != 0)
+        FATAL("strings do not match! expecting string '%s' got '%s'", result, str);
+
+    free(str);
+    expression_clean(&expr);
+    printf("done\n");
+}
+
+int main() {
+    scope_t scope;
+    scope_t other;
+    scope_init(&scope);
+    scope_init(&other);
+
+    symbol_t* a = symbol_intern("a");
+    if (symbol_intern("a") != a)
+        FATAL("the same name was interned twice");
+
+    check(&scope, "a: 1", "1");
+    check(&scope, "f(x): x + a", "x + a");
+    check(&scope, "f(1)", "2");
+    if (a->definitions != 1 || a->scope != &scope)
+        FATAL("expected `a` to be bound to it's definition");
+
+    /* redefining a name replaces the definition in it's slot */
+    size_t index = a->index;
+    check(&scope, "a: 5", "5");
+    if (a->index != index || a->definitions != 1)
+        FATAL("expected `a` to keep it's slot");
+    check(&scope, "f(1)", "6");
+
+    /* an argument with the same name shadows the definition while the function runs */
+    check(&scope, "g(a): f(1)", "f(1)");
+    check(&scope, "g(10)", "11");
+    if (a->definitions != 1)
+        FATAL("expected the argument's definition to be removed, got %zu definitions", a->definitions);
+    check(&scope, "f(1)", "6");
+
+    /* local definitions shadow it too */
+    check(&scope, "h(x): f(x) + (a: 100)", "f(x) + (a : 100)");
+    check(&scope, "h(1)", "201");
+    check(&scope, "f(2)", "7");
+
+    /* definitions in another scope aren't visible */
+    check(&other, "a", "a");
+    check(&other, "f(1)", "f(1)");
+
+    scope_clean(&other);
+    scope_clean(&scope);
+    if (a->definitions != 0 || a->scope)
+        FATAL("expected `a` to be undefined");
+
+    symbol_table_free();
+}
@@ -0,0 +1,57 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/thread_pool.h"
+
+/* compute a fibonacci number, spawning one of the two recursive calls */
+typedef struct {
+    thread_pool_t* pool;
+    int            n;
+    long           result;
+} fibonacci_t;
+
+void fibonacci(void* data) {
+    fibonacci_t* fib = data;
+    if (fib->n < 2) {
+        fib->result = fib->n;
+        return;
+    }
+
+    thread_pool_task_t task;
+    fibonacci_t left  = { fib->pool, fib->n - 1, 0 };
+    fibonacci_t right = { fib->pool, fib->n - 2, 0 };
+
+    thread_pool_spawn(fib->pool, &task, fibonacci, &left);
+    fibonacci(&right);
+    thread_pool_join(fib->pool, &task);
+
+    fib->result = left.result + right.result;
+}
+
+int main() {
+    size_t workers[] = { 0, 1, 2, 4, 8 };
+
+    for (int i = 0; i < (int) (sizeof(workers) / sizeof(workers[0])); ++i) {
+        thread_pool_t pool;
+
+        printf("starting test #%d (%zu workers)...", i + 1, workers[i]);
+        error_t err = thread_pool_init(&pool, workers[i]);
+        if (err)
+            FATAL("failed to start the pool: %s", error_string(err));
+
+        for (int j = 0; j < 4; ++j) {
+            fibonacci_t fib = { &pool, 20, 0 };
+            fibonacci(&fib);
+            if (fib.result != 6765)
+                FATAL("expected fibonacci(20) to be 6765, got %ld", fib.result);
+        }
+
+        if (pool.spawned != 4 * 10945)
+            FATAL("expected %d tasks to be spawned, got %zu", 4 * 10945, pool.spawned);
+        if (workers[i] <= 1 && pool.stolen)
+            FATAL("tasks were stolen with one worker");
+
+        thread_pool_clean(&pool);
+        printf("done\n");
+    }
+}
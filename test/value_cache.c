@@ -0,0 +1,130 @@
+/* Copyright Ian Shehadeh 2018 */
+
+#include "test/test.h"
+#include "simplify/expression/evaluate.h"
+#include "simplify/expression/value_cache.h"
+#include "simplify/expression/symbol.h"
+
+/* the number of times count was given a number, it's used to check which values are evaluated again */
+static int _g_calls;
+
+/* the number of times clock was given a number */
+static int _g_ticks;
+
+/* returns it's argument, once it's a number */
+error_t builtin_func_count(scope_t* scope, expression_t** out) {
+    expression_t input;
+    scope_get_argument(scope, 0, &input);
+    if (!EXPRESSION_IS_NUMBER(&input)) {
+        expression_clean(&input);
+        return ERROR_NO_ERROR;
+    }
+
+    ++_g_calls;
+    *out = malloc(sizeof(expression_t));
+    **out = input;
+    return ERROR_NO_ERROR;
+}
+
+/* returns the number of times it's been called with a number, it's marked impure */
+error_t builtin_func_clock(scope_t* scope, expression_t** out) {
+    expression_t input;
+    scope_get_argument(scope, 0, &input);
+    bool number = EXPRESSION_IS_NUMBER(&input);
+    expression_clean(&input);
+    if (!number)
+        return ERROR_NO_ERROR;
+
+    mpfr_ptr value = malloc(sizeof(mpfr_t));
+    mpfr_init_set_si(value, ++_g_ticks, MPFR_RNDN);
+    *out = expression_new_number(value);
+    return ERROR_NO_ERROR;
+}
+
+int main() {
+    struct {
+        char*  string;
+        char*  result;
+        int    calls;
+    } __string_result_pairs[] = {
+        { "base: count(rate) * 2", "count(rate) * 2", 0 },
+        { "other: count(size)", "count(size)", 0 },
+        { "rate: 3", "3", 0 },
+        { "size: 4", "4", 0 },
+        { "base", "6", 1 },
+        { "base", "6", 0 },
+        { "base * other", "24", 1 },
+        { "base * other", "24", 0 },
+
+        /* only the values that use the new definition are evaluated again */
+        { "rate: 5", "5", 0 },
+        { "base + other", "14", 1 },
+        { "other: count(width)", "count(width)", 0 },
+        { "width: 2", "2", 0 },
+        { "base + other", "12", 1 },
+
+        /* values that use other values are evaluated again when anything they reach changes */
+        { "outer: count(inner)", "count(inner)", 0 },
+        { "inner: count(leaf) + 1", "count(leaf) + 1", 0 },
+        { "leaf: 1", "1", 0 },
+        { "outer", "2", 2 },
+        { "outer", "2", 0 },
+        { "leaf: 2", "2", 0 },
+        { "outer", "3", 2 },
+        { "inner", "3", 0 },
+
+        /* an argument with the same name is used instead of the definition, and the cached value isn't changed */
+        { "g(rate): base", "base", 0 },
+        { "g(10)", "20", 1 },
+        { "base", "10", 0 },
+
+        /* values that use an impure definition are evaluated every time */
+        { "stamp: clock(tick) + count(tick)", "clock(tick) + count(tick)", 0 },
+        { "tick: 0", "0", 0 },
+        { "stamp", "1", 1 },
+        { "stamp", "2", 1 },
+    };
+
+    error_t err;
+    scope_t scope;
+    value_cache_t cache;
+
+    scope_init(&scope);
+    value_cache_init(&cache);
+    scope_set_value_cache(&scope, &cache);
+    scope_define_internal_function(&scope, "count", builtin_func_count, 1, "__arg0");
+    scope_define_internal_function(&scope, "clock", builtin_func_clock, 1, "__arg0");
+    scope_mark_impure(&scope, "clock");
+
+    for (int i = 0; i < (int) (sizeof(__string_result_pairs) / sizeof(__string_result_pairs[0])); ++i) {
+        expression_t expr;
+
+        printf("starting test #%d (%s)...", i + 1, __string_result_pairs[i].string);
+        err = parse_string(__string_result_pairs[i].string, &expr);
+        if (err)
+            FATAL("failed to parse string \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        _g_calls = 0;
+        err = expression_evaluate(&expr, &scope);
+        if (err)
+            FATAL("failed to evaluate \"%s\": %s", __string_result_pairs[i].string, error_string(err));
+
+        if (_g_calls != __string_result_pairs[i].calls)
+            FATAL("expected %d calls, got %d", __string_result_pairs[i].calls, _g_calls);
+
+        char* str = stringify(&expr);
+        if (strcmp(str, __string_result_pairs[i].result) != 0)
+            FATAL("strings do not match! expecting string '%s' got '%s'", __string_result_pairs[i].result, str);
+
+        free(str);
+        expression_clean(&expr);
+        printf("done\n");
+    }
+
+    if (cache.hits == 0 || cache.invalidations == 0)
+        FATAL("expected the cache to be hit, and values to be invalidated");
+
+    value_cache_clean(&cache);
+    scope_clean(&scope);
+    symbol_table_free();
+}